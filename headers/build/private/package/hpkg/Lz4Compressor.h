@@ -0,0 +1 @@
+#include <../private/package/hpkg/Lz4Compressor.h>
@@ -230,13 +230,23 @@ namespace agg
 
         //--------------------------------------------------------------------
         template<class Scanline> bool sweep_scanline(Scanline& sl)
+        {
+            return sweep_scanline(sl, m_scan_y);
+        }
+
+        //--------------------------------------------------------------------
+        // Sweeps the scanline scan_y of the sorted cells (see sort()), and
+        // advances scan_y instead of the rasterizer's own position, so that
+        // several threads can sweep different scanlines at the same time.
+        template<class Scanline> bool sweep_scanline(Scanline& sl,
+                                                     int& scan_y) const
         {
             for(;;)
             {
-                if(m_scan_y > m_outline.max_y()) return false;
+                if(scan_y > m_outline.max_y()) return false;
                 sl.reset_spans();
-                unsigned num_cells = m_outline.scanline_num_cells(m_scan_y);
-                const cell_aa* const* cells = m_outline.scanline_cells(m_scan_y);
+                unsigned num_cells = m_outline.scanline_num_cells(scan_y);
+                const cell_aa* const* cells = m_outline.scanline_cells(scan_y);
                 int cover = 0;
 
                 while(num_cells)
@@ -278,11 +288,11 @@ namespace agg
                 }
         
                 if(sl.num_spans()) break;
-                ++m_scan_y;
+                ++scan_y;
             }
 
-            sl.finalize(m_scan_y);
-            ++m_scan_y;
+            sl.finalize(scan_y);
+            ++scan_y;
             return true;
         }
 
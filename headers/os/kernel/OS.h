@@ -821,6 +821,39 @@ extern ssize_t		wait_for_objects(object_wait_info* infos, int numInfos);
 extern ssize_t		wait_for_objects_etc(object_wait_info* infos, int numInfos,
 						uint32 flags, bigtime_t timeout);
 
+/* event queue flags, to be or'ed to the events mask */
+enum {
+	B_EVENT_LEVEL_TRIGGERED		= 0x4000,	/* report the events as long as
+											   they persist */
+	B_EVENT_ONE_SHOT			= 0x8000	/* report the events only once */
+};
+
+typedef struct event_wait_info {
+	int32		object;						/* ID of the object */
+	uint16		type;						/* type of the object */
+	uint16		events;						/* events mask */
+	void*		user_data;					/* returned with the events */
+} event_wait_info;
+
+/* An event queue keeps objects selected across calls, so that waiting for
+   events doesn't need to select all of them again each time. The queue is a
+   file descriptor, and is deleted with close().
+   event_queue_select() adds objects to the queue, or changes the events or
+   user data of objects already in it; an events mask of 0 removes an object.
+   If the object could not be selected, its events field is set to
+   B_EVENT_INVALID.
+   event_queue_wait() waits until at least one of the selected events or, if
+   given, the timeout occurred, and returns the number of infos it filled in.
+   By default, events are edge triggered: they are reported once each time
+   they occur. Objects that reported B_EVENT_INVALID are removed from the
+   queue automatically. */
+
+extern int			create_event_queue(int openFlags);
+extern status_t		event_queue_select(int queue, event_wait_info* infos,
+						int numInfos);
+extern ssize_t		event_queue_wait(int queue, event_wait_info* infos,
+						int numInfos, uint32 flags, bigtime_t timeout);
+
 
 #ifdef __cplusplus
 }
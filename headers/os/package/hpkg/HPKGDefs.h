@@ -135,7 +135,9 @@ enum BHPKGAttributeID {
 // compression types
 enum {
 	B_HPKG_COMPRESSION_NONE	= 0,
-	B_HPKG_COMPRESSION_ZLIB	= 1
+	B_HPKG_COMPRESSION_ZLIB	= 1,
+	B_HPKG_COMPRESSION_LZ4	= 2
+		// only supported for file and attribute data, not for the sections
 };
 
 
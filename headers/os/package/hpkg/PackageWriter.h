@@ -50,6 +50,7 @@ public:
 			status_t			Init(const char* fileName, uint32 flags = 0);
 			status_t			SetInstallPath(const char* installPath);
 			void				SetCheckLicenses(bool checkLicenses);
+			status_t			SetCompression(uint32 compression);
 			status_t			AddEntry(const char* fileName, int fd = -1);
 			status_t			Finish();
 
@@ -79,5 +79,7 @@ struct tcphdr {
 	/* don't use TH_PUSH */
 #define TCP_NOOPT				0x08
 	/* don't use any TCP options */
+#define TCP_CONGESTION			0x10
+	/* congestion control algorithm, "newreno" or "cubic" */
 
 #endif	/* NETINET_TCP_H */
@@ -33,6 +33,7 @@ class LinkReceiver {
 		bool HasMessages() const;
 		bool NeedsReply() const;
 		int32 Code() const;
+		status_t RewindMessage();
 
 		virtual status_t Read(void* data, ssize_t size);
 		status_t ReadString(char** _string, size_t* _length = NULL);
@@ -60,6 +61,7 @@ class LinkReceiver {
 		int32	fReplySize;	//size of current reply message
 
 		status_t fReadError;	//Read failed for current message
+		bool	fReadArea;	//data of current message was read from an area
 };
 
 }	// namespace BPrivate
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2013, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SERVER_GLYPH_ADVANCES_H
+#define SERVER_GLYPH_ADVANCES_H
+
+
+#include <SupportDefs.h>
+
+
+// The app_server publishes the advances of the glyphs it has measured for
+// BFont::StringWidth() and BFont::GetEscapements() in an area that the
+// applications map read-only, so that they can measure strings without
+// asking the server again.
+//
+// Entries are only ever added; their key is set last. When the advances
+// change, the server makes the generation odd, clears all entries, and
+// makes it even again. A reader must see the same even generation before
+// and after its lookups.
+
+static const int32 kGlyphAdvanceFontCount = 64;
+static const int32 kGlyphAdvanceSlotCount = 16384;
+	// must be a power of two
+static const int32 kGlyphAdvanceMaxProbes = 16;
+
+struct glyph_advance_font {
+	uint16		family_id;
+	uint16		style_id;
+	float		size;
+};
+
+struct glyph_advance_slot {
+	vint32		key;
+	float		advance;
+};
+
+struct server_glyph_advances {
+	vint32				generation;
+	vint32				font_count;
+	glyph_advance_font	fonts[kGlyphAdvanceFontCount];
+	glyph_advance_slot	slots[kGlyphAdvanceSlotCount];
+};
+
+
+static inline int32
+glyph_advance_key(int32 fontIndex, uint32 charCode)
+{
+	// Unicode code points need 21 bits, 0 marks an unused slot
+	return ((fontIndex + 1) << 21) | (charCode & 0x1fffff);
+}
+
+
+static inline int32
+glyph_advance_slot_index(int32 key)
+{
+	return ((uint32)key * 2654435761UL) & (kGlyphAdvanceSlotCount - 1);
+}
+
+
+#endif	/* SERVER_GLYPH_ADVANCES_H */
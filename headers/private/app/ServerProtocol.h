@@ -147,6 +147,7 @@ enum {
 	AS_GET_HAS_GLYPHS,
 	AS_GET_GLYPH_SHAPES,
 	AS_GET_TRUNCATED_STRINGS,
+	AS_GET_GLYPH_ADVANCES,
 
 	// Screen methods
 	AS_VALID_SCREEN_ID,
@@ -882,6 +882,7 @@
 #define B_FS_HAS_SELF_HEALING_LINKS		FSSH_B_FS_HAS_SELF_HEALING_LINKS
 #define B_FS_HAS_ALIASES				FSSH_B_FS_HAS_ALIASES
 #define B_FS_SUPPORTS_NODE_MONITORING	FSSH_B_FS_SUPPORTS_NODE_MONITORING
+#define B_FS_CACHES_MISSING_ENTRIES		FSSH_B_FS_CACHES_MISSING_ENTRIES
 
 #define fs_info	fssh_fs_info
 
@@ -21,6 +21,7 @@
 #define FSSH_B_FS_HAS_SELF_HEALING_LINKS	0x00080000
 #define FSSH_B_FS_HAS_ALIASES				0x00100000
 #define FSSH_B_FS_SUPPORTS_NODE_MONITORING	0x00200000
+#define FSSH_B_FS_CACHES_MISSING_ENTRIES	0x00400000
 
 typedef struct fssh_fs_info {
 	fssh_dev_t	dev;								/* volume dev_t */
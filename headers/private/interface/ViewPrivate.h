@@ -22,6 +22,10 @@ const static uint32 kDeleteReplicant = 'JAHA';
 
 const static uint32 kWorkspacesViewFlag = 0x40000000UL;
 	// was/is _B_RESERVED1_ in View.h
+const static uint32 kRetainedDrawingViewFlag = 0x00200000UL;
+	// was/is _B_RESERVED7_ in View.h; lets the app_server keep what the
+	// view drew during its last updates, and replay it when the view is
+	// exposed again
 
 enum {
 	B_VIEW_FONT_BIT				= 0x00000001,
@@ -31,5 +31,8 @@ const window_type kWindowScreenWindow = window_type(1026);
 const uint32 kWindowScreenFlag = 0x10000;
 const uint32 kAcceptKeyboardFocusFlag = 0x40000;
 	// Accept keyboard input even if B_AVOID_FOCUS is set
+const uint32 kBackingStoreWindowFlag = 0x1000000;
+	// Keep the window contents in an offscreen bitmap, and copy them back
+	// to the screen when covered parts of the window are exposed again
 
 #endif // _WINDOW_PRIVATE_H
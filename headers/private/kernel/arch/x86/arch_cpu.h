@@ -131,6 +131,9 @@
 #define IA32_FEATURE_AMD_EXT_3DNOWEXT	(1 << 30) // 3DNow! extensions
 #define IA32_FEATURE_AMD_EXT_3DNOW		(1 << 31) // 3DNow!
 
+// x86 features from cpuid eax 0x80000001, ecx register (AMD)
+#define IA32_FEATURE_AMD_EXT_TOPOEXT	(1 << 22) // topology extensions
+
 // x86 defined features from cpuid eax 6, eax register
 // reference http://www.intel.com/Assets/en_US/PDF/appnote/241618.pdf (Table 5-11)
 #define IA32_FEATURE_DTS	(1 << 0) //Digital Thermal Sensor
@@ -31,6 +31,16 @@ namespace BKernel {
 using BKernel::Thread;
 
 
+/* CPU topology levels, from the innermost to the outermost one */
+enum cpu_topology_level {
+	CPU_TOPOLOGY_SMT,
+	CPU_TOPOLOGY_CORE,
+	CPU_TOPOLOGY_PACKAGE,
+
+	CPU_TOPOLOGY_LEVELS
+};
+
+
 /* CPU local data structure */
 
 typedef struct cpu_ent {
@@ -56,6 +66,10 @@ typedef struct cpu_ent {
 	bool			invoke_scheduler_if_idle;
 	bool			disabled;
 
+	// topology information, filled in by the architecture specific code; the
+	// IDs are only unique within the enclosing level
+	int32			topology_id[CPU_TOPOLOGY_LEVELS];
+
 	// arch-specific stuff
 	arch_cpu_info arch;
 } cpu_ent __attribute__((aligned(64)));
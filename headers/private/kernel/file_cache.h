@@ -16,6 +16,7 @@
 
 #define CACHE_CLEAR			1	// takes no parameters
 #define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_GET_STATS		3	// fills in a file_cache_stats structure
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +24,14 @@
 #define FILE_CACHE_LOADED_COMPLETELY 	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+struct file_cache_stats {
+	int64		read_ahead_streams;	// sequential reads detected
+	int64		read_ahead_pages;	// pages read ahead
+	int64		read_ahead_hits;	// pages read that had been read ahead
+	int64		read_ahead_misses;	// pages read sequentially that had not
+	int64		read_ahead_wasted;	// pages read ahead, but never read
+};
+
 struct cache_module_info {
 	module_info	info;
 
@@ -15,18 +15,21 @@ struct DepotMagazine;
 
 typedef struct object_depot {
 	rw_lock					outer_lock;
-	spinlock				inner_lock;
+	spinlock				pop_lock;
 	DepotMagazine*			full;
 	DepotMagazine*			empty;
-	size_t					full_count;
-	size_t					empty_count;
+	vint32					full_count;
+	vint32					empty_count;
 	size_t					max_count;
 	size_t					magazine_capacity;
+	size_t					max_magazine_capacity;
+	vint32					contention;
+	vint64					store_misses;
 	struct depot_cpu_store*	stores;
 	void*					cookie;
 
-	void (*return_object)(struct object_depot* depot, void* cookie,
-		void* object, uint32 flags);
+	void (*return_objects)(struct object_depot* depot, void* cookie,
+		void** objects, uint32 count, uint32 flags);
 } object_depot;
 
 
@@ -36,8 +39,8 @@ extern "C" {
 
 status_t object_depot_init(object_depot* depot, size_t capacity,
 	size_t maxCount, uint32 flags, void* cookie,
-	void (*returnObject)(object_depot* depot, void* cookie, void* object,
-		uint32 flags));
+	void (*returnObjects)(object_depot* depot, void* cookie, void** objects,
+		uint32 count, uint32 flags));
 void object_depot_destroy(object_depot* depot, uint32 flags);
 
 void* object_depot_obtain(object_depot* depot);
@@ -45,6 +48,9 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+void object_depot_get_stats(object_depot* depot, int64* _obtained,
+	int64* _stored, int64* _storeMisses);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
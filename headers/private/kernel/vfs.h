@@ -123,6 +123,8 @@ status_t	vfs_entry_ref_to_path(dev_t device, ino_t inode, const char *leaf,
 status_t	vfs_get_cwd(dev_t *_mountID, ino_t *_vnodeID);
 void		vfs_unlock_vnode_if_locked(struct file_descriptor *descriptor);
 status_t	vfs_unmount(dev_t mountID, uint32 flags);
+status_t	vfs_entry_cache_remove_missing(dev_t mountID, ino_t dirID,
+				const char *name);
 status_t	vfs_disconnect_vnode(dev_t mountID, ino_t vnodeID);
 void		vfs_free_unused_vnodes(int32 level);
 
@@ -264,6 +266,7 @@ ssize_t		_user_send(int socket, const void *data, size_t length, int flags);
 ssize_t		_user_sendto(int socket, const void *data, size_t length, int flags,
 				const struct sockaddr *address, socklen_t addressLength);
 ssize_t		_user_sendmsg(int socket, const struct msghdr *message, int flags);
+ssize_t		_user_sendfile(int socket, int fd, off_t *offset, size_t count);
 status_t	_user_getsockopt(int socket, int level, int option, void *value,
 				socklen_t *_length);
 status_t	_user_setsockopt(int socket, int level, int option,
@@ -162,6 +162,9 @@ public:
 									{ return -1; } // no restriction
 	virtual	int32				MaxPagesPerAsyncWrite() const
 									{ return -1; } // no restriction
+	virtual	uint32				FaultClusterSize() const
+									{ return 1; }
+										// pages read at once on a fault
 
 	virtual	status_t			Fault(struct VMAddressSpace *aspace,
 									off_t offset);
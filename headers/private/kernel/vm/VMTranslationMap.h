@@ -36,6 +36,13 @@ struct VMTranslationMap {
 									vm_page_reservation* reservation) = 0;
 	virtual	status_t			Unmap(addr_t start, addr_t end) = 0;
 
+	// large pages -- a map that doesn't support them returns 0
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			MapLarge(addr_t virtualAddress,
+									phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									vm_page_reservation* reservation);
+
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
@@ -37,6 +37,8 @@ status_t vm_mark_page_range_inuse(page_num_t startPage, page_num_t length);
 void vm_page_free(struct VMCache *cache, struct vm_page *page);
 void vm_page_set_state(struct vm_page *page, int state);
 void vm_page_requeue(struct vm_page *page, bool tail);
+void vm_page_mark_accessed(struct vm_page *page);
+bool vm_page_refault(struct vm_page *page);
 
 // get some data about the number of pages in the system
 page_num_t vm_page_num_pages(void);
@@ -44,6 +46,7 @@ page_num_t vm_page_num_free_pages(void);
 page_num_t vm_page_num_available_pages(void);
 page_num_t vm_page_num_unused_pages(void);
 void vm_page_get_stats(system_info *info);
+void vm_page_get_memory_info(struct system_memory_info *info);
 phys_addr_t vm_page_max_address();
 
 status_t vm_page_write_modified_page_range(struct VMCache *cache,
@@ -199,6 +199,9 @@ enum {
 #define VM_PAGE_ALLOC_STATE	0x00000007
 #define VM_PAGE_ALLOC_CLEAR	0x00000010
 #define VM_PAGE_ALLOC_BUSY	0x00000020
+#define VM_PAGE_ALLOC_TRY	0x00000040
+	// vm_page_allocate_page_run() only: don't wait for pages, don't steal
+	// cached pages, and fail silently
 
 
 inline void
@@ -21,11 +21,19 @@ typedef struct select_info {
 	uint16				selected_events;
 } select_info;
 
+typedef struct select_sync_ops {
+	status_t			(*notify)(struct select_info* info, uint16 events);
+	void				(*free)(struct select_sync* sync);
+} select_sync_ops;
+
 typedef struct select_sync {
 	vint32				ref_count;
 	sem_id				sem;
 	uint32				count;
 	struct select_info*	set;
+	const struct select_sync_ops* ops;
+		// NULL for select(), poll(), and wait_for_objects(), otherwise
+		// used instead of the semaphore, and to free the sync object
 } select_sync;
 
 #define SELECT_FLAG(type) (1L << (type - 1))
@@ -40,6 +48,11 @@ extern void		put_select_sync(select_sync* sync);
 extern status_t	notify_select_events(select_info* info, uint16 events);
 extern void		notify_select_events_list(select_info* list, uint16 events);
 
+extern status_t	select_object(uint32 type, int32 object, select_info* info,
+					bool kernel);
+extern status_t	deselect_object(uint32 type, int32 object, select_info* info,
+					bool kernel);
+
 extern ssize_t	_user_wait_for_objects(object_wait_info* userInfos,
 					int numInfos, uint32 flags, bigtime_t timeout);
 
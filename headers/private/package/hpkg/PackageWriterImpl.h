@@ -47,6 +47,7 @@ public:
 			status_t			Init(const char* fileName, uint32 flags);
 			status_t			SetInstallPath(const char* installPath);
 			void				SetCheckLicenses(bool checkLicenses);
+			status_t			SetCompression(uint32 compression);
 			status_t			AddEntry(const char* fileName, int fd = -1);
 			status_t			Finish();
 
@@ -127,7 +128,7 @@ private:
 
 			status_t			_WriteUncompressedData(BDataReader& dataReader,
 									off_t size, uint64 writeOffset);
-			status_t			_WriteZlibCompressedData(
+			status_t			_WriteCompressedData(
 									BDataReader& dataReader,
 									off_t size, uint64 writeOffset,
 									uint64& _compressedSize);
@@ -153,6 +154,7 @@ private:
 			BPackageInfo		fPackageInfo;
 			BString				fInstallPath;
 			bool				fCheckLicenses;
+			uint32				fCompression;
 };
 
 
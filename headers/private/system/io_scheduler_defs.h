@@ -0,0 +1,66 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_IO_SCHEDULER_DEFS_H
+#define _SYSTEM_IO_SCHEDULER_DEFS_H
+
+
+#include <OS.h>
+
+
+// scheduling modes
+#define IO_SCHEDULER_MODE_NONE			0
+	// the scheduler does not support modes (e.g. the IOCache)
+#define IO_SCHEDULER_MODE_ROUND_ROBIN	1
+	// every thread gets the same bandwidth per round
+#define IO_SCHEDULER_MODE_FAIR			2
+	// every team gets the same bandwidth per round, which is split among
+	// its threads
+#define IO_SCHEDULER_MODE_DEADLINE		3
+	// like round robin, but requests are served out of order once they
+	// waited longer than their expiry time, reads are preferred over writes,
+	// and adjacent requests of other threads are merged into the same batch
+
+// the latency histogram bucket i counts the requests that took less than
+// (64 << i) microseconds (and at least half of that), the last one all that
+// took longer
+#define IO_SCHEDULER_LATENCY_BUCKETS	16
+
+struct io_scheduler_stats {
+	int64		read_requests;
+	int64		write_requests;
+	int64		read_bytes;
+	int64		write_bytes;
+	int64		expired_requests;	// finished after their expiry time
+	int64		merged_requests;	// batched with the adjacent one before
+	int32		queue_depth;		// requests scheduled, but not finished yet
+	int32		max_queue_depth;
+	int64		read_latency[IO_SCHEDULER_LATENCY_BUCKETS];
+	int64		write_latency[IO_SCHEDULER_LATENCY_BUCKETS];
+};
+
+struct io_scheduler_info {
+	int32		id;
+	uint32		mode;
+	char		name[B_OS_NAME_LENGTH];
+	io_scheduler_stats stats;
+};
+
+struct io_scheduler_mode_control {
+	int32		id;					// -1 to change the default and all
+	uint32		mode;
+};
+
+
+// temporary/optional I/O scheduler syscall API
+#define IO_SCHEDULER_SYSCALLS "io_scheduler"
+
+#define IO_SCHEDULER_GET_NEXT_INFO	1
+	// gets an io_scheduler_info; the ID must be set to the one of the
+	// previously returned scheduler, or 0 to get the first one
+#define IO_SCHEDULER_SET_MODE		2
+	// gets an io_scheduler_mode_control
+
+
+#endif	/* _SYSTEM_IO_SCHEDULER_DEFS_H */
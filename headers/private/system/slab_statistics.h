@@ -0,0 +1,33 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_SLAB_STATISTICS_H
+#define _SYSTEM_SLAB_STATISTICS_H
+
+#include <OS.h>
+
+
+#define SLAB_STATISTICS					"slab statistics"
+#define GET_SLAB_CACHE_STATISTICS		0x01
+	// Fills the buffer with as many slab_cache_statistics as fit and returns
+	// the total number of object caches.
+
+
+typedef struct slab_cache_statistics {
+	char	name[32];
+	size_t	object_size;
+	size_t	usage;				// bytes used by the slabs
+	size_t	total_objects;
+	size_t	used_objects;
+	uint32	flags;
+	uint32	magazine_capacity;	// 0, if the cache doesn't have a depot
+	int64	allocations;
+	int64	frees;
+	int64	allocation_misses;	// allocations that had to go to the slabs
+	int64	free_misses;		// frees that had to go to the slabs
+	int64	depot_contention;
+} slab_cache_statistics;
+
+
+#endif	/* _SYSTEM_SLAB_STATISTICS_H */
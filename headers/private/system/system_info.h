@@ -11,6 +11,8 @@
 
 #define B_MEMORY_INFO	'memo'
 
+#define SWAP_CLUSTER_BUCKETS	6
+
 struct system_memory_info {
 	uint64		max_memory;
 	uint64		free_memory;
@@ -20,7 +22,25 @@ struct system_memory_info {
 	uint64		block_cache_memory;
 	uint32		page_faults;
 
-	// TODO: add active/inactive page counts, swap in/out, ...
+	// swap statistics
+	uint64		swap_in_pages;
+	uint64		swap_in_reads;
+	bigtime_t	swap_in_time;		// total time spent reading from swap
+	uint64		read_ahead_pages;	// read in along with a faulting page
+	uint64		swap_out_pages;
+	uint64		swap_out_writes;
+	uint64		swap_out_clusters[SWAP_CLUSTER_BUCKETS];
+		// bucket i counts the writes of [1 << i, 2 << i) pages
+
+	// page replacement statistics
+	uint64		active_pages;
+	uint64		inactive_pages;
+	uint64		evicted_pages;		// cached pages evicted
+	uint64		refault_pages;		// evicted pages read in again
+	uint64		refault_activations;
+		// refaulted pages that were activated as part of the working set
+	uint64		cache_activations;
+		// cached pages activated, since they were accessed a second time
 };
 
 
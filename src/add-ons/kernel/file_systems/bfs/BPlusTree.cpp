@@ -885,6 +885,29 @@ BPlusTree::ModeToKeyType(mode_t mode)
 }
 
 
+type_code
+BPlusTree::KeyTypeToTypeCode(int32 keyType)
+{
+	switch (keyType) {
+		case BPLUSTREE_STRING_TYPE:
+			return B_STRING_TYPE;
+		case BPLUSTREE_INT32_TYPE:
+			return B_INT32_TYPE;
+		case BPLUSTREE_UINT32_TYPE:
+			return B_UINT32_TYPE;
+		case BPLUSTREE_INT64_TYPE:
+			return B_INT64_TYPE;
+		case BPLUSTREE_UINT64_TYPE:
+			return B_UINT64_TYPE;
+		case BPLUSTREE_FLOAT_TYPE:
+			return B_FLOAT_TYPE;
+		case BPLUSTREE_DOUBLE_TYPE:
+			return B_DOUBLE_TYPE;
+	}
+	return 0;
+}
+
+
 //	#pragma mark - TransactionListener implementation
 
 
@@ -950,31 +973,8 @@ int32
 BPlusTree::_CompareKeys(const void* key1, int keyLength1, const void* key2,
 	int keyLength2)
 {
-	type_code type = 0;
-	switch (fHeader.DataType()) {
-	    case BPLUSTREE_STRING_TYPE:
-	    	type = B_STRING_TYPE;
-	    	break;
-		case BPLUSTREE_INT32_TYPE:
-	    	type = B_INT32_TYPE;
-	    	break;
-		case BPLUSTREE_UINT32_TYPE:
-	    	type = B_UINT32_TYPE;
-	    	break;
-		case BPLUSTREE_INT64_TYPE:
-	    	type = B_INT64_TYPE;
-	    	break;
-		case BPLUSTREE_UINT64_TYPE:
-	    	type = B_UINT64_TYPE;
-	    	break;
-		case BPLUSTREE_FLOAT_TYPE:
-	    	type = B_FLOAT_TYPE;
-	    	break;
-		case BPLUSTREE_DOUBLE_TYPE:
-	    	type = B_DOUBLE_TYPE;
-	    	break;
-	}
-   	return compareKeys(type, key1, keyLength1, key2, keyLength2);
+	return compareKeys(KeyTypeToTypeCode(fHeader.DataType()), key1,
+		keyLength1, key2, keyLength2);
 }
 
 
@@ -1590,10 +1590,20 @@ BPlusTree::_SplitNode(bplustree_node* node, off_t nodeOffset,
 	// Prepare the key that will be inserted in the parent node which
 	// is either the dropped key or the last of the other node.
 	// If it's the dropped key, "newKey" was already set earlier.
+	// For leaves, the key only needs to separate both nodes, so we can use
+	// a shorter one if possible.
 
-	if (newKey == NULL)
+	if (newKey == NULL) {
 		newKey = other->KeyAt(other->NumKeys() - 1, &newLength);
 
+		if (node->NumKeys() > 0) {
+			uint16 firstLength;
+			uint8* firstKey = node->KeyAt(0, &firstLength);
+			newKey = (uint8*)_Separator(newKey, newLength, firstKey,
+				firstLength, &newLength);
+		}
+	}
+
 	memcpy(key, newKey, newLength);
 	*_keyLength = newLength;
 	*_value = otherOffset;
@@ -1605,6 +1615,42 @@ BPlusTree::_SplitNode(bplustree_node* node, off_t nodeOffset,
 }
 
 
+/*!	Returns the shortest key that separates two neighbouring leaves in
+	their parent node, ie. a key that is larger than or equal to \a left,
+	the last key of the left node, and smaller than \a right, the first
+	key of the right node.
+	For strings, this is the shortest prefix of \a right that is still
+	larger than \a left, if that is shorter than \a left itself. Since any
+	key in that range is a valid separator, this does not change the
+	on-disk format, it only lets the index nodes hold more keys.
+	For all other types, \a left is returned.
+*/
+const uint8*
+BPlusTree::_Separator(const uint8* left, uint16 leftLength,
+	const uint8* right, uint16 rightLength, uint16* _length)
+{
+	*_length = leftLength;
+	if (fHeader.DataType() != BPLUSTREE_STRING_TYPE)
+		return left;
+
+	uint16 common = 0;
+	while (common < leftLength && common < rightLength
+		&& left[common] == right[common])
+		common++;
+
+	// The comparisons take care of the trailing null bytes that are
+	// ignored when comparing strings
+	uint16 length = common + 1;
+	if (length >= leftLength || length >= rightLength
+		|| _CompareKeys(right, length, right, rightLength) >= 0
+		|| _CompareKeys(left, leftLength, right, length) > 0)
+		return left;
+
+	*_length = length;
+	return right;
+}
+
+
 /*!	This inserts a key into the tree. The changes made to the tree will
 	all be part of the \a transaction.
 	You need to have the inode write locked.
@@ -2487,6 +2533,367 @@ BPlusTree::_ValidateChild(TreeCheck& check, CachedNode& cached, uint32 level,
 //	#pragma mark -
 
 
+static const int32 kMaxBuildLevels = 16;
+static const int32 kNodesPerTransaction = 512;
+
+
+/*!	Bulk-loads an empty B+tree with keys that are added in ascending order.
+	Instead of inserting the keys one by one, the leaves are filled up
+	completely one after the other, and the index nodes are built bottom-up
+	from the separators of their children at the same time.
+	The new nodes are not part of the tree before Finish() makes them its
+	root, so the builder may commit its work in several transactions
+	without ever leaving an inconsistent tree behind; if it fails, though,
+	the nodes committed so far are lost until the tree is emptied again.
+*/
+TreeBuilder::TreeBuilder(BPlusTree* tree)
+	:
+	fTree(tree),
+	fLeaf(tree),
+	fLeafOffset(BPLUSTREE_NULL),
+	fLastKeyLength(0),
+	fLevels(NULL),
+	fLevelCount(0),
+	fAllocatedNodes(0),
+	fStatus(B_BAD_VALUE)
+{
+	Inode* stream = tree->fStream;
+	if (stream == NULL)
+		return;
+
+	fLevels = new(std::nothrow) level_state[kMaxBuildLevels];
+	if (fLevels == NULL) {
+		fStatus = B_NO_MEMORY;
+		return;
+	}
+
+	fStatus = fTransaction.Start(stream->GetVolume(), stream->BlockNumber());
+	if (fStatus != B_OK)
+		return;
+
+	stream->WriteLockInTransaction(fTransaction);
+
+	// only an empty tree can be bulk-loaded
+	CachedNode cached(tree);
+	const bplustree_node* root = cached.SetTo(tree->fHeader.RootNode());
+	if (root == NULL)
+		fStatus = B_IO_ERROR;
+	else if (!root->IsLeaf() || root->NumKeys() != 0)
+		fStatus = B_BAD_VALUE;
+}
+
+
+TreeBuilder::~TreeBuilder()
+{
+	fLeaf.Unset();
+	delete[] fLevels;
+}
+
+
+/*!	Adds the \a key to the tree. The keys must be added in ascending order;
+	if the tree allows duplicates, equal keys may follow each other.
+*/
+status_t
+TreeBuilder::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (fStatus != B_OK)
+		return fStatus;
+
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	bplustree_node* leaf = fLeaf.Node();
+	if (leaf != NULL) {
+		int32 compare = fTree->_CompareKeys(key, keyLength, fLastKey,
+			fLastKeyLength);
+		if (compare < 0)
+			RETURN_ERROR(B_BAD_VALUE);
+		if (compare == 0) {
+			if (!fTree->fAllowDuplicates)
+				return B_NAME_IN_USE;
+
+			// Adding a duplicate may allocate a new duplicate node or
+			// fragment; there is no cheap way to know, so every one of
+			// them counts as an allocation.
+			if (fAllocatedNodes >= kNodesPerTransaction) {
+				fStatus = _SplitTransaction();
+				if (fStatus != B_OK)
+					return fStatus;
+
+				leaf = fLeaf.Node();
+			}
+
+			fStatus = fTree->_InsertDuplicate(fTransaction, fLeaf, leaf,
+				leaf->NumKeys() - 1, value);
+			fAllocatedNodes++;
+			return fStatus;
+		}
+	}
+
+	if (leaf == NULL || !_Fits(leaf, keyLength)) {
+		fStatus = _StartLeaf(key, keyLength);
+		if (fStatus != B_OK)
+			return fStatus;
+
+		leaf = fLeaf.Node();
+	}
+
+	fTree->_InsertKey(leaf, leaf->NumKeys(), (uint8*)key, keyLength, value);
+
+	memcpy(fLastKey, key, keyLength);
+	fLastKeyLength = keyLength;
+	return B_OK;
+}
+
+
+/*!	Completes the index levels, and replaces the empty root node of the tree
+	with the root of the new nodes.
+*/
+status_t
+TreeBuilder::Finish()
+{
+	if (fStatus != B_OK)
+		return fStatus;
+
+	fStatus = B_NO_INIT;
+		// the builder cannot be used anymore
+
+	if (fLeafOffset == BPLUSTREE_NULL) {
+		// nothing has been added, the tree just stays empty
+		return fTransaction.Done();
+	}
+
+	fLeaf.Unset();
+
+	// The last node of each level becomes the overflow link of the last
+	// node in the level above it
+	off_t child = fLeafOffset;
+	CachedNode cached(fTree);
+
+	for (int32 level = 0; level < fLevelCount; level++) {
+		level_state& state = fLevels[level];
+		if (state.pending != BPLUSTREE_NULL) {
+			status_t status = _AppendPending(level);
+			if (status != B_OK)
+				return status;
+		}
+
+		bplustree_node* node = cached.SetToWritable(fTransaction,
+			state.offset, false);
+		if (node == NULL)
+			return B_IO_ERROR;
+
+		node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(child);
+		child = state.offset;
+	}
+
+	bplustree_header* header = cached.SetToWritableHeader(fTransaction);
+	if (header == NULL)
+		return B_IO_ERROR;
+
+	off_t oldRoot = header->RootNode();
+	header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(child);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(fLevelCount + 1);
+
+	// the old root node is not needed anymore
+	if (cached.SetToWritable(fTransaction, oldRoot, false) == NULL)
+		return B_IO_ERROR;
+
+	status_t status = cached.Free(fTransaction, oldRoot);
+	if (status != B_OK)
+		return status;
+
+	cached.Unset();
+	return fTransaction.Done();
+}
+
+
+/*!	Allocates a new node, and links it to the \a previousOffset node of the
+	same level, if any.
+*/
+status_t
+TreeBuilder::_Allocate(off_t previousOffset, off_t* _offset)
+{
+	CachedNode cached(fTree);
+	bplustree_node* node;
+	status_t status = cached.Allocate(fTransaction, &node, _offset);
+	if (status != B_OK)
+		return status;
+
+	fAllocatedNodes++;
+
+	if (previousOffset == BPLUSTREE_NULL)
+		return B_OK;
+
+	node->left_link = HOST_ENDIAN_TO_BFS_INT64(previousOffset);
+
+	bplustree_node* previous = cached.SetToWritable(fTransaction,
+		previousOffset, false);
+	if (previous == NULL)
+		return B_IO_ERROR;
+
+	previous->right_link = HOST_ENDIAN_TO_BFS_INT64(*_offset);
+	return B_OK;
+}
+
+
+/*!	Starts a new leaf for the \a key, and adds the previous leaf to its
+	parent.
+*/
+status_t
+TreeBuilder::_StartLeaf(const uint8* key, uint16 keyLength)
+{
+	if (fAllocatedNodes >= kNodesPerTransaction) {
+		status_t status = _SplitTransaction();
+		if (status != B_OK)
+			return status;
+	}
+
+	off_t offset;
+	status_t status = _Allocate(fLeafOffset, &offset);
+	if (status != B_OK)
+		return status;
+
+	if (fLeafOffset != BPLUSTREE_NULL) {
+		uint16 length;
+		const uint8* separator = fTree->_Separator(fLastKey, fLastKeyLength,
+			key, keyLength, &length);
+
+		status = _AddToLevel(0, separator, length, fLeafOffset);
+		if (status != B_OK)
+			return status;
+	}
+
+	fLeafOffset = offset;
+	if (fLeaf.SetToWritable(fTransaction, offset, false) == NULL)
+		return B_IO_ERROR;
+
+	return B_OK;
+}
+
+
+/*!	Adds the \a child node to the index \a level. All keys of the child
+	must be smaller than or equal to \a key.
+	The child is kept pending until the next one arrives, as the last child
+	of a node has to be put into its overflow link.
+*/
+status_t
+TreeBuilder::_AddToLevel(int32 level, const uint8* key, uint16 keyLength,
+	off_t child)
+{
+	if (level >= kMaxBuildLevels)
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (level == fLevelCount) {
+		fLevels[level].offset = BPLUSTREE_NULL;
+		fLevels[level].pending = BPLUSTREE_NULL;
+		fLevelCount++;
+	}
+
+	level_state& state = fLevels[level];
+	if (state.pending != BPLUSTREE_NULL) {
+		status_t status = _AppendPending(level);
+		if (status != B_OK)
+			return status;
+	}
+
+	memcpy(state.pendingKey, key, keyLength);
+	state.pendingLength = keyLength;
+	state.pending = child;
+	return B_OK;
+}
+
+
+/*!	Adds the pending child of the \a level to its current node. If the node
+	is full, the child becomes its overflow link instead, the node is added
+	to the level above, and a new node is started.
+*/
+status_t
+TreeBuilder::_AppendPending(int32 level)
+{
+	level_state& state = fLevels[level];
+	status_t status;
+
+	if (state.offset == BPLUSTREE_NULL) {
+		status = _Allocate(BPLUSTREE_NULL, &state.offset);
+		if (status != B_OK)
+			return status;
+	}
+
+	CachedNode cached(fTree);
+	bplustree_node* node = cached.SetToWritable(fTransaction, state.offset,
+		false);
+	if (node == NULL)
+		return B_IO_ERROR;
+
+	if (_Fits(node, state.pendingLength)) {
+		fTree->_InsertKey(node, node->NumKeys(), state.pendingKey,
+			state.pendingLength, state.pending);
+		state.pending = BPLUSTREE_NULL;
+		return B_OK;
+	}
+
+	node->overflow_link = HOST_ENDIAN_TO_BFS_INT64(state.pending);
+	cached.Unset();
+
+	status = _AddToLevel(level + 1, state.pendingKey, state.pendingLength,
+		state.offset);
+	if (status != B_OK)
+		return status;
+
+	off_t offset;
+	status = _Allocate(state.offset, &offset);
+	if (status != B_OK)
+		return status;
+
+	state.offset = offset;
+	state.pending = BPLUSTREE_NULL;
+	return B_OK;
+}
+
+
+/*!	Commits the nodes written so far, and starts a new transaction, so that
+	a large tree does not need a transaction that is larger than the log.
+*/
+status_t
+TreeBuilder::_SplitTransaction()
+{
+	fLeaf.Unset();
+
+	status_t status = fTransaction.Done();
+	if (status != B_OK)
+		return status;
+
+	Inode* stream = fTree->fStream;
+	status = fTransaction.Start(stream->GetVolume(), stream->BlockNumber());
+	if (status != B_OK)
+		return status;
+
+	stream->WriteLockInTransaction(fTransaction);
+	fAllocatedNodes = 0;
+
+	if (fLeafOffset != BPLUSTREE_NULL
+		&& fLeaf.SetToWritable(fTransaction, fLeafOffset, false) == NULL)
+		return B_IO_ERROR;
+
+	return B_OK;
+}
+
+
+bool
+TreeBuilder::_Fits(const bplustree_node* node, uint16 keyLength) const
+{
+	return int32(key_align(sizeof(bplustree_node) + node->AllKeyLength()
+			+ keyLength)
+		+ (node->NumKeys() + 1) * (sizeof(uint16) + sizeof(off_t)))
+			< fTree->fNodeSize;
+}
+
+
+//	#pragma mark -
+
+
 TreeIterator::TreeIterator(BPlusTree* tree)
 	:
 	fTree(tree),
@@ -135,6 +135,7 @@ enum bplustree_traversing {
 template<class T> class Stack;
 class BPlusTree;
 class TreeIterator;
+class TreeBuilder;
 class CachedNode;
 class Inode;
 struct TreeCheck;
@@ -254,6 +255,7 @@ public:
 
 	static	int32				TypeCodeToKeyType(type_code code);
 	static	int32				ModeToKeyType(mode_t mode);
+	static	type_code			KeyTypeToTypeCode(int32 keyType);
 
 protected:
 	virtual void				TransactionDone(bool success);
@@ -288,6 +290,9 @@ private:
 									off_t otherOffset, uint16* _keyIndex,
 									uint8* key, uint16* _keyLength,
 									off_t* _value);
+			const uint8*		_Separator(const uint8* left,
+									uint16 leftLength, const uint8* right,
+									uint16 rightLength, uint16* _length);
 
 			status_t			_RemoveDuplicate(Transaction& transaction,
 									const bplustree_node* node,
@@ -313,6 +318,7 @@ private:
 
 private:
 			friend class TreeIterator;
+			friend class TreeBuilder;
 			friend class CachedNode;
 			friend class TreeCheck;
 
@@ -381,6 +387,50 @@ private:
 };
 
 
+class TreeBuilder {
+public:
+								TreeBuilder(BPlusTree* tree);
+								~TreeBuilder();
+
+			status_t			InitCheck() const { return fStatus; }
+
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Finish();
+
+private:
+			struct level_state {
+				off_t			offset;
+				off_t			pending;
+				uint16			pendingLength;
+				uint8			pendingKey[BPLUSTREE_MAX_KEY_LENGTH];
+			};
+
+			status_t			_Allocate(off_t previousOffset,
+									off_t* _offset);
+			status_t			_StartLeaf(const uint8* key,
+									uint16 keyLength);
+			status_t			_AddToLevel(int32 level, const uint8* key,
+									uint16 keyLength, off_t child);
+			status_t			_AppendPending(int32 level);
+			status_t			_SplitTransaction();
+			bool				_Fits(const bplustree_node* node,
+									uint16 keyLength) const;
+
+private:
+			BPlusTree*			fTree;
+			Transaction			fTransaction;
+			CachedNode			fLeaf;
+			off_t				fLeafOffset;
+			uint16				fLastKeyLength;
+			uint8				fLastKey[BPLUSTREE_MAX_KEY_LENGTH];
+			level_state*		fLevels;
+			int32				fLevelCount;
+			int32				fAllocatedNodes;
+			status_t			fStatus;
+};
+
+
 //	#pragma mark - BPlusTree's inline functions
 //	(most of them may not be needed)
 
@@ -36,6 +36,22 @@
 // be improved a lot. Furthermore, the allocation policies used here should
 // have some real world tests.
 
+// Since the file cache needs to know where the data of a file goes as soon
+// as it is written, we cannot delay the allocation until the data is flushed.
+// Instead, every file that is being written gets a reservation window of
+// free blocks behind its last run. Its next allocations are taken from there,
+// and other allocations avoid it, so that files that are written at the same
+// time don't interleave their block runs. The window grows every time a file
+// fills it up.
+
+static const uint32 kMinReservationWindow = 64 * 1024;
+static const uint32 kAppendReservationWindow = 1024 * 1024;
+static const uint32 kMaxReservationWindow = 8 * 1024 * 1024;
+	// in bytes
+static const int32 kMaxReservationSearchGroups = 4;
+	// how many allocation groups may be looked at to find room for a
+	// reservation window
+
 #if BFS_TRACING && !defined(BFS_SHELL)
 namespace BFSBlockTracing {
 
@@ -169,16 +185,46 @@ private:
 #endif
 
 
+struct check_index_entry {
+	off_t				value;
+	type_code			type;
+	uint16				length;
+
+	uint8* Key() const { return (uint8*)(this + 1); }
+	size_t Size() const { return SizeFor(length); }
+
+	static size_t SizeFor(uint16 length)
+		{ return (sizeof(check_index_entry) + length + 7) & ~7; }
+};
+
+
 struct check_index {
 	check_index()
 		:
-		inode(NULL)
+		inode(NULL),
+		type(0),
+		entries(NULL),
+		entries_size(0),
+		entries_capacity(0),
+		entry_count(0),
+		insert_directly(false)
 	{
 	}
 
+	~check_index()
+	{
+		free(entries);
+	}
+
 	char				name[B_FILE_NAME_LENGTH];
 	block_run			run;
 	Inode*				inode;
+	type_code			type;
+	uint8*				entries;
+	size_t				entries_size;
+	size_t				entries_capacity;
+	int32				entry_count;
+	bool				insert_directly;
 };
 
 
@@ -236,9 +282,15 @@ public:
 	uint32 NumBlocks() const { return fNumBlocks; }
 	int32 Start() const { return fStart; }
 
+	bool HasReservations() const { return !fReservations.IsEmpty(); }
+	inline void NextReservation(int32 bit,
+		const allocation_reservation* owner, int32& start, int32& end);
+
 private:
 	friend class BlockAllocator;
 
+	typedef DoublyLinkedList<allocation_reservation> ReservationList;
+
 	uint32	fNumBits;
 	uint32	fNumBlocks;
 	int32	fStart;
@@ -248,6 +300,8 @@ private:
 	int32	fLargestStart;
 	int32	fLargestLength;
 	bool	fLargestValid;
+
+	ReservationList fReservations;
 };
 
 
@@ -401,6 +455,29 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 }
 
 
+/*!	Returns the range [\a start, \a end) of the first reservation for another
+	file than the one \a owner belongs to, that ends after \a bit. If there is
+	none, both are set to INT32_MAX.
+	Assumes that the block bitmap lock is hold.
+*/
+void
+AllocationGroup::NextReservation(int32 bit,
+	const allocation_reservation* owner, int32& start, int32& end)
+{
+	start = INT32_MAX;
+	end = INT32_MAX;
+
+	ReservationList::Iterator iterator = fReservations.GetIterator();
+	while (allocation_reservation* reservation = iterator.Next()) {
+		if (reservation != owner && reservation->start < start
+			&& reservation->start + reservation->length > bit) {
+			start = reservation->start;
+			end = reservation->start + reservation->length;
+		}
+	}
+}
+
+
 /*!	Allocates the specified run in the allocation group.
 	Doesn't check if the run is valid or already allocated partially, nor
 	does it maintain the free ranges hints or the volume's used blocks count.
@@ -537,6 +614,7 @@ BlockAllocator::BlockAllocator(Volume* volume)
 	:
 	fVolume(volume),
 	fGroups(NULL),
+	fReservationCount(0),
 	fCheckBitmap(NULL),
 	fCheckCookie(NULL)
 {
@@ -757,6 +835,16 @@ BlockAllocator::Uninitialize()
 status_t
 BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 	uint16 start, uint16 maximum, uint16 minimum, block_run& run)
+{
+	return _AllocateBlocks(transaction, groupIndex, start, maximum, minimum,
+		run, NULL);
+}
+
+
+status_t
+BlockAllocator::_AllocateBlocks(Transaction& transaction, int32 groupIndex,
+	uint16 start, uint16 maximum, uint16 minimum, block_run& run,
+	allocation_reservation* reservation)
 {
 	if (maximum == 0)
 		return B_BAD_VALUE;
@@ -769,6 +857,14 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 
 	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
 
+	// If we are to reserve blocks for the file, we look for a range that
+	// can hold its reservation window as well
+	int32 wanted = maximum;
+	if (reservation != NULL) {
+		wanted = min_c((int32)maximum + reservation->window,
+			MAX_BLOCK_RUN_LENGTH);
+	}
+
 	// Find the block_run that can fulfill the request best
 	int32 bestGroup = -1;
 	int32 bestStart = -1;
@@ -789,7 +885,10 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		if (start < group.fFirstFree)
 			start = group.fFirstFree;
 
-		if (group.fLargestValid) {
+		// The free ranges hint doesn't know about reserved blocks
+		bool hasReservations = group.HasReservations();
+
+		if (group.fLargestValid && !hasReservations) {
 			if (group.fLargestLength < bestLength)
 				continue;
 
@@ -799,7 +898,7 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 					bestStart = group.fLargestStart;
 					bestLength = group.fLargestLength;
 
-					if (bestLength >= maximum)
+					if (bestLength >= wanted)
 						break;
 				}
 
@@ -818,7 +917,9 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		int32 groupLargestStart = -1;
 		int32 groupLargestLength = -1;
 		int32 currentBit = start;
-		bool canFindGroupLargest = start == 0;
+		int32 reservedStart = -1;
+		int32 reservedEnd = -1;
+		bool canFindGroupLargest = start == 0 && !hasReservations;
 
 		for (; block < group.NumBlocks(); block++) {
 			if (cached.SetTo(group, block) < B_OK)
@@ -830,14 +931,24 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 			// find a block large enough to hold the allocation
 			for (uint32 bit = start % bitsPerFullBlock;
 					bit < cached.NumBlockBits(); bit++) {
-				if (!cached.IsUsed(bit)) {
+				bool used = cached.IsUsed(bit);
+				if (!used && hasReservations) {
+					// blocks reserved for another file are considered used
+					if (currentBit >= reservedEnd) {
+						group.NextReservation(currentBit, reservation,
+							reservedStart, reservedEnd);
+					}
+					used = currentBit >= reservedStart;
+				}
+
+				if (!used) {
 					if (currentLength == 0) {
 						// start new range
 						currentStart = currentBit;
 					}
 
 					// have we found a range large enough to hold numBlocks?
-					if (++currentLength >= maximum) {
+					if (++currentLength >= wanted) {
 						bestGroup = groupIndex;
 						bestStart = currentStart;
 						bestLength = currentLength;
@@ -871,7 +982,7 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 			T(Block("alloc-out", block, cached.Block(),
 				fVolume->BlockSize(), groupIndex, currentStart));
 
-			if (bestLength >= maximum) {
+			if (bestLength >= wanted) {
 				canFindGroupLargest = false;
 				break;
 			}
@@ -899,7 +1010,8 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 			group.fLargestValid = true;
 		}
 
-		if (bestLength >= maximum)
+		if (bestLength >= wanted
+			|| (bestLength >= maximum && i >= kMaxReservationSearchGroups))
 			break;
 	}
 
@@ -908,9 +1020,11 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 	if (bestLength < minimum)
 		return B_DEVICE_FULL;
 
-	if (bestLength > maximum)
+	int32 reserved = 0;
+	if (bestLength > maximum) {
+		reserved = min_c(bestLength, wanted) - maximum;
 		bestLength = maximum;
-	else if (minimum > 1) {
+	} else if (minimum > 1) {
 		// make sure bestLength is a multiple of minimum
 		bestLength = round_down(bestLength, minimum);
 	}
@@ -920,12 +1034,71 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 
 	CHECK_ALLOCATION_GROUP(bestGroup);
 
-	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(bestGroup);
-	run.start = HOST_ENDIAN_TO_BFS_INT16(bestStart);
-	run.length = HOST_ENDIAN_TO_BFS_INT16(bestLength);
+	if (reservation != NULL) {
+		// Remember the rest of the range for the next allocations of the file
+		_ReleaseReservation(*reservation);
+
+		if (reserved > 0) {
+			reservation->group = bestGroup;
+			reservation->start = bestStart + bestLength;
+			reservation->length = reserved;
+			fGroups[bestGroup].fReservations.Add(reservation);
+			fReservationCount++;
+		}
+	}
+
+	_FinishAllocation(bestGroup, bestStart, bestLength, run);
+	return B_OK;
+}
+
+
+/*!	Allocates \a numBlocks blocks from the start of the given
+	\a reservation, and shrinks it accordingly.
+	Assumes that the block bitmap lock is hold.
+*/
+status_t
+BlockAllocator::_AllocateReserved(Transaction& transaction,
+	allocation_reservation& reservation, uint16 numBlocks, block_run& run)
+{
+	AllocationGroup& group = fGroups[reservation.group];
+	uint16 start = reservation.start;
+	uint16 length = min_c(numBlocks, reservation.length);
+
+	if (group.Allocate(transaction, start, length) != B_OK)
+		RETURN_ERROR(B_IO_ERROR);
+
+	CHECK_ALLOCATION_GROUP(reservation.group);
+
+	int32 groupIndex = reservation.group;
+	reservation.start += length;
+	reservation.length -= length;
+
+	if (reservation.length == 0) {
+		// The file used up its reservation completely, so it will get a
+		// larger one next time
+		_ReleaseReservation(reservation);
+		reservation.window = min_c((uint32)reservation.window * 2,
+			kMaxReservationWindow >> fVolume->BlockShift());
+	}
+
+	_FinishAllocation(groupIndex, start, length, run);
+	return B_OK;
+}
+
+
+/*!	Sets \a run to the given range that has just been allocated, and updates
+	the volume's used blocks count.
+*/
+void
+BlockAllocator::_FinishAllocation(int32 group, uint16 start, uint16 length,
+	block_run& run)
+{
+	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(group);
+	run.start = HOST_ENDIAN_TO_BFS_INT16(start);
+	run.length = HOST_ENDIAN_TO_BFS_INT16(length);
 
 	fVolume->SuperBlock().used_blocks
-		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + bestLength);
+		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + length);
 		// We are not writing back the disk's superblock - it's
 		// either done by the journaling code, or when the disk
 		// is unmounted.
@@ -938,7 +1111,6 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		run.Length());
 
 	T(Allocate(run));
-	return B_OK;
 }
 
 
@@ -1016,7 +1188,34 @@ BlockAllocator::Allocate(Transaction& transaction, Inode* inode,
 		group = inode->BlockRun().AllocationGroup() + 1;
 	}
 
-	return AllocateBlocks(transaction, group, start, numBlocks, minimum, run);
+	RecursiveLocker locker(fLock);
+
+	status_t status;
+	if (inode->IsFile() && minimum == 1) {
+		// File data is taken from the file's reservation, if it has one
+		allocation_reservation& reservation = inode->Reservation();
+		if (reservation.length > 0) {
+			return _AllocateReserved(transaction, reservation, numBlocks,
+				run);
+		}
+
+		if (reservation.window == 0)
+			reservation.window = kMinReservationWindow >> fVolume->BlockShift();
+
+		status = _AllocateBlocks(transaction, group, start, numBlocks, minimum,
+			run, &reservation);
+	} else
+		status = AllocateBlocks(transaction, group, start, numBlocks, minimum,
+			run);
+
+	if (status == B_DEVICE_FULL && fReservationCount > 0) {
+		// The reserved blocks are needed for something more important now
+		_ReleaseAllReservations();
+		status = AllocateBlocks(transaction, group, start, numBlocks, minimum,
+			run);
+	}
+
+	return status;
 }
 
 
@@ -1078,6 +1277,84 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 }
 
 
+/*!	Drops the block reservation of the \a inode, if it has one. This should
+	be called whenever the file is not being written to anymore.
+*/
+void
+BlockAllocator::ReleaseReservation(Inode* inode)
+{
+	RecursiveLocker lock(fLock);
+	_ReleaseReservation(inode->Reservation());
+}
+
+
+/*!	Tells the allocator that the \a inode has been opened for writing.
+*/
+void
+BlockAllocator::AddWriter(Inode* inode)
+{
+	RecursiveLocker lock(fLock);
+	inode->Reservation().writers++;
+}
+
+
+/*!	Tells the allocator that a cookie that had the \a inode open for writing
+	has been closed. When the last one is gone, its reservation is dropped.
+*/
+void
+BlockAllocator::RemoveWriter(Inode* inode)
+{
+	RecursiveLocker lock(fLock);
+
+	allocation_reservation& reservation = inode->Reservation();
+	if (reservation.writers > 0 && --reservation.writers > 0)
+		return;
+
+	_ReleaseReservation(reservation);
+}
+
+
+/*!	Lets the \a inode start with a larger reservation window, as files that
+	are opened for appending are likely to grow a lot.
+*/
+void
+BlockAllocator::PrepareForAppending(Inode* inode)
+{
+	RecursiveLocker lock(fLock);
+
+	allocation_reservation& reservation = inode->Reservation();
+	reservation.window = max_c(reservation.window,
+		kAppendReservationWindow >> fVolume->BlockShift());
+}
+
+
+void
+BlockAllocator::_ReleaseReservation(allocation_reservation& reservation)
+{
+	if (reservation.length == 0)
+		return;
+
+	fGroups[reservation.group].fReservations.Remove(&reservation);
+	reservation.length = 0;
+	fReservationCount--;
+}
+
+
+void
+BlockAllocator::_ReleaseAllReservations()
+{
+	for (int32 i = 0; i < fNumGroups; i++) {
+		AllocationGroup& group = fGroups[i];
+		while (allocation_reservation* reservation
+				= group.fReservations.RemoveHead()) {
+			reservation->length = 0;
+		}
+	}
+
+	fReservationCount = 0;
+}
+
+
 size_t
 BlockAllocator::BitmapSize() const
 {
@@ -1371,6 +1648,15 @@ BlockAllocator::CheckNextNode(check_control* control)
 					continue;
 				}
 
+				if (fCheckCookie->pass == BFS_CHECK_PASS_INDEX) {
+					// All index entries have been collected
+					status_t status = _WriteIndices();
+					if (status != B_OK) {
+						fCheckCookie->control.status = status;
+						return status;
+					}
+				}
+
 				fCheckCookie->control.status = B_ENTRY_NOT_FOUND;
 				return B_ENTRY_NOT_FOUND;
 			}
@@ -2046,11 +2332,20 @@ BlockAllocator::_PrepareIndices()
 			continue;
 		}
 
+		// The index stays locked until the check is stopped, so that
+		// nobody sees the incomplete index, or can change it before the
+		// collected entries have been written (see _WriteIndices()).
+		rw_lock_write_lock(&inode->Lock());
+
 		status = tree->MakeEmpty();
-		if (status != B_OK)
+		if (status != B_OK) {
+			rw_lock_write_unlock(&inode->Lock());
 			return status;
+		}
 
 		index->inode = inode;
+		index->type = BPlusTree::KeyTypeToTypeCode(
+			BPlusTree::ModeToKeyType(inode->Mode()));
 		vnode.Keep();
 		count++;
 	}
@@ -2065,65 +2360,235 @@ BlockAllocator::_FreeIndices()
 	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
 		check_index* index = fCheckCookie->indices.Array()[i];
 		if (index->inode != NULL) {
+			rw_lock_write_unlock(&index->inode->Lock());
 			put_vnode(fVolume->FSVolume(),
 				fVolume->ToVnode(index->inode->BlockRun()));
 		}
+		delete index;
 	}
 	fCheckCookie->indices.MakeEmpty();
 }
 
 
+/*!	Collects the index entries of the \a inode. The indices are only
+	written when all inodes have been visited, see _WriteIndices().
+*/
 status_t
 BlockAllocator::_AddInodeToIndex(Inode* inode)
 {
-	Transaction transaction(fVolume, inode->BlockNumber());
-
 	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
 		check_index* index = fCheckCookie->indices.Array()[i];
 		if (index->inode == NULL)
 			continue;
 
-		index->inode->WriteLockInTransaction(transaction);
-
-		BPlusTree* tree = index->inode->Tree();
-		if (tree == NULL)
-			return B_ERROR;
-
-		status_t status = B_OK;
+		uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+		size_t keyLength;
 
 		if (!strcmp(index->name, "name")) {
-			if (inode->InNameIndex()) {
-				char name[B_FILE_NAME_LENGTH];
-				if (inode->GetName(name, B_FILE_NAME_LENGTH) != B_OK)
-					return B_ERROR;
+			if (!inode->InNameIndex())
+				continue;
 
-				status = tree->Insert(transaction, name, inode->ID());
-			}
+			if (inode->GetName((char*)key, sizeof(key)) != B_OK)
+				return B_ERROR;
+
+			keyLength = strlen((char*)key);
 		} else if (!strcmp(index->name, "last_modified")) {
-			if (inode->InLastModifiedIndex()) {
-				status = tree->Insert(transaction, inode->OldLastModified(),
-					inode->ID());
-			}
+			if (!inode->InLastModifiedIndex())
+				continue;
+
+			int64 modified = inode->OldLastModified();
+			memcpy(key, &modified, sizeof(modified));
+			keyLength = sizeof(modified);
 		} else if (!strcmp(index->name, "size")) {
-			if (inode->InSizeIndex())
-				status = tree->Insert(transaction, inode->Size(), inode->ID());
+			if (!inode->InSizeIndex())
+				continue;
+
+			int64 size = inode->Size();
+			memcpy(key, &size, sizeof(size));
+			keyLength = sizeof(size);
 		} else {
-			uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
-			size_t keyLength = BPLUSTREE_MAX_KEY_LENGTH;
+			keyLength = BPLUSTREE_MAX_KEY_LENGTH;
 			if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
-					&keyLength) == B_OK) {
-				status = tree->Insert(transaction, key, keyLength, inode->ID());
-			}
+					&keyLength) != B_OK)
+				continue;
 		}
 
+		status_t status = _AddIndexEntry(index, key, keyLength, inode->ID());
 		if (status != B_OK)
 			return status;
 	}
 
+	return B_OK;
+}
+
+
+/*!	Remembers the entry, so that the index can be bulk-loaded later on. If
+	there is not enough memory left for this, the entry is inserted into the
+	index right away.
+*/
+status_t
+BlockAllocator::_AddIndexEntry(check_index* index, const uint8* key,
+	uint16 keyLength, off_t value)
+{
+	size_t size = check_index_entry::SizeFor(keyLength);
+
+	if (!index->insert_directly
+		&& index->entries_size + size > index->entries_capacity) {
+		size_t capacity = max_c(2 * index->entries_capacity, 65536);
+		uint8* entries = (uint8*)realloc(index->entries, capacity);
+		if (entries != NULL) {
+			index->entries = entries;
+			index->entries_capacity = capacity;
+		} else
+			index->insert_directly = true;
+	}
+
+	if (index->insert_directly)
+		return _InsertIndexEntry(index, key, keyLength, value);
+
+	check_index_entry* entry
+		= (check_index_entry*)(index->entries + index->entries_size);
+	entry->value = value;
+	entry->type = index->type;
+	entry->length = keyLength;
+	memcpy(entry->Key(), key, keyLength);
+
+	index->entries_size += size;
+	index->entry_count++;
+	return B_OK;
+}
+
+
+status_t
+BlockAllocator::_InsertIndexEntry(check_index* index, const uint8* key,
+	uint16 keyLength, off_t value)
+{
+	Transaction transaction(fVolume, index->inode->BlockNumber());
+	index->inode->WriteLockInTransaction(transaction);
+
+	BPlusTree* tree = index->inode->Tree();
+	if (tree == NULL)
+		return B_ERROR;
+
+	status_t status = tree->Insert(transaction, key, keyLength, value);
+	if (status != B_OK)
+		return status;
+
 	return transaction.Done();
 }
 
 
+static int
+compare_check_index_entries(const void* _a, const void* _b)
+{
+	const check_index_entry* a = *(const check_index_entry**)_a;
+	const check_index_entry* b = *(const check_index_entry**)_b;
+
+	int32 compare = compareKeys(a->type, a->Key(), a->length, b->Key(),
+		b->length);
+	if (compare != 0)
+		return compare;
+
+	if (a->value == b->value)
+		return 0;
+	return a->value < b->value ? -1 : 1;
+}
+
+
+/*!	Writes the collected entries to their indices. Since the entries are
+	sorted first, the indices can be built bottom-up with completely filled
+	nodes, instead of inserting one entry after the other.
+	The journal, and the indices have been locked by the checker all the
+	time, so the entries are still valid, and only entries that could not
+	be collected, but were inserted right away can be in the indices already.
+*/
+status_t
+BlockAllocator::_WriteIndices()
+{
+	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
+		check_index* index = fCheckCookie->indices.Array()[i];
+		if (index->inode == NULL || index->entry_count == 0)
+			continue;
+
+		check_index_entry** entries = (check_index_entry**)malloc(
+			index->entry_count * sizeof(check_index_entry*));
+		if (entries != NULL) {
+			size_t offset = 0;
+			for (int32 j = 0; j < index->entry_count; j++) {
+				entries[j] = (check_index_entry*)(index->entries + offset);
+				offset += entries[j]->Size();
+			}
+
+			// sorted entries also make inserting them one by one faster
+			qsort(entries, index->entry_count, sizeof(check_index_entry*),
+				&compare_check_index_entries);
+		}
+
+		status_t status = B_BAD_VALUE;
+		if (entries != NULL && !index->insert_directly)
+			status = _BulkLoadIndex(index, entries);
+
+		if (status == B_BAD_VALUE) {
+			// The index is not empty, or we don't have the memory to sort
+			// the entries; just insert them one by one
+			status = B_OK;
+			size_t offset = 0;
+			for (int32 j = 0; status == B_OK && j < index->entry_count; j++) {
+				check_index_entry* entry;
+				if (entries != NULL)
+					entry = entries[j];
+				else {
+					entry = (check_index_entry*)(index->entries + offset);
+					offset += entry->Size();
+				}
+
+				status = _InsertIndexEntry(index, entry->Key(), entry->length,
+					entry->value);
+			}
+		}
+
+		free(entries);
+		free(index->entries);
+		index->entries = NULL;
+		index->entries_size = 0;
+		index->entries_capacity = 0;
+		index->entry_count = 0;
+
+		if (status != B_OK) {
+			FATAL(("check: Could not write index \"%s\": %s\n", index->name,
+				strerror(status)));
+			return status;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Builds the \a index from the sorted \a entries. Returns \c B_BAD_VALUE
+	without changing anything if the index is not empty.
+*/
+status_t
+BlockAllocator::_BulkLoadIndex(check_index* index, check_index_entry** entries)
+{
+	TreeBuilder builder(index->inode->Tree());
+	status_t status = builder.InitCheck();
+
+	for (int32 i = 0; status == B_OK && i < index->entry_count; i++) {
+		status = builder.Add(entries[i]->Key(), entries[i]->length,
+			entries[i]->value);
+		if (status == B_BAD_VALUE) {
+			// only an empty tree must cause the fallback
+			status = B_ERROR;
+		}
+	}
+	if (status == B_OK)
+		status = builder.Finish();
+
+	return status;
+}
+
+
 //	#pragma mark - debugger commands
 
 
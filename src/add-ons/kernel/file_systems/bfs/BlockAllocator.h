@@ -18,12 +18,43 @@ struct disk_super_block;
 struct block_run;
 struct check_control;
 struct check_cookie;
+struct check_index;
+struct check_index_entry;
 
 
 //#define DEBUG_ALLOCATION_GROUPS
 //#define DEBUG_FRAGMENTER
 
 
+/*!	An in-memory reservation of free blocks behind the last run of a file.
+	While a file is being written, its data blocks are allocated from its
+	reservation, so that concurrent writers don't interleave their runs.
+	The reserved blocks stay free in the block bitmap; the reservation is
+	dropped as soon as the file is closed, trimmed, or the volume runs out
+	of space.
+*/
+struct allocation_reservation
+	: DoublyLinkedListLinkImpl<allocation_reservation> {
+	allocation_reservation()
+		:
+		group(-1),
+		start(0),
+		length(0),
+		window(0),
+		writers(0)
+	{
+	}
+
+	int32	group;
+	uint16	start;
+	uint16	length;
+	uint16	window;
+		// the number of blocks to reserve next time
+	int32	writers;
+		// the number of cookies that have the file open for writing
+};
+
+
 class BlockAllocator {
 public:
 							BlockAllocator(Volume* volume);
@@ -42,6 +73,11 @@ public:
 								uint16 minimum = 1);
 			status_t		Free(Transaction& transaction, block_run run);
 
+			void			ReleaseReservation(Inode* inode);
+			void			AddWriter(Inode* inode);
+			void			RemoveWriter(Inode* inode);
+			void			PrepareForAppending(Inode* inode);
+
 			status_t		AllocateBlocks(Transaction& transaction,
 								int32 group, uint16 start, uint16 numBlocks,
 								uint16 minimum, block_run& run);
@@ -67,6 +103,19 @@ public:
 #endif
 
 private:
+			status_t		_AllocateBlocks(Transaction& transaction,
+								int32 group, uint16 start, uint16 numBlocks,
+								uint16 minimum, block_run& run,
+								allocation_reservation* reservation);
+			status_t		_AllocateReserved(Transaction& transaction,
+								allocation_reservation& reservation,
+								uint16 numBlocks, block_run& run);
+			void			_FinishAllocation(int32 group, uint16 start,
+								uint16 length, block_run& run);
+			void			_ReleaseReservation(
+								allocation_reservation& reservation);
+			void			_ReleaseAllReservations();
+
 			status_t		_RemoveInvalidNode(Inode* parent, BPlusTree* tree,
 								Inode* inode, const char* name);
 #ifdef DEBUG_ALLOCATION_GROUPS
@@ -80,6 +129,15 @@ private:
 			status_t		_PrepareIndices();
 			void			_FreeIndices();
 			status_t		_AddInodeToIndex(Inode* inode);
+			status_t		_AddIndexEntry(check_index* index,
+								const uint8* key, uint16 keyLength,
+								off_t value);
+			status_t		_InsertIndexEntry(check_index* index,
+								const uint8* key, uint16 keyLength,
+								off_t value);
+			status_t		_WriteIndices();
+			status_t		_BulkLoadIndex(check_index* index,
+								check_index_entry** entries);
 			status_t		_WriteBackCheckBitmap();
 
 	static	status_t		_Initialize(BlockAllocator* self);
@@ -91,6 +149,7 @@ private:
 			int32			fNumGroups;
 			uint32			fBlocksPerGroup;
 			uint32			fNumBlocks;
+			int32			fReservationCount;
 
 			uint32*			fCheckBitmap;
 			check_cookie*	fCheckCookie;
@@ -233,6 +233,9 @@ Index::Update(Transaction& transaction, const char* name, int32 type,
 	if (!compareKeys(type, oldKey, oldLength, newKey, newLength))
 		return B_OK;
 
+	// running queries may have collected candidates from this index
+	fVolume->IndexChanged();
+
 	// update all live queries about the change, if they have an index or not
 	fVolume->UpdateLiveQueries(inode, name, type, oldKey, oldLength,
 		newKey, newLength);
@@ -333,7 +333,8 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fCommitGeneration(0)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %Ld) @ %p\n", volume, id, this));
 
@@ -363,7 +364,8 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fCommitGeneration(0)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %Ld) @ %p\n",
 		volume, &transaction, id, this));
@@ -398,6 +400,8 @@ Inode::~Inode()
 {
 	PRINT(("Inode::~Inode() @ %p\n", this));
 
+	fVolume->Allocator().ReleaseReservation(this);
+
 	file_cache_delete(FileCache());
 	file_map_delete(Map());
 	delete fTree;
@@ -2166,6 +2170,9 @@ Inode::_ShrinkStream(Transaction& transaction, off_t size)
 	data_stream* data = &Node().data;
 	status_t status;
 
+	// the reserved blocks would no longer follow the end of the stream
+	fVolume->Allocator().ReleaseReservation(this);
+
 	if (data->MaxDoubleIndirectRange() > size) {
 		off_t* maxDoubleIndirect = &data->max_double_indirect_range;
 			// gcc 4 work-around: "error: cannot bind packed field
@@ -2445,6 +2452,9 @@ Inode::TransactionDone(bool success)
 	if (!success) {
 		// revert any changes made to the cached bfs_inode
 		UpdateNodeFromDisk();
+	} else {
+		// remember which log write fsync() has to wait for
+		fCommitGeneration = fVolume->GetJournal(0)->CommitGeneration();
 	}
 }
 
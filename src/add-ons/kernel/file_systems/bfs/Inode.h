@@ -185,6 +185,13 @@ public:
 			void*				Map() const { return fMap; }
 			void				SetMap(void* map) { fMap = map; }
 
+			// block reservation, see BlockAllocator
+			allocation_reservation& Reservation() { return fReservation; }
+
+			// journal generation of the last transaction that changed us
+			int32				CommitGeneration() const
+									{ return fCommitGeneration; }
+
 #if _KERNEL_MODE && KDEBUG
 			void				AssertReadLocked()
 									{ ASSERT_READ_LOCKED_RW_LOCK(&fLock); }
@@ -264,6 +271,10 @@ private:
 
 			mutable recursive_lock fSmallDataLock;
 			SinglyLinkedList<AttributeIterator> fIterators;
+
+			allocation_reservation fReservation;
+				// protected by the block allocator's lock
+			int32				fCommitGeneration;
 };
 
 
@@ -405,10 +405,14 @@ Journal::Journal(Volume* volume)
 	fUsed(0),
 	fUnwrittenTransactions(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fCommitLatency(0),
+	fCommitGeneration(0),
+	fWrittenGeneration(0)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
+	mutex_init(&fCommitLock, "bfs journal commit");
 }
 
 
@@ -418,6 +422,7 @@ Journal::~Journal()
 
 	recursive_lock_destroy(&fLock);
 	mutex_destroy(&fEntriesLock);
+	mutex_destroy(&fCommitLock);
 }
 
 
@@ -765,6 +770,7 @@ Journal::_WriteTransactionToLog()
 				NULL);
 			fUnwrittenTransactions = 0;
 		}
+		_SetWritten(detached);
 		return B_OK;
 	}
 
@@ -887,6 +893,8 @@ Journal::_WriteTransactionToLog()
 	fUsed += logEntry->Length();
 	mutex_unlock(&fEntriesLock);
 
+	_SetWritten(detached);
+
 	if (detached) {
 		fTransactionID = cache_detach_sub_transaction(fVolume->BlockCache(),
 			fTransactionID, _TransactionWritten, logEntry);
@@ -926,9 +934,10 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 		return B_OK;
 	}
 
-	// write the current log entry to disk
+	// write the current log entry to disk (a transaction without any
+	// changed blocks is just ended)
 
-	if (fUnwrittenTransactions != 0 && _TransactionSize() != 0) {
+	if (fUnwrittenTransactions != 0) {
 		status = _WriteTransactionToLog();
 		if (status < B_OK)
 			FATAL(("writing current log entry failed: %s\n", strerror(status)));
@@ -942,6 +951,34 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 }
 
 
+/*!	Waits until the transactions of the given commit \a generation have
+	been written to the log, and writes them if necessary; fsync() uses this
+	to make sure that the changes to an inode are safe on disk.
+	Concurrent callers are committed as a group: only the first of them
+	writes the log entry, and flushes the drive cache for all of them, while
+	the others wait for it to finish, and then find their transactions
+	written already. With a commit latency set, callers wait that long
+	first, so that more transactions can join their commit.
+*/
+status_t
+Journal::WaitForCommit(int32 generation)
+{
+	if (_IsWritten(generation))
+		return B_OK;
+
+	if (fCommitLatency > 0)
+		snooze(fCommitLatency);
+
+	MutexLocker locker(fCommitLock);
+
+	// someone else might have committed our transaction in the mean time
+	if (_IsWritten(generation))
+		return B_OK;
+
+	return _FlushLog(true, false);
+}
+
+
 /*!	Flushes the current log entry to disk, and also writes back all dirty
 	blocks for this volume (completing all open transactions).
 */
@@ -984,8 +1021,10 @@ Journal::Lock(Transaction* owner, bool separateSubTransactions)
 			// start a sub transaction
 			cache_start_sub_transaction(fVolume->BlockCache(), fTransactionID);
 			fHasSubtransaction = true;
-		} else
+		} else {
 			fTransactionID = cache_start_transaction(fVolume->BlockCache());
+			fCommitGeneration++;
+		}
 
 		if (fTransactionID < B_OK) {
 			recursive_lock_unlock(&fLock);
@@ -1061,6 +1100,7 @@ Journal::_TransactionDone(bool success)
 		} else {
 			cache_abort_transaction(fVolume->BlockCache(), fTransactionID);
 			fUnwrittenTransactions = 0;
+			_SetWritten(false);
 		}
 
 		return B_OK;
@@ -1083,6 +1123,27 @@ Journal::_TransactionDone(bool success)
 }
 
 
+/*!	Marks the current commit generation as written to the log. If the
+	current sub-transaction was \a detached from it, that one starts the
+	next generation.
+*/
+void
+Journal::_SetWritten(bool detached)
+{
+	atomic_set(&fWrittenGeneration, fCommitGeneration);
+	if (detached)
+		fCommitGeneration++;
+}
+
+
+bool
+Journal::_IsWritten(int32 generation)
+{
+	return (int32)((uint32)atomic_get(&fWrittenGeneration)
+		- (uint32)generation) >= 0;
+}
+
+
 //	#pragma mark - debugger commands
 
 
@@ -1104,6 +1165,9 @@ Journal::Dump()
 	kprintf("  transaction ID:       %" B_PRId32 "\n", fTransactionID);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
+	kprintf("  commit latency:       %" B_PRId64 "\n", fCommitLatency);
+	kprintf("  commit generation:    %" B_PRId32 "\n", fCommitGeneration);
+	kprintf("  written generation:   %" B_PRId32 "\n", fWrittenGeneration);
 	kprintf("entries:\n");
 	kprintf("  address        id  start length\n");
 
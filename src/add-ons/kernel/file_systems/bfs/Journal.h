@@ -35,6 +35,13 @@ public:
 			size_t			CurrentTransactionSize() const;
 			bool			CurrentTransactionTooLarge() const;
 
+			int32			CommitGeneration() const
+								{ return fCommitGeneration; }
+			status_t		WaitForCommit(int32 generation);
+			void			SetCommitLatency(bigtime_t latency)
+								{ fCommitLatency = latency; }
+			bigtime_t		CommitLatency() const { return fCommitLatency; }
+
 			status_t		FlushLogAndBlocks();
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
@@ -55,6 +62,8 @@ private:
 			status_t		_CheckRunArray(const run_array* array);
 			status_t		_ReplayRunArray(int32* start);
 			status_t		_TransactionDone(bool success);
+			void			_SetWritten(bool detached);
+			bool			_IsWritten(int32 generation);
 
 	static	void			_TransactionWritten(int32 transactionID,
 								int32 event, void* _logEntry);
@@ -76,6 +85,11 @@ private:
 			int32			fTransactionID;
 			bool			fHasSubtransaction;
 			bool			fSeparateSubTransactions;
+
+			mutex			fCommitLock;
+			bigtime_t		fCommitLatency;
+			int32			fCommitGeneration;
+			vint32			fWrittenGeneration;
 };
 
 
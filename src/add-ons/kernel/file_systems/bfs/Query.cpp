@@ -79,19 +79,66 @@ union value {
 	char	String[INODE_FILE_NAME_LENGTH];
 };
 
+// The maximum number of inode IDs that are collected from the indices of
+// the terms that are combined with the one whose index is iterated; if there
+// are more, these terms are matched against the inodes as usual.
+static const int32 kMaxCandidates = 65536;
+
+// Only after this many index entries matched an equation, the candidates are
+// collected from the other indices; for very selective equations, checking
+// the inodes themselves is cheaper.
+static const int32 kCollectCandidatesThreshold = 64;
+
+
+/*!	A sorted set of inode IDs that were collected from one or more indices.
+	It is used to sort out index entries before their inode is loaded.
+*/
+class CandidateSet {
+public:
+						CandidateSet();
+						~CandidateSet();
+
+			bool		Add(off_t id);
+			void		Finish();
+
+			bool		Contains(off_t id) const;
+			int32		Count() const { return fCount; }
+
+			void		Intersect(const CandidateSet& other);
+			status_t	Unite(const CandidateSet& other);
+
+private:
+						CandidateSet(const CandidateSet& other);
+						CandidateSet& operator=(const CandidateSet& other);
+							// no implementation
+
+			off_t*		fIDs;
+			int32		fCount;
+			int32		fCapacity;
+};
+
 
 /*!	Abstract base class for the operator/equation classes.
 */
 class Term {
 public:
-						Term(int8 op) : fOp(op), fParent(NULL) {}
-	virtual				~Term() {}
+						Term(int8 op)
+							: fOp(op), fParent(NULL), fCandidates(NULL),
+							fCandidatesCollected(false) {}
+	virtual				~Term() { delete fCandidates; }
 
 			int8		Op() const { return fOp; }
 
 			void		SetParent(Term* parent) { fParent = parent; }
 			Term*		Parent() const { return fParent; }
 
+			CandidateSet* Candidates() const { return fCandidates; }
+			bool		CandidatesCollected() const
+							{ return fCandidatesCollected; }
+			void		SetCandidates(CandidateSet* candidates);
+	virtual	void		ResetCandidates();
+	virtual	CandidateSet* CollectCandidates(Volume* volume) = 0;
+
 	virtual	status_t	Match(Inode* inode, const char* attribute = NULL,
 							int32 type = 0, const uint8* key = NULL,
 							size_t size = 0) = 0;
@@ -109,6 +156,8 @@ public:
 protected:
 			int8		fOp;
 			Term*		fParent;
+			CandidateSet* fCandidates;
+			bool		fCandidatesCollected;
 };
 
 
@@ -146,6 +195,8 @@ public:
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
 
+	virtual	CandidateSet* CollectCandidates(Volume* volume);
+
 #ifdef DEBUG
 	virtual	void		PrintToStream();
 #endif
@@ -159,6 +210,9 @@ private:
 			bool		CompareTo(const uint8* value, uint16 size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 			status_t	MatchEmptyString();
+			void		_CollectCandidates(Volume* volume);
+			void		_DropCandidates();
+			bool		_IsCandidate(off_t id) const;
 
 			char*		fAttribute;
 			char*		fString;
@@ -170,6 +224,8 @@ private:
 
 			int32		fScore;
 			bool		fHasIndex;
+			int32		fIndexMatches;
+			int32		fCandidatesChangeCount;
 };
 
 
@@ -192,6 +248,9 @@ public:
 	virtual	void		CalculateScore(Index& index);
 	virtual	int32		Score() const;
 
+	virtual	void		ResetCandidates();
+	virtual	CandidateSet* CollectCandidates(Volume* volume);
+
 	virtual	status_t	InitCheck();
 
 #ifdef DEBUG
@@ -470,12 +529,187 @@ matchString(char* pattern, char* string)
 //	#pragma mark -
 
 
+static int
+compare_ids(const void* _a, const void* _b)
+{
+	off_t a = *(const off_t*)_a;
+	off_t b = *(const off_t*)_b;
+
+	if (a == b)
+		return 0;
+	return a < b ? -1 : 1;
+}
+
+
+CandidateSet::CandidateSet()
+	:
+	fIDs(NULL),
+	fCount(0),
+	fCapacity(0)
+{
+}
+
+
+CandidateSet::~CandidateSet()
+{
+	free(fIDs);
+}
+
+
+/*!	Adds the inode \a id to the set. Returns false if the set has grown
+	too large, or if there is not enough memory.
+*/
+bool
+CandidateSet::Add(off_t id)
+{
+	if (fCount == fCapacity) {
+		if (fCapacity >= kMaxCandidates)
+			return false;
+
+		int32 capacity = fCapacity > 0 ? fCapacity * 2 : 256;
+		off_t* ids = (off_t*)realloc(fIDs, capacity * sizeof(off_t));
+		if (ids == NULL)
+			return false;
+
+		fIDs = ids;
+		fCapacity = capacity;
+	}
+
+	fIDs[fCount++] = id;
+	return true;
+}
+
+
+/*!	Sorts the collected IDs, and removes duplicates. Must be called after
+	the last Add(), and before any of the other methods are used.
+*/
+void
+CandidateSet::Finish()
+{
+	if (fCount < 2)
+		return;
+
+	qsort(fIDs, fCount, sizeof(off_t), &compare_ids);
+
+	int32 count = 1;
+	for (int32 i = 1; i < fCount; i++) {
+		if (fIDs[i] != fIDs[count - 1])
+			fIDs[count++] = fIDs[i];
+	}
+	fCount = count;
+}
+
+
+bool
+CandidateSet::Contains(off_t id) const
+{
+	int32 first = 0;
+	int32 last = fCount - 1;
+
+	while (first <= last) {
+		int32 middle = (first + last) / 2;
+		if (fIDs[middle] == id)
+			return true;
+
+		if (fIDs[middle] < id)
+			first = middle + 1;
+		else
+			last = middle - 1;
+	}
+
+	return false;
+}
+
+
+//!	Removes all IDs from this set that are not part of \a other.
+void
+CandidateSet::Intersect(const CandidateSet& other)
+{
+	int32 count = 0;
+	int32 otherIndex = 0;
+
+	for (int32 i = 0; i < fCount; i++) {
+		while (otherIndex < other.fCount && other.fIDs[otherIndex] < fIDs[i])
+			otherIndex++;
+		if (otherIndex == other.fCount)
+			break;
+
+		if (other.fIDs[otherIndex] == fIDs[i])
+			fIDs[count++] = fIDs[i];
+	}
+
+	fCount = count;
+}
+
+
+//!	Adds all IDs of \a other to this set.
+status_t
+CandidateSet::Unite(const CandidateSet& other)
+{
+	if (fCount + other.fCount > kMaxCandidates)
+		return B_BUFFER_OVERFLOW;
+
+	int32 capacity = max_c(fCount + other.fCount, 1);
+	off_t* ids = (off_t*)malloc(capacity * sizeof(off_t));
+	if (ids == NULL)
+		return B_NO_MEMORY;
+
+	int32 count = 0;
+	int32 index = 0;
+	int32 otherIndex = 0;
+
+	while (index < fCount || otherIndex < other.fCount) {
+		off_t id;
+		if (otherIndex == other.fCount
+			|| (index < fCount && fIDs[index] <= other.fIDs[otherIndex])) {
+			id = fIDs[index++];
+		} else
+			id = other.fIDs[otherIndex++];
+
+		if (count == 0 || ids[count - 1] != id)
+			ids[count++] = id;
+	}
+
+	free(fIDs);
+	fIDs = ids;
+	fCount = count;
+	fCapacity = capacity;
+	return B_OK;
+}
+
+
+//	#pragma mark -
+
+
+void
+Term::SetCandidates(CandidateSet* candidates)
+{
+	delete fCandidates;
+	fCandidates = candidates;
+	fCandidatesCollected = true;
+}
+
+
+void
+Term::ResetCandidates()
+{
+	delete fCandidates;
+	fCandidates = NULL;
+	fCandidatesCollected = false;
+}
+
+
+//	#pragma mark -
+
+
 Equation::Equation(char** expr)
 	: Term(OP_EQUATION),
 	fAttribute(NULL),
 	fString(NULL),
 	fType(0),
-	fIsPattern(false)
+	fIsPattern(false),
+	fIndexMatches(0),
+	fCandidatesChangeCount(0)
 {
 	char* string = *expr;
 	char* start = string;
@@ -940,6 +1174,7 @@ Equation::PrepareQuery(Volume* /*volume*/, Index& index,
 	TreeIterator** iterator, bool queryNonIndexed)
 {
 	status_t status = index.SetTo(fAttribute);
+	fIndexMatches = 0;
 
 	// if we should query attributes without an index, we can just proceed here
 	if (status != B_OK && !queryNonIndexed)
@@ -1065,6 +1300,19 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 			continue;
 		}
 
+		// Before we load the inode, check the candidates that were collected
+		// from the indices of the other terms we are combined with
+		if (++fIndexMatches == kCollectCandidatesThreshold)
+			_CollectCandidates(volume);
+		if (fIndexMatches >= kCollectCandidatesThreshold
+			&& volume->IndexChangeCount() != fCandidatesChangeCount) {
+			// an inode may have entered one of the indices since then
+			_DropCandidates();
+			fCandidatesChangeCount = volume->IndexChangeCount();
+		}
+		if (!_IsCandidate(offset))
+			continue;
+
 		Vnode vnode(volume, offset);
 		Inode* inode;
 		if ((status = vnode.Get(&inode)) != B_OK) {
@@ -1139,6 +1387,167 @@ Equation::GetNextMatching(Volume* volume, TreeIterator* iterator,
 }
 
 
+/*!	Collects the candidate sets of all terms that are and-ed with this
+	equation, and don't have one yet.
+*/
+void
+Equation::_CollectCandidates(Volume* volume)
+{
+	fCandidatesChangeCount = volume->IndexChangeCount();
+
+	Term* term = this;
+
+	while (Term* parent = term->Parent()) {
+		if (parent->Op() == OP_AND) {
+			Operator* op = (Operator*)parent;
+			Term* other = op->Right();
+			if (other == term)
+				other = op->Left();
+
+			if (other != NULL && !other->CandidatesCollected())
+				other->SetCandidates(other->CollectCandidates(volume));
+		}
+		term = parent;
+	}
+}
+
+
+/*!	Throws away the candidate sets of all terms that are and-ed with this
+	equation, as they no longer reflect the indices. They are not collected
+	again for this query; the terms are matched against the inodes instead.
+*/
+void
+Equation::_DropCandidates()
+{
+	Term* term = this;
+
+	while (Term* parent = term->Parent()) {
+		if (parent->Op() == OP_AND) {
+			Operator* op = (Operator*)parent;
+			Term* other = op->Right();
+			if (other == term)
+				other = op->Left();
+
+			if (other != NULL && other->Candidates() != NULL)
+				other->SetCandidates(NULL);
+		}
+		term = parent;
+	}
+}
+
+
+/*!	Checks the inode \a id against the candidate sets of all terms that
+	are and-ed with this equation. Returns false if the inode cannot match
+	the query, without having to load it.
+*/
+bool
+Equation::_IsCandidate(off_t id) const
+{
+	const Term* term = this;
+
+	while (const Term* parent = term->Parent()) {
+		if (parent->Op() == OP_AND) {
+			const Operator* op = (const Operator*)parent;
+			Term* other = op->Right();
+			if (other == term)
+				other = op->Left();
+
+			if (other != NULL && other->Candidates() != NULL
+				&& !other->Candidates()->Contains(id))
+				return false;
+		}
+		term = parent;
+	}
+
+	return true;
+}
+
+
+/*!	Iterates over the part of the equation's index that matches, and returns
+	the set of inode IDs that were found. Returns NULL if the equation has no
+	usable index, if it could also match inodes that are not in its index, or
+	if there are too many matching entries.
+*/
+CandidateSet*
+Equation::CollectCandidates(Volume* volume)
+{
+	// We would have to iterate over the whole index for these
+	if (fOp == OP_UNEQUAL)
+		return NULL;
+
+	// Match() also evaluates these for directories and symlinks, but only
+	// files are in their index
+	if (!strcmp(fAttribute, "size") || !strcmp(fAttribute, "last_modified"))
+		return NULL;
+
+	Index index(volume);
+	TreeIterator* iterator = NULL;
+	status_t status = PrepareQuery(volume, index, &iterator, false);
+	if (iterator == NULL || !fHasIndex || MatchEmptyString() == MATCH_OK) {
+		// an inode without the attribute matches the empty string, but
+		// cannot be found in the index
+		delete iterator;
+		return NULL;
+	}
+
+	CandidateSet* candidates = new(std::nothrow) CandidateSet;
+	if (candidates == NULL) {
+		delete iterator;
+		return NULL;
+	}
+
+	if (status != B_OK) {
+		delete iterator;
+
+		// For an exact match, PrepareQuery() already tells us if there is one
+		if (status == B_ENTRY_NOT_FOUND && fOp == OP_EQUAL && !fIsPattern)
+			return candidates;
+
+		delete candidates;
+		return NULL;
+	}
+
+	while (status == B_OK) {
+		union value indexValue;
+		uint16 keyLength;
+		uint16 duplicate;
+		off_t offset;
+
+		status = iterator->GetNextEntry(&indexValue, &keyLength,
+			(uint16)sizeof(indexValue), &offset, &duplicate);
+		if (status != B_OK)
+			break;
+
+		// the same rules as in GetNextMatching() apply
+		if (duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
+			if (fOp == OP_LESS_THAN
+				|| fOp == OP_LESS_THAN_OR_EQUAL
+				|| (fOp == OP_EQUAL && !fIsPattern)) {
+				status = B_ENTRY_NOT_FOUND;
+				break;
+			}
+
+			if (duplicate > 0)
+				iterator->SkipDuplicates();
+			continue;
+		}
+
+		if (!candidates->Add(offset))
+			status = B_BUFFER_OVERFLOW;
+	}
+
+	delete iterator;
+
+	if (status != B_ENTRY_NOT_FOUND) {
+		delete candidates;
+		return NULL;
+	}
+
+	candidates->Finish();
+	return candidates;
+}
+
+
 //	#pragma mark -
 
 
@@ -1232,6 +1641,50 @@ Operator::Score() const
 }
 
 
+void
+Operator::ResetCandidates()
+{
+	Term::ResetCandidates();
+
+	fLeft->ResetCandidates();
+	fRight->ResetCandidates();
+}
+
+
+/*!	An and-ed term only needs one of its sides to have a candidate set, as
+	each set alone already contains all inodes that could match. An or-ed
+	term needs both.
+*/
+CandidateSet*
+Operator::CollectCandidates(Volume* volume)
+{
+	CandidateSet* left = fLeft->CollectCandidates(volume);
+	if (left == NULL && fOp == OP_OR)
+		return NULL;
+
+	CandidateSet* right = fRight->CollectCandidates(volume);
+	if (left == NULL)
+		return right;
+	if (right == NULL) {
+		if (fOp == OP_AND)
+			return left;
+
+		delete left;
+		return NULL;
+	}
+
+	if (fOp == OP_AND)
+		left->Intersect(*right);
+	else if (left->Unite(*right) != B_OK) {
+		delete left;
+		left = NULL;
+	}
+
+	delete right;
+	return left;
+}
+
+
 status_t
 Operator::InitCheck()
 {
@@ -1523,6 +1976,9 @@ Query::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	// the candidates are collected again when needed
+	fExpression->Root()->ResetCandidates();
+
 	// put the whole expression on the stack
 
 	Stack<Term*> stack;
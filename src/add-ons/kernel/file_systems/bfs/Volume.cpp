@@ -281,6 +281,7 @@ Volume::Volume(fs_volume* volume)
 	fRootNode(NULL),
 	fIndicesNode(NULL),
 	fDirtyCachedBlocks(0),
+	fIndexChangeCount(0),
 	fFlags(0),
 	fCheckingThread(-1)
 {
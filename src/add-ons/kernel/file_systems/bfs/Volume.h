@@ -129,6 +129,10 @@ public:
 								ino_t newDirectoryID, const char* newName);
 
 			bool			CheckForLiveQuery(const char* attribute);
+			int32			IndexChangeCount() const
+								{ return fIndexChangeCount; }
+			void			IndexChanged()
+								{ atomic_add(&fIndexChangeCount, 1); }
 			void			AddQuery(Query* query);
 			void			RemoveQuery(Query* query);
 
@@ -164,6 +168,7 @@ protected:
 
 			mutex			fQueryLock;
 			SinglyLinkedList<Query> fQueries;
+			vint32			fIndexChangeCount;
 
 			uint32			fFlags;
 
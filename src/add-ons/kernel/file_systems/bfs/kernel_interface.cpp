@@ -176,6 +176,19 @@ bfs_mount(fs_volume* _volume, const char* device, uint32 flags,
 	_volume->ops = &gBFSVolumeOps;
 	*_rootID = volume->ToVnode(volume->Root());
 
+	// "commit_latency <us>" lets fsync() wait a bit for other transactions
+	// to join its log write
+	void* handle = parse_driver_settings_string(args);
+	if (handle != NULL) {
+		const char* latency = get_driver_parameter(handle, "commit_latency",
+			NULL, NULL);
+		if (latency != NULL) {
+			volume->GetJournal(0)->SetCommitLatency(
+				strtoll(latency, NULL, 0));
+		}
+		delete_driver_settings(handle);
+	}
+
 	INFORM(("mounted \"%s\" (root node at %" B_PRIdINO ", device = %s)\n",
 		volume->Name(), *_rootID, device));
 	return B_OK;
@@ -205,6 +218,7 @@ bfs_read_fs_stat(fs_volume* _volume, struct fs_info* info)
 
 	// File system flags.
 	info->flags = B_FS_IS_PERSISTENT | B_FS_HAS_ATTR | B_FS_HAS_MIME
+		| B_FS_CACHES_MISSING_ENTRIES
 		| (volume->IndicesNode() != NULL ? B_FS_HAS_QUERY : 0)
 		| (volume->IsReadOnly() ? B_FS_IS_READONLY : 0);
 
@@ -749,7 +763,14 @@ bfs_fsync(fs_volume* _volume, fs_vnode* _node)
 	FUNCTION();
 
 	Inode* inode = (Inode*)_node->private_node;
-	return inode->Sync();
+	status_t status = inode->Sync();
+	if (status != B_OK)
+		return status;
+
+	// make sure the metadata changes to this inode have been written to the
+	// log, too; concurrent calls share a single log write
+	Volume* volume = (Volume*)_volume->private_volume;
+	return volume->GetJournal(0)->WaitForCommit(inode->CommitGeneration());
 }
 
 
@@ -946,6 +967,13 @@ bfs_create(fs_volume* _volume, fs_vnode* _directory, const char* name,
 		// register the cookie
 		*_cookie = cookie;
 
+		// Files opened for appending will most likely grow for a while
+		if ((openMode & O_APPEND) != 0 && inode->IsFile())
+			volume->Allocator().PrepareForAppending(inode);
+
+		if ((openMode & O_RWMASK) != 0 && inode->IsFile())
+			volume->Allocator().AddWriter(inode);
+
 		if (created) {
 			notify_entry_created(volume->ID(), directory->ID(), name,
 				*_vnodeID);
@@ -1278,6 +1306,10 @@ bfs_open(fs_volume* _volume, fs_vnode* _node, int openMode, void** _cookie)
 	cookie->last_size = inode->Size();
 	cookie->last_notification = system_time();
 
+	// Files opened for appending will most likely grow for a while
+	if ((openMode & O_APPEND) != 0 && inode->IsFile())
+		volume->Allocator().PrepareForAppending(inode);
+
 	// Disable the file cache, if requested?
 	CObjectDeleter<void> fileCacheEnabler(file_cache_enable);
 	if ((openMode & O_NOCACHE) != 0 && inode->FileCache() != NULL) {
@@ -1304,6 +1336,9 @@ bfs_open(fs_volume* _volume, fs_vnode* _node, int openMode, void** _cookie)
 			return status;
 	}
 
+	if ((openMode & O_RWMASK) != 0 && inode->IsFile())
+		volume->Allocator().AddWriter(inode);
+
 	fileCacheEnabler.Detach();
 	cookieDeleter.Detach();
 	*_cookie = cookie;
@@ -1459,6 +1494,11 @@ bfs_free_cookie(fs_volume* _volume, fs_vnode* _node, void* _cookie)
 	if (status == B_OK)
 		transaction.Done();
 
+	// Give the blocks reserved for the file back to the others, once
+	// nobody writes to it anymore
+	if ((cookie->open_mode & O_RWMASK) != 0 && inode->IsFile())
+		volume->Allocator().RemoveWriter(inode);
+
 	if ((cookie->open_mode & BFS_OPEN_MODE_CHECKING) != 0) {
 		// "chkbfs" exited abnormally, so we have to stop it here...
 		FATAL(("check process was aborted!\n"));
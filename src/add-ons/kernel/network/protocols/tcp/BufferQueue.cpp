@@ -11,6 +11,8 @@
 
 #include <KernelExport.h>
 
+#include <string.h>
+
 
 //#define TRACE_BUFFER_QUEUE
 #ifdef TRACE_BUFFER_QUEUE
@@ -33,7 +35,11 @@ BufferQueue::BufferQueue(size_t maxBytes)
 	fContiguousBytes(0),
 	fFirstSequence(0),
 	fLastSequence(0),
-	fPushPointer(0)
+	fPushPointer(0),
+	fLastAdded(0),
+	fSackCount(0),
+	fSackedBytes(0),
+	fHighestSacked(0)
 {
 }
 
@@ -63,6 +69,7 @@ BufferQueue::SetInitialSequence(tcp_sequence sequence)
 		sequence.Number()));
 
 	fFirstSequence = fLastSequence = sequence;
+	ClearSacks();
 }
 
 
@@ -101,6 +108,7 @@ BufferQueue::Add(net_buffer *buffer, tcp_sequence sequence)
 		// we usually just add the buffer to the end of the queue
 		fList.Add(buffer);
 		buffer->sequence = sequence.Number();
+		fLastAdded = sequence;
 
 		if (sequence == fLastSequence
 			&& fLastSequence - fFirstSequence == fNumBytes) {
@@ -200,6 +208,7 @@ BufferQueue::Add(net_buffer *buffer, tcp_sequence sequence)
 	fList.Insert(next, buffer);
 	buffer->sequence = sequence.Number();
 	fNumBytes += buffer->size;
+	fLastAdded = sequence;
 
 	// we might need to update the number of bytes available
 
@@ -272,6 +281,8 @@ BufferQueue::RemoveUntil(tcp_sequence sequence)
 	else
 		fFirstSequence = fList.Head()->sequence;
 
+	_TrimSacks();
+
 	VERIFY();
 	return B_OK;
 }
@@ -427,6 +438,193 @@ BufferQueue::Available(tcp_sequence sequence) const
 }
 
 
+/*!	Fills in up to \a maxSackCount SACK blocks describing the data in the
+	queue that has been received beyond \a sequence, the next expected
+	sequence. As suggested by RFC 2018, the block that contains the most
+	recently received data is reported first.
+	Returns the number of blocks filled in.
+*/
+int
+BufferQueue::PopulateSackInfo(tcp_sequence sequence, int maxSackCount,
+	tcp_sack* sacks) const
+{
+	int sackCount = 0;
+	bool inBlock = false;
+	tcp_sequence left;
+	tcp_sequence right;
+
+	SegmentList::ConstIterator iterator = fList.GetIterator();
+	net_buffer* buffer = iterator.Next();
+
+	while (maxSackCount > 0) {
+		if (buffer != NULL && tcp_sequence(buffer->sequence) <= sequence) {
+			buffer = iterator.Next();
+			continue;
+		}
+
+		if (buffer != NULL && inBlock && right == buffer->sequence) {
+			right += buffer->size;
+			buffer = iterator.Next();
+			continue;
+		}
+
+		if (inBlock) {
+			// the block is complete
+			if (fLastAdded >= left && fLastAdded < right) {
+				if (sackCount == maxSackCount)
+					sackCount--;
+				memmove(sacks + 1, sacks, sackCount * sizeof(tcp_sack));
+				sacks[0].left_edge = left.Number();
+				sacks[0].right_edge = right.Number();
+				sackCount++;
+			} else if (sackCount < maxSackCount) {
+				sacks[sackCount].left_edge = left.Number();
+				sacks[sackCount].right_edge = right.Number();
+				sackCount++;
+			}
+			inBlock = false;
+		}
+
+		if (buffer == NULL)
+			break;
+
+		left = buffer->sequence;
+		right = left + buffer->size;
+		inBlock = true;
+		buffer = iterator.Next();
+	}
+
+	return sackCount;
+}
+
+
+/*!	Adds the range from \a left to \a right to the SACK scoreboard; it is
+	merged with the ranges it overlaps or touches. If the scoreboard is full,
+	the highest range is forgotten, which means that its data may be
+	retransmitted needlessly, but the highest sequence that has been
+	selectively acknowledged is always remembered.
+*/
+void
+BufferQueue::AddSack(tcp_sequence left, tcp_sequence right)
+{
+	if (left < fFirstSequence)
+		left = fFirstSequence;
+	if (right > fLastSequence)
+		right = fLastSequence;
+	if (left >= right)
+		return;
+
+	if (fSackCount == 0 || right > fHighestSacked)
+		fHighestSacked = right;
+
+	// find the first range that ends at or after the new one starts
+	int32 index = 0;
+	while (index < fSackCount && fSacks[index].right < left)
+		index++;
+
+	// merge all ranges that are overlapping with the new one
+	int32 end = index;
+	while (end < fSackCount && fSacks[end].left <= right) {
+		if (fSacks[end].left < left)
+			left = fSacks[end].left;
+		if (fSacks[end].right > right)
+			right = fSacks[end].right;
+		end++;
+	}
+
+	if (end == index && fSackCount == MAX_SACK_RANGES) {
+		if (index == fSackCount)
+			return;
+
+		fSackCount--;
+	}
+
+	memmove(&fSacks[index + 1], &fSacks[end],
+		(fSackCount - end) * sizeof(sack_range));
+	fSackCount -= end - index - 1;
+
+	fSacks[index].left = left;
+	fSacks[index].right = right;
+
+	fSackedBytes = 0;
+	for (int32 i = 0; i < fSackCount; i++)
+		fSackedBytes += (fSacks[i].right - fSacks[i].left).Number();
+}
+
+
+void
+BufferQueue::ClearSacks()
+{
+	fSackCount = 0;
+	fSackedBytes = 0;
+	fHighestSacked = fFirstSequence;
+}
+
+
+/*!	Returns the number of selectively acknowledged bytes between \a from
+	and \a to.
+*/
+size_t
+BufferQueue::SackedBytes(tcp_sequence from, tcp_sequence to) const
+{
+	size_t bytes = 0;
+
+	for (int32 i = 0; i < fSackCount; i++) {
+		tcp_sequence left = fSacks[i].left > from ? fSacks[i].left : from;
+		tcp_sequence right = fSacks[i].right < to ? fSacks[i].right : to;
+		if (left < right)
+			bytes += (right - left).Number();
+	}
+
+	return bytes;
+}
+
+
+/*!	Returns the end of the highest range that has been selectively
+	acknowledged, or the first sequence of the queue if there is none.
+*/
+tcp_sequence
+BufferQueue::HighestSacked() const
+{
+	if (fSackCount == 0 || fHighestSacked < fFirstSequence)
+		return fFirstSequence;
+
+	return fHighestSacked;
+}
+
+
+/*!	Finds the first range between \a from and \a to that has not been
+	selectively acknowledged.
+	Returns \c false if there is no such range.
+*/
+bool
+BufferQueue::FindHole(tcp_sequence from, tcp_sequence to,
+	tcp_sequence& _start, tcp_sequence& _end) const
+{
+	tcp_sequence sequence = from;
+
+	for (int32 i = 0; i < fSackCount && sequence < to; i++) {
+		if (fSacks[i].right <= sequence)
+			continue;
+
+		if (fSacks[i].left > sequence) {
+			_start = sequence;
+			_end = fSacks[i].left < to ? fSacks[i].left : to;
+			return true;
+		}
+
+		sequence = fSacks[i].right;
+	}
+
+	if (sequence >= to)
+		return false;
+
+	_start = sequence;
+	_end = to;
+	return true;
+}
+
+
 void
 BufferQueue::SetPushPointer()
 {
@@ -436,6 +634,32 @@ BufferQueue::SetPushPointer()
 		fPushPointer = fList.Tail()->sequence + fList.Tail()->size;
 }
 
+
+/*!	Removes everything from the SACK scoreboard that has been acknowledged
+	cumulatively.
+*/
+void
+BufferQueue::_TrimSacks()
+{
+	int32 first = 0;
+	while (first < fSackCount && fSacks[first].right <= fFirstSequence)
+		first++;
+
+	if (first > 0) {
+		memmove(&fSacks[0], &fSacks[first],
+			(fSackCount - first) * sizeof(sack_range));
+		fSackCount -= first;
+	}
+
+	if (fSackCount > 0 && fSacks[0].left < fFirstSequence)
+		fSacks[0].left = fFirstSequence;
+
+	fSackedBytes = 0;
+	for (int32 i = 0; i < fSackCount; i++)
+		fSackedBytes += (fSacks[i].right - fSacks[i].left).Number();
+}
+
+
 #if DEBUG_BUFFER_QUEUE
 
 /*!	Perform a sanity check of the whole queue.
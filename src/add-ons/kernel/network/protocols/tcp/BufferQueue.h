@@ -21,6 +21,13 @@
 typedef DoublyLinkedList<struct net_buffer,
 	DoublyLinkedListCLink<struct net_buffer> > SegmentList;
 
+#define MAX_SACK_RANGES	16
+
+struct sack_range {
+	tcp_sequence	left;
+	tcp_sequence	right;
+};
+
 class BufferQueue {
 public:
 								BufferQueue(size_t maxBytes);
@@ -55,11 +62,28 @@ public:
 			tcp_sequence		NextSequence() const
 									{ return fFirstSequence + fContiguousBytes; }
 
+			int					PopulateSackInfo(tcp_sequence sequence,
+									int maxSackCount, tcp_sack* sacks) const;
+
+			// scoreboard of data selectively acknowledged by the peer
+			void				AddSack(tcp_sequence left, tcp_sequence right);
+			void				ClearSacks();
+			size_t				SackedBytes() const { return fSackedBytes; }
+			size_t				SackedBytes(tcp_sequence from,
+									tcp_sequence to) const;
+			tcp_sequence		HighestSacked() const;
+			bool				FindHole(tcp_sequence from, tcp_sequence to,
+									tcp_sequence& _start,
+									tcp_sequence& _end) const;
+
 #if DEBUG_BUFFER_QUEUE
 			void				Verify() const;
 			void				Dump() const;
 #endif
 
+private:
+			void				_TrimSacks();
+
 private:
 			SegmentList			fList;
 			size_t				fMaxBytes;
@@ -68,6 +92,12 @@ private:
 			tcp_sequence		fFirstSequence;
 			tcp_sequence		fLastSequence;
 			tcp_sequence		fPushPointer;
+			tcp_sequence		fLastAdded;
+
+			sack_range			fSacks[MAX_SACK_RANGES];
+			int32				fSackCount;
+			size_t				fSackedBytes;
+			tcp_sequence		fHighestSacked;
 };
 
 
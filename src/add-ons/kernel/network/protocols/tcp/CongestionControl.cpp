@@ -0,0 +1,79 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CongestionControl.h"
+
+#include <new>
+#include <string.h>
+
+#include "Cubic.h"
+#include "NewReno.h"
+
+
+CongestionControl::CongestionControl()
+	:
+	fMaxSegmentSize(0),
+	fWindow(0),
+	fSlowStartThreshold(0)
+{
+}
+
+
+CongestionControl::~CongestionControl()
+{
+}
+
+
+/*!	Creates the congestion control algorithm with the given \a name, or the
+	default one, if \a name is \c NULL.
+*/
+/*static*/ status_t
+CongestionControl::Create(const char* name, CongestionControl** _control)
+{
+	CongestionControl* control;
+	if (name == NULL || strcmp(name, "newreno") == 0)
+		control = new(std::nothrow) NewReno;
+	else if (strcmp(name, "cubic") == 0)
+		control = new(std::nothrow) Cubic;
+	else
+		return B_NAME_NOT_FOUND;
+
+	if (control == NULL)
+		return B_NO_MEMORY;
+
+	*_control = control;
+	return B_OK;
+}
+
+
+/*!	Called when the connection has been synchronized. Until then, the
+	congestion window is zero, and does not limit the amount of data sent.
+*/
+void
+CongestionControl::Init(uint32 maxSegmentSize, uint32 slowStartThreshold)
+{
+	fMaxSegmentSize = maxSegmentSize;
+	fWindow = 2 * maxSegmentSize;
+	fSlowStartThreshold = slowStartThreshold;
+}
+
+
+/*!	Called when all data that was outstanding when the recovery started
+	has been acknowledged.
+*/
+void
+CongestionControl::ExitRecovery()
+{
+	fWindow = fSlowStartThreshold;
+}
+
+
+void
+CongestionControl::_SlowStart(uint32 bytesAcknowledged)
+{
+	// RFC 5681: cwnd += min(N, SMSS)
+	fWindow += min_c(bytesAcknowledged, fMaxSegmentSize);
+}
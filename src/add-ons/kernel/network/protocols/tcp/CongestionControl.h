@@ -0,0 +1,53 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+
+#include <OS.h>
+
+
+#define TCP_CONGESTION_NAME_LENGTH	16
+
+
+/*!	Interface of a TCP congestion control algorithm. An instance is owned
+	by a single endpoint, and is always called with the endpoint locked.
+	All sizes are in bytes.
+*/
+class CongestionControl {
+public:
+								CongestionControl();
+	virtual						~CongestionControl();
+
+	static	status_t			Create(const char* name,
+									CongestionControl** _control);
+
+	virtual	const char*			Name() const = 0;
+
+	virtual	void				Init(uint32 maxSegmentSize,
+									uint32 slowStartThreshold);
+
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize,
+									bigtime_t roundTripTime) = 0;
+	virtual	void				EnterRecovery(uint32 flightSize) = 0;
+	virtual	void				ExitRecovery();
+	virtual	void				RetransmitTimeout(uint32 flightSize) = 0;
+
+			uint32				Window() const { return fWindow; }
+			uint32				SlowStartThreshold() const
+									{ return fSlowStartThreshold; }
+
+protected:
+			void				_SlowStart(uint32 bytesAcknowledged);
+
+protected:
+			uint32				fMaxSegmentSize;
+			uint32				fWindow;
+			uint32				fSlowStartThreshold;
+};
+
+
+#endif	// CONGESTION_CONTROL_H
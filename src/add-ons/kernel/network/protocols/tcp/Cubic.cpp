@@ -0,0 +1,160 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	CUBIC congestion control as specified in RFC 8312.
+
+	The window grows as a cubic function of the time since the last
+	reduction, W(t) = C * (t - K)^3 + W_max, with C = 0.4, and it is reduced
+	by a factor of beta = 0.7 on congestion. Since floating point cannot be
+	used in the kernel, time is measured in milliseconds, and the constants
+	are applied as fractions.
+*/
+
+
+#include "Cubic.h"
+
+#include <KernelExport.h>
+
+
+// C = 0.4 segments/s^3: the time K (in ms) it takes to grow the window by
+// W bytes is cbrt(W / C / segmentSize * 10^9).
+static const uint64 kCubeFactor = 2500000000ULL;
+static const int64 kMaxTimeOffset = 1 << 20;
+
+
+static uint32
+cube_root(uint64 value)
+{
+	uint32 low = 0;
+	uint32 high = 1 << 21;
+
+	while (low < high) {
+		uint32 middle = (low + high + 1) / 2;
+		if ((uint64)middle * middle * middle <= value)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+
+Cubic::Cubic()
+	:
+	fMaxWindow(0),
+	fOriginWindow(0),
+	fEstimatedWindow(0),
+	fEpochStart(0),
+	fTimeToOrigin(0)
+{
+}
+
+
+const char*
+Cubic::Name() const
+{
+	return "cubic";
+}
+
+
+void
+Cubic::Init(uint32 maxSegmentSize, uint32 slowStartThreshold)
+{
+	CongestionControl::Init(maxSegmentSize, slowStartThreshold);
+
+	fMaxWindow = 0;
+	fEpochStart = 0;
+}
+
+
+void
+Cubic::Acknowledged(uint32 bytesAcknowledged, uint32 flightSize,
+	bigtime_t roundTripTime)
+{
+	if (fWindow < fSlowStartThreshold) {
+		_SlowStart(bytesAcknowledged);
+		return;
+	}
+
+	bigtime_t now = system_time();
+
+	if (fEpochStart == 0) {
+		// start of a new congestion avoidance epoch
+		fEpochStart = now;
+		if (fWindow < fMaxWindow) {
+			fTimeToOrigin = cube_root((uint64)(fMaxWindow - fWindow)
+				* kCubeFactor / fMaxSegmentSize);
+			fOriginWindow = fMaxWindow;
+		} else {
+			fTimeToOrigin = 0;
+			fOriginWindow = fWindow;
+		}
+		fEstimatedWindow = fWindow;
+	}
+
+	// compute the target window one round trip ahead: W(t + RTT)
+	int64 offset = (now - fEpochStart + roundTripTime) / 1000 - fTimeToOrigin;
+	if (offset > kMaxTimeOffset)
+		offset = kMaxTimeOffset;
+	else if (offset < -kMaxTimeOffset)
+		offset = -kMaxTimeOffset;
+
+	int64 target = (int64)fOriginWindow
+		+ offset * offset * offset / 1000000 * 4 * fMaxSegmentSize / 10000;
+
+	uint32 increment;
+	if (target > (int64)fWindow) {
+		// approach the target within a round trip, but grow at most by half
+		// of the acknowledged data
+		increment = (uint32)min_c((uint64)(target - fWindow)
+			* bytesAcknowledged / fWindow, bytesAcknowledged / 2);
+	} else {
+		increment = (uint64)fMaxSegmentSize * bytesAcknowledged
+			/ (100 * (uint64)fWindow);
+	}
+	fWindow += increment;
+
+	// TCP friendly region: grow at least as fast as standard TCP would,
+	// with alpha = 3 * (1 - beta) / (1 + beta)
+	fEstimatedWindow += (uint64)fMaxSegmentSize * bytesAcknowledged * 9
+		/ (17 * (uint64)fEstimatedWindow);
+	if (fEstimatedWindow > fWindow)
+		fWindow = fEstimatedWindow;
+}
+
+
+void
+Cubic::EnterRecovery(uint32 flightSize)
+{
+	_Reduce();
+	fWindow = fSlowStartThreshold;
+}
+
+
+void
+Cubic::RetransmitTimeout(uint32 flightSize)
+{
+	_Reduce();
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+Cubic::_Reduce()
+{
+	fEpochStart = 0;
+
+	// fast convergence: release bandwidth if the window did not reach
+	// its previous maximum again
+	if (fWindow < fMaxWindow)
+		fMaxWindow = (uint64)fWindow * 17 / 20;
+	else
+		fMaxWindow = fWindow;
+
+	fSlowStartThreshold = max_c((uint64)fWindow * 7 / 10,
+		2 * fMaxSegmentSize);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CUBIC_H
+#define CUBIC_H
+
+
+#include "CongestionControl.h"
+
+
+class Cubic : public CongestionControl {
+public:
+								Cubic();
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Init(uint32 maxSegmentSize,
+									uint32 slowStartThreshold);
+
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize,
+									bigtime_t roundTripTime);
+	virtual	void				EnterRecovery(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+private:
+			void				_Reduce();
+
+private:
+			uint32				fMaxWindow;
+			uint32				fOriginWindow;
+			uint32				fEstimatedWindow;
+			bigtime_t			fEpochStart;
+			int64				fTimeToOrigin;
+};
+
+
+#endif	// CUBIC_H
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//! Standard TCP congestion control as specified in RFC 5681 and RFC 6582.
+
+
+#include "NewReno.h"
+
+
+const char*
+NewReno::Name() const
+{
+	return "newreno";
+}
+
+
+void
+NewReno::Acknowledged(uint32 bytesAcknowledged, uint32 flightSize,
+	bigtime_t roundTripTime)
+{
+	if (fWindow < fSlowStartThreshold) {
+		_SlowStart(bytesAcknowledged);
+		return;
+	}
+
+	// congestion avoidance: grow by about one segment per round trip
+	uint32 increment = fMaxSegmentSize * fMaxSegmentSize / fWindow;
+	fWindow += max_c(increment, 1);
+}
+
+
+void
+NewReno::EnterRecovery(uint32 flightSize)
+{
+	fSlowStartThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fWindow = fSlowStartThreshold;
+}
+
+
+void
+NewReno::RetransmitTimeout(uint32 flightSize)
+{
+	fSlowStartThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fWindow = fMaxSegmentSize;
+}
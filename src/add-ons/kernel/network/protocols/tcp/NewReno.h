@@ -0,0 +1,24 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef NEW_RENO_H
+#define NEW_RENO_H
+
+
+#include "CongestionControl.h"
+
+
+class NewReno : public CongestionControl {
+public:
+	virtual	const char*			Name() const;
+
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize,
+									bigtime_t roundTripTime);
+	virtual	void				EnterRecovery(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+};
+
+
+#endif	// NEW_RENO_H
@@ -41,15 +41,20 @@
 //  - RFC 793 - Transmission Control Protocol
 //  - RFC 813 - Window and Acknowledgement Strategy in TCP
 //	- RFC 1337 - TIME_WAIT Assassination Hazards in TCP
+//	- RFC 2018 - TCP Selective Acknowledgment Options
+//	- RFC 5681 - TCP Congestion Control
+//	- RFC 6582 - The NewReno Modification to TCP's Fast Recovery Algorithm
+//	- RFC 6675 - A Conservative Loss Recovery Algorithm Based on Selective
+//	  Acknowledgment (SACK) for TCP
+//	- RFC 8312 - CUBIC for Fast Long-Distance Networks (see Cubic.cpp)
+//	- RACK: a time-based fast loss detection algorithm for TCP (draft)
 //
 // Things this implementation currently doesn't implement:
-//	- TCP Slow Start, Congestion Avoidance, Fast Retransmit, and Fast Recovery,
-//	  RFC 2001, RFC 2581, RFC 3042
-//	- NewReno Modification to TCP's Fast Recovery, RFC 2582
+//	- Limited Transmit, RFC 3042
 //	- Explicit Congestion Notification (ECN), RFC 3168
 //	- SYN-Cache
-//	- TCP Extensions for High Performance, RFC 1323
-//	- SACK, Selective Acknowledgment - RFC 2018, RFC 2883, RFC 3517
+//	- D-SACK, RFC 2883
+//	- Per-segment send times for RACK; reordering is detected with a timer
 //	- Forward RTO-Recovery, RFC 4138
 //	- Time-Wait hash instead of keeping sockets alive
 
@@ -73,7 +78,8 @@
 	dprintf("TCP PROBE %llu %s %s %ld snxt %lu suna %lu cw %lu sst %lu win %lu swin %lu smax-suna %lu savail %lu sqused %lu rto %llu\n", \
 		system_time(), PrintAddress(buffer->source), \
 		PrintAddress(buffer->destination), buffer->size, fSendNext.Number(), \
-		fSendUnacknowledged.Number(), fCongestionWindow, fSlowStartThreshold, \
+		fSendUnacknowledged.Number(), fCongestionControl->Window(), \
+		fCongestionControl->SlowStartThreshold(), \
 		window, fSendWindow, (fSendMax - fSendUnacknowledged).Number(), \
 		fSendQueue.Available(fSendNext), fSendQueue.Used(), fRetransmitTimeout)
 #else
@@ -265,7 +271,9 @@ enum {
 	FLAG_NO_RECEIVE				= 0x04,
 	FLAG_CLOSED					= 0x08,
 	FLAG_DELETE_ON_CLOSE		= 0x10,
-	FLAG_LOCAL					= 0x20
+	FLAG_LOCAL					= 0x20,
+	FLAG_OPTION_SACK_PERMITTED	= 0x40,
+	FLAG_RECOVERY				= 0x80
 };
 
 
@@ -439,10 +447,13 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fRoundTripDeviation(TCP_INITIAL_RTT / kTimestampFactor),
 	fRetransmitTimeout(TCP_INITIAL_RTT),
 	fReceivedTimestamp(0),
-	fCongestionWindow(0),
-	fSlowStartThreshold(0),
+	fCongestionControl(NULL),
+	fRecoveryPoint(0),
+	fRetransmitNext(0),
+	fLossEnd(0),
 	fState(CLOSED),
-	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP)
+	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP
+		| FLAG_OPTION_SACK_PERMITTED)
 {
 	// TODO: to be replaced with a real read/write locking strategy!
 	mutex_init(&fLock, "tcp lock");
@@ -454,6 +465,10 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 		TCPEndpoint::_DelayedAcknowledgeTimer, this);
 	gStackModule->init_timer(&fTimeWaitTimer, TCPEndpoint::_TimeWaitTimer,
 		this);
+	gStackModule->init_timer(&fReorderTimer, TCPEndpoint::_ReorderTimer,
+		this);
+
+	CongestionControl::Create(NULL, &fCongestionControl);
 }
 
 
@@ -476,8 +491,10 @@ TCPEndpoint::~TCPEndpoint()
 	gStackModule->wait_for_timer(&fPersistTimer);
 	gStackModule->wait_for_timer(&fDelayedAcknowledgeTimer);
 	gStackModule->wait_for_timer(&fTimeWaitTimer);
+	gStackModule->wait_for_timer(&fReorderTimer);
 
 	gDatalinkModule->put_route(Domain(), fRoute);
+	delete fCongestionControl;
 }
 
 
@@ -490,6 +507,9 @@ TCPEndpoint::InitCheck() const
 	if (fSendList.InitCheck() < B_OK)
 		return fSendList.InitCheck();
 
+	if (fCongestionControl == NULL)
+		return B_NO_MEMORY;
+
 	return B_OK;
 }
 
@@ -1018,6 +1038,19 @@ TCPEndpoint::SetReceiveBufferSize(size_t length)
 status_t
 TCPEndpoint::GetOption(int option, void* _value, int* _length)
 {
+	if (option == TCP_CONGESTION) {
+		MutexLocker _(fLock);
+
+		const char* name = fCongestionControl->Name();
+		size_t length = strlen(name) + 1;
+		if (*_length < (int)length)
+			return B_BAD_VALUE;
+
+		memcpy(_value, name, length);
+		*_length = length;
+		return B_OK;
+	}
+
 	if (*_length != sizeof(int))
 		return B_BAD_VALUE;
 
@@ -1044,6 +1077,24 @@ TCPEndpoint::GetOption(int option, void* _value, int* _length)
 status_t
 TCPEndpoint::SetOption(int option, const void* _value, int length)
 {
+	if (option == TCP_CONGESTION) {
+		if (length <= 0)
+			return B_BAD_VALUE;
+
+		char name[TCP_CONGESTION_NAME_LENGTH];
+		length = min_c(length, (int)sizeof(name) - 1);
+		memcpy(name, _value, length);
+		name[length] = '\0';
+
+		MutexLocker _(fLock);
+
+		// the algorithm cannot be changed once it is in use
+		if (fState > SYNCHRONIZE_SENT)
+			return EISCONN;
+
+		return _SetCongestionControl(name);
+	}
+
 	if (option != TCP_NODELAY)
 		return B_BAD_VALUE;
 
@@ -1138,6 +1189,7 @@ TCPEndpoint::_CancelConnectionTimers()
 	gStackModule->cancel_timer(&fRetransmitTimer);
 	gStackModule->cancel_timer(&fPersistTimer);
 	gStackModule->cancel_timer(&fDelayedAcknowledgeTimer);
+	gStackModule->cancel_timer(&fReorderTimer);
 }
 
 
@@ -1240,21 +1292,153 @@ TCPEndpoint::_HandleReset(status_t error)
 void
 TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 {
-	if (++fDuplicateAcknowledgeCount < 3)
-		return;
+	fDuplicateAcknowledgeCount++;
+	_UpdateScoreboard(segment);
+
+	if ((fFlags & FLAG_RECOVERY) == 0) {
+		if (fDuplicateAcknowledgeCount < 3
+			&& fSendQueue.SackedBytes() < 3 * fSendMaxSegmentSize) {
+			// Data beyond a hole has arrived, but not enough to be sure that
+			// the hole is not just caused by reordering: wait a fraction of
+			// the round trip time before we give up on it.
+			if (fSendQueue.SackedBytes() > 0
+				&& !gStackModule->is_timer_active(&fReorderTimer)) {
+				gStackModule->set_timer(&fReorderTimer,
+					max_c(_SmoothedRoundTripTime() / 4, 1000));
+			}
+			return;
+		}
 
-	if (fDuplicateAcknowledgeCount == 3) {
-		_ResetSlowStart();
-		fCongestionWindow = fSlowStartThreshold + 3
-			* fSendMaxSegmentSize;
-		fSendNext = segment.acknowledge;
-	} else if (fDuplicateAcknowledgeCount > 3)
-		fCongestionWindow += fSendMaxSegmentSize;
+		_EnterRecovery();
+	}
 
 	_SendQueued();
 }
 
 
+/*!	Adds the SACK blocks of the \a segment to the scoreboard of the send
+	queue.
+*/
+void
+TCPEndpoint::_UpdateScoreboard(tcp_segment_header& segment)
+{
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) == 0)
+		return;
+
+	for (int i = 0; i < segment.sack_count; i++) {
+		tcp_sequence left = segment.sacks[i].left_edge;
+		tcp_sequence right = segment.sacks[i].right_edge;
+
+		// ignore invalid blocks, and those reporting duplicates (RFC 2883)
+		if (left >= right || right <= fSendUnacknowledged
+			|| right > fSendMax)
+			continue;
+
+		fSendQueue.AddSack(left, right);
+	}
+
+	if ((fFlags & FLAG_RECOVERY) != 0 && fSendQueue.HighestSacked() > fLossEnd)
+		fLossEnd = fSendQueue.HighestSacked();
+}
+
+
+/*!	Enters loss recovery: everything that is not selectively acknowledged
+	between the first unacknowledged byte, and the highest selectively
+	acknowledged one is considered lost, and will be retransmitted as the
+	congestion window allows.
+*/
+void
+TCPEndpoint::_EnterRecovery()
+{
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+
+	TRACE("_EnterRecovery(): flight size %lu, sacked %lu", flightSize,
+		fSendQueue.SackedBytes());
+
+	fFlags |= FLAG_RECOVERY;
+	fRecoveryPoint = fSendMax;
+	fRetransmitNext = fSendUnacknowledged;
+	fLossEnd = fSendUnacknowledged + min_c(fSendMaxSegmentSize, flightSize);
+	if (fSendQueue.HighestSacked() > fLossEnd)
+		fLossEnd = fSendQueue.HighestSacked();
+
+	fCongestionControl->EnterRecovery(flightSize);
+	gStackModule->cancel_timer(&fReorderTimer);
+}
+
+
+/*!	Returns an estimate of the number of bytes that are still in the network,
+	as described in RFC 6675.
+*/
+uint32
+TCPEndpoint::_PipeSize() const
+{
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+
+	uint32 delivered;
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0)
+		delivered = fSendQueue.SackedBytes();
+	else
+		delivered = fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
+
+	uint32 lost = 0;
+	if ((fFlags & FLAG_RECOVERY) != 0) {
+		tcp_sequence start = fRetransmitNext > fSendUnacknowledged
+			? fRetransmitNext : fSendUnacknowledged;
+		if (fLossEnd > start) {
+			lost = (fLossEnd - start).Number()
+				- fSendQueue.SackedBytes(start, fLossEnd);
+		}
+	}
+
+	if (delivered + lost >= flightSize)
+		return 0;
+
+	return flightSize - delivered - lost;
+}
+
+
+/*!	Returns how many bytes beyond the first unacknowledged one the
+	congestion window currently allows to be sent, or zero, if there is no
+	limit yet.
+*/
+uint32
+TCPEndpoint::_EffectiveCongestionWindow() const
+{
+	uint32 window = fCongestionControl->Window();
+	if ((fFlags & FLAG_RECOVERY) == 0 || window == 0)
+		return window;
+
+	// during recovery, new data may be sent as long as the estimated amount
+	// of data in the network stays below the congestion window
+	uint32 consumedWindow = (fSendNext - fSendUnacknowledged).Number();
+	uint32 pipe = _PipeSize();
+
+	return consumedWindow + (window > pipe ? window - pipe : 0);
+}
+
+
+bigtime_t
+TCPEndpoint::_SmoothedRoundTripTime() const
+{
+	return (bigtime_t)fRoundTripTime * kTimestampFactor / 8;
+}
+
+
+status_t
+TCPEndpoint::_SetCongestionControl(const char* name)
+{
+	CongestionControl* control;
+	status_t status = CongestionControl::Create(name, &control);
+	if (status != B_OK)
+		return status;
+
+	delete fCongestionControl;
+	fCongestionControl = control;
+	return B_OK;
+}
+
+
 void
 TCPEndpoint::_UpdateTimestamps(tcp_segment_header& segment,
 	size_t segmentLength)
@@ -1356,10 +1540,14 @@ TCPEndpoint::_PrepareReceivePath(tcp_segment_header& segment)
 			fReceivedTimestamp = segment.timestamp_value;
 		} else
 			fFlags &= ~FLAG_OPTION_TIMESTAMP;
-	}
 
-	fCongestionWindow = 2 * fSendMaxSegmentSize;
-	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
+		if ((segment.options & TCP_SACK_PERMITTED) == 0)
+			fFlags &= ~FLAG_OPTION_SACK_PERMITTED;
+	} else
+		fFlags &= ~FLAG_OPTION_SACK_PERMITTED;
+
+	fCongestionControl->Init(fSendMaxSegmentSize,
+		(uint32)segment.advertised_window << fSendWindowShift);
 }
 
 
@@ -1406,6 +1594,14 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	fOptions = parent->fOptions;
 	fAcceptSemaphore = parent->fAcceptSemaphore;
 
+	if (strcmp(parent->fCongestionControl->Name(),
+			fCongestionControl->Name()) != 0
+		&& _SetCongestionControl(parent->fCongestionControl->Name())
+			!= B_OK) {
+		T(Error(this, "congestion control failed", __LINE__));
+		return DROP;
+	}
+
 	_PrepareReceivePath(segment);
 
 	// send SYN+ACK
@@ -1628,6 +1824,8 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 	}
 #endif
 
+	bool windowChanged = advertisedWindow != fSendWindow;
+
 	fSendWindow = advertisedWindow;
 	if (advertisedWindow > fSendMaxWindow)
 		fSendMaxWindow = advertisedWindow;
@@ -1642,25 +1840,19 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		if (fSendMax < segment.acknowledge)
 			return DROP | IMMEDIATE_ACKNOWLEDGE;
 
-		if (segment.acknowledge < fSendUnacknowledged) {
-			if (buffer->size == 0 && advertisedWindow == fSendWindow
-				&& (segment.flags & TCP_FLAG_FINISH) == 0) {
-				TRACE("Receive(): duplicate ack!");
+		if (segment.acknowledge < fSendUnacknowledged)
+			return DROP;
 
-				_DuplicateAcknowledge(segment);
-			}
+		if (segment.acknowledge == fSendUnacknowledged
+			&& fSendMax > fSendUnacknowledged && buffer->size == 0
+			&& !windowChanged && (segment.flags & TCP_FLAG_FINISH) == 0) {
+			TRACE("Receive(): duplicate ack!");
 
+			_DuplicateAcknowledge(segment);
 			return DROP;
 		} else {
 			// this segment acknowledges in flight data
 
-			if (fDuplicateAcknowledgeCount >= 3) {
-				// deflate the window.
-				fCongestionWindow = fSlowStartThreshold;
-			}
-
-			fDuplicateAcknowledgeCount = 0;
-
 			if (fSendMax == segment.acknowledge)
 				TRACE("Receive(): all inflight data ack'd!");
 
@@ -1708,9 +1900,15 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 	uint32 bufferSize = buffer->size;
 
 	if ((bufferSize > 0 || (segment.flags & TCP_FLAG_FINISH) != 0)
-		&& _ShouldReceive())
+		&& _ShouldReceive()) {
+		// out of order segments, and those that fill a hole, are to be
+		// acknowledged immediately, so that the sender learns about the
+		// loss (or its repair) as soon as possible
+		if (segment.sequence != fReceiveNext || !fReceiveQueue.IsContiguous())
+			action |= IMMEDIATE_ACKNOWLEDGE;
+
 		notify = _AddData(segment, buffer);
-	else {
+	} else {
 		if ((fFlags & FLAG_NO_RECEIVE) != 0)
 			fReceiveNext += buffer->size;
 
@@ -1940,6 +2138,15 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 				segment.options |= TCP_HAS_WINDOW_SCALE;
 				segment.window_shift = fReceiveWindowShift;
 			}
+			if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0)
+				segment.options |= TCP_SACK_PERMITTED;
+		}
+
+		if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+			&& !fReceiveQueue.IsContiguous()) {
+			// tell the peer what we have received beyond the hole
+			segment.sack_count = fReceiveQueue.PopulateSackInfo(fReceiveNext,
+				TCP_MAX_SACK_BLOCKS, segment.sacks);
 		}
 	}
 
@@ -1962,8 +2169,16 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		segment.urgent_offset = 0;
 	}
 
-	if (fCongestionWindow > 0 && fCongestionWindow < sendWindow)
-		sendWindow = fCongestionWindow;
+	if ((fFlags & FLAG_RECOVERY) != 0 && sendWindow > 0) {
+		// retransmissions of lost data take precedence over new data
+		_RetransmitLost(segment);
+	}
+
+	if (fCongestionControl->Window() > 0) {
+		uint32 congestionWindow = _EffectiveCongestionWindow();
+		if (congestionWindow < sendWindow)
+			sendWindow = congestionWindow;
+	}
 
 	// fSendUnacknowledged
 	//  |    fSendNext      fSendMax
@@ -2043,7 +2258,8 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 			buffer, buffer->size, PrintAddress(buffer->source),
 			PrintAddress(buffer->destination), segment.flags, segment.sequence,
 			segment.acknowledge, segment.advertised_window,
-			fCongestionWindow, fSlowStartThreshold, segmentLength,
+			fCongestionControl->Window(),
+			fCongestionControl->SlowStartThreshold(), segmentLength,
 			fSendQueue.FirstSequence().Number(),
 			fSendQueue.LastSequence().Number());
 		T(Send(this, segment, buffer, fSendQueue.FirstSequence(),
@@ -2062,7 +2278,7 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		// for local connections as the answer is directly handled
 
 		if (segment.flags & TCP_FLAG_SYNCHRONIZE) {
-			segment.options &= ~TCP_HAS_WINDOW_SCALE;
+			segment.options &= ~(TCP_HAS_WINDOW_SCALE | TCP_SACK_PERMITTED);
 			segment.max_segment_size = 0;
 			size++;
 		}
@@ -2110,6 +2326,78 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 }
 
 
+/*!	Sends \a length bytes of the send queue starting at \a start again,
+	without touching the regular send state.
+*/
+status_t
+TCPEndpoint::_SendRetransmission(tcp_segment_header& segment,
+	tcp_sequence start, uint32 length)
+{
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = fSendQueue.Get(buffer, start, length);
+	if (status != B_OK) {
+		gBufferModule->free(buffer);
+		return status;
+	}
+
+	LocalAddress().CopyTo(buffer->source);
+	PeerAddress().CopyTo(buffer->destination);
+
+	tcp_segment_header retransmission = segment;
+	retransmission.flags &= ~(TCP_FLAG_SYNCHRONIZE | TCP_FLAG_FINISH
+		| TCP_FLAG_PUSH | TCP_FLAG_URGENT);
+	retransmission.urgent_offset = 0;
+	retransmission.sequence = start.Number();
+
+	TRACE("_SendRetransmission(): seq %lu, len %lu", start.Number(), length);
+	T(Send(this, retransmission, buffer, fSendQueue.FirstSequence(),
+		fSendQueue.LastSequence()));
+	PROBE(buffer, length);
+
+	status = add_tcp_header(AddressModule(), retransmission, buffer);
+	if (status == B_OK)
+		status = next->module->send_routed_data(next, fRoute, buffer);
+	if (status != B_OK) {
+		gBufferModule->free(buffer);
+		return status;
+	}
+
+	fLastAcknowledgeSent = segment.acknowledge;
+	return B_OK;
+}
+
+
+/*!	Retransmits data considered lost while the congestion window allows
+	for it.
+*/
+void
+TCPEndpoint::_RetransmitLost(tcp_segment_header& segment)
+{
+	uint32 segmentMaxSize = fSendMaxSegmentSize - tcp_options_length(segment);
+
+	while (_PipeSize() < fCongestionControl->Window()) {
+		tcp_sequence start = fRetransmitNext > fSendUnacknowledged
+			? fRetransmitNext : fSendUnacknowledged;
+		tcp_sequence holeStart;
+		tcp_sequence holeEnd;
+		if (!fSendQueue.FindHole(start, fLossEnd, holeStart, holeEnd))
+			break;
+
+		uint32 length = min_c((holeEnd - holeStart).Number(), segmentMaxSize);
+		if (_SendRetransmission(segment, holeStart, length) != B_OK)
+			break;
+
+		fRetransmitNext = holeStart + length;
+	}
+
+	if (!gStackModule->is_timer_active(&fRetransmitTimer))
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+}
+
+
 int
 TCPEndpoint::_MaxSegmentSize(const sockaddr* address) const
 {
@@ -2162,6 +2450,9 @@ void
 TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 {
 	size_t previouslyUsed = fSendQueue.Used();
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+	uint32 bytesAcknowledged
+		= (tcp_sequence(segment.acknowledge) - fSendUnacknowledged).Number();
 
 	fSendQueue.RemoveUntil(segment.acknowledge);
 	fSendUnacknowledged = segment.acknowledge;
@@ -2172,6 +2463,8 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 	if (fSendUnacknowledged == fSendMax)
 		gStackModule->cancel_timer(&fRetransmitTimer);
 
+	_UpdateScoreboard(segment);
+
 	if (fSendQueue.Used() < previouslyUsed) {
 		// this ACK acknowledged data
 
@@ -2186,22 +2479,35 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			fSendList.Signal();
 			gSocketModule->notify(socket, B_SELECT_WRITE, fSendQueue.Used());
 		}
-
-		if (fCongestionWindow < fSlowStartThreshold)
-			fCongestionWindow += fSendMaxSegmentSize;
 	}
 
-	if (fCongestionWindow >= fSlowStartThreshold) {
-		uint32 increment = fSendMaxSegmentSize * fSendMaxSegmentSize;
-
-		if (increment < fCongestionWindow)
-			increment = 1;
-		else
-			increment /= fCongestionWindow;
-
-		fCongestionWindow += increment;
+	if ((fFlags & FLAG_RECOVERY) != 0) {
+		if (fSendUnacknowledged >= fRecoveryPoint) {
+			// everything that was outstanding when the loss was detected
+			// has arrived now
+			fFlags &= ~FLAG_RECOVERY;
+			fCongestionControl->ExitRecovery();
+			fDuplicateAcknowledgeCount = 0;
+		} else if (bytesAcknowledged > 0) {
+			// A partial acknowledgement: the data following it is lost,
+			// too (RFC 6582)
+			tcp_sequence lossEnd = fSendUnacknowledged
+				+ min_c(fSendMaxSegmentSize,
+					(fSendMax - fSendUnacknowledged).Number());
+			if (lossEnd > fLossEnd)
+				fLossEnd = lossEnd;
+			if ((fFlags & FLAG_OPTION_SACK_PERMITTED) == 0)
+				fDuplicateAcknowledgeCount = 0;
+		}
+	} else if (bytesAcknowledged > 0) {
+		fCongestionControl->Acknowledged(bytesAcknowledged, flightSize,
+			_SmoothedRoundTripTime());
+		fDuplicateAcknowledgeCount = 0;
 	}
 
+	if (fSendQueue.SackedBytes() == 0)
+		gStackModule->cancel_timer(&fReorderTimer);
+
 	// if there is data left to be send, send it now
 	if (fSendQueue.Used() > 0)
 		_SendQueued();
@@ -2212,7 +2518,17 @@ void
 TCPEndpoint::_Retransmit()
 {
 	TRACE("Retransmit()");
-	_ResetSlowStart();
+
+	fCongestionControl->RetransmitTimeout(
+		(fSendMax - fSendUnacknowledged).Number());
+
+	// the peer may have discarded data it selectively acknowledged, and
+	// everything in flight is considered lost now (RFC 2018)
+	fFlags &= ~FLAG_RECOVERY;
+	fSendQueue.ClearSacks();
+	fDuplicateAcknowledgeCount = 0;
+	gStackModule->cancel_timer(&fReorderTimer);
+
 	fSendNext = fSendUnacknowledged;
 	_SendQueued();
 }
@@ -2239,15 +2555,6 @@ TCPEndpoint::_UpdateRoundTripTime(int32 roundTripTime)
 }
 
 
-void
-TCPEndpoint::_ResetSlowStart()
-{
-	fSlowStartThreshold = max_c((fSendMax - fSendUnacknowledged).Number() / 2,
-		2 * fSendMaxSegmentSize);
-	fCongestionWindow = fSendMaxSegmentSize;
-}
-
-
 //	#pragma mark - timer
 
 
@@ -2301,6 +2608,28 @@ TCPEndpoint::_DelayedAcknowledgeTimer(net_timer* timer, void* _endpoint)
 }
 
 
+/*static*/ void
+TCPEndpoint::_ReorderTimer(net_timer* timer, void* _endpoint)
+{
+	TCPEndpoint* endpoint = (TCPEndpoint*)_endpoint;
+	T(Timer(endpoint, "reorder"));
+
+	MutexLocker locker(endpoint->fLock);
+	if (!locker.IsLocked())
+		return;
+
+	// the timer might not have been canceled early enough
+	if (endpoint->State() == CLOSED
+		|| (endpoint->fFlags & FLAG_RECOVERY) != 0
+		|| endpoint->fSendQueue.SackedBytes() == 0)
+		return;
+
+	// the hole has not been filled within the reordering window
+	endpoint->_EnterRecovery();
+	endpoint->_SendQueued();
+}
+
+
 /*static*/ void
 TCPEndpoint::_TimeWaitTimer(net_timer* timer, void* _endpoint)
 {
@@ -2373,7 +2702,17 @@ TCPEndpoint::Dump() const
 	kprintf("  round trip time: %" B_PRId32 " (deviation %" B_PRId32 ")\n",
 		fRoundTripTime, fRoundTripDeviation);
 	kprintf("  retransmit timeout: %" B_PRId64 "\n", fRetransmitTimeout);
-	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
-	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
+	kprintf("  congestion control: %s\n", fCongestionControl->Name());
+	kprintf("    window: %" B_PRIu32 "\n", fCongestionControl->Window());
+	kprintf("    slow start threshold: %" B_PRIu32 "\n",
+		fCongestionControl->SlowStartThreshold());
+	kprintf("    sacked: %lu\n", fSendQueue.SackedBytes());
+	if ((fFlags & FLAG_RECOVERY) != 0) {
+		kprintf("    recovery point: %" B_PRIu32 "\n",
+			fRecoveryPoint.Number());
+		kprintf("    retransmit next: %" B_PRIu32 "\n",
+			fRetransmitNext.Number());
+		kprintf("    loss end: %" B_PRIu32 "\n", fLossEnd.Number());
+	}
 }
 
@@ -12,6 +12,7 @@
 
 
 #include "BufferQueue.h"
+#include "CongestionControl.h"
 #include "EndpointManager.h"
 #include "tcp.h"
 
@@ -95,6 +96,9 @@ private:
 							uint32 flightSize);
 			status_t	_SendQueued(bool force = false);
 			status_t	_SendQueued(bool force, uint32 sendWindow);
+			status_t	_SendRetransmission(tcp_segment_header& segment,
+							tcp_sequence start, uint32 length);
+			void		_RetransmitLost(tcp_segment_header& segment);
 			int			_MaxSegmentSize(const struct sockaddr* address) const;
 			status_t	_Disconnect(bool closing);
 			ssize_t		_AvailableData() const;
@@ -123,14 +127,20 @@ private:
 			void		_Acknowledged(tcp_segment_header& segment);
 			void		_Retransmit();
 			void		_UpdateRoundTripTime(int32 roundTripTime);
-			void		_ResetSlowStart();
 			void		_DuplicateAcknowledge(tcp_segment_header& segment);
+			void		_UpdateScoreboard(tcp_segment_header& segment);
+			void		_EnterRecovery();
+			uint32		_PipeSize() const;
+			uint32		_EffectiveCongestionWindow() const;
+			bigtime_t	_SmoothedRoundTripTime() const;
+			status_t	_SetCongestionControl(const char* name);
 
 	static	void		_TimeWaitTimer(net_timer* timer, void* _endpoint);
 	static	void		_RetransmitTimer(net_timer* timer, void* _endpoint);
 	static	void		_PersistTimer(net_timer* timer, void* _endpoint);
 	static	void		_DelayedAcknowledgeTimer(net_timer* timer,
 							void* _endpoint);
+	static	void		_ReorderTimer(net_timer* timer, void* _endpoint);
 
 private:
 	TCPEndpoint*	fConnectionHashLink;
@@ -181,8 +191,12 @@ private:
 
 	uint32			fReceivedTimestamp;
 
-	uint32			fCongestionWindow;
-	uint32			fSlowStartThreshold;
+	CongestionControl* fCongestionControl;
+
+	// loss recovery
+	tcp_sequence	fRecoveryPoint;
+	tcp_sequence	fRetransmitNext;
+	tcp_sequence	fLossEnd;
 
 	tcp_state		fState;
 	uint32			fFlags;
@@ -192,6 +206,7 @@ private:
 	net_timer		fPersistTimer;
 	net_timer		fDelayedAcknowledgeTimer;
 	net_timer		fTimeWaitTimer;
+	net_timer		fReorderTimer;
 };
 
 #endif	// TCP_ENDPOINT_H
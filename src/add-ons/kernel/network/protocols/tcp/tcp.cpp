@@ -54,8 +54,8 @@ static EndpointManager* sEndpointManagers[AF_MAX];
 static rw_lock sEndpointManagersLock;
 
 
-// The TCP header length is at most 64 bytes.
-static const int kMaxOptionSize = 64 - sizeof(tcp_header);
+// The TCP header length is at most 60 bytes.
+static const int kMaxOptionSize = 60 - sizeof(tcp_header);
 
 
 /*!	Returns an endpoint manager for the specified domain, if any.
@@ -153,7 +153,11 @@ add_options(tcp_segment_header &segment, uint8 *buffer, size_t bufferSize)
 			bump_option(option, length);
 			option->kind = TCP_OPTION_SACK;
 			option->length = 2 + sackCount * sizeof(tcp_sack);
-			memcpy(option->sack, segment.sacks, sackCount * sizeof(tcp_sack));
+			for (int i = 0; i < sackCount; i++) {
+				option->sack[i].left_edge = htonl(segment.sacks[i].left_edge);
+				option->sack[i].right_edge
+					= htonl(segment.sacks[i].right_edge);
+			}
 			bump_option(option, length);
 		}
 	}
@@ -219,6 +223,20 @@ process_options(tcp_segment_header &segment, net_buffer *buffer, size_t size)
 				if (option->length == 2 && size >= 2)
 					segment.options |= TCP_SACK_PERMITTED;
 				break;
+			case TCP_OPTION_SACK:
+				if (option->length > 2 && option->length <= size) {
+					int count = min_c(
+						(int)((option->length - 2) / sizeof(tcp_sack)),
+						TCP_MAX_SACK_BLOCKS);
+					for (int i = 0; i < count; i++) {
+						segment.sacks[i].left_edge
+							= ntohl(option->sack[i].left_edge);
+						segment.sacks[i].right_edge
+							= ntohl(option->sack[i].right_edge);
+					}
+					segment.sack_count = count;
+				}
+				break;
 		}
 
 		if (length < 0) {
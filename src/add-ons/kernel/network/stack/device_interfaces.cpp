@@ -10,18 +10,21 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "receive_coalescing.h"
 #include "stack_private.h"
 #include "utility.h"
 
 #include <net_device.h>
 
 #include <lock.h>
+#include <smp.h>
 #include <util/AutoLock.h>
 
 #include <KernelExport.h>
 
 #include <net/if_dl.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
 #include <new>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,11 +39,99 @@
 #endif
 
 
+static const size_t kReceiveQueueSize = 16 * 1024 * 1024;
+static const int32 kMaxReceiveBatch = 32;
+
 static mutex sLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sDeviceIndex;
 
 
+/*!	Chooses the receive queue for the \a buffer: all packets of a connection
+	(or, if the ports cannot be determined, between two hosts) end up in the
+	same queue, so that their order is preserved.
+*/
+static net_receive_queue*
+receive_queue_for(net_device_interface* interface, net_buffer* buffer)
+{
+	if (interface->receive_queue_count == 1)
+		return &interface->receive_queues[0];
+
+	struct {
+		struct ip	header;
+		uint32		ports;
+	} packet;
+	uint32 hash = 0;
+
+	if (buffer->size >= sizeof(packet)
+		&& gNetBufferModule.read(buffer, 0, &packet, sizeof(packet)) == B_OK
+		&& ((uint8*)&packet.header)[0] == ((IPVERSION << 4)
+			| sizeof(struct ip) / 4)) {
+		hash = packet.header.ip_src.s_addr ^ packet.header.ip_dst.s_addr;
+
+		if ((packet.header.ip_p == IPPROTO_TCP
+				|| packet.header.ip_p == IPPROTO_UDP)
+			&& (ntohs(packet.header.ip_off) & (IP_MF | IP_OFFMASK)) == 0)
+			hash ^= packet.ports;
+
+		hash ^= hash >> 16;
+		hash ^= hash >> 8;
+	}
+
+	return &interface->receive_queues[hash % interface->receive_queue_count];
+}
+
+
+/*!	Passes the \a buffer on to the domain or the receive handlers. Only the
+	latter need the receive lock; \a locker holds it across calls, so that a
+	batch of buffers rarely has to acquire it more than once.
+*/
+static void
+deliver_buffer(net_device_interface* interface, net_buffer* buffer,
+	RecursiveLocker& locker)
+{
+	net_device* device = interface->device;
+
+	if (buffer->interface_address != NULL) {
+		// If the interface is already specified, this buffer was
+		// delivered locally.
+		locker.Unlock();
+
+		if (buffer->interface_address->domain->module->receive_data(buffer)
+				== B_OK)
+			buffer = NULL;
+	} else {
+		if (!locker.IsLocked())
+			locker.Lock();
+
+		sockaddr_dl& linkAddress = *(sockaddr_dl*)buffer->source;
+		int32 genericType = buffer->type;
+		int32 specificType = B_NET_FRAME_TYPE(linkAddress.sdl_type,
+			ntohs(linkAddress.sdl_e_type));
+
+		buffer->index = device->index;
+
+		// Find handler for this packet
+
+		DeviceHandlerList::Iterator iterator
+			= interface->receive_funcs.GetIterator();
+		while (buffer != NULL && iterator.HasNext()) {
+			net_device_handler* handler = iterator.Next();
+
+			// If the handler returns B_OK, it consumed the buffer - first
+			// handler wins.
+			if ((handler->type == genericType
+					|| handler->type == specificType)
+				&& handler->func(handler->cookie, device, buffer) == B_OK)
+				buffer = NULL;
+		}
+	}
+
+	if (buffer != NULL)
+		gNetBufferModule.free(buffer);
+}
+
+
 /*!	A service thread for each device interface. It just reads as many packets
 	as availabe, deframes them, and puts them into the receive queue of the
 	device interface.
@@ -67,7 +158,8 @@ device_reader_thread(void* _interface)
 				continue;
 			}
 
-			fifo_enqueue_buffer(&interface->receive_queue, buffer);
+			if (device_interface_enqueue_buffer(interface, buffer) != B_OK)
+				gNetBufferModule.free(buffer);
 		} else if (status == B_DEVICE_NOT_FOUND) {
 				device_removed(device);
 		} else {
@@ -81,56 +173,48 @@ device_reader_thread(void* _interface)
 }
 
 
+/*!	A service thread for each receive queue of a device interface. It takes
+	as many buffers as are waiting in its queue at once, merges consecutive
+	TCP segments of the same connection, and then passes them on to the
+	receive handlers, holding the receive lock for as long as it can.
+	The receive lock is recursive, as the handlers may register or unregister
+	handlers and monitors themselves. Therefore, the threads of the different
+	queues still pass their buffers on one after the other.
+*/
 static status_t
-device_consumer_thread(void* _interface)
+device_consumer_thread(void* _queue)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
-	net_device* device = interface->device;
-	net_buffer* buffer;
+	net_receive_queue* queue = (net_receive_queue*)_queue;
+	net_device_interface* interface = queue->interface;
+	net_buffer* buffers[kMaxReceiveBatch];
 
 	while (true) {
-		ssize_t status = fifo_dequeue_buffer(&interface->receive_queue, 0,
-			B_INFINITE_TIMEOUT, &buffer);
-		if (status != B_OK) {
-			if (status == B_INTERRUPTED)
+		ssize_t count = fifo_dequeue_buffers(&queue->fifo, buffers,
+			kMaxReceiveBatch, B_INFINITE_TIMEOUT);
+		if (count < 0) {
+			if (count == B_INTERRUPTED)
 				continue;
 			break;
 		}
 
-		if (buffer->interface_address != NULL) {
-			// If the interface is already specified, this buffer was
-			// delivered locally.
-			if (buffer->interface_address->domain->module->receive_data(buffer)
-					== B_OK)
-				buffer = NULL;
-		} else {
-			sockaddr_dl& linkAddress = *(sockaddr_dl*)buffer->source;
-			int32 genericType = buffer->type;
-			int32 specificType = B_NET_FRAME_TYPE(linkAddress.sdl_type,
-				ntohs(linkAddress.sdl_e_type));
+		queue->packets += count;
+		queue->batches++;
 
-			buffer->index = interface->device->index;
-
-			// Find handler for this packet
-
-			RecursiveLocker locker(interface->receive_lock);
-
-			DeviceHandlerList::Iterator iterator
-				= interface->receive_funcs.GetIterator();
-			while (buffer != NULL && iterator.HasNext()) {
-				net_device_handler* handler = iterator.Next();
-
-				// If the handler returns B_OK, it consumed the buffer - first
-				// handler wins.
-				if ((handler->type == genericType
-						|| handler->type == specificType)
-					&& handler->func(handler->cookie, device, buffer) == B_OK)
-					buffer = NULL;
+		int32 last = 0;
+		for (int32 i = 1; i < count; i++) {
+			if (coalesce_tcp_segments(buffers[last], buffers[i])) {
+				queue->coalesced++;
+				continue;
 			}
+
+			buffers[++last] = buffers[i];
 		}
+		count = last + 1;
 
-		if (buffer != NULL)
-			gNetBufferModule.free(buffer);
+		RecursiveLocker locker(interface->receive_lock, false, false);
+
+		for (int32 i = 0; i < count; i++)
+			deliver_buffer(interface, buffers[i], locker);
 	}
 
 	return B_OK;
@@ -173,27 +257,60 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 	recursive_lock_init(&interface->receive_lock, "device interface receive");
 	mutex_init(&interface->monitor_lock, "device interface monitors");
 
-	char name[128];
-	snprintf(name, sizeof(name), "%s receive queue", device->name);
-
-	if (init_fifo(&interface->receive_queue, name, 16 * 1024 * 1024) < B_OK)
-		goto error1;
-
 	interface->device = device;
 	interface->up_count = 0;
 	interface->ref_count = 1;
 	interface->monitor_count = 0;
 	interface->deframe_func = NULL;
 	interface->deframe_ref_count = 0;
+	interface->reader_thread   = -1;
 
-	snprintf(name, sizeof(name), "%s consumer", device->name);
+	// one receive queue and consumer thread per CPU
+	interface->receive_queue_count = min_c(smp_get_num_cpus(),
+		MAX_RECEIVE_QUEUES);
 
-	interface->reader_thread   = -1;
-	interface->consumer_thread = spawn_kernel_thread(device_consumer_thread,
-		name, B_DISPLAY_PRIORITY, interface);
-	if (interface->consumer_thread < B_OK)
-		goto error2;
-	resume_thread(interface->consumer_thread);
+	uint32 index = 0;
+	for (; index < interface->receive_queue_count; index++) {
+		net_receive_queue& queue = interface->receive_queues[index];
+		queue.interface = interface;
+		queue.packets = 0;
+		queue.batches = 0;
+		queue.coalesced = 0;
+
+		char name[128];
+		snprintf(name, sizeof(name), "%s receive queue %" B_PRIu32,
+			device->name, index);
+
+		if (init_fifo(&queue.fifo, name,
+				kReceiveQueueSize / interface->receive_queue_count) < B_OK)
+			break;
+
+		snprintf(name, sizeof(name), "%s consumer %" B_PRIu32, device->name,
+			index);
+
+		queue.consumer_thread = spawn_kernel_thread(device_consumer_thread,
+			name, B_DISPLAY_PRIORITY, &queue);
+		if (queue.consumer_thread < B_OK) {
+			uninit_fifo(&queue.fifo);
+			break;
+		}
+		resume_thread(queue.consumer_thread);
+	}
+
+	if (index < interface->receive_queue_count) {
+		while (index-- > 0) {
+			net_receive_queue& queue = interface->receive_queues[index];
+			uninit_fifo(&queue.fifo);
+
+			status_t status;
+			wait_for_thread(queue.consumer_thread, &status);
+		}
+
+		recursive_lock_destroy(&interface->receive_lock);
+		mutex_destroy(&interface->monitor_lock);
+		delete interface;
+		return NULL;
+	}
 
 	// TODO: proper interface index allocation
 	device->index = ++sDeviceIndex;
@@ -201,15 +318,6 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	sInterfaces.Add(interface);
 	return interface;
-
-error2:
-	uninit_fifo(&interface->receive_queue);
-error1:
-	recursive_lock_destroy(&interface->receive_lock);
-	mutex_destroy(&interface->monitor_lock);
-	delete interface;
-
-	return NULL;
 }
 
 
@@ -247,7 +355,6 @@ dump_device_interface(int argc, char** argv)
 	kprintf("ref_count:         %" B_PRId32 "\n", interface->ref_count);
 	kprintf("deframe_func:      %p\n", interface->deframe_func);
 	kprintf("deframe_ref_count: %" B_PRId32 "\n", interface->ref_count);
-	kprintf("consumer_thread:   %" B_PRId32 "\n", interface->consumer_thread);
 
 	kprintf("monitor_count:     %" B_PRId32 "\n", interface->monitor_count);
 	kprintf("monitor_lock:      %p\n", &interface->monitor_lock);
@@ -258,7 +365,14 @@ dump_device_interface(int argc, char** argv)
 		kprintf("  %p\n", monitorIterator.Next());
 
 	kprintf("receive_lock:      %p\n", &interface->receive_lock);
-	kprintf("receive_queue:     %p\n", &interface->receive_queue);
+	kprintf("receive_queues:\n");
+	for (uint32 i = 0; i < interface->receive_queue_count; i++) {
+		const net_receive_queue& queue = interface->receive_queues[i];
+		kprintf("  %p: consumer %" B_PRId32 ", %" B_PRId64 " packets in %"
+			B_PRId64 " batches, %" B_PRId64 " coalesced\n", &queue.fifo,
+			queue.consumer_thread, queue.packets, queue.batches,
+			queue.coalesced);
+	}
 	kprintf("receive_funcs:\n");
 	DeviceHandlerList::Iterator handlerIterator
 		= interface->receive_funcs.GetIterator();
@@ -382,9 +496,13 @@ put_device_interface(struct net_device_interface* interface)
 	sInterfaces.Remove(interface);
 	locker.Unlock();
 
-	uninit_fifo(&interface->receive_queue);
-	status_t status;
-	wait_for_thread(interface->consumer_thread, &status);
+	for (uint32 i = 0; i < interface->receive_queue_count; i++) {
+		net_receive_queue& queue = interface->receive_queues[i];
+		uninit_fifo(&queue.fifo);
+
+		status_t status;
+		wait_for_thread(queue.consumer_thread, &status);
+	}
 
 	net_device* device = interface->device;
 	const char* moduleName = device->module->info.name;
@@ -789,6 +907,18 @@ device_removed(net_device* device)
 }
 
 
+/*!	Puts the \a buffer into one of the receive queues of the \a interface,
+	from where it will be passed on to the receive handlers.
+*/
+status_t
+device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer)
+{
+	return fifo_enqueue_buffer(&receive_queue_for(interface, buffer)->fifo,
+		buffer);
+}
+
+
 status_t
 device_enqueue_buffer(net_device* device, net_buffer* buffer)
 {
@@ -796,7 +926,7 @@ device_enqueue_buffer(net_device* device, net_buffer* buffer)
 	if (interface == NULL)
 		return B_DEVICE_NOT_FOUND;
 
-	status_t status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+	status_t status = device_interface_enqueue_buffer(interface, buffer);
 
 	put_device_interface(interface);
 	return status;
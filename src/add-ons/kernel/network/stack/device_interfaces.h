@@ -26,6 +26,21 @@ typedef DoublyLinkedList<net_device_handler> DeviceHandlerList;
 typedef DoublyLinkedList<net_device_monitor,
 	DoublyLinkedListCLink<net_device_monitor> > DeviceMonitorList;
 
+#define MAX_RECEIVE_QUEUES	4
+
+struct net_device_interface;
+
+struct net_receive_queue {
+	net_device_interface* interface;
+	net_fifo			fifo;
+	thread_id			consumer_thread;
+
+	// statistics
+	int64				packets;
+	int64				batches;
+	int64				coalesced;
+};
+
 struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	struct net_device*	device;
 	thread_id			reader_thread;
@@ -43,8 +58,8 @@ struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	DeviceHandlerList	receive_funcs;
 	recursive_lock		receive_lock;
 
-	thread_id			consumer_thread;
-	net_fifo			receive_queue;
+	uint32				receive_queue_count;
+	net_receive_queue	receive_queues[MAX_RECEIVE_QUEUES];
 };
 
 typedef DoublyLinkedList<net_device_interface> DeviceInterfaceList;
@@ -62,6 +77,8 @@ struct net_device_interface* get_device_interface(const char* name,
 	bool create = true);
 void device_interface_monitor_receive(net_device_interface* interface,
 	net_buffer* buffer);
+status_t device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer);
 status_t up_device_interface(net_device_interface* interface);
 void down_device_interface(net_device_interface* interface);
 
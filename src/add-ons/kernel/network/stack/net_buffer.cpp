@@ -53,6 +53,8 @@
 #define DATA_NODE_READ_ONLY		0x1
 #define DATA_NODE_STORED_HEADER	0x2
 
+#define DATA_HEADER_EXTERNAL	0x1
+
 struct header_space {
 	uint16	size;
 	uint16	free;
@@ -70,6 +72,14 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	uint16			flags;
+};
+
+// A data header for data that lives outside of the header, and is only
+// referenced by the nodes that use it.
+struct external_data_header : data_header {
+	void			(*free_data)(void* cookie);
+	void*			cookie;
 };
 
 struct data_node {
@@ -153,6 +163,7 @@ struct net_buffer_private : net_buffer {
 
 static object_cache* sNetBufferCache;
 static object_cache* sDataNodeCache;
+static object_cache* sExternalHeaderCache;
 
 
 static status_t append_data(net_buffer* buffer, const void* data, size_t size);
@@ -813,6 +824,7 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->flags = 0;
 
 	TRACE(("%ld:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -829,6 +841,16 @@ release_data_header(data_header* header)
 		return;
 
 	TRACE(("%ld:   free header %p\n", find_thread(NULL), header));
+
+	if ((header->flags & DATA_HEADER_EXTERNAL) != 0) {
+		external_data_header* externalHeader = (external_data_header*)header;
+		if (externalHeader->free_data != NULL)
+			externalHeader->free_data(externalHeader->cookie);
+
+		object_cache_free(sExternalHeaderCache, externalHeader, 0);
+		return;
+	}
+
 	free_data_header(header);
 }
 
@@ -1413,7 +1435,8 @@ merge_buffer(net_buffer* _buffer, net_buffer* _with, bool after)
 		if (node == NULL)
 			break;
 
-		if ((uint8*)node > (uint8*)node->header
+		if ((node->header->flags & DATA_HEADER_EXTERNAL) == 0
+			&& (uint8*)node > (uint8*)node->header
 			&& (uint8*)node < (uint8*)node->header + BUFFER_SIZE) {
 			// The node is already in the buffer, we can just move it
 			// over to the new owner
@@ -2008,6 +2031,78 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 }
 
 
+/*!	Appends \a size bytes at \a data to the buffer without copying them: the
+	data is referenced by read-only data nodes, and \a freeData is called
+	with \a cookie as soon as the last node referencing it is gone. That
+	includes the nodes of buffers that cloned the data from this one.
+	If this function fails, the caller remains the owner of the data.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, void* data, size_t size,
+	void (*freeData)(void* cookie), void* cookie)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+	TRACE(("%ld: append_external_data(buffer %p, data %p, size %ld)\n",
+		find_thread(NULL), buffer, data, size));
+
+	if (size == 0)
+		return B_OK;
+
+	ParanoiaChecker _(buffer);
+
+	external_data_header* header = (external_data_header*)object_cache_alloc(
+		sExternalHeaderCache, 0);
+	if (header == NULL)
+		return B_NO_MEMORY;
+
+	header->ref_count = 1;
+	header->physical_address = 0;
+	header->first_free = NULL;
+	header->data_end = (uint8*)data + size;
+	header->space.size = 0;
+	header->space.free = 0;
+	header->tail_space = 0;
+	header->flags = DATA_HEADER_EXTERNAL;
+	header->free_data = freeData;
+	header->cookie = cookie;
+
+	// the size of a node is limited to 16 bit
+	const size_t kMaxNodeSize = 32768;
+	size_t sizeAppended = 0;
+
+	while (sizeAppended < size) {
+		data_node* node = add_data_node(buffer, header);
+		if (node == NULL) {
+			remove_trailer(buffer, sizeAppended);
+
+			// the caller keeps the data
+			header->free_data = NULL;
+			release_data_header(header);
+			return ENOBUFS;
+		}
+
+		node->offset = buffer->size;
+		node->start = (uint8*)data + sizeAppended;
+		node->used = min_c(size - sizeAppended, kMaxNodeSize);
+		node->flags = DATA_NODE_READ_ONLY;
+
+		list_add_item(&buffer->buffers, node);
+
+		buffer->size += node->used;
+		sizeAppended += node->used;
+	}
+
+	// the nodes have their own references to the header now
+	release_data_header(header);
+
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+	CHECK_BUFFER(buffer);
+
+	return B_OK;
+}
+
+
 void
 set_ancillary_data(net_buffer* buffer, ancillary_data_container* container)
 {
@@ -2324,6 +2419,15 @@ std_ops(int32 op, ...)
 				return B_NO_MEMORY;
 			}
 
+			sExternalHeaderCache = create_object_cache(
+				"external data header cache", sizeof(external_data_header), 8,
+				NULL, NULL, NULL);
+			if (sExternalHeaderCache == NULL) {
+				delete_object_cache(sNetBufferCache);
+				delete_object_cache(sDataNodeCache);
+				return B_NO_MEMORY;
+			}
+
 #if ENABLE_STATS
 			add_debugger_command_etc("net_buffer_stats", &dump_net_buffer_stats,
 				"Print net buffer statistics",
@@ -2345,6 +2449,7 @@ std_ops(int32 op, ...)
 #endif
 			delete_object_cache(sNetBufferCache);
 			delete_object_cache(sDataNodeCache);
+			delete_object_cache(sExternalHeaderCache);
 			return B_OK;
 
 		default:
@@ -2377,6 +2482,7 @@ net_buffer_module_info gNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	append_external_data,
 
 	NULL,	// associate_data
 
@@ -1487,6 +1487,96 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Sends \a length bytes from the kernel buffer \a data to the connected
+	peer of the socket without copying them into the buffers: they are only
+	referenced from the net_buffers, and \a freeData is called with \a cookie
+	once the last of them is gone, which might well be after this function
+	has returned (for example, when the data has to remain queued for
+	retransmission).
+	The socket always takes over ownership of the data, even on failure.
+	Protocols that cannot make use of this (atomic messages, or those
+	without buffers) transparently fall back to socket_send().
+*/
+ssize_t
+socket_send_external(net_socket* socket, void* data, size_t length, int flags,
+	void (*freeData)(void* cookie), void* cookie)
+{
+	if (length > SSIZE_MAX) {
+		freeData(cookie);
+		return B_BAD_VALUE;
+	}
+
+	if (socket->first_info->send_data_no_buffer != NULL
+		|| (socket->first_info->flags & NET_PROTOCOL_ATOMIC_MESSAGES) != 0
+		|| socket->peer.ss_len == 0) {
+		ssize_t bytesSent = socket_send(socket, NULL, data, length, flags);
+		freeData(cookie);
+		return bytesSent;
+	}
+
+	net_buffer* source = gNetBufferModule.create(0);
+	if (source == NULL) {
+		freeData(cookie);
+		return ENOBUFS;
+	}
+
+	status_t status = gNetBufferModule.append_external(source, data, length,
+		freeData, cookie);
+	if (status != B_OK) {
+		gNetBufferModule.free(source);
+		freeData(cookie);
+		return status;
+	}
+
+	// From here on, the data is freed with the last buffer referencing it
+
+	ssize_t bytesSent = 0;
+
+	while ((size_t)bytesSent < length) {
+		net_buffer* buffer = gNetBufferModule.create(256);
+		if (buffer == NULL) {
+			status = ENOBUFS;
+			break;
+		}
+
+		size_t bytes = min_c(length - bytesSent, socket->send.buffer_size);
+		status = gNetBufferModule.append_cloned(buffer, source, bytesSent,
+			bytes);
+		if (status != B_OK) {
+			gNetBufferModule.free(buffer);
+			break;
+		}
+
+		buffer->flags = flags;
+		memcpy(buffer->source, &socket->address, socket->address.ss_len);
+		memcpy(buffer->destination, &socket->peer, socket->peer.ss_len);
+
+		status = socket->first_info->send_data(socket->first_protocol, buffer);
+		if (status != B_OK) {
+			size_t sizeAfterSend = buffer->size;
+			gNetBufferModule.free(buffer);
+
+			if ((sizeAfterSend != bytes || bytesSent > 0)
+				&& (status == B_INTERRUPTED || status == B_WOULD_BLOCK)) {
+				// this appears to be a partial write
+				bytesSent += bytes - sizeAfterSend;
+				status = B_OK;
+			}
+			break;
+		}
+
+		bytesSent += bytes;
+	}
+
+	gNetBufferModule.free(source);
+
+	if (status != B_OK)
+		return status;
+
+	return bytesSent;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1764,6 +1854,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_listen,
 	socket_receive,
 	socket_send,
+	socket_send_external,
 	socket_setsockopt,
 	socket_shutdown,
 	socket_socketpair
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Coalesces consecutive TCP segments of the same connection into a single
+	larger one before they enter the protocol layers, so that the IPv4 and
+	TCP receive paths, and their locking, only run once for all of them.
+
+	The segments must not carry any information that would get lost by the
+	merge (the flags besides ACK and PUSH, the acknowledge number, the window,
+	and the options must all be the same). The checksum of the merged segment
+	is derived from the original checksums, instead of being verified here:
+	if any of the original segments was corrupted, the merged one will not
+	pass the check in the TCP module either.
+*/
+
+
+#include "receive_coalescing.h"
+
+#include <net/if_types.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <string.h>
+
+#include <net_datalink.h>
+#include <net_stack.h>
+
+#include "stack_private.h"
+#include "utility.h"
+
+
+// We cannot use the TH_* constants of <netinet/tcp.h>, as they are not
+// exported.
+enum {
+	TCP_FLAG_FINISH			= 0x01,
+	TCP_FLAG_SYNCHRONIZE	= 0x02,
+	TCP_FLAG_RESET			= 0x04,
+	TCP_FLAG_PUSH			= 0x08,
+	TCP_FLAG_ACKNOWLEDGE	= 0x10,
+	TCP_FLAG_URGENT			= 0x20
+};
+
+static const size_t kMaxTCPOptionsLength = 40;
+
+struct tcp_segment {
+	struct ip		ip;
+	struct tcphdr	tcp;
+	uint8			options[kMaxTCPOptionsLength];
+	size_t			tcp_header_length;
+	size_t			header_length;
+	uint32			data_length;
+};
+
+
+static inline uint32
+fold_sum(uint32 sum)
+{
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
+static uint32
+sum_words(const void* _data, size_t length)
+{
+	const uint16* data = (const uint16*)_data;
+	uint32 sum = 0;
+
+	for (size_t i = 0; i < length / 2; i++)
+		sum += data[i];
+
+	return fold_sum(sum);
+}
+
+
+/*!	Returns the one's complement sum of the TCP pseudo header and the TCP
+	header (without its checksum) of the \a segment, for the given TCP length.
+*/
+static uint32
+tcp_header_sum(const tcp_segment& segment, uint8 flags, uint32 tcpLength)
+{
+	struct tcphdr header = segment.tcp;
+	header.th_flags = flags;
+	header.th_sum = 0;
+
+	uint32 sum = sum_words(&segment.ip.ip_src, sizeof(in_addr))
+		+ sum_words(&segment.ip.ip_dst, sizeof(in_addr))
+		+ htons(IPPROTO_TCP) + htons(tcpLength)
+		+ sum_words(&header, sizeof(struct tcphdr))
+		+ sum_words(segment.options,
+			segment.tcp_header_length - sizeof(struct tcphdr));
+
+	return fold_sum(sum);
+}
+
+
+/*!	Returns the one's complement sum of the data of the \a segment, as
+	claimed by its checksum.
+*/
+static uint32
+tcp_data_sum(const tcp_segment& segment)
+{
+	uint32 headerSum = tcp_header_sum(segment, segment.tcp.th_flags,
+		segment.tcp_header_length + segment.data_length);
+
+	return fold_sum((uint16)~segment.tcp.th_sum + (uint16)~headerSum);
+}
+
+
+static bool
+is_ipv4_buffer(net_buffer* buffer)
+{
+	if (buffer->interface_address != NULL) {
+		// delivered locally, the buffer goes directly to its domain
+		return buffer->interface_address->domain->family == AF_INET;
+	}
+
+	return buffer->type == B_NET_FRAME_TYPE_IPV4;
+}
+
+
+static bool
+read_segment(net_buffer* buffer, tcp_segment& segment)
+{
+	if (buffer->size < sizeof(struct ip) + sizeof(struct tcphdr)
+		|| gNetBufferModule.read(buffer, 0, &segment.ip,
+			sizeof(struct ip)) != B_OK)
+		return false;
+
+	// only plain IPv4 without options or fragmentation
+	if (((uint8*)&segment.ip)[0] != ((IPVERSION << 4) | sizeof(struct ip) / 4)
+		|| segment.ip.ip_p != IPPROTO_TCP
+		|| (ntohs(segment.ip.ip_off) & (IP_MF | IP_OFFMASK)) != 0
+		|| ntohs(segment.ip.ip_len) != buffer->size)
+		return false;
+
+	if (gNetBufferModule.read(buffer, sizeof(struct ip), &segment.tcp,
+			sizeof(struct tcphdr)) != B_OK)
+		return false;
+
+	segment.tcp_header_length = (((uint8*)&segment.tcp)[12] >> 4) * 4;
+	segment.header_length = sizeof(struct ip) + segment.tcp_header_length;
+	if (segment.tcp_header_length < sizeof(struct tcphdr)
+		|| segment.header_length >= buffer->size)
+		return false;
+
+	segment.data_length = buffer->size - segment.header_length;
+
+	return gNetBufferModule.read(buffer,
+		sizeof(struct ip) + sizeof(struct tcphdr), segment.options,
+		segment.tcp_header_length - sizeof(struct tcphdr)) == B_OK;
+}
+
+
+static bool
+can_coalesce(const tcp_segment& first, const tcp_segment& next)
+{
+	if (first.ip.ip_src.s_addr != next.ip.ip_src.s_addr
+		|| first.ip.ip_dst.s_addr != next.ip.ip_dst.s_addr
+		|| first.ip.ip_tos != next.ip.ip_tos
+		|| first.tcp.th_sport != next.tcp.th_sport
+		|| first.tcp.th_dport != next.tcp.th_dport)
+		return false;
+
+	// a PUSH ends the coalescing
+	if (first.tcp.th_flags != TCP_FLAG_ACKNOWLEDGE
+		|| (next.tcp.th_flags & ~TCP_FLAG_PUSH) != TCP_FLAG_ACKNOWLEDGE)
+		return false;
+
+	if (first.tcp.th_ack != next.tcp.th_ack
+		|| first.tcp.th_win != next.tcp.th_win
+		|| ntohl(first.tcp.th_seq) + first.data_length
+			!= ntohl(next.tcp.th_seq))
+		return false;
+
+	if (first.tcp_header_length != next.tcp_header_length
+		|| memcmp(first.options, next.options,
+			first.tcp_header_length - sizeof(struct tcphdr)) != 0)
+		return false;
+
+	// The data of the first segment must end on a 16 bit boundary for the
+	// checksums to be combinable
+	return (first.data_length & 1) == 0
+		&& ntohs(first.ip.ip_len) + next.data_length <= IP_MAXPACKET;
+}
+
+
+/*!	Appends the data of the TCP segment in \a next to the one in \a buffer,
+	if both belong to the same connection, and follow each other directly.
+	Both buffers must have been received from the same source.
+	Returns \c true if \a next has been consumed.
+*/
+bool
+coalesce_tcp_segments(net_buffer* buffer, net_buffer* next)
+{
+	if (buffer->interface_address != next->interface_address
+		|| buffer->flags != next->flags
+		|| !is_ipv4_buffer(buffer) || !is_ipv4_buffer(next))
+		return false;
+
+	if (buffer->interface_address == NULL
+		&& (buffer->source->sa_len != next->source->sa_len
+			|| memcmp(buffer->source, next->source, buffer->source->sa_len)
+				!= 0
+			|| buffer->destination->sa_len != next->destination->sa_len
+			|| memcmp(buffer->destination, next->destination,
+				buffer->destination->sa_len) != 0))
+		return false;
+
+	tcp_segment first;
+	tcp_segment second;
+	if (!read_segment(buffer, first) || !read_segment(next, second)
+		|| !can_coalesce(first, second))
+		return false;
+
+	// The IP header will be rewritten, so it must be valid
+	if (gNetBufferModule.checksum(buffer, 0, sizeof(struct ip), true) != 0
+		|| gNetBufferModule.checksum(next, 0, sizeof(struct ip), true) != 0)
+		return false;
+
+	uint8 flags = first.tcp.th_flags | second.tcp.th_flags;
+	uint32 dataLength = first.data_length + second.data_length;
+	uint32 dataSum = fold_sum(tcp_data_sum(first) + tcp_data_sum(second));
+	uint16 tcpChecksum = ~fold_sum(tcp_header_sum(first, flags,
+		first.tcp_header_length + dataLength) + dataSum);
+
+	if (gNetBufferModule.remove_header(next, second.header_length) != B_OK)
+		return false;
+
+	if (gNetBufferModule.merge(buffer, next, true) != B_OK) {
+		// the segment is lost, but TCP will recover from that
+		gNetBufferModule.free(next);
+		return true;
+	}
+
+	first.ip.ip_len = htons(first.header_length + dataLength);
+	first.ip.ip_sum = 0;
+	first.ip.ip_sum = checksum((uint8*)&first.ip, sizeof(struct ip));
+	first.tcp.th_flags = flags;
+	first.tcp.th_sum = tcpChecksum;
+
+	gNetBufferModule.write(buffer, 0, &first.ip, sizeof(struct ip));
+	gNetBufferModule.write(buffer, sizeof(struct ip), &first.tcp,
+		sizeof(struct tcphdr));
+	return true;
+}
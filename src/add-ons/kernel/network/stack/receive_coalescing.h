@@ -0,0 +1,15 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RECEIVE_COALESCING_H
+#define RECEIVE_COALESCING_H
+
+
+#include <net_buffer.h>
+
+
+bool coalesce_tcp_segments(net_buffer* buffer, net_buffer* next);
+
+
+#endif	// RECEIVE_COALESCING_H
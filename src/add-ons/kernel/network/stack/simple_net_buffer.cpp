@@ -702,6 +702,7 @@ net_buffer_module_info gSimpleNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	NULL,	// append_external
 
 	NULL,	// associate_data
 
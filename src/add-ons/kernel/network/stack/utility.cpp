@@ -425,6 +425,47 @@ fifo_dequeue_buffer(net_fifo* fifo, uint32 flags, bigtime_t timeout,
 }
 
 
+/*!	Removes up to \a count buffers from the FIFO with a single lock
+	acquisition. If the FIFO is empty, it will wait for the first buffer as
+	long as the \a timeout allows.
+	Returns the number of buffers dequeued, or an error code.
+*/
+ssize_t
+fifo_dequeue_buffers(net_fifo* fifo, net_buffer** buffers, size_t count,
+	bigtime_t timeout)
+{
+	MutexLocker locker(fifo->lock);
+
+	while (list_get_first_item(&fifo->buffers) == NULL) {
+		if (timeout == 0)
+			return B_WOULD_BLOCK;
+
+		fifo->waiting++;
+		locker.Unlock();
+
+		status_t status = acquire_sem_etc(fifo->notify, 1,
+			B_CAN_INTERRUPT | B_RELATIVE_TIMEOUT, timeout);
+		if (status < B_OK)
+			return status;
+
+		locker.Lock();
+	}
+
+	size_t dequeued = 0;
+	while (dequeued < count) {
+		net_buffer* buffer
+			= (net_buffer*)list_remove_head_item(&fifo->buffers);
+		if (buffer == NULL)
+			break;
+
+		fifo->current_bytes -= buffer->size;
+		buffers[dequeued++] = buffer;
+	}
+
+	return dequeued;
+}
+
+
 status_t
 clear_fifo(net_fifo* fifo)
 {
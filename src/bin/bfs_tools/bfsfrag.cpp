@@ -0,0 +1,327 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+//!	Reports how fragmented the files on a BFS volume are
+
+
+#include "Disk.h"
+#include "Inode.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+
+static const int32 kHistogramSlots = 8;
+static const int32 kWorstFiles = 10;
+
+
+struct file_extents {
+	block_run	run;
+	int64		extents;
+	off_t		size;
+};
+
+
+char gEscape[3] = {0x1b, '[', 0};
+off_t gCount = 1;
+bool gVerbose = false;
+
+int64 gFiles = 0;
+int64 gFragmentedFiles = 0;
+int64 gExtents = 0;
+int64 gRuns = 0;
+int64 gHistogram[kHistogramSlots];
+file_extents gWorst[kWorstFiles];
+
+
+/*!	Counts the physically contiguous extents of a data stream. Consecutive
+	block runs that directly follow each other on disk count as one.
+*/
+class ExtentCounter {
+public:
+	ExtentCounter(Disk& disk)
+		:
+		fDisk(disk),
+		fExtents(0),
+		fRuns(0),
+		fLastEnd(-1)
+	{
+	}
+
+	void Add(const block_run& run)
+	{
+		off_t start = fDisk.ToBlock(run);
+		if (start != fLastEnd)
+			fExtents++;
+
+		fLastEnd = start + run.length;
+		fRuns++;
+	}
+
+	status_t AddArray(const block_run& arrayRun, bool doubleIndirect)
+	{
+		int32 bytes = arrayRun.length << fDisk.BlockShift();
+		block_run* array = (block_run*)malloc(bytes);
+		if (array == NULL)
+			return B_NO_MEMORY;
+
+		if (fDisk.ReadAt(fDisk.ToOffset(arrayRun), array, bytes) < bytes) {
+			free(array);
+			return B_IO_ERROR;
+		}
+
+		status_t status = B_OK;
+		int32 count = bytes / sizeof(block_run);
+		for (int32 i = 0; i < count; i++) {
+			if (array[i].IsZero())
+				break;
+
+			if (doubleIndirect) {
+				status = AddArray(array[i], false);
+				if (status != B_OK)
+					break;
+			} else
+				Add(array[i]);
+		}
+
+		free(array);
+		return status;
+	}
+
+	int64 Extents() const { return fExtents; }
+	int64 Runs() const { return fRuns; }
+
+private:
+	Disk&	fDisk;
+	int64	fExtents;
+	int64	fRuns;
+	off_t	fLastEnd;
+};
+
+
+status_t
+countExtents(Disk& disk, Inode* inode, ExtentCounter& counter)
+{
+	const data_stream* data = &inode->InodeBuffer()->data;
+
+	for (int32 i = 0; i < NUM_DIRECT_BLOCKS; i++) {
+		if (data->direct[i].IsZero())
+			break;
+
+		counter.Add(data->direct[i]);
+	}
+
+	if (data->max_indirect_range == 0 || data->indirect.IsZero())
+		return B_OK;
+
+	status_t status = counter.AddArray(data->indirect, false);
+	if (status != B_OK)
+		return status;
+
+	if (data->max_double_indirect_range == 0 || data->double_indirect.IsZero())
+		return B_OK;
+
+	return counter.AddArray(data->double_indirect, true);
+}
+
+
+void
+addToWorst(const block_run& run, int64 extents, off_t size)
+{
+	int32 index = kWorstFiles - 1;
+	if (gWorst[index].extents >= extents)
+		return;
+
+	while (index > 0 && gWorst[index - 1].extents < extents) {
+		gWorst[index] = gWorst[index - 1];
+		index--;
+	}
+
+	gWorst[index].run = run;
+	gWorst[index].extents = extents;
+	gWorst[index].size = size;
+}
+
+
+void
+scanFile(Disk& disk, Inode* inode, const char* name)
+{
+	if (inode->Size() == 0)
+		return;
+
+	ExtentCounter counter(disk);
+	status_t status = countExtents(disk, inode, counter);
+	if (status != B_OK) {
+		printf("  Could not read the data stream of \"%s\" (%ld, %u): %s\n",
+			name, inode->BlockRun().allocation_group, inode->BlockRun().start,
+			strerror(status));
+		return;
+	}
+
+	int64 extents = counter.Extents();
+
+	gFiles++;
+	gExtents += extents;
+	gRuns += counter.Runs();
+	if (extents > 1)
+		gFragmentedFiles++;
+
+	int32 slot = 0;
+	while (slot < kHistogramSlots - 1 && (1LL << slot) < extents)
+		slot++;
+	gHistogram[slot]++;
+
+	addToWorst(inode->BlockRun(), extents, inode->Size());
+
+	if (gVerbose) {
+		printf("%8Ld %8Ld  (%ld, %u) %s\n", extents, counter.Runs(),
+			inode->BlockRun().allocation_group, inode->BlockRun().start,
+			name);
+	}
+}
+
+
+void
+scanFiles(Disk& disk, Directory* directory)
+{
+	if (directory == NULL)
+		return;
+
+	directory->Rewind();
+	char name[B_FILE_NAME_LENGTH];
+	block_run run;
+	while (directory->GetNextEntry(name, &run) == B_OK) {
+		if (!strcmp(name, ".") || !strcmp(name, ".."))
+			continue;
+
+		if (!gVerbose && ++gCount % 50 == 0)
+			printf("  %7Ld%s1A\n", gCount, gEscape);
+
+		Inode* inode = Inode::Factory(&disk, run);
+		if (inode != NULL) {
+			if (inode->IsDirectory())
+				scanFiles(disk, static_cast<Directory*>(inode));
+			else if (inode->IsFile())
+				scanFile(disk, inode, name);
+
+			delete inode;
+		} else {
+			printf("  Directory \"%s\" (%ld, %d) points to corrupt inode \"%s\" "
+				"(%ld, %d)\n", directory->Name(),
+				directory->BlockRun().allocation_group,
+				directory->BlockRun().start, name, run.allocation_group,
+				run.start);
+		}
+	}
+}
+
+
+void
+printReport()
+{
+	printf("\n%Ld files with data, %Ld block runs, %Ld extents\n", gFiles,
+		gRuns, gExtents);
+	if (gFiles == 0)
+		return;
+
+	printf("  %.2f runs per file, %.2f extents per file\n",
+		1.0 * gRuns / gFiles, 1.0 * gExtents / gFiles);
+	printf("  %Ld files (%.1f%%) are fragmented\n", gFragmentedFiles,
+		100.0 * gFragmentedFiles / gFiles);
+
+	puts("\nextents     files");
+	for (int32 slot = 0; slot < kHistogramSlots; slot++) {
+		if (slot == 0)
+			printf("      1");
+		else if (slot == kHistogramSlots - 1)
+			printf("  > %3Ld", 1LL << (slot - 1));
+		else
+			printf("  <= %3Ld", 1LL << slot);
+
+		printf("  %8Ld\n", gHistogram[slot]);
+	}
+
+	puts("\nmost fragmented files:");
+	for (int32 i = 0; i < kWorstFiles; i++) {
+		if (gWorst[i].extents <= 1)
+			break;
+
+		printf("  (%ld, %u) %Ld extents, %Ld bytes\n",
+			gWorst[i].run.allocation_group, gWorst[i].run.start,
+			gWorst[i].extents, gWorst[i].size);
+	}
+}
+
+
+void
+printUsage(char* tool)
+{
+	char* filename = strrchr(tool, '/');
+	fprintf(stderr, "usage: %s [-v] <device>\n"
+		"\t-v\tlist the number of extents and runs of every file\n",
+		filename ? filename + 1 : tool);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	char* toolName = argv[0];
+	if (argc < 2 || !strcmp(argv[1], "--help")) {
+		printUsage(toolName);
+		return -1;
+	}
+
+	while (*++argv) {
+		char *arg = *argv;
+		if (*arg == '-') {
+			while (*++arg && isalpha(*arg)) {
+				switch (*arg) {
+					case 'v':
+						gVerbose = true;
+						break;
+					default:
+						printUsage(toolName);
+						return -1;
+				}
+			}
+		} else
+			break;
+	}
+
+	if (argv[0] == NULL) {
+		printUsage(toolName);
+		return -1;
+	}
+
+	Disk disk(argv[0]);
+	status_t status = disk.InitCheck();
+	if (status < B_OK) {
+		fprintf(stderr, "Could not open device or file \"%s\": %s\n",
+			argv[0], strerror(status));
+		return -1;
+	}
+
+	if (disk.ValidateSuperBlock() != B_OK) {
+		fprintf(stderr, "The disk's superblock is corrupt!\n");
+		return -1;
+	}
+
+	Directory* root = (Directory*)Inode::Factory(&disk, disk.Root());
+	if (root == NULL || root->InitCheck() != B_OK) {
+		fprintf(stderr, "Could not open root directory!\n");
+		delete root;
+		return -1;
+	}
+
+	puts("Scanning files (this will take some time)...");
+	scanFiles(disk, root);
+	delete root;
+
+	printReport();
+	return 0;
+}
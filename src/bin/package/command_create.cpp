@@ -35,6 +35,7 @@ command_create(int argc, const char* const* argv)
 	const char* changeToDirectory = NULL;
 	const char* packageInfoFileName = NULL;
 	const char* installPath = NULL;
+	uint32 compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
 	bool isBuildPackage = false;
 	bool quiet = false;
 	bool verbose = false;
@@ -48,7 +49,7 @@ command_create(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+bC:hi:I:qv", sLongOptions,
+		int c = getopt_long(argc, (char**)argv, "+bc:C:hi:I:qv", sLongOptions,
 			NULL);
 		if (c == -1)
 			break;
@@ -58,6 +59,20 @@ command_create(int argc, const char* const* argv)
 				isBuildPackage = true;
 				break;
 
+			case 'c':
+				if (strcmp(optarg, "none") == 0)
+					compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE;
+				else if (strcmp(optarg, "zlib") == 0)
+					compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+				else if (strcmp(optarg, "lz4") == 0)
+					compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LZ4;
+				else {
+					fprintf(stderr, "Error: Unknown compression \"%s\".\n",
+						optarg);
+					return 1;
+				}
+				break;
+
 			case 'C':
 				changeToDirectory = optarg;
 				break;
@@ -132,6 +147,8 @@ command_create(int argc, const char* const* argv)
 	if (isBuildPackage)
 		packageWriter.SetCheckLicenses(false);
 
+	packageWriter.SetCompression(compression);
+
 	// set install path, if specified
 	if (installPath != NULL) {
 		result = packageWriter.SetInstallPath(installPath);
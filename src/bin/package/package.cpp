@@ -44,6 +44,10 @@ static const char* kUsage =
 	"    -b         - Create an empty build package. Only the .PackageInfo "
 		"will\n"
 	"                 be added.\n"
+	"    -c <comp>  - Compress the file data with <comp>, one of \"none\",\n"
+	"                 \"zlib\" (the default), or \"lz4\" (faster to "
+		"read, but\n"
+	"                 larger).\n"
 	"    -C <dir>   - Change to directory <dir> before adding entries.\n"
 	"    -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                 \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
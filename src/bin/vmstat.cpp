@@ -82,6 +82,24 @@ main(int argc, char** argv)
 	printf("max swap space:\t\t%Lu\n", info.max_swap_space);
 	printf("free swap space:\t%Lu\n", info.free_swap_space);
 	printf("page faults:\t\t%lu\n", info.page_faults);
+	printf("read ahead pages:\t%Lu\n", info.read_ahead_pages);
+	printf("swap in pages:\t\t%Lu\n", info.swap_in_pages);
+	printf("swap in reads:\t\t%Lu\n", info.swap_in_reads);
+	printf("swap in latency:\t%Ld us\n", info.swap_in_reads > 0
+		? info.swap_in_time / (bigtime_t)info.swap_in_reads : 0);
+	printf("swap out pages:\t\t%Lu\n", info.swap_out_pages);
+	printf("swap out writes:\t%Lu\n", info.swap_out_writes);
+	printf("swap out clusters:\t");
+	for (int32 i = 0; i < SWAP_CLUSTER_BUCKETS; i++)
+		printf("%s%d+: %Lu", i > 0 ? ", " : "", 1 << i,
+			info.swap_out_clusters[i]);
+	printf("\n");
+	printf("active pages:\t\t%Lu\n", info.active_pages);
+	printf("inactive pages:\t\t%Lu\n", info.inactive_pages);
+	printf("evicted pages:\t\t%Lu\n", info.evicted_pages);
+	printf("refaulted pages:\t%Lu (%Lu activated)\n", info.refault_pages,
+		info.refault_activations);
+	printf("activated on access:\t%Lu\n", info.cache_activations);
 
 	if (periodically) {
 		puts("\npage faults  used memory    used swap  block cache");
@@ -54,7 +54,7 @@ LinkReceiver::LinkReceiver(port_id port)
 	:
 	fReceivePort(port), fRecvBuffer(NULL), fRecvPosition(0), fRecvStart(0),
 	fRecvBufferSize(0), fDataSize(0),
-	fReplySize(0), fReadError(B_OK)
+	fReplySize(0), fReadError(B_OK), fReadArea(false)
 {
 }
 
@@ -76,6 +76,7 @@ status_t
 LinkReceiver::GetNextMessage(int32 &code, bigtime_t timeout)
 {
 	fReadError = B_OK;
+	fReadArea = false;
 
 	int32 remaining = fDataSize - (fRecvStart + fReplySize);
 	STRACE(("info: LinkReceiver GetNextReply() reports %ld bytes remaining in buffer.\n", remaining));
@@ -149,6 +150,24 @@ LinkReceiver::Code() const
 }
 
 
+/*!	Rewinds the current message, so that it can be read once more from its
+	start. This is not possible anymore once data has been read that was
+	passed in an area, as that area is deleted after reading it.
+*/
+status_t
+LinkReceiver::RewindMessage()
+{
+	if (fReplySize == 0)
+		return B_NO_INIT;
+	if (fReadArea)
+		return B_NOT_ALLOWED;
+
+	fRecvPosition = fRecvStart + sizeof(message_header);
+	fReadError = B_OK;
+	return B_OK;
+}
+
+
 void
 LinkReceiver::ResetBuffer()
 {
@@ -304,6 +323,7 @@ LinkReceiver::Read(void *data, ssize_t passedSize)
 			if (areaAddress && sourceArea >= B_OK) {
 				memcpy(data, areaAddress, passedSize);
 				delete_area(sourceArea);
+				fReadArea = true;
 			}
 		}
 	} else {
@@ -13,6 +13,7 @@
 #include <MessageUtils.h>
 
 #include <DirectMessageTarget.h>
+#include <locks.h>
 #include <MessengerPrivate.h>
 #include <TokenSpace.h>
 #include <util/KMessage.h>
@@ -81,6 +82,128 @@ port_id BMessage::sReplyPorts[sNumReplyPorts];
 int32 BMessage::sReplyPortInUse[sNumReplyPorts];
 
 
+// Messages with more data than this are passed by area.
+static const size_t kMinAreaMessageDataSize = B_PAGE_SIZE * 10;
+
+struct message_area {
+	area_id	area;
+	void*	address;
+	size_t	size;
+};
+
+static const int32 kMaxPooledMessageAreas = 8;
+static const size_t kMaxPooledMessageAreaMemory = 16 * 1024 * 1024;
+static const int32 kMaxOwnMessageAreas = 16;
+
+static mutex sMessageAreaPoolLock = MUTEX_INITIALIZER("message area pool");
+static message_area sMessageAreaPool[kMaxPooledMessageAreas];
+static int32 sMessageAreaPoolCount = 0;
+static size_t sMessageAreaPoolMemory = 0;
+
+// The message areas this team created itself, and that are in use. Only
+// these may go into the pool; an area we received could still be mapped by
+// its sender, who would then see the next message we put into it.
+static area_id sOwnMessageAreas[kMaxOwnMessageAreas];
+static int32 sOwnMessageAreaCount = 0;
+
+
+/*!	Remembers \a area as one of our own message areas. If there are too many
+	of them already, it just won't be pooled later.
+	The pool lock must be held.
+*/
+static void
+add_own_message_area(area_id area)
+{
+	if (sOwnMessageAreaCount < kMaxOwnMessageAreas)
+		sOwnMessageAreas[sOwnMessageAreaCount++] = area;
+}
+
+
+/*!	Forgets \a area as one of our own message areas, and returns whether it
+	was one.
+	The pool lock must be held.
+*/
+static bool
+remove_own_message_area(area_id area)
+{
+	for (int32 i = 0; i < sOwnMessageAreaCount; i++) {
+		if (sOwnMessageAreas[i] == area) {
+			sOwnMessageAreas[i] = sOwnMessageAreas[--sOwnMessageAreaCount];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*!	Returns an area of at least \a size bytes for passing a message. The
+	smallest fitting area of the pool is reused, if it isn't overly large,
+	otherwise a new area is created.
+	Since the area may have carried another message before, the part beyond
+	\a size is cleared; the caller has to take care of the rest.
+*/
+static area_id
+get_message_area(size_t size, void **_address)
+{
+	MutexLocker locker(sMessageAreaPoolLock);
+
+	int32 best = -1;
+	for (int32 i = 0; i < sMessageAreaPoolCount; i++) {
+		if (sMessageAreaPool[i].size >= size && (best < 0
+				|| sMessageAreaPool[i].size < sMessageAreaPool[best].size)) {
+			best = i;
+		}
+	}
+
+	if (best >= 0 && sMessageAreaPool[best].size / 4 <= size) {
+		message_area entry = sMessageAreaPool[best];
+		sMessageAreaPool[best] = sMessageAreaPool[--sMessageAreaPoolCount];
+		sMessageAreaPoolMemory -= entry.size;
+		add_own_message_area(entry.area);
+		locker.Unlock();
+
+		memset((uint8 *)entry.address + size, 0, entry.size - size);
+		*_address = entry.address;
+		return entry.area;
+	}
+
+	area_id area = create_area("BMessage data", _address, B_ANY_ADDRESS,
+		size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area >= 0)
+		add_own_message_area(area);
+
+	return area;
+}
+
+
+/*!	Returns a message area that is no longer used to the pool, or deletes it,
+	if the pool is full, or if it isn't one of our own areas.
+*/
+static void
+put_message_area(area_id area)
+{
+	MutexLocker locker(sMessageAreaPoolLock);
+
+	area_info info;
+	if (remove_own_message_area(area)
+		&& sMessageAreaPoolCount < kMaxPooledMessageAreas
+		&& get_area_info(area, &info) == B_OK
+		&& sMessageAreaPoolMemory + info.size <= kMaxPooledMessageAreaMemory) {
+		message_area &entry = sMessageAreaPool[sMessageAreaPoolCount++];
+		entry.area = area;
+		entry.address = info.address;
+		entry.size = info.size;
+		sMessageAreaPoolMemory += info.size;
+		return;
+	}
+
+	locker.Unlock();
+
+	delete_area(area);
+}
+
+
 template<typename Type>
 static void
 print_to_stream_type(uint8 *pointer)
@@ -1103,6 +1226,13 @@ BMessage::Flatten(BDataIO *stream, ssize_t *size) const
 	Additionally we save us the reference counting with the use of areas that
 	are reference counted internally. So we don't have to worry about leaving
 	an area behind or deleting one that is still in use.
+	Once a message is done with an area the team created itself, the area is
+	kept in a per team pool and reused for the next large message the team
+	sends. An area that is transferred to another team leaves the pool for
+	good, and the receiver deletes it when done, since it cannot know who
+	else still maps it. So only the messages a team sends to itself gain
+	from the pool; a request/reply between two teams still creates and
+	deletes an area for every message.
 */
 
 status_t
@@ -1129,8 +1259,7 @@ BMessage::_FlattenToArea(message_header **_header) const
 	size_t fieldsSize = header->field_count * sizeof(field_header);
 	size_t size = fieldsSize + header->data_size;
 	size = (size + B_PAGE_SIZE) & ~(B_PAGE_SIZE - 1);
-	area_id area = create_area("BMessage data", (void **)&address,
-		B_ANY_ADDRESS, size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	area_id area = get_message_area(size, (void **)&address);
 
 	if (area < 0) {
 		free(header);
@@ -1140,6 +1269,8 @@ BMessage::_FlattenToArea(message_header **_header) const
 
 	memcpy(address, fFields, fieldsSize);
 	memcpy(address + fieldsSize, fData, fHeader->data_size);
+	memset(address + fieldsSize + fHeader->data_size, 0,
+		size - fieldsSize - fHeader->data_size);
 	header->flags |= MESSAGE_FLAG_PASS_BY_AREA;
 	header->message_area = area;
 	return B_OK;
@@ -1179,7 +1310,7 @@ BMessage::_Dereference()
 	if (fHeader == NULL)
 		return B_NO_INIT;
 
-	delete_area(fHeader->message_area);
+	put_message_area(fHeader->message_area);
 	fHeader->message_area = -1;
 	fFields = NULL;
 	fData = NULL;
@@ -2055,6 +2186,15 @@ BMessage::_StaticReInitForkedChild()
 	sReplyPortInUse[0] = 0;
 	sReplyPortInUse[1] = 0;
 	sReplyPortInUse[2] = 0;
+
+	// the pooled message areas have been copied with new IDs -- we don't
+	// need the copies
+	mutex_init(&sMessageAreaPoolLock, "message area pool");
+	for (int32 i = 0; i < sMessageAreaPoolCount; i++)
+		delete_area(area_for(sMessageAreaPool[i].address));
+	sMessageAreaPoolCount = 0;
+	sMessageAreaPoolMemory = 0;
+	sOwnMessageAreaCount = 0;
 }
 
 
@@ -2068,6 +2208,12 @@ BMessage::_StaticCleanup()
 	sReplyPorts[1] = -1;
 	delete_port(sReplyPorts[2]);
 	sReplyPorts[2] = -1;
+
+	MutexLocker locker(sMessageAreaPoolLock);
+	for (int32 i = 0; i < sMessageAreaPoolCount; i++)
+		delete_area(sMessageAreaPool[i].area);
+	sMessageAreaPoolCount = 0;
+	sMessageAreaPoolMemory = 0;
 }
 
 
@@ -2129,8 +2275,7 @@ BMessage::_SendMessage(port_id port, team_id portOwner, int32 token,
 			return B_NO_MEMORY;
 		}
 #ifndef HAIKU_TARGET_PLATFORM_LIBBE_TEST
-	} else if (fHeader->data_size > B_PAGE_SIZE * 10) {
-		// ToDo: bind the above size to the max port message size
+	} else if (fHeader->data_size > kMinAreaMessageDataSize) {
 		// use message passing by area for such a large message
 		result = _FlattenToArea(&header);
 		if (result != B_OK)
@@ -2155,11 +2300,19 @@ BMessage::_SendMessage(port_id port, team_id portOwner, int32 token,
 			area_id transfered = _kern_transfer_area(header->message_area,
 				&address, B_ANY_ADDRESS, target);
 			if (transfered < 0) {
-				delete_area(header->message_area);
+				put_message_area(header->message_area);
 				free(header);
 				return transfered;
 			}
 
+			// the area only stays ours, if we sent it to ourselves
+			MutexLocker locker(sMessageAreaPoolLock);
+			if (remove_own_message_area(header->message_area)
+				&& target == BPrivate::current_team()) {
+				add_own_message_area(transfered);
+			}
+			locker.Unlock();
+
 			header->message_area = transfered;
 		}
 #endif
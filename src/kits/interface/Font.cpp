@@ -12,8 +12,11 @@
 
 
 #include <AppServerLink.h>
+#include <ApplicationPrivate.h>
 #include <FontPrivate.h>
 #include <ObjectList.h>
+#include <ServerGlyphAdvances.h>
+#include <ServerMemoryAllocator.h>
 #include <ServerProtocol.h>
 #include <truncate_string.h>
 #include <utf8_functions.h>
@@ -331,6 +334,191 @@ FontList::_InitSingleton()
 //	#pragma mark -
 
 
+namespace {
+
+/*!	Measures strings with the glyph advances the app_server has published,
+	exactly like the server would. All methods return false if an advance
+	is not known, in which case the server has to be asked.
+*/
+class GlyphAdvances {
+	public:
+		GlyphAdvances(const BFont& font);
+
+		bool StringWidth(const char* string, int32 length,
+			float& _width) const;
+		bool GetEscapements(const char* string, int32 numChars,
+			float escapements[]) const;
+
+	private:
+		bool _Advance(uint32 charCode, float& _advance) const;
+		bool _IsUnchanged() const;
+
+		static void _InitShared();
+
+		server_glyph_advances* fShared;
+		int32		fGeneration;
+		int32		fFontIndex;
+		float		fSize;
+
+		static pthread_once_t			sInitOnce;
+		static server_glyph_advances*	sShared;
+};
+
+pthread_once_t GlyphAdvances::sInitOnce = PTHREAD_ONCE_INIT;
+server_glyph_advances* GlyphAdvances::sShared = NULL;
+
+
+GlyphAdvances::GlyphAdvances(const BFont& font)
+	:
+	fShared(NULL),
+	fGeneration(0),
+	fFontIndex(-1),
+	fSize(font.Size())
+{
+	if (be_app == NULL)
+		return;
+
+	pthread_once(&sInitOnce, &_InitShared);
+	if (sShared == NULL)
+		return;
+
+	fGeneration = atomic_get(&sShared->generation);
+	if ((fGeneration & 1) != 0) {
+		// the server is just starting over
+		return;
+	}
+
+	uint32 familyAndStyle = font.FamilyAndStyle();
+	uint16 familyID = familyAndStyle >> 16;
+	uint16 styleID = familyAndStyle & 0xffff;
+
+	int32 count = atomic_get(&sShared->font_count);
+	for (int32 i = 0; i < count; i++) {
+		const glyph_advance_font& entry = sShared->fonts[i];
+		if (entry.family_id == familyID && entry.style_id == styleID
+			&& entry.size == fSize) {
+			fShared = sShared;
+			fFontIndex = i;
+			break;
+		}
+	}
+}
+
+
+bool
+GlyphAdvances::StringWidth(const char* string, int32 length,
+	float& _width) const
+{
+	if (fShared == NULL)
+		return false;
+
+	// walk the string like the server's GlyphLayoutEngine does, which only
+	// gets to see the first length bytes
+	const char* start = string;
+	double width = 0.0;
+	uint32 charCode;
+	while ((charCode = UTF8ToCharCode(&string)) != 0) {
+		if (string - start > length)
+			return false;
+
+		float advance;
+		if (!_Advance(charCode, advance))
+			return false;
+
+		width += advance;
+
+		if (string - start + 1 > length)
+			break;
+	}
+
+	if (!_IsUnchanged())
+		return false;
+
+	_width = width;
+	return true;
+}
+
+
+bool
+GlyphAdvances::GetEscapements(const char* string, int32 numChars,
+	float escapements[]) const
+{
+	if (fShared == NULL)
+		return false;
+
+	for (int32 i = 0; i < numChars; i++) {
+		uint32 charCode = UTF8ToCharCode(&string);
+
+		float advance;
+		if (charCode == 0 || !_Advance(charCode, advance))
+			return false;
+
+		escapements[i] = advance / fSize;
+	}
+
+	return _IsUnchanged();
+}
+
+
+bool
+GlyphAdvances::_Advance(uint32 charCode, float& _advance) const
+{
+	int32 key = glyph_advance_key(fFontIndex, charCode);
+	int32 index = glyph_advance_slot_index(key);
+
+	for (int32 i = 0; i < kGlyphAdvanceMaxProbes; i++) {
+		glyph_advance_slot& slot = fShared->slots[index];
+
+		// the advance is valid once the key is visible
+		int32 slotKey = atomic_get(&slot.key);
+		if (slotKey == key) {
+			_advance = slot.advance;
+			return true;
+		}
+		if (slotKey == 0)
+			return false;
+
+		index = (index + 1) & (kGlyphAdvanceSlotCount - 1);
+	}
+
+	return false;
+}
+
+
+bool
+GlyphAdvances::_IsUnchanged() const
+{
+	return atomic_get(&fShared->generation) == fGeneration;
+}
+
+
+/*static*/ void
+GlyphAdvances::_InitShared()
+{
+	BPrivate::AppServerLink link;
+	link.StartMessage(AS_GET_GLYPH_ADVANCES);
+
+	area_id serverArea;
+	int32 code;
+	if (link.FlushWithReply(code) != B_OK || code != B_OK
+		|| link.Read<area_id>(&serverArea) != B_OK) {
+		return;
+	}
+
+	area_id area;
+	uint8* base;
+	if (BApplication::Private::ServerAllocator()->AddArea(serverArea, area,
+			base, sizeof(server_glyph_advances), true) == B_OK) {
+		sShared = (server_glyph_advances*)base;
+	}
+}
+
+}	// unnamed namespace
+
+
+//	#pragma mark -
+
+
 void
 _init_global_fonts_()
 {
@@ -987,6 +1175,20 @@ BFont::GetStringWidths(const char *stringArray[], const int32 lengthArray[],
 		return;
 	}
 
+	// try to do without the server first
+	GlyphAdvances advances(*this);
+	int32 measured = 0;
+	for (; measured < numStrings; measured++) {
+		if (stringArray[measured] == NULL || lengthArray[measured] <= 0)
+			widthArray[measured] = 0.0f;
+		else if (!advances.StringWidth(stringArray[measured],
+				lengthArray[measured], widthArray[measured])) {
+			break;
+		}
+	}
+	if (measured == numStrings)
+		return;
+
 	BPrivate::AppServerLink link;
 	link.StartMessage(AS_GET_STRING_WIDTHS);
 	link.Attach<uint16>(fFamilyID);
@@ -1024,6 +1226,14 @@ BFont::GetEscapements(const char charArray[], int32 numChars,
 	if (charArray == NULL || numChars < 1 || escapementArray == NULL)
 		return;
 
+	// The published advances are only valid for upright, antialiased text,
+	// the deltas do not change the escapements.
+	if (fRotation == 0.0f && (fFlags & B_DISABLE_ANTIALIASING) == 0) {
+		GlyphAdvances advances(*this);
+		if (advances.GetEscapements(charArray, numChars, escapementArray))
+			return;
+	}
+
 	BPrivate::AppServerLink link;
 	link.StartMessage(AS_GET_ESCAPEMENTS_AS_FLOATS);
 	link.Attach<uint16>(fFamilyID);
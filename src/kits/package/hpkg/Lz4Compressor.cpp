@@ -0,0 +1,179 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/hpkg/Lz4Compressor.h>
+
+#include <string.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+// LZ4 block format constants
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+	// the last bytes of a block are always literals
+static const size_t kMatchSearchLimit = 12;
+	// no match may start within the last bytes of a block
+static const size_t kMaxOffset = 65535;
+static const size_t kLengthMask = 15;
+
+static const int32 kHashBits = 12;
+
+
+static inline uint32
+read32(const uint8* buffer)
+{
+	uint32 value;
+	memcpy(&value, buffer, sizeof(value));
+	return value;
+}
+
+
+static inline uint32
+hash_sequence(uint32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - kHashBits);
+}
+
+
+static inline void
+write_length(uint8*& output, size_t length)
+{
+	while (length >= 255) {
+		*output++ = 255;
+		length -= 255;
+	}
+	*output++ = (uint8)length;
+}
+
+
+/*!	Appends a sequence of \a literalLength literals, followed by a match
+	of \a matchLength bytes at \a offset to \a output. If \a matchLength is
+	0, only the literals are written, as required for the last sequence of
+	a block.
+*/
+static bool
+write_sequence(uint8*& output, const uint8* outputEnd, const uint8* literals,
+	size_t literalLength, size_t offset, size_t matchLength)
+{
+	// make sure the worst case fits
+	size_t needed = 1 + literalLength / 255 + 1 + literalLength;
+	if (matchLength > 0)
+		needed += 2 + matchLength / 255 + 1;
+	if (needed > (size_t)(outputEnd - output))
+		return false;
+
+	uint8* token = output++;
+	*token = (uint8)((literalLength >= kLengthMask
+		? kLengthMask : literalLength) << 4);
+	if (literalLength >= kLengthMask)
+		write_length(output, literalLength - kLengthMask);
+
+	memcpy(output, literals, literalLength);
+	output += literalLength;
+
+	if (matchLength == 0)
+		return true;
+
+	*output++ = (uint8)(offset & 0xff);
+	*output++ = (uint8)(offset >> 8);
+
+	matchLength -= kMinMatch;
+	*token |= (uint8)(matchLength >= kLengthMask ? kLengthMask : matchLength);
+	if (matchLength >= kLengthMask)
+		write_length(output, matchLength - kLengthMask);
+
+	return true;
+}
+
+
+/*!	Compresses \a input into a single LZ4 block. Like the zlib compressor,
+	this returns \c B_BUFFER_OVERFLOW if the data does not get smaller, so
+	that the caller can store it uncompressed instead.
+	The compressor is a simple greedy one that favors speed; what matters
+	for packages is that the data decompresses quickly.
+*/
+/*static*/ status_t
+Lz4Compressor::CompressSingleBuffer(const void* _input, size_t inputSize,
+	void* _output, size_t outputSize, size_t& _compressedSize)
+{
+	if (inputSize == 0 || outputSize == 0)
+		return B_BAD_VALUE;
+
+	const uint8* input = (const uint8*)_input;
+	const uint8* inputEnd = input + inputSize;
+	uint8* output = (uint8*)_output;
+	const uint8* outputEnd = output
+		+ (outputSize < inputSize ? outputSize : inputSize - 1);
+		// there is no point in an output as large as the input
+
+	const uint8* anchor = input;
+
+	if (inputSize > kMatchSearchLimit) {
+		uint32 table[1 << kHashBits];
+		memset(table, 0, sizeof(table));
+
+		const uint8* matchLimit = inputEnd - kLastLiterals;
+		const uint8* searchEnd = inputEnd - kMatchSearchLimit;
+		const uint8* position = input;
+
+		while (position < searchEnd) {
+			uint32 sequence = read32(position);
+			uint32 hash = hash_sequence(sequence);
+			const uint8* candidate = input + table[hash];
+			table[hash] = position - input;
+
+			if (candidate >= position
+				|| (size_t)(position - candidate) > kMaxOffset
+				|| read32(candidate) != sequence) {
+				position++;
+				continue;
+			}
+
+			// extend the match backwards over the pending literals
+			while (position > anchor && candidate > input
+				&& position[-1] == candidate[-1]) {
+				position--;
+				candidate--;
+			}
+
+			// and forwards as far as possible
+			const uint8* matchEnd = position + kMinMatch;
+			const uint8* candidateEnd = candidate + kMinMatch;
+			while (matchEnd < matchLimit && *matchEnd == *candidateEnd) {
+				matchEnd++;
+				candidateEnd++;
+			}
+
+			if (!write_sequence(output, outputEnd, anchor, position - anchor,
+					position - candidate, matchEnd - position)) {
+				return B_BUFFER_OVERFLOW;
+			}
+
+			position = matchEnd;
+			anchor = position;
+		}
+	}
+
+	// the remaining literals
+	if (!write_sequence(output, outputEnd, anchor, inputEnd - anchor, 0, 0))
+		return B_BUFFER_OVERFLOW;
+
+	_compressedSize = output - (uint8*)_output;
+	return B_OK;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
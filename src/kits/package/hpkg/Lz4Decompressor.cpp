@@ -0,0 +1,121 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/hpkg/Lz4Decompressor.h>
+
+#include <string.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+static const size_t kMinMatch = 4;
+static const size_t kLengthMask = 15;
+
+
+static inline bool
+read_length(const uint8*& input, const uint8* inputEnd, size_t& length)
+{
+	uint8 byte;
+	do {
+		if (input >= inputEnd)
+			return false;
+
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+
+/*!	Decompresses a single LZ4 block, as written by
+	Lz4Compressor::CompressSingleBuffer(). Since this is used for the data
+	of packages in the kernel, it does not need any memory besides the
+	buffers given, and validates all lengths and offsets.
+*/
+/*static*/ status_t
+Lz4Decompressor::DecompressSingleBuffer(const void* _input, size_t inputSize,
+	void* _output, size_t outputSize, size_t& _uncompressedSize)
+{
+	if (inputSize == 0 || outputSize == 0)
+		return B_BAD_VALUE;
+
+	const uint8* input = (const uint8*)_input;
+	const uint8* inputEnd = input + inputSize;
+	uint8* output = (uint8*)_output;
+	uint8* outputEnd = output + outputSize;
+
+	while (true) {
+		if (input >= inputEnd)
+			return B_BAD_DATA;
+
+		uint8 token = *input++;
+
+		// literals
+		size_t literalLength = token >> 4;
+		if (literalLength == kLengthMask
+			&& !read_length(input, inputEnd, literalLength)) {
+			return B_BAD_DATA;
+		}
+
+		if (literalLength > (size_t)(inputEnd - input))
+			return B_BAD_DATA;
+		if (literalLength > (size_t)(outputEnd - output))
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(output, input, literalLength);
+		input += literalLength;
+		output += literalLength;
+
+		// the last sequence consists of literals only
+		if (input == inputEnd)
+			break;
+
+		// match
+		if (inputEnd - input < 2)
+			return B_BAD_DATA;
+
+		size_t offset = input[0] | ((size_t)input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - (uint8*)_output))
+			return B_BAD_DATA;
+
+		size_t matchLength = token & kLengthMask;
+		if (matchLength == kLengthMask
+			&& !read_length(input, inputEnd, matchLength)) {
+			return B_BAD_DATA;
+		}
+		matchLength += kMinMatch;
+
+		if (matchLength > (size_t)(outputEnd - output))
+			return B_BUFFER_OVERFLOW;
+
+		const uint8* match = output - offset;
+		if (offset >= matchLength) {
+			memcpy(output, match, matchLength);
+			output += matchLength;
+		} else {
+			// overlapping match -- repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; i++)
+				*output++ = *match++;
+		}
+	}
+
+	_uncompressedSize = output - (uint8*)_output;
+	return B_OK;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
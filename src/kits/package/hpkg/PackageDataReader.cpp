@@ -15,6 +15,7 @@
 #include <package/hpkg/BufferCache.h>
 #include <package/hpkg/CachedBuffer.h>
 #include <package/hpkg/DataOutput.h>
+#include <package/hpkg/Lz4Decompressor.h>
 #include <package/hpkg/PackageData.h>
 #include <package/hpkg/ZlibDecompressor.h>
 
@@ -27,12 +28,12 @@ namespace BHPKG {
 using namespace BPrivate;
 
 
-// minimum/maximum zlib chunk size we consider sane
-static const size_t kMinSaneZlibChunkSize = 1024;
-static const size_t kMaxSaneZlibChunkSize = 10 * 1024 * 1024;
+// minimum/maximum compressed chunk size we consider sane
+static const size_t kMinSaneChunkSize = 1024;
+static const size_t kMaxSaneChunkSize = 10 * 1024 * 1024;
 
-// maximum number of entries in the zlib offset table buffer
-static const uint32 kMaxZlibOffsetTableBufferSize = 512;
+// maximum number of entries in the chunk offset table buffer
+static const uint32 kMaxOffsetTableBufferSize = 512;
 
 static const size_t kUncompressedReaderBufferSize
 	= B_HPKG_DEFAULT_DATA_CHUNK_SIZE_ZLIB;
@@ -152,21 +153,27 @@ private:
 };
 
 
-// #pragma mark - ZlibPackageDataReader
+// #pragma mark - CompressedPackageDataReader
 
 
-class ZlibPackageDataReader : public BPackageDataReader {
+/*!	Reads data that has been compressed in chunks, each of which can be
+	uncompressed independently. The format of the chunks and of the offset
+	table preceding them is the same for all compression algorithms.
+*/
+class CompressedPackageDataReader : public BPackageDataReader {
 public:
-	ZlibPackageDataReader(BDataReader* dataReader, BBufferCache* bufferCache)
+	CompressedPackageDataReader(BDataReader* dataReader,
+		BBufferCache* bufferCache, uint32 compression)
 		:
 		BPackageDataReader(dataReader),
 		fBufferCache(bufferCache),
+		fCompression(compression),
 		fUncompressBuffer(NULL),
 		fOffsetTable(NULL)
 	{
 	}
 
-	~ZlibPackageDataReader()
+	~CompressedPackageDataReader()
 	{
 		delete[] fOffsetTable;
 
@@ -183,8 +190,8 @@ public:
 		// validate chunk size
 		if (fChunkSize == 0)
 			fChunkSize = B_HPKG_DEFAULT_DATA_CHUNK_SIZE_ZLIB;
-		if (fChunkSize < kMinSaneZlibChunkSize
-			|| fChunkSize > kMaxSaneZlibChunkSize) {
+		if (fChunkSize < kMinSaneChunkSize
+			|| fChunkSize > kMaxSaneChunkSize) {
 			return B_BAD_DATA;
 		}
 
@@ -196,7 +203,7 @@ public:
 		// allocate a buffer for the offset table
 		if (fChunkCount > 1) {
 			fOffsetTableBufferEntryCount = std::min(fChunkCount - 1,
-				(uint64)kMaxZlibOffsetTableBufferSize);
+				(uint64)kMaxOffsetTableBufferSize);
 			fOffsetTable = new(std::nothrow) uint64[
 				fOffsetTableBufferEntryCount];
 			if (fOffsetTable == NULL)
@@ -314,10 +321,17 @@ private:
 				return error;
 
 			size_t actuallyUncompressedSize;
-			error = ZlibDecompressor::DecompressSingleBuffer(
-				readBuffer->Buffer(), compressedSize,
-				fUncompressBuffer->Buffer(), uncompressedSize,
-				actuallyUncompressedSize);
+			if (fCompression == B_HPKG_COMPRESSION_LZ4) {
+				error = Lz4Decompressor::DecompressSingleBuffer(
+					readBuffer->Buffer(), compressedSize,
+					fUncompressBuffer->Buffer(), uncompressedSize,
+					actuallyUncompressedSize);
+			} else {
+				error = ZlibDecompressor::DecompressSingleBuffer(
+					readBuffer->Buffer(), compressedSize,
+					fUncompressBuffer->Buffer(), uncompressedSize,
+					actuallyUncompressedSize);
+			}
 			if (error == B_OK && actuallyUncompressedSize != uncompressedSize)
 				error = B_BAD_DATA;
 		}
@@ -401,6 +415,7 @@ private:
 
 private:
 	BBufferCache*	fBufferCache;
+	uint32			fCompression;
 	CachedBuffer*	fUncompressBuffer;
 	int64			fUncompressedChunk;
 
@@ -438,8 +453,9 @@ BPackageDataReaderFactory::CreatePackageDataReader(BDataReader* dataReader,
 				dataReader, fBufferCache);
 			break;
 		case B_HPKG_COMPRESSION_ZLIB:
-			reader = new(std::nothrow) ZlibPackageDataReader(dataReader,
-				fBufferCache);
+		case B_HPKG_COMPRESSION_LZ4:
+			reader = new(std::nothrow) CompressedPackageDataReader(dataReader,
+				fBufferCache, data.Compression());
 			break;
 		default:
 			return B_BAD_VALUE;
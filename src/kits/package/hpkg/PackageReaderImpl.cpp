@@ -99,6 +99,7 @@ struct PackageReaderImpl::DataAttributeHandler : AttributeHandler {
 				switch (value.unsignedInt) {
 					case B_HPKG_COMPRESSION_NONE:
 					case B_HPKG_COMPRESSION_ZLIB:
+					case B_HPKG_COMPRESSION_LZ4:
 						break;
 					default:
 						context->errorOutput->PrintError("Error: Invalid "
@@ -57,6 +57,16 @@ BPackageWriter::SetCheckLicenses(bool checkLicenses)
 }
 
 
+status_t
+BPackageWriter::SetCompression(uint32 compression)
+{
+	if (fImpl == NULL)
+		return B_NO_INIT;
+
+	return fImpl->SetCompression(compression);
+}
+
+
 status_t
 BPackageWriter::AddEntry(const char* fileName, int fd)
 {
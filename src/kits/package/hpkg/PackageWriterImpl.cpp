@@ -40,6 +40,7 @@
 
 #include <package/hpkg/DataOutput.h>
 #include <package/hpkg/DataReader.h>
+#include <package/hpkg/Lz4Compressor.h>
 #include <package/hpkg/PackageReaderImpl.h>
 #include <package/hpkg/Stacker.h>
 
@@ -59,8 +60,8 @@ namespace BHPKG {
 namespace BPrivate {
 
 
-// minimum length of data we require before trying to zlib compress them
-static const size_t kZlibCompressionSizeThreshold = 64;
+// minimum length of data we require before trying to compress them
+static const size_t kCompressionSizeThreshold = 64;
 
 
 // #pragma mark - Attributes
@@ -451,7 +452,8 @@ PackageWriterImpl::PackageWriterImpl(BPackageWriterListener* listener)
 	fRootEntry(NULL),
 	fRootAttribute(NULL),
 	fTopAttribute(NULL),
-	fCheckLicenses(true)
+	fCheckLicenses(true),
+	fCompression(B_HPKG_COMPRESSION_ZLIB)
 {
 }
 
@@ -497,6 +499,21 @@ PackageWriterImpl::SetCheckLicenses(bool checkLicenses)
 }
 
 
+status_t
+PackageWriterImpl::SetCompression(uint32 compression)
+{
+	switch (compression) {
+		case B_HPKG_COMPRESSION_NONE:
+		case B_HPKG_COMPRESSION_ZLIB:
+		case B_HPKG_COMPRESSION_LZ4:
+			fCompression = compression;
+			return B_OK;
+		default:
+			return B_BAD_VALUE;
+	}
+}
+
+
 status_t
 PackageWriterImpl::AddEntry(const char* fileName, int fd)
 {
@@ -847,7 +864,7 @@ PackageWriterImpl::_UpdateReadPackageInfo()
 	data.SetUncompressedSize(size);
 
 	// get the chunk size
-	uint64 chunkSize = compression == B_HPKG_COMPRESSION_ZLIB
+	uint64 chunkSize = compression != B_HPKG_COMPRESSION_NONE
 		? B_HPKG_DEFAULT_DATA_CHUNK_SIZE_ZLIB : 0;
 	if (Attribute* chunkSizeAttribute = dataAttribute->ChildWithID(
 			B_HPKG_ATTRIBUTE_ID_DATA_CHUNK_SIZE)) {
@@ -1808,10 +1825,13 @@ PackageWriterImpl::_AddData(BDataReader& dataReader, off_t size)
 	uint64 compression = B_HPKG_COMPRESSION_NONE;
 	uint64 compressedSize;
 
-	status_t error = _WriteZlibCompressedData(dataReader, size, dataOffset,
-		compressedSize);
+	status_t error = B_BAD_VALUE;
+	if (fCompression != B_HPKG_COMPRESSION_NONE) {
+		error = _WriteCompressedData(dataReader, size, dataOffset,
+			compressedSize);
+	}
 	if (error == B_OK) {
-		compression = B_HPKG_COMPRESSION_ZLIB;
+		compression = fCompression;
 	} else {
 		error = _WriteUncompressedData(dataReader, size, dataOffset);
 		compressedSize = size;
@@ -1875,11 +1895,11 @@ PackageWriterImpl::_WriteUncompressedData(BDataReader& dataReader, off_t size,
 
 
 status_t
-PackageWriterImpl::_WriteZlibCompressedData(BDataReader& dataReader, off_t size,
+PackageWriterImpl::_WriteCompressedData(BDataReader& dataReader, off_t size,
 	uint64 writeOffset, uint64& _compressedSize)
 {
-	// Use zlib compression only for data large enough.
-	if (size < (off_t)kZlibCompressionSizeThreshold)
+	// Use compression only for data large enough.
+	if (size < (off_t)kCompressionSizeThreshold)
 		return B_BAD_VALUE;
 
 	// fDataBuffer is 2 * B_HPKG_DEFAULT_DATA_CHUNK_SIZE_ZLIB, so split it into
@@ -1916,8 +1936,13 @@ PackageWriterImpl::_WriteZlibCompressedData(BDataReader& dataReader, off_t size,
 
 		// compress
 		size_t compressedSize;
-		error = ZlibCompressor::CompressSingleBuffer(inputBuffer, toCopy,
-			outputBuffer, toCopy, compressedSize);
+		if (fCompression == B_HPKG_COMPRESSION_LZ4) {
+			error = Lz4Compressor::CompressSingleBuffer(inputBuffer, toCopy,
+				outputBuffer, toCopy, compressedSize);
+		} else {
+			error = ZlibCompressor::CompressSingleBuffer(inputBuffer, toCopy,
+				outputBuffer, toCopy, compressedSize);
+		}
 
 		const void* writeBuffer;
 		size_t bytesToWrite;
@@ -25,6 +25,7 @@
 #include "FontCacheEntry.h"
 #include "FontManager.h"
 #include "GlobalSubpixelSettings.h"
+#include "GlyphAdvanceCache.h"
 #include "ServerConfig.h"
 
 
@@ -35,6 +36,9 @@ DesktopSettingsPrivate::DesktopSettingsPrivate(server_read_only_memory* shared)
 	// if the on-disk settings are not complete, the defaults will be kept
 	_SetDefaults();
 	_Load();
+
+	// the font rendering settings are global, and might have changed
+	GlyphAdvanceCache::Default()->Invalidate();
 }
 
 
@@ -676,6 +680,7 @@ void
 DesktopSettingsPrivate::SetSubpixelAntialiasing(bool subpix)
 {
 	gSubpixelAntialiasing = subpix;
+	GlyphAdvanceCache::Default()->Invalidate();
 	Save(kAppearanceSettings);
 }
 
@@ -691,6 +696,7 @@ void
 DesktopSettingsPrivate::SetHinting(uint8 hinting)
 {
 	gDefaultHintingMode = hinting;
+	GlyphAdvanceCache::Default()->Invalidate();
 	Save(kFontSettings);
 }
 
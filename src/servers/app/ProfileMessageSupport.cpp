@@ -125,6 +125,7 @@ string_for_message_code(uint32 code, BString& string)
 		CODE(AS_GET_HAS_GLYPHS);
 		CODE(AS_GET_GLYPH_SHAPES);
 		CODE(AS_GET_TRUNCATED_STRINGS);
+		CODE(AS_GET_GLYPH_ADVANCES);
 
 		// Screen methods
 		CODE(AS_VALID_SCREEN_ID);
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "RetainedDrawing.h"
+
+#include "ServerPicture.h"
+
+
+RetainedDrawing::RetainedDrawing()
+	:
+	fHasUpdateRect(false),
+	fCount(0)
+{
+}
+
+
+RetainedDrawing::~RetainedDrawing()
+{
+	MakeEmpty();
+}
+
+
+/*!	Remembers the update rect the client has been asked to redraw the view
+	in, in view coordinates. The client will draw everything within it, even
+	those parts that are currently hidden.
+*/
+void
+RetainedDrawing::SetUpdateRect(const BRect& rect)
+{
+	fUpdateRect = rect;
+	fHasUpdateRect = true;
+}
+
+
+/*!	Returns the update rect set before, if any, and forgets it, as it only
+	belongs to one drawing pass of the client.
+*/
+bool
+RetainedDrawing::TakeUpdateRect(BRect& rect)
+{
+	if (!fHasUpdateRect)
+		return false;
+
+	rect = fUpdateRect;
+	fHasUpdateRect = false;
+	return true;
+}
+
+
+/*!	Adds a reference to \a picture, that has drawn the view within \a region.
+	The pictures added before are no longer used in that region. When there
+	are too many pictures already, the oldest one is dropped.
+*/
+void
+RetainedDrawing::AddPicture(ServerPicture* picture, const BRegion& region)
+{
+	Exclude(region);
+
+	if (fCount == kMaxPictures)
+		_RemovePictureAt(0);
+
+	picture->AcquireReference();
+	fPictures[fCount] = picture;
+	fRegions[fCount] = region;
+	fCount++;
+}
+
+
+/*!	Forgets about the drawing within \a region, ie. because the client is
+	going to draw it anew.
+*/
+void
+RetainedDrawing::Exclude(const BRegion& region)
+{
+	for (int32 i = fCount; i-- > 0;) {
+		fRegions[i].Exclude(&region);
+		if (fRegions[i].CountRects() == 0)
+			_RemovePictureAt(i);
+	}
+}
+
+
+void
+RetainedDrawing::MakeEmpty()
+{
+	while (fCount > 0)
+		_RemovePictureAt(fCount - 1);
+}
+
+
+/*!	Returns the region that can be redrawn without the client.
+*/
+void
+RetainedDrawing::GetRegion(BRegion& region) const
+{
+	region.MakeEmpty();
+	for (int32 i = 0; i < fCount; i++)
+		region.Include(&fRegions[i]);
+}
+
+
+void
+RetainedDrawing::_RemovePictureAt(int32 index)
+{
+	fPictures[index]->ReleaseReference();
+
+	for (int32 i = index + 1; i < fCount; i++) {
+		fPictures[i - 1] = fPictures[i];
+		fRegions[i - 1] = fRegions[i];
+	}
+
+	fCount--;
+	fRegions[fCount].MakeEmpty();
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef RETAINED_DRAWING_H
+#define RETAINED_DRAWING_H
+
+
+#include <Rect.h>
+#include <Region.h>
+
+
+class ServerPicture;
+
+
+/*!	Keeps what a view with the kRetainedDrawingViewFlag has drawn during its
+	last updates, so that the view can be redrawn without the client when it
+	is exposed again.
+	Every picture covers the region (in view coordinates) the client has
+	redrawn with it; the regions of the pictures never overlap.
+*/
+class RetainedDrawing {
+public:
+								RetainedDrawing();
+								~RetainedDrawing();
+
+			void				SetUpdateRect(const BRect& rect);
+			bool				TakeUpdateRect(BRect& rect);
+
+			void				AddPicture(ServerPicture* picture,
+									const BRegion& region);
+			void				Exclude(const BRegion& region);
+			void				MakeEmpty();
+
+			int32				CountPictures() const
+									{ return fCount; }
+			ServerPicture*		PictureAt(int32 index) const
+									{ return fPictures[index]; }
+			const BRegion&		RegionAt(int32 index) const
+									{ return fRegions[index]; }
+			void				GetRegion(BRegion& region) const;
+
+private:
+			void				_RemovePictureAt(int32 index);
+
+	static	const int32			kMaxPictures = 4;
+
+			BRect				fUpdateRect;
+			bool				fHasUpdateRect;
+
+			ServerPicture*		fPictures[kMaxPictures];
+			BRegion				fRegions[kMaxPictures];
+			int32				fCount;
+};
+
+
+#endif	// RETAINED_DRAWING_H
@@ -51,6 +51,7 @@
 #include "DrawingEngine.h"
 #include "EventStream.h"
 #include "FontManager.h"
+#include "GlyphAdvanceCache.h"
 #include "HWInterface.h"
 #include "InputManager.h"
 #include "OffscreenServerWindow.h"
@@ -1877,6 +1878,8 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 					else {
 						widthArray[i] = font.StringWidth(stringArray[i],
 							lengthArray[i]);
+						GlyphAdvanceCache::Default()->AddGlyphs(font,
+							stringArray[i], lengthArray[i]);
 					}
 				}
 
@@ -1892,6 +1895,24 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 			break;
 		}
 
+		case AS_GET_GLYPH_ADVANCES:
+		{
+			FTRACE(("ServerApp %s: AS_GET_GLYPH_ADVANCES\n", Signature()));
+
+			// Returns:
+			// 1) area_id - the area with the published glyph advances
+
+			area_id area = GlyphAdvanceCache::Default()->Area();
+			if (area >= 0) {
+				fLink.StartMessage(B_OK);
+				fLink.Attach<area_id>(area);
+			} else
+				fLink.StartMessage(area);
+
+			fLink.Flush();
+			break;
+		}
+
 		case AS_GET_FONT_BOUNDING_BOX:
 		{
 			FTRACE(("ServerApp %s: AS_GET_BOUNDING_BOX unimplemented\n",
@@ -2337,6 +2358,9 @@ ServerApp::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 				if (status == B_OK) {
 					fLink.StartMessage(B_OK);
 					fLink.Attach(escapements, numChars * sizeof(float));
+
+					GlyphAdvanceCache::Default()->AddGlyphs(font, charArray,
+						numBytes);
 				}
 			}
 
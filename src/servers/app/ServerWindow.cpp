@@ -61,6 +61,7 @@
 #include "Overlay.h"
 #include "ProfileMessageSupport.h"
 #include "RenderingBuffer.h"
+#include "RetainedDrawing.h"
 #include "ServerApp.h"
 #include "ServerBitmap.h"
 #include "ServerPicture.h"
@@ -145,6 +146,97 @@ compare_message_profiles(const void* _a, const void* _b)
 //	#pragma mark -
 
 
+// Drawing passes that need more than this are not kept
+static const off_t kMaxRetainedPictureSize = 2 * 1024 * 1024;
+
+enum retained_drawing_action {
+	RETAINED_DRAWING_KEEP,
+		// doesn't change how the view looks
+	RETAINED_DRAWING_RECORD,
+		// can be recorded in a picture
+	RETAINED_DRAWING_DISCARD
+		// changes how the view looks, and cannot be recorded
+};
+
+
+static retained_drawing_action
+retained_drawing_action_for(int32 code)
+{
+	switch (code) {
+		case AS_VIEW_GET_STATE:
+		case AS_VIEW_SET_EVENT_MASK:
+		case AS_VIEW_SET_MOUSE_EVENT_MASK:
+		case AS_VIEW_GET_COORD:
+		case AS_VIEW_GET_ORIGIN:
+		case AS_VIEW_RESIZE_MODE:
+		case AS_VIEW_GET_LINE_MODE:
+		case AS_VIEW_GET_SCALE:
+		case AS_VIEW_GET_PEN_LOC:
+		case AS_VIEW_GET_PEN_SIZE:
+		case AS_VIEW_GET_VIEW_COLOR:
+		case AS_VIEW_GET_HIGH_COLOR:
+		case AS_VIEW_GET_LOW_COLOR:
+		case AS_VIEW_GET_BLENDING_MODE:
+		case AS_VIEW_GET_DRAWING_MODE:
+		case AS_VIEW_GET_CLIP_REGION:
+		case AS_VIEW_INVALIDATE_RECT:
+		case AS_VIEW_INVALIDATE_REGION:
+			// the invalidated parts are excluded by Window::InvalidateView()
+		case AS_VIEW_DRAG_IMAGE:
+		case AS_VIEW_DRAG_RECT:
+		case AS_VIEW_BEGIN_RECT_TRACK:
+		case AS_VIEW_END_RECT_TRACK:
+			return RETAINED_DRAWING_KEEP;
+
+		// Changing the clipping is not recorded, as a picture that is played
+		// back cannot change the clipping of the drawing engine.
+		case AS_VIEW_SET_ORIGIN:
+		case AS_VIEW_INVERT_RECT:
+		case AS_VIEW_PUSH_STATE:
+		case AS_VIEW_POP_STATE:
+		case AS_VIEW_SET_DRAWING_MODE:
+		case AS_VIEW_SET_PEN_LOC:
+		case AS_VIEW_SET_PEN_SIZE:
+		case AS_VIEW_SET_LINE_MODE:
+		case AS_VIEW_SET_SCALE:
+		case AS_VIEW_SET_PATTERN:
+		case AS_VIEW_SET_FONT_STATE:
+		case AS_VIEW_SET_LOW_COLOR:
+		case AS_VIEW_SET_HIGH_COLOR:
+		case AS_FILL_RECT:
+		case AS_STROKE_RECT:
+		case AS_FILL_REGION:
+		case AS_STROKE_ROUNDRECT:
+		case AS_FILL_ROUNDRECT:
+		case AS_STROKE_ELLIPSE:
+		case AS_FILL_ELLIPSE:
+		case AS_STROKE_ARC:
+		case AS_FILL_ARC:
+		case AS_STROKE_TRIANGLE:
+		case AS_FILL_TRIANGLE:
+		case AS_STROKE_POLYGON:
+		case AS_FILL_POLYGON:
+		case AS_STROKE_BEZIER:
+		case AS_FILL_BEZIER:
+		case AS_STROKE_LINE:
+		case AS_STROKE_LINEARRAY:
+		case AS_DRAW_STRING:
+		case AS_DRAW_STRING_WITH_DELTA:
+		case AS_STROKE_SHAPE:
+		case AS_FILL_SHAPE:
+		case AS_VIEW_DRAW_BITMAP:
+		case AS_VIEW_DRAW_PICTURE:
+			return RETAINED_DRAWING_RECORD;
+
+		default:
+			return RETAINED_DRAWING_DISCARD;
+	}
+}
+
+
+//	#pragma mark -
+
+
 /*!	Sets up the basic BWindow counterpart - you have to call Init() before
 	you can actually use it, though.
 */
@@ -170,6 +262,10 @@ ServerWindow::ServerWindow(const char* title, ServerApp* app,
 	fCurrentDrawingRegion(),
 	fCurrentDrawingRegionValid(false),
 
+	fRetainedPicture(NULL),
+	fRetainedPictureView(NULL),
+	fRetainedPictureDepth(0),
+
 	fDirectWindowInfo(NULL),
 	fIsDirectlyAccessing(false)
 {
@@ -206,6 +302,9 @@ ServerWindow::~ServerWindow()
 		fServerApp = NULL;
 	}
 
+	if (fRetainedPicture != NULL)
+		fRetainedPicture->ReleaseReference();
+
 	delete fWindow;
 
 	free(fTitle);
@@ -493,6 +592,49 @@ ServerWindow::ResyncDrawState()
 }
 
 
+/*!	Replays the retained drawing of \a view within \a region, which is in
+	screen coordinates. The drawing engine must be locked, and the background
+	of the view must have been drawn already.
+*/
+void
+ServerWindow::PlayRetainedDrawing(View* view, const BRegion& region)
+{
+	RetainedDrawing* retained = view->GetRetainedDrawing();
+	DrawingEngine* drawingEngine = fWindow->GetDrawingEngine();
+	if (retained == NULL || drawingEngine == NULL)
+		return;
+
+	BRegion* clipping = fWindow->GetRegion();
+	if (clipping == NULL)
+		return;
+
+	// the pictures are played back with the state of the current view
+	View* currentView = fCurrentView;
+	_SetCurrentView(view);
+
+	for (int32 i = 0; i < retained->CountPictures(); i++) {
+		*clipping = retained->RegionAt(i);
+		view->ConvertToScreen(clipping);
+		clipping->IntersectWith(&region);
+		if (clipping->CountRects() == 0)
+			continue;
+
+		drawingEngine->ConstrainClippingRegion(clipping);
+
+		view->PushState();
+		retained->PictureAt(i)->Play(view);
+		view->PopState();
+
+		_UpdateDrawState(view);
+	}
+
+	fWindow->RecycleRegion(clipping);
+
+	_SetCurrentView(currentView);
+	fCurrentDrawingRegionValid = false;
+}
+
+
 View*
 ServerWindow::_CreateView(BPrivate::LinkReceiver& link, View** _parent)
 {
@@ -808,8 +950,11 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 					? B_OK : B_BAD_VALUE;
 			}
 
-			if (status == B_OK && !fWindow->IsOffscreenWindow())
+			if (status == B_OK && !fWindow->IsOffscreenWindow()) {
 				fDesktop->SetWindowFlags(fWindow, flags);
+				// the contents might be drawn with another drawing engine now
+				ResyncDrawState();
+			}
 
 			fLink.StartMessage(status);
 			fLink.Flush();
@@ -1036,6 +1181,9 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 
 		case AS_END_UPDATE:
 			DTRACE(("ServerWindow %s: Message AS_END_UPDATE\n", Title()));
+			if (fRetainedPicture != NULL)
+				_EndRetainedDrawing(false);
+
 			fWindow->EndUpdate();
 			break;
 
@@ -1063,7 +1211,16 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 
 		case AS_DIRECT_WINDOW_GET_SYNC_DATA:
 		{
+			// Has the all-window look
 			status_t status = _EnableDirectWindowMode();
+			if (status == B_OK
+				&& (fWindow->Flags() & kBackingStoreWindowFlag) != 0) {
+				// the client draws into the frame buffer itself from now on,
+				// which a backing store would not know about
+				fDesktop->SetWindowFlags(fWindow,
+					fWindow->Flags() & ~kBackingStoreWindowFlag);
+				ResyncDrawState();
+			}
 
 			fLink.StartMessage(status);
 			if (status == B_OK) {
@@ -1181,6 +1338,13 @@ ServerWindow::_DispatchMessage(int32 code, BPrivate::LinkReceiver& link)
 				return;
 			}
 
+			if (_PrepareRetainedDrawing(code)) {
+				// the message is recorded after it has been carried out
+				_DispatchViewMessage(code, link);
+				_RecordRetainedDrawing(code, link);
+				break;
+			}
+
 			_DispatchViewMessage(code, link);
 			break;
 	}
@@ -1194,7 +1358,8 @@ void
 ServerWindow::_DispatchViewMessage(int32 code,
 	BPrivate::LinkReceiver &link)
 {
-	if (_DispatchPictureMessage(code, link))
+	ServerPicture* picture = fCurrentView->Picture();
+	if (picture != NULL && _DispatchPictureMessage(code, link, picture))
 		return;
 
 	switch (code) {
@@ -2135,6 +2300,9 @@ ServerWindow::_DispatchViewDrawingMessage(int32 code,
 	BPrivate::LinkReceiver &link)
 {
 	if (!fCurrentView->IsVisible() || !fWindow->IsVisible()) {
+		if (!fWindow->IsVisible())
+			fWindow->InvalidateHiddenContents(fCurrentView);
+
 		if (link.NeedsReply()) {
 			debug_printf("ServerWindow::DispatchViewDrawingMessage() got "
 				"message %" B_PRId32 " that needs a reply!\n", code);
@@ -2844,12 +3012,9 @@ ServerWindow::_DispatchViewDrawingMessage(int32 code,
 
 
 bool
-ServerWindow::_DispatchPictureMessage(int32 code, BPrivate::LinkReceiver& link)
+ServerWindow::_DispatchPictureMessage(int32 code, BPrivate::LinkReceiver& link,
+	ServerPicture* picture)
 {
-	ServerPicture* picture = fCurrentView->Picture();
-	if (picture == NULL)
-		return false;
-
 	switch (code) {
 		case AS_VIEW_SET_ORIGIN:
 		{
@@ -3634,10 +3799,138 @@ ServerWindow::_UpdateCurrentDrawingRegion()
 		|| fWindow->DrawingRegionChanged(fCurrentView)) {
 		fWindow->GetEffectiveDrawingRegion(fCurrentView, fCurrentDrawingRegion);
 		fCurrentDrawingRegionValid = true;
+
+		// outside of an update, the client can draw where it likes, but
+		// only the visible parts make it into the window
+		if (!fWindow->InUpdate())
+			fWindow->InvalidateHiddenContents(fCurrentView);
 	}
 }
 
 
+/*!	Keeps the retained drawing of the current view up to date with the view
+	message \a code that is about to be dispatched. Returns \c true when the
+	message belongs to a drawing pass that is being recorded; it then needs
+	to be recorded via _RecordRetainedDrawing() after it has been dispatched.
+*/
+bool
+ServerWindow::_PrepareRetainedDrawing(int32 code)
+{
+	retained_drawing_action action = retained_drawing_action_for(code);
+	if (action == RETAINED_DRAWING_KEEP)
+		return false;
+
+	if (fRetainedPicture != NULL) {
+		if (fRetainedPictureView == fCurrentView
+			&& action == RETAINED_DRAWING_RECORD)
+			return true;
+
+		// this drawing pass cannot be recorded completely
+		_EndRetainedDrawing(false);
+	}
+
+	RetainedDrawing* retained = fCurrentView->GetRetainedDrawing();
+	if (retained == NULL)
+		return false;
+
+	// The client starts drawing a view by pushing its state; only the
+	// views it was asked to redraw in this update have an update rect.
+	BRect updateRect;
+	if (code == AS_VIEW_PUSH_STATE && fWindow->InUpdate()
+		&& fCurrentView->Picture() == NULL
+		&& retained->TakeUpdateRect(updateRect))
+		return _BeginRetainedDrawing(updateRect);
+
+	// anything else might make the view look differently
+	fCurrentView->DiscardRetainedDrawing();
+	return false;
+}
+
+
+bool
+ServerWindow::_BeginRetainedDrawing(const BRect& updateRect)
+{
+	ServerPicture* picture = new(std::nothrow) ServerPicture;
+	if (picture == NULL) {
+		fCurrentView->DiscardRetainedDrawing();
+		return false;
+	}
+
+	picture->SyncState(fCurrentView);
+
+	// The client redraws everything within the update rect, also where
+	// the view is hidden by other windows, but only within its clipping.
+	BRegion* clipping = fWindow->GetRegion();
+	if (clipping == NULL) {
+		picture->ReleaseReference();
+		fCurrentView->DiscardRetainedDrawing();
+		return false;
+	}
+
+	fWindow->GetContentRegion(clipping);
+	*clipping = fCurrentView->ScreenAndUserClipping(clipping);
+	fCurrentView->ConvertFromScreen(clipping);
+
+	fRetainedPictureRegion.Set(updateRect);
+	fRetainedPictureRegion.IntersectWith(clipping);
+	fWindow->RecycleRegion(clipping);
+
+	// what was kept there before is about to be overdrawn
+	fCurrentView->GetRetainedDrawing()->Exclude(fRetainedPictureRegion);
+
+	fRetainedPicture = picture;
+	fRetainedPictureView = fCurrentView;
+	fRetainedPictureBounds = (BRect)fCurrentView->Bounds();
+	fRetainedPictureDepth = 0;
+	return true;
+}
+
+
+/*!	Adds the view message \a code that has just been dispatched to the
+	drawing pass that is being recorded.
+*/
+void
+ServerWindow::_RecordRetainedDrawing(int32 code, BPrivate::LinkReceiver& link)
+{
+	// Reading the message once more does not work when it has passed data
+	// in an area
+	if (link.NeedsReply() || link.RewindMessage() != B_OK) {
+		_EndRetainedDrawing(false);
+		return;
+	}
+
+	_DispatchPictureMessage(code, link, fRetainedPicture);
+
+	if (fRetainedPicture->DataLength() > kMaxRetainedPictureSize) {
+		_EndRetainedDrawing(false);
+		return;
+	}
+
+	if (code == AS_VIEW_PUSH_STATE)
+		fRetainedPictureDepth++;
+	else if (code == AS_VIEW_POP_STATE && --fRetainedPictureDepth == 0) {
+		// the client has finished drawing the view
+		_EndRetainedDrawing(true);
+	}
+}
+
+
+void
+ServerWindow::_EndRetainedDrawing(bool keep)
+{
+	RetainedDrawing* retained = fRetainedPictureView->GetRetainedDrawing();
+	if (keep && retained != NULL
+		&& (BRect)fRetainedPictureView->Bounds() == fRetainedPictureBounds) {
+		retained->AddPicture(fRetainedPicture, fRetainedPictureRegion);
+	}
+
+	fRetainedPicture->ReleaseReference();
+	fRetainedPicture = NULL;
+	fRetainedPictureView = NULL;
+	fRetainedPictureRegion.MakeEmpty();
+}
+
+
 bool
 ServerWindow::_MessageNeedsAllWindowsLocked(uint32 code) const
 {
@@ -3658,6 +3951,7 @@ ServerWindow::_MessageNeedsAllWindowsLocked(uint32 code) const
 		case AS_SYSTEM_FONT_CHANGED:
 		case AS_SET_DECORATOR_SETTINGS:
 		case AS_GET_MOUSE:
+		case AS_DIRECT_WINDOW_GET_SYNC_DATA:
 		case AS_DIRECT_WINDOW_SET_FULLSCREEN:
 //		case AS_VIEW_SET_EVENT_MASK:
 //		case AS_VIEW_SET_MOUSE_EVENT_MASK:
@@ -112,6 +112,9 @@ public:
 
 			void				ResyncDrawState();
 
+			void				PlayRetainedDrawing(View* view,
+									const BRegion& region);
+
 						// TODO: Change this
 	inline	void				UpdateCurrentDrawingRegion()
 									{ _UpdateCurrentDrawingRegion(); };
@@ -131,7 +134,8 @@ private:
 			void				_DispatchViewDrawingMessage(int32 code,
 									BPrivate::LinkReceiver &link);
 			bool				_DispatchPictureMessage(int32 code,
-									BPrivate::LinkReceiver &link);
+									BPrivate::LinkReceiver &link,
+									ServerPicture* picture);
 			void				_MessageLooper();
 	virtual void				_PrepareQuit();
 	virtual void				_GetLooperName(char* name, size_t size);
@@ -144,6 +148,12 @@ private:
 			void				_UpdateDrawState(View* view);
 			void				_UpdateCurrentDrawingRegion();
 
+			bool				_PrepareRetainedDrawing(int32 code);
+			bool				_BeginRetainedDrawing(const BRect& updateRect);
+			void				_RecordRetainedDrawing(int32 code,
+									BPrivate::LinkReceiver &link);
+			void				_EndRetainedDrawing(bool keep);
+
 			bool				_MessageNeedsAllWindowsLocked(
 									uint32 code) const;
 
@@ -178,6 +188,14 @@ private:
 			BRegion				fCurrentDrawingRegion;
 			bool				fCurrentDrawingRegionValid;
 
+			// the drawing pass of a view that is being recorded for its
+			// retained drawing
+			ServerPicture*		fRetainedPicture;
+			View*				fRetainedPictureView;
+			BRect				fRetainedPictureBounds;
+			BRegion				fRetainedPictureRegion;
+			int32				fRetainedPictureDepth;
+
 			DirectWindowInfo*	fDirectWindowInfo;
 			bool				fIsDirectlyAccessing;
 };
@@ -19,6 +19,7 @@
 #include "DrawingEngine.h"
 #include "DrawState.h"
 #include "Overlay.h"
+#include "RetainedDrawing.h"
 #include "ServerApp.h"
 #include "ServerBitmap.h"
 #include "ServerCursor.h"
@@ -32,6 +33,7 @@
 #include <Message.h>
 #include <PortLink.h>
 #include <View.h> // for resize modes
+#include <ViewPrivate.h>
 #include <WindowPrivate.h>
 
 #include <GradientLinear.h>
@@ -113,6 +115,7 @@ View::View(IntRect frame, IntPoint scrollingOffset, const char* name,
 
 	fCursor(NULL),
 	fPicture(NULL),
+	fRetainedDrawing(NULL),
 
 	fLocalClipping((BRect)Bounds()),
 	fScreenClipping(),
@@ -122,6 +125,9 @@ View::View(IntRect frame, IntPoint scrollingOffset, const char* name,
 {
 	if (fDrawState)
 		fDrawState->SetSubPixelPrecise(fFlags & B_SUBPIXEL_PRECISE);
+
+	if ((fFlags & kRetainedDrawingViewFlag) != 0)
+		fRetainedDrawing = new (nothrow) RetainedDrawing;
 }
 
 
@@ -133,6 +139,7 @@ View::~View()
 	delete fScreenAndUserClipping;
 	delete fUserClipping;
 	delete fDrawState;
+	delete fRetainedDrawing;
 
 //	if (fWindow && this == fWindow->TopView())
 //		fWindow->SetTopView(NULL);
@@ -452,6 +459,12 @@ View::SetFlags(uint32 flags)
 {
 	fFlags = flags;
 	fDrawState->SetSubPixelPrecise(fFlags & B_SUBPIXEL_PRECISE);
+
+	if ((fFlags & kRetainedDrawingViewFlag) == 0) {
+		delete fRetainedDrawing;
+		fRetainedDrawing = NULL;
+	} else if (fRetainedDrawing == NULL)
+		fRetainedDrawing = new (nothrow) RetainedDrawing;
 }
 
 
@@ -1031,6 +1044,8 @@ View::ResizeBy(int32 x, int32 y, BRegion* dirtyRegion)
 	fFrame.right += x;
 	fFrame.bottom += y;
 
+	DiscardRetainedDrawing();
+
 	if (fVisible && dirtyRegion) {
 		IntRect oldBounds(Bounds());
 		oldBounds.right -= x;
@@ -1117,6 +1132,8 @@ View::ParentResized(int32 x, int32 y, BRegion* dirtyRegion)
 void
 View::ScrollBy(int32 x, int32 y, BRegion* dirtyRegion)
 {
+	DiscardRetainedDrawing();
+
 	if (!fVisible || !fWindow) {
 		fScrollingOffset.x += x;
 		fScrollingOffset.y += y;
@@ -1323,6 +1340,17 @@ View::SetPicture(ServerPicture* picture)
 }
 
 
+/*!	Forgets what the view has drawn, so that the client has to redraw it
+	when it is exposed again.
+*/
+void
+View::DiscardRetainedDrawing()
+{
+	if (fRetainedDrawing != NULL)
+		fRetainedDrawing->MakeEmpty();
+}
+
+
 void
 View::Draw(DrawingEngine* drawingEngine, BRegion* effectiveClipping,
 	BRegion* windowContentClipping, bool deep)
@@ -1602,6 +1630,12 @@ View::AddTokensForViewsInRegion(BPrivate::PortLink& link, BRegion& region,
 		if (localDirty.CountRects() > 0) {
 			link.Attach<int32>(fToken);
 			link.Attach<BRect>(localDirty.Frame());
+
+			if (fRetainedDrawing != NULL) {
+				BRect updateRect = localDirty.Frame();
+				ConvertFromScreen(&updateRect);
+				fRetainedDrawing->SetUpdateRect(updateRect);
+			}
 		}
 	}
 
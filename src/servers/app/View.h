@@ -31,6 +31,7 @@ class DrawState;
 class DrawingEngine;
 class Overlay;
 class Window;
+class RetainedDrawing;
 class ServerBitmap;
 class ServerCursor;
 class ServerPicture;
@@ -189,6 +190,11 @@ class View {
 			ServerPicture*	Picture() const
 								{ return fPicture; }
 
+			// drawing kept for redrawing exposed parts without the client
+			RetainedDrawing* GetRetainedDrawing() const
+								{ return fRetainedDrawing; }
+			void			DiscardRetainedDrawing();
+
 			// for background clearing
 			virtual void	Draw(DrawingEngine* drawingEngine,
 								BRegion* effectiveClipping,
@@ -286,6 +292,7 @@ class View {
 
 			ServerCursor*	fCursor;
 			ServerPicture*	fPicture;
+			RetainedDrawing* fRetainedDrawing;
 
 			// clipping
 			BRegion			fLocalClipping;
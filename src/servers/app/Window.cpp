@@ -33,8 +33,10 @@
 #include "HWInterface.h"
 #include "MessagePrivate.h"
 #include "PortLink.h"
+#include "RetainedDrawing.h"
 #include "ServerApp.h"
 #include "ServerWindow.h"
+#include "WindowBackingStore.h"
 #include "WindowBehaviour.h"
 #include "Workspace.h"
 #include "WorkspacesView.h"
@@ -94,6 +96,8 @@ Window::Window(const BRect& frame, const char *name,
 	fTopView(NULL),
 	fWindow(window),
 	fDrawingEngine(drawingEngine),
+	fBackingStore(NULL),
+	fContentDrawingEngine(drawingEngine),
 	fDesktop(window->Desktop()),
 
 	fCurrentUpdateSession(&fUpdateSessions[0]),
@@ -177,6 +181,7 @@ Window::~Window()
 	DetachFromWindowStack(false);
 
 	delete fWindowBehaviour;
+	delete fBackingStore;
 	delete fDrawingEngine;
 
 	gDecorManager.CleanupForWindow(this);
@@ -206,6 +211,22 @@ Window::SetClipping(BRegion* stillAvailableOnScreen)
 
 	fVisibleContentRegionValid = false;
 	fEffectiveDrawingRegionValid = false;
+
+	if (fBackingStore != NULL) {
+		// the backing store keeps what has been visible until now, as
+		// long as the client has not been asked to redraw it
+		BRegion* dirty = fRegionPool.GetRegion(fDirtyRegion);
+		if (dirty == NULL)
+			return;
+
+		if (fPendingUpdateSession->IsUsed())
+			dirty->Include(&fPendingUpdateSession->DirtyRegion());
+		if (fCurrentUpdateSession->IsUsed())
+			dirty->Include(&fCurrentUpdateSession->DirtyRegion());
+
+		fBackingStore->SetVisibleRegion(VisibleContentRegion(), *dirty);
+		fRegionPool.Recycle(dirty);
+	}
 }
 
 
@@ -294,6 +315,9 @@ Window::MoveBy(int32 x, int32 y, bool moveStack)
 	// processed yet
 	fDirtyRegion.OffsetBy(x, y);
 
+	if (fBackingStore != NULL)
+		fBackingStore->MoveBy(x, y);
+
 	if (fContentRegionValid)
 		fContentRegion.OffsetBy(x, y);
 
@@ -389,6 +413,28 @@ Window::ResizeBy(int32 x, int32 y, BRegion* dirtyRegion, bool resizeStack)
 		}
 	}
 
+	if (fBackingStore != NULL) {
+		if (dirtyRegion != NULL)
+			_InvalidateBackingStore(*dirtyRegion);
+		else
+			_InvalidateBackingStore(BRegion(fFrame));
+
+		if (fBackingStore->SetSize(fFrame.IntegerWidth() + 1,
+				fFrame.IntegerHeight() + 1) != B_OK) {
+			// the window does not fit into the old bitmap anymore, but
+			// since the screen is up to date, it can just draw there again
+			fFlags &= ~kBackingStoreWindowFlag;
+			_UpdateBackingStore(NULL);
+
+			// the current draw state was only set on the drawing engine of
+			// the backing store
+			if (fDrawingEngine->LockParallelAccess()) {
+				fWindow->ResyncDrawState();
+				fDrawingEngine->UnlockParallelAccess();
+			}
+		}
+	}
+
 	// send a message to the client informing about the changed size
 	BRect frame(Frame());
 	BMessage msg(B_WINDOW_RESIZED);
@@ -413,6 +459,7 @@ Window::ScrollViewBy(View* view, int32 dx, int32 dy)
 		return;
 
 	view->ScrollBy(dx, dy, dirty);
+	_InvalidateBackingStore(*dirty);
 
 //fDrawingEngine->FillRegion(*dirty, (rgb_color){ 255, 0, 255, 255 });
 //snooze(20000);
@@ -431,8 +478,13 @@ void
 Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 {
 	// executed in ServerWindow thread with the read lock held
-	if (!IsVisible())
+	if (!IsVisible()) {
+		if (fBackingStore != NULL) {
+			region->OffsetBy(xOffset, yOffset);
+			_InvalidateBackingStore(*region);
+		}
 		return;
+	}
 
 	BRegion* newDirty = fRegionPool.GetRegion(*region);
 
@@ -471,9 +523,10 @@ Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 				if (allDirtyRegions != NULL)
 					copyRegion->Exclude(allDirtyRegions);
 
-				if (fDrawingEngine->LockParallelAccess()) {
-					fDrawingEngine->CopyRegion(copyRegion, xOffset, yOffset);
-					fDrawingEngine->UnlockParallelAccess();
+				if (fContentDrawingEngine->LockParallelAccess()) {
+					fContentDrawingEngine->CopyRegion(copyRegion, xOffset,
+						yOffset);
+					fContentDrawingEngine->UnlockParallelAccess();
 
 					// Prevent those parts from being added to the dirty region...
 					newDirty->Exclude(copyRegion);
@@ -489,9 +542,9 @@ Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 				fRegionPool.Recycle(copyRegion);
 			} else {
 				// Fallback, should never be here.
-				if (fDrawingEngine->LockParallelAccess()) {
-					fDrawingEngine->CopyRegion(region, xOffset, yOffset);
-					fDrawingEngine->UnlockParallelAccess();
+				if (fContentDrawingEngine->LockParallelAccess()) {
+					fContentDrawingEngine->CopyRegion(region, xOffset, yOffset);
+					fContentDrawingEngine->UnlockParallelAccess();
 				}
 			}
 
@@ -507,6 +560,8 @@ Window::CopyContents(BRegion* region, int32 xOffset, int32 yOffset)
 	// since these parts will now be in newDirty anyways
 	// (with the right offset)
 	newDirty->OffsetBy(xOffset, yOffset);
+	// the backing store cannot provide these parts either
+	_InvalidateBackingStore(*newDirty);
 	newDirty->IntersectWith(&fVisibleContentRegion);
 	if (newDirty->CountRects() > 0)
 		ProcessDirtyRegion(*newDirty);
@@ -711,6 +766,25 @@ Window::ProcessDirtyRegion(BRegion& region)
 	// have the read lock and the desktop thread
 	// is blocking to get the write lock. IAW, this
 	// is only executed in one thread.
+	if (fBackingStore != NULL) {
+		// the region is shared with other windows, and must not be changed
+		BRegion* dirty = fRegionPool.GetRegion(region);
+		if (dirty == NULL)
+			return;
+
+		_CopyFromBackingStore(*dirty);
+		if (dirty->CountRects() > 0)
+			_ProcessDirtyRegion(*dirty);
+
+		fRegionPool.Recycle(dirty);
+	} else
+		_ProcessDirtyRegion(region);
+}
+
+
+void
+Window::_ProcessDirtyRegion(BRegion& region)
+{
 	if (fDirtyRegion.CountRects() == 0) {
 		// the window needs to be informed
 		// when the dirty region was empty.
@@ -725,6 +799,7 @@ Window::ProcessDirtyRegion(BRegion& region)
 		ServerWindow()->RequestRedraw();
 	}
 
+	_InvalidateBackingStore(region);
 	fDirtyRegion.Include(&region);
 	fDirtyCause |= UPDATE_EXPOSE;
 }
@@ -733,6 +808,10 @@ Window::ProcessDirtyRegion(BRegion& region)
 void
 Window::RedrawDirtyRegion()
 {
+	// whatever is not redrawn now is going to be redrawn by the client, or
+	// not at all, when it is no longer visible
+	_InvalidateBackingStore(fDirtyRegion);
+
 	if (TopLayerStackWindow() != this) {
 		fDirtyRegion.MakeEmpty();
 		fDirtyCause = 0;
@@ -747,6 +826,7 @@ Window::RedrawDirtyRegion()
 			fRegionPool.GetRegion(VisibleContentRegion());
 		dirtyContentRegion->IntersectWith(&fDirtyRegion);
 
+		_DrawRetainedViews(*dirtyContentRegion);
 		_TriggerContentRedraw(*dirtyContentRegion);
 
 		fRegionPool.Recycle(dirtyContentRegion);
@@ -783,6 +863,7 @@ Window::MarkContentDirty(BRegion& regionOnScreen)
 	// since this won't affect other windows, read locking
 	// is sufficient. If there was no dirty region before,
 	// an update message is triggered
+	_InvalidateBackingStore(regionOnScreen);
 	if (fHidden || IsOffscreenWindow())
 		return;
 
@@ -796,6 +877,7 @@ void
 Window::MarkContentDirtyAsync(BRegion& regionOnScreen)
 {
 	// NOTE: see comments in ProcessDirtyRegion()
+	_InvalidateBackingStore(regionOnScreen);
 	if (fHidden || IsOffscreenWindow())
 		return;
 
@@ -813,6 +895,20 @@ Window::MarkContentDirtyAsync(BRegion& regionOnScreen)
 void
 Window::InvalidateView(View* view, BRegion& viewRegion)
 {
+	if (view != NULL && view->GetRetainedDrawing() != NULL) {
+		// the client is going to draw something else there
+		view->GetRetainedDrawing()->Exclude(viewRegion);
+	}
+
+	if (view != NULL && fBackingStore != NULL) {
+		BRegion* region = fRegionPool.GetRegion(viewRegion);
+		if (region != NULL) {
+			view->ConvertToScreen(region);
+			_InvalidateBackingStore(*region);
+			fRegionPool.Recycle(region);
+		}
+	}
+
 	if (view && IsVisible() && view->IsVisible()) {
 		if (!fContentRegionValid)
 			_UpdateContentRegion();
@@ -831,6 +927,33 @@ Window::InvalidateView(View* view, BRegion& viewRegion)
 	}
 }
 
+
+/*!	Tells the backing store that the drawing of \a view will not reach
+	its hidden parts, so the contents there are no longer up to date.
+	Called by the ServerWindow whenever the client draws outside of an
+	update, or while the window is not visible.
+*/
+void
+Window::InvalidateHiddenContents(View* view)
+{
+	if (fBackingStore == NULL || view == NULL)
+		return;
+
+	if (!fContentRegionValid)
+		_UpdateContentRegion();
+
+	BRegion* hidden = fRegionPool.GetRegion(
+		view->ScreenAndUserClipping(&fContentRegion));
+	if (hidden == NULL)
+		return;
+
+	if (IsVisible())
+		hidden->Exclude(&VisibleContentRegion());
+
+	_InvalidateBackingStore(*hidden);
+	fRegionPool.Recycle(hidden);
+}
+
 // DisableUpdateRequests
 void
 Window::DisableUpdateRequests()
@@ -1319,6 +1442,8 @@ Window::SetFlags(uint32 flags, BRegion* updateRegion)
 	if ((fFlags & B_SAME_POSITION_IN_ALL_WORKSPACES) != 0)
 		_PropagatePosition();
 
+	_UpdateBackingStore(updateRegion);
+
 	::Decorator* decorator = Decorator();
 	if (decorator == NULL)
 		return;
@@ -1682,7 +1807,8 @@ Window::ValidWindowFlags()
 		| B_CLOSE_ON_ESCAPE
 		| B_NO_SERVER_SIDE_WINDOW_MODIFIERS
 		| kWindowScreenFlag
-		| kAcceptKeyboardFocusFlag;
+		| kAcceptKeyboardFocusFlag
+		| kBackingStoreWindowFlag;
 }
 
 
@@ -1745,10 +1871,11 @@ Window::_TriggerContentRedraw(BRegion& dirtyContentRegion)
 			backgroundClearingRegion = &fPendingUpdateSession->DirtyRegion();
 		}
 
-		if (fDrawingEngine->LockParallelAccess()) {
-			bool copyToFrontEnabled = fDrawingEngine->CopyToFrontEnabled();
-			fDrawingEngine->SetCopyToFrontEnabled(true);
-			fDrawingEngine->SuspendAutoSync();
+		if (fContentDrawingEngine->LockParallelAccess()) {
+			bool copyToFrontEnabled
+				= fContentDrawingEngine->CopyToFrontEnabled();
+			fContentDrawingEngine->SetCopyToFrontEnabled(true);
+			fContentDrawingEngine->SuspendAutoSync();
 
 //sCurrentColor.red = rand() % 255;
 //sCurrentColor.green = rand() % 255;
@@ -1759,12 +1886,12 @@ Window::_TriggerContentRedraw(BRegion& dirtyContentRegion)
 //fDrawingEngine->FillRegion(*backgroundClearingRegion, sCurrentColor);
 //snooze(10000);
 
-			fTopView->Draw(fDrawingEngine, backgroundClearingRegion,
+			fTopView->Draw(fContentDrawingEngine, backgroundClearingRegion,
 				&fContentRegion, true);
 
-			fDrawingEngine->Sync();
-			fDrawingEngine->SetCopyToFrontEnabled(copyToFrontEnabled);
-			fDrawingEngine->UnlockParallelAccess();
+			fContentDrawingEngine->Sync();
+			fContentDrawingEngine->SetCopyToFrontEnabled(copyToFrontEnabled);
+			fContentDrawingEngine->UnlockParallelAccess();
 		}
 	}
 }
@@ -1815,6 +1942,81 @@ fWindow->ResyncDrawState();
 }
 
 
+/*!	Redraws those parts of \a dirtyContentRegion that views can replay
+	from their retained drawing, and removes them from the region, so that
+	the client is not asked to redraw them.
+*/
+void
+Window::_DrawRetainedViews(BRegion& dirtyContentRegion)
+{
+	// leave alone whatever the client is going to redraw anyway
+	BRegion* replayRegion = fRegionPool.GetRegion(dirtyContentRegion);
+	if (replayRegion == NULL)
+		return;
+
+	if (fPendingUpdateSession->IsUsed())
+		replayRegion->Exclude(&fPendingUpdateSession->DirtyRegion());
+	if (fInUpdate)
+		replayRegion->Exclude(&fCurrentUpdateSession->DirtyRegion());
+
+	if (replayRegion->CountRects() > 0
+		&& fContentDrawingEngine->LockParallelAccess()) {
+		if (!fContentRegionValid)
+			_UpdateContentRegion();
+
+		bool copyToFrontEnabled = fContentDrawingEngine->CopyToFrontEnabled();
+		fContentDrawingEngine->SetCopyToFrontEnabled(true);
+		fContentDrawingEngine->SuspendAutoSync();
+
+		_DrawRetainedView(fTopView, *replayRegion, dirtyContentRegion);
+
+		fContentDrawingEngine->Sync();
+		fContentDrawingEngine->SetCopyToFrontEnabled(copyToFrontEnabled);
+		fContentDrawingEngine->UnlockParallelAccess();
+	}
+
+	fRegionPool.Recycle(replayRegion);
+}
+
+
+void
+Window::_DrawRetainedView(View* view, const BRegion& replayRegion,
+	BRegion& dirtyContentRegion)
+{
+	// A view that draws on its children is drawn after them, and would
+	// need to be redrawn whenever one of them is.
+	if (view == NULL || !view->IsVisible()
+		|| (view->Flags() & B_DRAW_ON_CHILDREN) != 0)
+		return;
+
+	RetainedDrawing* retained = view->GetRetainedDrawing();
+	if (retained != NULL && retained->CountPictures() > 0) {
+		BRegion* region = fRegionPool.GetRegion();
+		if (region == NULL)
+			return;
+
+		retained->GetRegion(*region);
+		view->ConvertToScreen(region);
+		region->IntersectWith(&replayRegion);
+		region->IntersectWith(&view->ScreenAndUserClipping(&fContentRegion));
+
+		if (region->CountRects() > 0) {
+			view->Draw(fContentDrawingEngine, region, &fContentRegion, false);
+			fWindow->PlayRetainedDrawing(view, *region);
+
+			dirtyContentRegion.Exclude(region);
+		}
+
+		fRegionPool.Recycle(region);
+	}
+
+	for (View* child = view->FirstChild(); child != NULL;
+			child = child->NextSibling()) {
+		_DrawRetainedView(child, replayRegion, dirtyContentRegion);
+	}
+}
+
+
 /*!	pre: the clipping is readlocked (this function is
 	only called from _TriggerContentRedraw()), which
 	in turn is only called from MessageReceived() with
@@ -1937,16 +2139,16 @@ Window::BeginUpdate(BPrivate::PortLink& link)
 	link.Flush();
 
 	// supress back to front buffer copies in the drawing engine
-	fDrawingEngine->SetCopyToFrontEnabled(false);
+	fContentDrawingEngine->SetCopyToFrontEnabled(false);
 
 	if (!fCurrentUpdateSession->IsExpose()
-		&& fDrawingEngine->LockParallelAccess()) {
-		fDrawingEngine->SuspendAutoSync();
+		&& fContentDrawingEngine->LockParallelAccess()) {
+		fContentDrawingEngine->SuspendAutoSync();
 
-		fTopView->Draw(fDrawingEngine, dirty, &fContentRegion, true);
+		fTopView->Draw(fContentDrawingEngine, dirty, &fContentRegion, true);
 
-		fDrawingEngine->Sync();
-		fDrawingEngine->UnlockParallelAccess();
+		fContentDrawingEngine->Sync();
+		fContentDrawingEngine->UnlockParallelAccess();
 	} // else the background was cleared already
 
 	fRegionPool.Recycle(dirty);
@@ -1960,7 +2162,7 @@ Window::EndUpdate()
 
 	if (fInUpdate) {
 		// reenable copy to front
-		fDrawingEngine->SetCopyToFrontEnabled(true);
+		fContentDrawingEngine->SetCopyToFrontEnabled(true);
 
 		BRegion* dirty = fRegionPool.GetRegion(
 			fCurrentUpdateSession->DirtyRegion());
@@ -1968,7 +2170,7 @@ Window::EndUpdate()
 		if (dirty) {
 			dirty->IntersectWith(&VisibleContentRegion());
 
-			fDrawingEngine->CopyToFront(*dirty);
+			fContentDrawingEngine->CopyToFront(*dirty);
 			fRegionPool.Recycle(dirty);
 		}
 
@@ -2000,6 +2202,90 @@ Window::_UpdateContentRegion()
 }
 
 
+/*!	Creates or deletes the backing store as the window flags demand. A new
+	backing store is empty, so the contents of the window are added to
+	\a updateRegion to have the client draw them into it.
+	Windows that access the frame buffer themselves don't get one.
+*/
+void
+Window::_UpdateBackingStore(BRegion* updateRegion)
+{
+	bool wanted = (fFlags & kBackingStoreWindowFlag) != 0
+		&& (fFlags & kWindowScreenFlag) == 0
+		&& fFeel != kOffscreenWindowFeel && fFeel != kWindowScreenFeel
+		&& !fWindow->HasDirectFrameBufferAccess()
+		&& fDrawingEngine != NULL;
+	if (wanted == (fBackingStore != NULL))
+		return;
+
+	if (!wanted) {
+		fDrawingEngine->SetCopyToFrontEnabled(
+			fContentDrawingEngine->CopyToFrontEnabled());
+		fContentDrawingEngine = fDrawingEngine;
+
+		delete fBackingStore;
+		fBackingStore = NULL;
+		return;
+	}
+
+	WindowBackingStore* backingStore
+		= new(nothrow) WindowBackingStore(this);
+	if (backingStore == NULL || backingStore->InitCheck() != B_OK) {
+		delete backingStore;
+		fFlags &= ~kBackingStoreWindowFlag;
+		return;
+	}
+
+	fBackingStore = backingStore;
+	fContentDrawingEngine = fBackingStore->GetDrawingEngine();
+	fContentDrawingEngine->SetCopyToFrontEnabled(
+		fDrawingEngine->CopyToFrontEnabled());
+	fDrawingEngine->SetCopyToFrontEnabled(true);
+
+	if (updateRegion != NULL)
+		updateRegion->Include(fFrame);
+}
+
+
+/*!	Copies those parts of \a region to the screen that the backing store
+	still has, and are not waiting to be redrawn by the client anyway, and
+	removes them from \a region.
+*/
+void
+Window::_CopyFromBackingStore(BRegion& region)
+{
+	if (!IsVisible() || fWindow->HasDirectFrameBufferAccess())
+		return;
+
+	BRegion* copyRegion = fRegionPool.GetRegion(region);
+	if (copyRegion == NULL)
+		return;
+
+	copyRegion->IntersectWith(&VisibleContentRegion());
+	copyRegion->IntersectWith(&fBackingStore->ValidRegion());
+	copyRegion->Exclude(&fDirtyRegion);
+	if (fPendingUpdateSession->IsUsed())
+		copyRegion->Exclude(&fPendingUpdateSession->DirtyRegion());
+	if (fCurrentUpdateSession->IsUsed())
+		copyRegion->Exclude(&fCurrentUpdateSession->DirtyRegion());
+
+	if (copyRegion->CountRects() > 0) {
+		fBackingStore->CopyToScreen(*copyRegion);
+		region.Exclude(copyRegion);
+	}
+
+	fRegionPool.Recycle(copyRegion);
+}
+
+
+void
+Window::_InvalidateBackingStore(const BRegion& region)
+{
+	if (fBackingStore != NULL)
+		fBackingStore->Invalidate(region);
+}
+
+
 void
 Window::_ObeySizeLimits()
 {
@@ -71,6 +71,7 @@ class Desktop;
 class DrawingEngine;
 class EventDispatcher;
 class Screen;
+class WindowBackingStore;
 class WindowBehaviour;
 class WorkspacesView;
 
@@ -154,6 +155,7 @@ public:
 			void				MarkContentDirtyAsync(BRegion& regionOnScreen);
 			// shortcut for invalidating just one view
 			void				InvalidateView(View* view, BRegion& viewRegion);
+			void				InvalidateHiddenContents(View* view);
 
 			void				DisableUpdateRequests();
 			void				EnableUpdateRequests();
@@ -166,7 +168,11 @@ public:
 			bool				NeedsUpdate() const
 									{ return fUpdateRequested; }
 
+			// the contents of the window are drawn with this one,
+			// the decorator is drawn with the screen drawing engine
 			DrawingEngine*		GetDrawingEngine() const
+									{ return fContentDrawingEngine; }
+			DrawingEngine*		GetScreenDrawingEngine() const
 									{ return fDrawingEngine; }
 
 			// managing a region pool
@@ -317,6 +323,11 @@ protected:
 			// different types of drawing
 			void				_TriggerContentRedraw(BRegion& dirty);
 			void				_DrawBorder();
+			void				_DrawRetainedViews(
+									BRegion& dirtyContentRegion);
+			void				_DrawRetainedView(View* view,
+									const BRegion& replayRegion,
+									BRegion& dirtyContentRegion);
 
 			// handling update sessions
 			void				_TransferToUpdateSession(
@@ -325,6 +336,13 @@ protected:
 
 			void				_UpdateContentRegion();
 
+			void				_ProcessDirtyRegion(BRegion& region);
+
+			void				_UpdateBackingStore(BRegion* updateRegion);
+			void				_CopyFromBackingStore(BRegion& region);
+			void				_InvalidateBackingStore(
+									const BRegion& region);
+
 			void				_ObeySizeLimits();
 			void				_PropagatePosition();
 
@@ -365,6 +383,8 @@ protected:
 			View*				fTopView;
 			::ServerWindow*		fWindow;
 			DrawingEngine*		fDrawingEngine;
+			WindowBackingStore*	fBackingStore;
+			DrawingEngine*		fContentDrawingEngine;
 			::Desktop*			fDesktop;
 
 			// The synchronization, which client drawing commands
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "WindowBackingStore.h"
+
+#include <new>
+#include <string.h>
+
+#include "BitmapHWInterface.h"
+#include "DrawingEngine.h"
+#include "IntPoint.h"
+#include "ServerBitmap.h"
+#include "Window.h"
+
+
+using std::nothrow;
+
+
+// When the window grows beyond the bitmap, the new bitmap leaves some room
+// for it to grow further, so that resizing a window does not need a new
+// bitmap for every step.
+static const int32 kSizeIncrement = 64;
+
+
+/*!	The interface the drawing engine of the window draws into. The
+	DrawingEngine invalidates everything it has drawn, which is then
+	copied to the screen.
+*/
+class WindowBackingStore::CompositingInterface : public BitmapHWInterface {
+public:
+	CompositingInterface(WindowBackingStore* store, ServerBitmap* bitmap)
+		:
+		BitmapHWInterface(bitmap),
+		fStore(store)
+	{
+	}
+
+	virtual status_t InvalidateRegion(BRegion& region)
+	{
+		fStore->CopyToScreen(region);
+		return B_OK;
+	}
+
+	virtual status_t Invalidate(const BRect& frame)
+	{
+		fStore->CopyToScreen(frame);
+		return B_OK;
+	}
+
+private:
+	WindowBackingStore*	fStore;
+};
+
+
+//	#pragma mark -
+
+
+WindowBackingStore::WindowBackingStore(Window* window)
+	:
+	fWindow(window),
+	fFrame(window->Frame()),
+	fBitmap(NULL),
+	fInterface(NULL),
+	fDrawingEngine(new(nothrow) DrawingEngine())
+{
+	if (fDrawingEngine == NULL)
+		return;
+
+	UtilityBitmap* bitmap;
+	CompositingInterface* interface;
+	if (_Allocate(fFrame.IntegerWidth() + 1, fFrame.IntegerHeight() + 1,
+			bitmap, interface) != B_OK) {
+		return;
+	}
+
+	_Attach(interface);
+	fBitmap = bitmap;
+	fInterface = interface;
+}
+
+
+WindowBackingStore::~WindowBackingStore()
+{
+	if (fDrawingEngine != NULL)
+		fDrawingEngine->SetHWInterface(NULL);
+
+	_FreeInterface(fInterface);
+	delete fDrawingEngine;
+	delete fBitmap;
+}
+
+
+status_t
+WindowBackingStore::InitCheck() const
+{
+	if (fDrawingEngine == NULL || fBitmap == NULL || fInterface == NULL)
+		return B_NO_MEMORY;
+
+	return B_OK;
+}
+
+
+/*!	Moves the bitmap along with the window; nobody must be drawing into it
+	at the same time.
+*/
+void
+WindowBackingStore::MoveBy(int32 x, int32 y)
+{
+	fFrame.OffsetBy(x, y);
+	fValidRegion.OffsetBy(x, y);
+	fVisibleRegion.OffsetBy(x, y);
+	fInvalidRegion.OffsetBy(x, y);
+
+	if (fInterface != NULL)
+		_Attach(fInterface);
+}
+
+
+/*!	Adapts the bitmap to the new size of the window. The contents stay where
+	they are relative to the window's left top corner. If a bigger bitmap
+	cannot be allocated, the old one is kept, and an error is returned.
+*/
+status_t
+WindowBackingStore::SetSize(int32 width, int32 height)
+{
+	if (InitCheck() != B_OK)
+		return B_NO_INIT;
+
+	BRect frame(fFrame.LeftTop(),
+		BPoint(fFrame.left + width - 1, fFrame.top + height - 1));
+
+	int32 oldWidth = fBitmap->Width();
+	int32 oldHeight = fBitmap->Height();
+	if (width > oldWidth || height > oldHeight) {
+		UtilityBitmap* bitmap;
+		CompositingInterface* interface;
+		status_t status = _Allocate(width + kSizeIncrement,
+			height + kSizeIncrement, bitmap, interface);
+		if (status != B_OK)
+			return status;
+
+		// keep the contents that are still valid
+		int32 rowCount = min_c(oldHeight, bitmap->Height());
+		size_t rowLength = min_c(oldWidth, bitmap->Width()) * 4;
+		for (int32 y = 0; y < rowCount; y++) {
+			memcpy(bitmap->Bits() + y * bitmap->BytesPerRow(),
+				fBitmap->Bits() + y * fBitmap->BytesPerRow(), rowLength);
+		}
+
+		_Attach(interface);
+		_FreeInterface(fInterface);
+		delete fBitmap;
+
+		fBitmap = bitmap;
+		fInterface = interface;
+	}
+
+	fFrame = frame;
+
+	BRegion bounds(fFrame);
+	fValidRegion.IntersectWith(&bounds);
+	fVisibleRegion.IntersectWith(&bounds);
+	return B_OK;
+}
+
+
+/*!	Called by the window whenever its visible content region is about to
+	change to \a visible. Whatever was visible before and has not been
+	invalidated since, is still what the client has drawn there, unless it
+	is \a dirty, ie. waiting to be drawn anew.
+*/
+void
+WindowBackingStore::SetVisibleRegion(const BRegion& visible,
+	const BRegion& dirty)
+{
+	fVisibleRegion.Exclude(&fInvalidRegion);
+	fVisibleRegion.Exclude(&dirty);
+	fValidRegion.Include(&fVisibleRegion);
+
+	fInvalidRegion.MakeEmpty();
+	fVisibleRegion = visible;
+}
+
+
+/*!	Tells the backing store that the contents within \a region are no longer
+	what the client would draw there, ie. because it has been asked to draw
+	them anew, or because its drawing did not make it into the bitmap.
+*/
+void
+WindowBackingStore::Invalidate(const BRegion& region)
+{
+	fValidRegion.Exclude(&region);
+	fInvalidRegion.Include(&region);
+}
+
+
+/*!	Copies the contents of the bitmap within \a frame to the screen, as far
+	as the window is visible there.
+*/
+void
+WindowBackingStore::CopyToScreen(const BRect& frame)
+{
+	BRegion* region = fWindow->GetRegion();
+	if (region == NULL)
+		return;
+
+	region->Set(frame);
+	_CopyToScreen(*region);
+	fWindow->RecycleRegion(region);
+}
+
+
+void
+WindowBackingStore::CopyToScreen(const BRegion& region)
+{
+	BRegion* copy = fWindow->GetRegion(region);
+	if (copy == NULL)
+		return;
+
+	_CopyToScreen(*copy);
+	fWindow->RecycleRegion(copy);
+}
+
+
+status_t
+WindowBackingStore::_Allocate(int32 width, int32 height,
+	UtilityBitmap*& _bitmap, CompositingInterface*& _interface)
+{
+	UtilityBitmap* bitmap = new(nothrow) UtilityBitmap(
+		BRect(0, 0, width - 1, height - 1), B_RGB32, 0);
+	if (bitmap == NULL)
+		return B_NO_MEMORY;
+
+	CompositingInterface* interface
+		= new(nothrow) CompositingInterface(this, bitmap);
+	if (interface == NULL || !bitmap->IsValid()) {
+		delete interface;
+		delete bitmap;
+		return B_NO_MEMORY;
+	}
+
+	status_t status = interface->Initialize();
+	if (status != B_OK) {
+		delete interface;
+		delete bitmap;
+		return status;
+	}
+
+	_bitmap = bitmap;
+	_interface = interface;
+	return B_OK;
+}
+
+
+void
+WindowBackingStore::_FreeInterface(CompositingInterface* interface)
+{
+	if (interface == NULL)
+		return;
+
+	interface->LockExclusiveAccess();
+	interface->Shutdown();
+	interface->UnlockExclusiveAccess();
+	delete interface;
+}
+
+
+/*!	Lets the drawing engine draw into \a interface, with the bitmap placed
+	at the window's position on screen.
+*/
+void
+WindowBackingStore::_Attach(CompositingInterface* interface)
+{
+	// the painter must not look at a clipping region that might be gone
+	// by the time it is attached to the buffer again
+	if (fInterface != NULL && fDrawingEngine->LockParallelAccess()) {
+		fDrawingEngine->ConstrainClippingRegion(&fClipping);
+		fDrawingEngine->UnlockParallelAccess();
+	}
+
+	interface->SetOrigin(IntPoint((int32)fFrame.left, (int32)fFrame.top));
+	fDrawingEngine->SetHWInterface(interface);
+}
+
+
+void
+WindowBackingStore::_CopyToScreen(BRegion& region)
+{
+	if (!fWindow->IsVisible())
+		return;
+
+	region.IntersectWith(&fWindow->VisibleContentRegion());
+	if (region.CountRects() == 0)
+		return;
+
+	DrawingEngine* engine = fWindow->GetScreenDrawingEngine();
+	if (engine == NULL || !engine->LockParallelAccess())
+		return;
+
+	BRect bounds = fBitmap->Bounds();
+	engine->ConstrainClippingRegion(&region);
+	engine->SetDrawingMode(B_OP_COPY);
+	engine->DrawBitmap(fBitmap, bounds,
+		bounds.OffsetByCopy(fFrame.LeftTop()));
+
+	engine->UnlockParallelAccess();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef WINDOW_BACKING_STORE_H
+#define WINDOW_BACKING_STORE_H
+
+
+#include <Rect.h>
+#include <Region.h>
+
+
+class DrawingEngine;
+class UtilityBitmap;
+class Window;
+
+
+/*!	Keeps the contents of a window with the kBackingStoreWindowFlag in an
+	offscreen bitmap. The window draws its contents into the bitmap instead
+	of the screen, and everything that is drawn there is copied to the
+	visible part of the window on screen right away.
+	Whatever is left in the bitmap when parts of the window are covered
+	stays valid until the client is asked to redraw it, so the Desktop can
+	copy it back to the screen when these parts are exposed again, instead
+	of asking the client to redraw them.
+	All regions are in screen coordinates.
+*/
+class WindowBackingStore {
+public:
+								WindowBackingStore(Window* window);
+								~WindowBackingStore();
+
+			status_t			InitCheck() const;
+
+			DrawingEngine*		GetDrawingEngine() const
+									{ return fDrawingEngine; }
+
+			void				MoveBy(int32 x, int32 y);
+			status_t			SetSize(int32 width, int32 height);
+
+			void				SetVisibleRegion(const BRegion& visible,
+									const BRegion& dirty);
+			void				Invalidate(const BRegion& region);
+			const BRegion&		ValidRegion() const
+									{ return fValidRegion; }
+
+			void				CopyToScreen(const BRect& frame);
+			void				CopyToScreen(const BRegion& region);
+
+private:
+			class CompositingInterface;
+
+			status_t			_Allocate(int32 width, int32 height,
+									UtilityBitmap*& _bitmap,
+									CompositingInterface*& _interface);
+			void				_FreeInterface(
+									CompositingInterface* interface);
+			void				_Attach(CompositingInterface* interface);
+			void				_CopyToScreen(BRegion& region);
+
+			Window*				fWindow;
+			BRect				fFrame;
+			UtilityBitmap*		fBitmap;
+			CompositingInterface* fInterface;
+			DrawingEngine*		fDrawingEngine;
+			BRegion				fClipping;
+
+			BRegion				fValidRegion;
+			BRegion				fVisibleRegion;
+			BRegion				fInvalidRegion;
+};
+
+
+#endif	// WINDOW_BACKING_STORE_H
@@ -136,15 +136,15 @@ DecorManager::AllocateDecorator(Window* window)
 	if (window == fPreviewWindow) {
 		if (fPreviewDecor != NULL) {
 			return fPreviewDecor->AllocateDecorator(window->Desktop(),
-				window->GetDrawingEngine(), window->Frame(), window->Title(),
-				window->Look(), window->Flags());
+				window->GetScreenDrawingEngine(), window->Frame(),
+				window->Title(), window->Look(), window->Flags());
 		} else {
 			fPreviewWindow = NULL;
 		}
 	}
 
 	return fCurrentDecor->AllocateDecorator(window->Desktop(),
-		window->GetDrawingEngine(), window->Frame(), window->Title(),
+		window->GetScreenDrawingEngine(), window->Frame(), window->Title(),
 		window->Look(), window->Flags());
 }
 
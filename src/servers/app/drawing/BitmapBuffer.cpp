@@ -10,7 +10,8 @@
 
 // constructor
 BitmapBuffer::BitmapBuffer(ServerBitmap* bitmap)
-	: fBitmap(bitmap)
+	: fBitmap(bitmap),
+	  fOrigin(0, 0)
 {
 }
 
@@ -43,8 +44,11 @@ BitmapBuffer::ColorSpace() const
 void*
 BitmapBuffer::Bits() const
 {
-	if (InitCheck() >= B_OK)
-		return fBitmap->Bits();
+	if (InitCheck() >= B_OK) {
+		// the pixel at fOrigin is the first one of the bitmap
+		return fBitmap->Bits() - (ssize_t)fOrigin.y * fBitmap->BytesPerRow()
+			- (ssize_t)fOrigin.x * 4;
+	}
 	return NULL;
 }
 
@@ -61,8 +65,8 @@ BitmapBuffer::BytesPerRow() const
 uint32
 BitmapBuffer::Width() const
 {
-	if (InitCheck() >= B_OK)
-		return fBitmap->Width();
+	if (InitCheck() >= B_OK && fBitmap->Width() + fOrigin.x > 0)
+		return fBitmap->Width() + fOrigin.x;
 	return 0;
 }
 
@@ -70,8 +74,21 @@ BitmapBuffer::Width() const
 uint32
 BitmapBuffer::Height() const
 {
-	if (InitCheck() >= B_OK)
-		return fBitmap->Height();
+	if (InitCheck() >= B_OK && fBitmap->Height() + fOrigin.y > 0)
+		return fBitmap->Height() + fOrigin.y;
 	return 0;
 }
 
+// SetOrigin
+/*!	Places the bitmap at \a origin, so that it is addressed in the
+	coordinates of whatever it is a part of, ie. the screen. The buffer
+	then also spans the (inaccessible) area between (0, 0) and \a origin,
+	while anything left or above of (0, 0) cannot be reached anymore.
+	This only works with 32 bit bitmaps.
+*/
+void
+BitmapBuffer::SetOrigin(const IntPoint& origin)
+{
+	fOrigin = origin;
+}
+
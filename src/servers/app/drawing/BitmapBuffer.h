@@ -3,6 +3,7 @@
 #ifndef BITMAP_BUFFER_H
 #define BITMAP_BUFFER_H
 
+#include "IntPoint.h"
 #include "RenderingBuffer.h"
 
 class ServerBitmap;
@@ -23,9 +24,14 @@ class BitmapBuffer : public RenderingBuffer {
 								// BitmapBuffer
 			const ServerBitmap*	Bitmap() const
 									{ return fBitmap; }
+
+			void				SetOrigin(const IntPoint& origin);
+			IntPoint			Origin() const
+									{ return fOrigin; }
  private:
 
 			ServerBitmap*		fBitmap;
+			IntPoint			fOrigin;
 };
 
 #endif // BITMAP_BUFFER_H
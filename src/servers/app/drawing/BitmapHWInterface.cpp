@@ -199,3 +199,20 @@ BitmapHWInterface::IsDoubleBuffered() const
 
 	return HWInterface::IsDoubleBuffered();
 }
+
+
+/*!	Places the bitmap at \a origin in the coordinate system it is drawn in,
+	see BitmapBuffer::SetOrigin(). Nobody must be drawing at the same time.
+*/
+status_t
+BitmapHWInterface::SetOrigin(const IntPoint& origin)
+{
+	if (fFrontBuffer == NULL || fBackBuffer != NULL)
+		return B_NOT_SUPPORTED;
+
+	if (fFrontBuffer->Origin() != origin) {
+		fFrontBuffer->SetOrigin(origin);
+		_NotifyFrameBufferChanged();
+	}
+	return B_OK;
+}
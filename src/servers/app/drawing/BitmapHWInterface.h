@@ -12,6 +12,7 @@
 #include "HWInterface.h"
 
 class BitmapBuffer;
+class IntPoint;
 class MallocBuffer;
 class ServerBitmap;
 class BBitmapBuffer;
@@ -56,6 +57,8 @@ public:
 	virtual	RenderingBuffer*	BackBuffer() const;
 	virtual	bool				IsDoubleBuffered() const;
 
+			status_t			SetOrigin(const IntPoint& origin);
+
 private:
 			BBitmapBuffer*		fBackBuffer;
 			BitmapBuffer*		fFrontBuffer;
@@ -15,6 +15,7 @@
 
 #include <new>
 
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -52,8 +53,10 @@
 #include <View.h>
 
 #include "DrawingMode.h"
+#include "DrawingModeSIMD.h"
 #include "GlobalSubpixelSettings.h"
 #include "PatternHandler.h"
+#include "RenderThreadPool.h"
 #include "RenderingBuffer.h"
 #include "ServerBitmap.h"
 #include "ServerFont.h"
@@ -83,10 +86,6 @@ using std::nothrow;
 #define CHECK_CLIPPING	if (!fValidClipping) return BRect(0, 0, -1, -1);
 #define CHECK_CLIPPING_NO_RETURN	if (!fValidClipping) return;
 
-// Defines for SIMD support.
-#define APPSERVER_SIMD_MMX	(1 << 0)
-#define APPSERVER_SIMD_SSE	(1 << 1)
-
 // Prototypes for assembler routines
 extern "C" {
 	void bilinear_scale_xloop_mmxsse(const uint8* src, void* dst,
@@ -104,7 +103,7 @@ static uint32 sSIMDFlags = detect_simd();
 static uint32
 detect_simd()
 {
-#if __INTEL__
+#if defined(__INTEL__) || defined(__x86_64__)
 	// Only scan CPUs for which we are certain the SIMD flags are properly
 	// defined.
 	const char* vendorNames[] = {
@@ -149,6 +148,8 @@ detect_simd()
 				cpuSIMD |= APPSERVER_SIMD_MMX;
 			if (edx & (1 << 25))
 				cpuSIMD |= APPSERVER_SIMD_SSE;
+			if (edx & (1 << 26))
+				cpuSIMD |= APPSERVER_SIMD_SSE2;
 		} else {
 			// no flags can be identified
 			cpuSIMD = 0;
@@ -156,12 +157,221 @@ detect_simd()
 		systemSIMD &= cpuSIMD;
 	}
 	return systemSIMD;
-#else	// !__INTEL__
+#else	// !__INTEL__ && !__x86_64__
 	return 0;
 #endif
 }
 
 
+// #pragma mark - tiled rendering
+
+
+// Operations touching fewer pixels are rendered by the calling thread alone,
+// handing them to the RenderThreadPool would cost more than it saves.
+static const int64 kMinTiledPixels = 256 * 256;
+
+
+/*!	Renders the scanlines of the rasterizer between top and bottom only.
+	The cells of the rasterizer must have been sorted by rewind_scanlines()
+	before, they are only read here, so that the bands of one rasterizer
+	can be rendered at the same time. Every scanline is computed from the
+	cells of its own row, so the pixels are exactly the same as when all
+	scanlines are rendered at once.
+*/
+template<class Rasterizer, class Scanline, class Renderer>
+static void
+render_scanlines_in_band(const Rasterizer& rasterizer, Scanline& scanline,
+	Renderer& renderer, int32 top, int32 bottom)
+{
+	int y = max_c(top, rasterizer.min_y());
+	if (y > bottom)
+		return;
+
+	scanline.reset(rasterizer.min_x(), rasterizer.max_x());
+	renderer.prepare();
+	while (rasterizer.sweep_scanline(scanline, y) && scanline.y() <= bottom)
+		renderer.render(scanline);
+}
+
+
+//! Fills with a solid color, using the renderer of the Painter's type.
+template<class Renderer>
+class SolidFill {
+public:
+	SolidFill(const agg::rgba8& color)
+		:
+		fColor(color)
+	{
+	}
+
+	template<class Rasterizer, class Scanline>
+	void Render(renderer_base& baseRenderer, const Rasterizer& rasterizer,
+		Scanline& scanline, int32 top, int32 bottom) const
+	{
+		Renderer renderer(baseRenderer);
+		renderer.color(fColor);
+		render_scanlines_in_band(rasterizer, scanline, renderer, top, bottom);
+	}
+
+private:
+	agg::rgba8	fColor;
+};
+
+
+/*!	Fills with a gradient. The span generator keeps state while it works on
+	a span, so every band gets one of its own.
+*/
+template<class GradientFunction, class ColorArray>
+class GradientFill {
+public:
+	GradientFill(const GradientFunction& function,
+			const agg::trans_affine& matrix, const ColorArray& colors)
+		:
+		fFunction(function),
+		fMatrix(matrix),
+		fColors(colors)
+	{
+	}
+
+	template<class Rasterizer, class Scanline>
+	void Render(renderer_base& baseRenderer, const Rasterizer& rasterizer,
+		Scanline& scanline, int32 top, int32 bottom) const
+	{
+		typedef agg::span_interpolator_linear<> interpolator_type;
+		typedef agg::span_allocator<agg::rgba8> span_allocator_type;
+		typedef agg::span_gradient<agg::rgba8, interpolator_type,
+			GradientFunction, ColorArray> span_gradient_type;
+		typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
+			span_gradient_type> renderer_gradient_type;
+
+		interpolator_type spanInterpolator(fMatrix);
+		span_allocator_type spanAllocator;
+		span_gradient_type spanGradient(spanInterpolator, fFunction, fColors,
+			0, 100);
+		renderer_gradient_type renderer(baseRenderer, spanAllocator,
+			spanGradient);
+
+		render_scanlines_in_band(rasterizer, scanline, renderer, top, bottom);
+	}
+
+private:
+	const GradientFunction&		fFunction;
+	const agg::trans_affine&	fMatrix;
+	const ColorArray&			fColors;
+};
+
+
+/*!	Fills a path in horizontal bands. All bands share the cells of the one
+	rasterizer the path was added to, and every band only sweeps the
+	scanlines of its rows, with a scanline and base renderer of its own.
+*/
+template<class Rasterizer, class Scanline, class Fill>
+class FillPathTask : public RenderTask {
+public:
+	FillPathTask(pixfmt& pixelFormat, const BRegion* clipping,
+			const Rasterizer& rasterizer, const Fill& fill)
+		:
+		fPixelFormat(pixelFormat),
+		fClipping(clipping),
+		fRasterizer(rasterizer),
+		fFill(fill)
+	{
+	}
+
+	virtual void Render(int32 top, int32 bottom)
+	{
+		renderer_base baseRenderer(fPixelFormat);
+		baseRenderer.set_clipping_region(const_cast<BRegion*>(fClipping));
+
+		Scanline scanline;
+		fFill.Render(baseRenderer, fRasterizer, scanline, top, bottom);
+	}
+
+private:
+	pixfmt&						fPixelFormat;
+	const BRegion*				fClipping;
+	const Rasterizer&			fRasterizer;
+	const Fill&					fFill;
+};
+
+
+/*!	Fills the path that has been added to \a rasterizer between the rows
+	top and bottom using the threads of the RenderThreadPool. The path is
+	only rasterized once; its cells are sorted here, before the bands start
+	reading them.
+*/
+template<class Scanline, class Rasterizer, class Fill>
+static void
+fill_path_tiled(pixfmt& pixelFormat, const BRegion* clipping,
+	Rasterizer& rasterizer, const Fill& fill, int32 top, int32 bottom)
+{
+	if (!rasterizer.rewind_scanlines())
+		return;
+
+	FillPathTask<Rasterizer, Scanline, Fill> task(pixelFormat, clipping,
+		rasterizer, fill);
+	RenderThreadPool::Default()->Run(task, top, bottom);
+}
+
+
+struct FilterInfo {
+	uint16 index;	// index into source bitmap row/column
+	uint16 weight;	// weight of the pixel at index [0..255]
+};
+
+
+// versions of the bilinear scaling loops
+enum {
+	kOptimizeForLowFilterRatio = 0,
+	kUseDefaultVersion,
+	kUseSIMDVersion
+};
+
+
+/*!	Scales a B_RGBA32 bitmap with bilinear filtering into the rows of a
+	band, using the filter weights computed by
+	Painter::_DrawBitmapBilinearCopy32().
+*/
+class BilinearCopyTask : public RenderTask {
+public:
+	BilinearCopyTask(agg::rendering_buffer& dstBuffer,
+			agg::rendering_buffer& srcBuffer, const BRegion* clipping,
+			FilterInfo* xWeights, FilterInfo* yWeights, uint32 xIndexOffset,
+			uint32 yIndexOffset, const BRect& viewRect, int codeSelect)
+		:
+		fDstBuffer(dstBuffer),
+		fSrcBuffer(srcBuffer),
+		fClipping(clipping),
+		fXWeights(xWeights),
+		fYWeights(yWeights),
+		fXIndexOffset(xIndexOffset),
+		fYIndexOffset(yIndexOffset),
+		fLeft((int32)viewRect.left),
+		fTop((int32)viewRect.top),
+		fRight((int32)viewRect.right),
+		fBottom((int32)viewRect.bottom),
+		fCodeSelect(codeSelect)
+	{
+	}
+
+	virtual void Render(int32 bandTop, int32 bandBottom);
+
+private:
+	agg::rendering_buffer&		fDstBuffer;
+	agg::rendering_buffer&		fSrcBuffer;
+	const BRegion*				fClipping;
+	FilterInfo*					fXWeights;
+	FilterInfo*					fYWeights;
+	uint32						fXIndexOffset;
+	uint32						fYIndexOffset;
+	int32						fLeft;
+	int32						fTop;
+	int32						fRight;
+	int32						fBottom;
+	int							fCodeSelect;
+};
+
+
 // #pragma mark -
 
 
@@ -201,6 +411,7 @@ Painter::Painter()
 	fTextRenderer(fSubpixRenderer, fRenderer, fRendererBin, fUnpackedScanline,
 		fSubpixUnpackedScanline, fSubpixRasterizer)
 {
+	fPixelFormat.SetSIMDFlags(sSIMDFlags);
 	fPixelFormat.SetDrawingMode(fDrawingMode, fAlphaSrcMode, fAlphaFncMode,
 		false);
 
@@ -1726,6 +1937,31 @@ Painter::_Clipped(const BRect& rect) const
 }
 
 
+// _IsWorthTiling
+/*!	Returns whether an operation touching the pixels within \a bounds is
+	large enough to be split into bands for the RenderThreadPool, and the
+	rows it covers.
+*/
+bool
+Painter::_IsWorthTiling(const BRect& bounds, int32& top, int32& bottom) const
+{
+	BRect frame = fClippingRegion->Frame();
+	BRect touched = bounds & frame;
+	if (!bounds.IsValid() || !touched.IsValid())
+		return false;
+
+	int32 left = (int32)floorf(touched.left);
+	int32 right = min_c((int32)ceilf(touched.right), (int32)frame.right);
+	top = (int32)floorf(touched.top);
+	bottom = min_c((int32)ceilf(touched.bottom), (int32)frame.bottom);
+
+	if ((int64)(right - left + 1) * (bottom - top + 1) < kMinTiledPixels)
+		return false;
+
+	return RenderThreadPool::Default()->IsParallel();
+}
+
+
 // _UpdateDrawingMode
 void
 Painter::_UpdateDrawingMode(bool drawingText)
@@ -2304,11 +2540,6 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 			- viewRect.top);
 	}
 
-	struct FilterInfo {
-		uint16 index;	// index into source bitmap row/column
-		uint16 weight;	// weight of the pixel at index [0..255]
-	};
-
 //#define FILTER_INFOS_ON_HEAP
 #ifdef FILTER_INFOS_ON_HEAP
 	FilterInfo* xWeights = new (nothrow) FilterInfo[dstWidth];
@@ -2378,48 +2609,80 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 //	yWeights[dstHeight - 1].index, yWeights[dstHeight - 1].weight,
 //	dstHeight);
 
-	const int32 left = (int32)viewRect.left;
-	const int32 top = (int32)viewRect.top;
-	const int32 right = (int32)viewRect.right;
-	const int32 bottom = (int32)viewRect.bottom;
-
-	const uint32 dstBPR = fBuffer.stride();
-	const uint32 srcBPR = srcBuffer.stride();
-
 	// Figure out which version of the code we want to use...
-	enum {
-		kOptimizeForLowFilterRatio = 0,
-		kUseDefaultVersion,
-		kUseSIMDVersion
-	};
-
 	int codeSelect = kUseDefaultVersion;
 
+#ifdef __INTEL__
+	// the assembler version of the x loop only exists for x86
 	uint32 neededSIMDFlags = APPSERVER_SIMD_MMX | APPSERVER_SIMD_SSE;
 	if ((sSIMDFlags & neededSIMDFlags) == neededSIMDFlags)
 		codeSelect = kUseSIMDVersion;
-	else {
+	else
+#endif
+	{
 		if (xScale == yScale && (xScale == 1.5 || xScale == 2.0
 			|| xScale == 2.5 || xScale == 3.0)) {
 			codeSelect = kOptimizeForLowFilterRatio;
 		}
 	}
 
+	BilinearCopyTask task(fBuffer, srcBuffer, fClippingRegion, xWeights,
+		yWeights, filterWeightXIndexOffset, filterWeightYIndexOffset,
+		viewRect, codeSelect);
+
+	int32 bandTop;
+	int32 bandBottom;
+	if (_IsWorthTiling(viewRect, bandTop, bandBottom))
+		RenderThreadPool::Default()->Run(task, bandTop, bandBottom);
+	else
+		task.Render(INT_MIN, INT_MAX);
+
+#ifdef FILTER_INFOS_ON_HEAP
+	delete[] xWeights;
+	delete[] yWeights;
+#endif
+//printf("draw bitmap %.5fx%.5f: %lld\n", xScale, yScale, system_time() - now);
+}
+
+
+// BilinearCopyTask
+void
+BilinearCopyTask::Render(int32 bandTop, int32 bandBottom)
+{
+	agg::rendering_buffer& srcBuffer = fSrcBuffer;
+	FilterInfo* xWeights = fXWeights;
+	FilterInfo* yWeights = fYWeights;
+	const uint32 filterWeightXIndexOffset = fXIndexOffset;
+	const uint32 filterWeightYIndexOffset = fYIndexOffset;
+	const int32 left = fLeft;
+	const int32 top = fTop;
+	const int32 right = fRight;
+	const int32 bottom = fBottom;
+	const uint32 dstBPR = fDstBuffer.stride();
+	const uint32 srcBPR = fSrcBuffer.stride();
+	const int codeSelect = fCodeSelect;
+
 	// iterate over clipping boxes
-	fBaseRenderer.first_clip_box();
-	do {
-		const int32 x1 = max_c(fBaseRenderer.xmin(), left);
-		const int32 x2 = min_c(fBaseRenderer.xmax(), right);
+	const int32 count = fClipping->CountRects();
+	for (int32 i = 0; i < count; i++) {
+		clipping_rect box = fClipping->RectAtInt(i);
+		const int32 x1 = max_c(box.left, left);
+		const int32 x2 = min_c(box.right, right);
 		if (x1 > x2)
 			continue;
 
-		int32 y1 = max_c(fBaseRenderer.ymin(), top);
-		int32 y2 = min_c(fBaseRenderer.ymax(), bottom);
+		int32 y1 = max_c(box.top, top);
+		int32 y2 = min_c(box.bottom, bottom);
+
+		// restrict the box to the rows of this band
+		const bool includesLastRow = y2 <= bandBottom;
+		y1 = max_c(y1, bandTop);
+		y2 = min_c(y2, bandBottom);
 		if (y1 > y2)
 			continue;
 
 		// buffer offset into destination
-		uint8* dst = fBuffer.row_ptr(y1) + x1 * 4;
+		uint8* dst = fDstBuffer.row_ptr(y1) + x1 * 4;
 
 		// x and y are needed as indeces into the wheight arrays, so the
 		// offset into the target buffer needs to be compensated
@@ -2428,9 +2691,6 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 		y1 -= top + filterWeightYIndexOffset;
 		y2 -= top + filterWeightYIndexOffset;
 
-//printf("x: %ld - %ld\n", xIndexL, xIndexR);
-//printf("y: %ld - %ld\n", y1, y2);
-
 		switch (codeSelect) {
 			case kOptimizeForLowFilterRatio:
 			{
@@ -2525,9 +2785,10 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 				// the last column/row and the right/bottom corner pixel.
 
 				// The last column/row handling does not need to be performed
-				// for all clipping rects!
+				// for all clipping rects! Bands only get it for the last row of
+				// the box, so the pixels do not depend on the banding.
 				int32 yMax = y2;
-				if (yWeights[yMax].weight == 255)
+				if (includesLastRow && yWeights[yMax].weight == 255)
 					yMax--;
 				int32 xIndexMax = xIndexR;
 				if (xWeights[xIndexMax].weight == 255)
@@ -2612,9 +2873,10 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 				// routines for the processing of the single display lines.
 
 				// The last column/row handling does not need to be performed
-				// for all clipping rects!
+				// for all clipping rects! Bands only get it for the last row of
+				// the box, so the pixels do not depend on the banding.
 				int32 yMax = y2;
-				if (yWeights[yMax].weight == 255)
+				if (includesLastRow && yWeights[yMax].weight == 255)
 					yMax--;
 				int32 xIndexMax = xIndexR;
 				if (xWeights[xIndexMax].weight == 255)
@@ -2675,13 +2937,7 @@ Painter::_DrawBitmapBilinearCopy32(agg::rendering_buffer& srcBuffer,
 			}
 #endif	// __INTEL__
 		}
-	} while (fBaseRenderer.next_clip_box());
-
-#ifdef FILTER_INFOS_ON_HEAP
-	delete[] xWeights;
-	delete[] yWeights;
-#endif
-//printf("draw bitmap %.5fx%.5f: %lld\n", xScale, yScale, system_time() - now);
+	}
 }
 
 
@@ -2907,7 +3163,27 @@ template<class VertexSource>
 BRect
 Painter::_FillPath(VertexSource& path) const
 {
-	if (gSubpixelAntialiasing) {
+	BRect bounds = _BoundingBox(path);
+
+	int32 top;
+	int32 bottom;
+	if (_IsWorthTiling(bounds, top, bottom)) {
+		if (gSubpixelAntialiasing) {
+			fSubpixRasterizer.reset();
+			fSubpixRasterizer.add_path(path);
+
+			SolidFill<renderer_subpix_type> fill(fSubpixRenderer.color());
+			fill_path_tiled<scanline_packed_subpix_type>(fBaseRenderer.ren(),
+				fClippingRegion, fSubpixRasterizer, fill, top, bottom);
+		} else {
+			fRasterizer.reset();
+			fRasterizer.add_path(path);
+
+			SolidFill<renderer_type> fill(fRenderer.color());
+			fill_path_tiled<scanline_packed_type>(fBaseRenderer.ren(),
+				fClippingRegion, fRasterizer, fill, top, bottom);
+		}
+	} else if (gSubpixelAntialiasing) {
 		fSubpixRasterizer.reset();
 		fSubpixRasterizer.add_path(path);
 		agg::render_scanlines(fSubpixRasterizer,
@@ -2918,7 +3194,7 @@ Painter::_FillPath(VertexSource& path) const
 		agg::render_scanlines(fRasterizer, fPackedScanline, fRenderer);
 	}
 
-	return _Clipped(_BoundingBox(path));
+	return _Clipped(bounds);
 }
 
 
@@ -3106,34 +3382,18 @@ Painter::_FillPathGradientLinear(VertexSource& path,
 	BPoint start = linear.Start();
 	BPoint end = linear.End();
 
-	typedef agg::span_interpolator_linear<> interpolator_type;
 	typedef agg::pod_auto_array<agg::rgba8, 256> color_array_type;
-	typedef agg::span_allocator<agg::rgba8> span_allocator_type;
-	typedef agg::gradient_x	gradient_func_type;
-	typedef agg::span_gradient<agg::rgba8, interpolator_type,
-				gradient_func_type, color_array_type> span_gradient_type;
-	typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
-				span_gradient_type> renderer_gradient_type;
+	typedef agg::gradient_x gradient_func_type;
 
 	gradient_func_type gradientFunc;
 	agg::trans_affine gradientMatrix;
-	interpolator_type spanInterpolator(gradientMatrix);
-	span_allocator_type spanAllocator;
 	color_array_type colorArray;
 
 	_MakeGradient(colorArray, linear);
 
-	span_gradient_type spanGradient(spanInterpolator, gradientFunc, colorArray,
-		0, 100);
-
-	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
-		spanGradient);
-
 	_CalcLinearGradientTransform(start, end, gradientMatrix);
 
-	fRasterizer.reset();
-	fRasterizer.add_path(path);
-	agg::render_scanlines(fRasterizer, fPackedScanline, gradientRenderer);
+	_FillPathGradient(path, gradientFunc, gradientMatrix, colorArray);
 }
 
 
@@ -3149,38 +3409,22 @@ Painter::_FillPathGradientRadial(VertexSource& path,
 // TODO: finish this
 //	float radius = radial.Radius();
 
-	typedef agg::span_interpolator_linear<> interpolator_type;
 	typedef agg::pod_auto_array<agg::rgba8, 256> color_array_type;
-	typedef agg::span_allocator<agg::rgba8> span_allocator_type;
 	typedef agg::gradient_radial gradient_func_type;
-	typedef agg::span_gradient<agg::rgba8, interpolator_type,
-	gradient_func_type, color_array_type> span_gradient_type;
-	typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
-	span_gradient_type> renderer_gradient_type;
 
 	gradient_func_type gradientFunc;
 	agg::trans_affine gradientMatrix;
-	interpolator_type spanInterpolator(gradientMatrix);
-	span_allocator_type spanAllocator;
 	color_array_type colorArray;
 
 	_MakeGradient(colorArray, radial);
 
-	span_gradient_type spanGradient(spanInterpolator, gradientFunc, colorArray,
-		0, 100);
-
-	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
-		spanGradient);
-
 	gradientMatrix.reset();
 	gradientMatrix *= agg::trans_affine_translation(center.x, center.y);
 	gradientMatrix.invert();
 
 //	_CalcLinearGradientTransform(start, end, gradientMtx);
 
-	fRasterizer.reset();
-	fRasterizer.add_path(path);
-	agg::render_scanlines(fRasterizer, fPackedScanline, gradientRenderer);
+	_FillPathGradient(path, gradientFunc, gradientMatrix, colorArray);
 }
 
 
@@ -3197,38 +3441,22 @@ Painter::_FillPathGradientRadialFocus(VertexSource& path,
 //	BPoint focal = focus.Focal();
 //	float radius = focus.Radius();
 
-	typedef agg::span_interpolator_linear<> interpolator_type;
 	typedef agg::pod_auto_array<agg::rgba8, 256> color_array_type;
-	typedef agg::span_allocator<agg::rgba8> span_allocator_type;
 	typedef agg::gradient_radial_focus gradient_func_type;
-	typedef agg::span_gradient<agg::rgba8, interpolator_type,
-	gradient_func_type, color_array_type> span_gradient_type;
-	typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
-	span_gradient_type> renderer_gradient_type;
 
 	gradient_func_type gradientFunc;
 	agg::trans_affine gradientMatrix;
-	interpolator_type spanInterpolator(gradientMatrix);
-	span_allocator_type spanAllocator;
 	color_array_type colorArray;
 
 	_MakeGradient(colorArray, focus);
 
-	span_gradient_type spanGradient(spanInterpolator, gradientFunc, colorArray,
-		0, 100);
-
-	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
-		spanGradient);
-
 	gradientMatrix.reset();
 	gradientMatrix *= agg::trans_affine_translation(center.x, center.y);
 	gradientMatrix.invert();
 
 	//	_CalcLinearGradientTransform(start, end, gradientMatrix);
 
-	fRasterizer.reset();
-	fRasterizer.add_path(path);
-	agg::render_scanlines(fRasterizer, fPackedScanline, gradientRenderer);
+	_FillPathGradient(path, gradientFunc, gradientMatrix, colorArray);
 }
 
 
@@ -3243,38 +3471,22 @@ Painter::_FillPathGradientDiamond(VertexSource& path,
 	BPoint center = diamond.Center();
 //	float radius = diamond.Radius();
 
-	typedef agg::span_interpolator_linear<> interpolator_type;
 	typedef agg::pod_auto_array<agg::rgba8, 256> color_array_type;
-	typedef agg::span_allocator<agg::rgba8> span_allocator_type;
 	typedef agg::gradient_diamond gradient_func_type;
-	typedef agg::span_gradient<agg::rgba8, interpolator_type,
-	gradient_func_type, color_array_type> span_gradient_type;
-	typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
-	span_gradient_type> renderer_gradient_type;
 
 	gradient_func_type gradientFunc;
 	agg::trans_affine gradientMatrix;
-	interpolator_type spanInterpolator(gradientMatrix);
-	span_allocator_type spanAllocator;
 	color_array_type colorArray;
 
 	_MakeGradient(colorArray, diamond);
 
-	span_gradient_type spanGradient(spanInterpolator, gradientFunc, colorArray,
-		0, 100);
-
-	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
-		spanGradient);
-
 	gradientMatrix.reset();
 	gradientMatrix *= agg::trans_affine_translation(center.x, center.y);
 	gradientMatrix.invert();
 
 	//	_CalcLinearGradientTransform(start, end, gradientMatrix);
 
-	fRasterizer.reset();
-	fRasterizer.add_path(path);
-	agg::render_scanlines(fRasterizer, fPackedScanline, gradientRenderer);
+	_FillPathGradient(path, gradientFunc, gradientMatrix, colorArray);
 }
 
 
@@ -3289,36 +3501,47 @@ Painter::_FillPathGradientConic(VertexSource& path,
 	BPoint center = conic.Center();
 //	float radius = conic.Radius();
 
-	typedef agg::span_interpolator_linear<> interpolator_type;
 	typedef agg::pod_auto_array<agg::rgba8, 256> color_array_type;
-	typedef agg::span_allocator<agg::rgba8> span_allocator_type;
 	typedef agg::gradient_conic gradient_func_type;
-	typedef agg::span_gradient<agg::rgba8, interpolator_type,
-	gradient_func_type, color_array_type> span_gradient_type;
-	typedef agg::renderer_scanline_aa<renderer_base, span_allocator_type,
-	span_gradient_type> renderer_gradient_type;
 
 	gradient_func_type gradientFunc;
 	agg::trans_affine gradientMatrix;
-	interpolator_type spanInterpolator(gradientMatrix);
-	span_allocator_type spanAllocator;
 	color_array_type colorArray;
 
 	_MakeGradient(colorArray, conic);
 
-	span_gradient_type spanGradient(spanInterpolator, gradientFunc, colorArray,
-		0, 100);
-
-	renderer_gradient_type gradientRenderer(fBaseRenderer, spanAllocator,
-		spanGradient);
-
 	gradientMatrix.reset();
 	gradientMatrix *= agg::trans_affine_translation(center.x, center.y);
 	gradientMatrix.invert();
 
 	//	_CalcLinearGradientTransform(start, end, gradientMatrix);
 
+	_FillPathGradient(path, gradientFunc, gradientMatrix, colorArray);
+}
+
+
+// _FillPathGradient
+template<class VertexSource, class GradientFunction, class ColorArray>
+void
+Painter::_FillPathGradient(VertexSource& path,
+	const GradientFunction& function, const agg::trans_affine& gradientMatrix,
+	const ColorArray& colorArray) const
+{
+	GradientFill<GradientFunction, ColorArray> fill(function, gradientMatrix,
+		colorArray);
+
+	int32 top;
+	int32 bottom;
+	bool tiled = _IsWorthTiling(_BoundingBox(path), top, bottom);
+
 	fRasterizer.reset();
 	fRasterizer.add_path(path);
-	agg::render_scanlines(fRasterizer, fPackedScanline, gradientRenderer);
+
+	if (tiled) {
+		fill_path_tiled<scanline_packed_type>(fBaseRenderer.ren(),
+			fClippingRegion, fRasterizer, fill, top, bottom);
+	} else if (fRasterizer.rewind_scanlines()) {
+		fill.Render(fBaseRenderer, fRasterizer, fPackedScanline, INT_MIN,
+			INT_MAX);
+	}
 }
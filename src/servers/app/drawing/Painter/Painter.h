@@ -238,6 +238,8 @@ private:
 			BPoint				_Transform(const BPoint& point,
 									bool centerOffset = true) const;
 			BRect				_Clipped(const BRect& rect) const;
+			bool				_IsWorthTiling(const BRect& bounds,
+									int32& top, int32& bottom) const;
 
 			void				_UpdateFont() const;
 			void				_UpdateLineWidth();
@@ -324,6 +326,12 @@ private:
 			template<class VertexSource>
 			void				_FillPathGradientConic(VertexSource& path,
 									const BGradientConic& conic) const;
+			template<class VertexSource, class GradientFunction,
+				class ColorArray>
+			void				_FillPathGradient(VertexSource& path,
+									const GradientFunction& function,
+									const agg::trans_affine& gradientMatrix,
+									const ColorArray& colorArray) const;
 
 	mutable	agg::rendering_buffer fBuffer;
 
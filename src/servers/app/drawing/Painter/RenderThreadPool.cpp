@@ -0,0 +1,221 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * A pool of threads shared by all Painters, which render large operations
+ * in horizontal bands in parallel.
+ *
+ */
+
+#include "RenderThreadPool.h"
+
+
+// Bands are handed out one at a time to whichever thread is free, so a
+// few more bands than threads even out differences in the cost of rows.
+static const int32 kBandsPerThread = 4;
+static const int32 kMinBandHeight = 16;
+
+enum {
+	kNotInitialized = 0,
+	kInitializing,
+	kInitialized
+};
+
+
+RenderTask::~RenderTask()
+{
+}
+
+
+// #pragma mark -
+
+
+RenderThreadPool
+RenderThreadPool::sDefaultInstance;
+
+
+// constructor
+RenderThreadPool::RenderThreadPool()
+	:
+	fBusy(0),
+	fInitState(kNotInitialized),
+	fEnabled(true),
+	fThreadCount(0),
+	fWorkSemaphore(-1),
+	fDoneSemaphore(-1),
+	fTask(NULL),
+	fTop(0),
+	fBottom(-1),
+	fBandHeight(0),
+	fNextBand(0),
+	fBandCount(0)
+{
+}
+
+
+// destructor
+RenderThreadPool::~RenderThreadPool()
+{
+	// deleting the semaphore makes the workers quit
+	delete_sem(fWorkSemaphore);
+	delete_sem(fDoneSemaphore);
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		status_t result;
+		wait_for_thread(fThreads[i], &result);
+	}
+}
+
+
+// Default
+/*static*/ RenderThreadPool*
+RenderThreadPool::Default()
+{
+	return &sDefaultInstance;
+}
+
+
+// IsParallel
+bool
+RenderThreadPool::IsParallel()
+{
+	_Init();
+	return fEnabled && fThreadCount > 0;
+}
+
+
+// SetEnabled
+void
+RenderThreadPool::SetEnabled(bool enabled)
+{
+	fEnabled = enabled;
+}
+
+
+// Run
+void
+RenderThreadPool::Run(RenderTask& task, int32 top, int32 bottom)
+{
+	if (top > bottom)
+		return;
+
+	_Init();
+
+	int32 rows = bottom - top + 1;
+	if (fThreadCount == 0 || !fEnabled || rows < 2 * kMinBandHeight
+		|| atomic_test_and_set(&fBusy, 1, 0) != 0) {
+		// nothing to share, or somebody else is using the pool already
+		task.Render(top, bottom);
+		return;
+	}
+
+	int32 bandCount = (fThreadCount + 1) * kBandsPerThread;
+	int32 bandHeight = (rows + bandCount - 1) / bandCount;
+	if (bandHeight < kMinBandHeight)
+		bandHeight = kMinBandHeight;
+
+	fTask = &task;
+	fTop = top;
+	fBottom = bottom;
+	fBandHeight = bandHeight;
+	fBandCount = (rows + bandHeight - 1) / bandHeight;
+	fNextBand = 0;
+
+	int32 helpers = fBandCount - 1;
+	if (helpers > fThreadCount)
+		helpers = fThreadCount;
+
+	release_sem_etc(fWorkSemaphore, helpers, 0);
+
+	_RenderBands();
+
+	// wait for the helpers to finish their bands
+	while (acquire_sem_etc(fDoneSemaphore, helpers, 0, 0) == B_INTERRUPTED)
+		;
+
+	fTask = NULL;
+	atomic_set(&fBusy, 0);
+}
+
+
+// _Init
+void
+RenderThreadPool::_Init()
+{
+	if (atomic_get(&fInitState) == kInitialized)
+		return;
+
+	if (atomic_test_and_set(&fInitState, kInitializing, kNotInitialized)
+			!= kNotInitialized) {
+		// another thread is starting the pool
+		while (atomic_get(&fInitState) != kInitialized)
+			snooze(1000);
+		return;
+	}
+
+	system_info info;
+	int32 count = 0;
+	if (get_system_info(&info) == B_OK)
+		count = info.cpu_count - 1;
+	if (count > kMaxThreads)
+		count = kMaxThreads;
+
+	if (count > 0) {
+		fWorkSemaphore = create_sem(0, "render work");
+		fDoneSemaphore = create_sem(0, "render done");
+		if (fWorkSemaphore < 0 || fDoneSemaphore < 0)
+			count = 0;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		thread_id thread = spawn_thread(_WorkerThread, "render worker",
+			B_DISPLAY_PRIORITY, this);
+		if (thread < 0)
+			break;
+
+		fThreads[fThreadCount++] = thread;
+		resume_thread(thread);
+	}
+
+	atomic_set(&fInitState, kInitialized);
+}
+
+
+// _RenderBands
+void
+RenderThreadPool::_RenderBands()
+{
+	while (true) {
+		int32 band = atomic_add(&fNextBand, 1);
+		if (band >= fBandCount)
+			break;
+
+		int32 top = fTop + band * fBandHeight;
+		int32 bottom = top + fBandHeight - 1;
+		if (bottom > fBottom)
+			bottom = fBottom;
+
+		fTask->Render(top, bottom);
+	}
+}
+
+
+// _WorkerThread
+/*static*/ status_t
+RenderThreadPool::_WorkerThread(void* data)
+{
+	RenderThreadPool* pool = (RenderThreadPool*)data;
+
+	while (true) {
+		status_t status = acquire_sem(pool->fWorkSemaphore);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		pool->_RenderBands();
+		release_sem_etc(pool->fDoneSemaphore, 1, B_DO_NOT_RESCHEDULE);
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * A pool of threads shared by all Painters, which render large operations
+ * in horizontal bands in parallel.
+ *
+ */
+
+#ifndef RENDER_THREAD_POOL_H
+#define RENDER_THREAD_POOL_H
+
+#include <OS.h>
+
+
+class RenderTask {
+public:
+	virtual						~RenderTask();
+
+	// renders the rows top to bottom (inclusive), may be called from any
+	// thread of the pool at the same time for different rows
+	virtual	void				Render(int32 top, int32 bottom) = 0;
+};
+
+
+class RenderThreadPool {
+public:
+								RenderThreadPool();
+								~RenderThreadPool();
+
+	// global instance
+	static	RenderThreadPool*	Default();
+
+	// whether rendering in bands can happen in parallel at all
+			bool				IsParallel();
+
+	// turns rendering in bands off, so that everything is rendered by the
+	// calling thread alone, as on a single CPU
+			void				SetEnabled(bool enabled);
+
+	// renders the rows top to bottom with the task, and returns when all
+	// of them are done; when the pool is busy with another task, the rows
+	// are rendered by the calling thread alone
+			void				Run(RenderTask& task, int32 top,
+									int32 bottom);
+
+private:
+	static	status_t			_WorkerThread(void* data);
+			void				_Init();
+			void				_RenderBands();
+
+	enum {
+		kMaxThreads			= 8
+	};
+
+	static	RenderThreadPool	sDefaultInstance;
+
+			vint32				fBusy;
+			vint32				fInitState;
+			bool				fEnabled;
+
+			thread_id			fThreads[kMaxThreads];
+			int32				fThreadCount;
+			sem_id				fWorkSemaphore;
+			sem_id				fDoneSemaphore;
+
+			RenderTask*			fTask;
+			int32				fTop;
+			int32				fBottom;
+			int32				fBandHeight;
+			vint32				fNextBand;
+			int32				fBandCount;
+};
+
+#endif // RENDER_THREAD_POOL_H
@@ -0,0 +1,522 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * SSE2 versions of the span functions of the most common drawing modes on
+ * B_RGBA32.
+ *
+ * Four pixels are processed at once, their channels are spread to 16 bit
+ * lanes, so that the blending can be done with exactly the same integer
+ * arithmetic as the BLEND and BLEND16 macros in DrawingMode.h use. The
+ * results are identical to those of the C versions, which also still handle
+ * the pixels at the end of a span that don't fill a whole vector.
+ *
+ * On x86, only the functions of this file are compiled for SSE2. The headers
+ * are included before that on purpose: the inline functions they contain
+ * may end up being used by the rest of the app_server as well.
+ *
+ */
+
+#include "DrawingModeSIMD.h"
+
+#if DRAWING_MODE_SSE2
+
+#include <string.h>
+
+#include "DrawingMode.h"
+#include "GlobalSubpixelSettings.h"
+#include "PatternHandler.h"
+
+#ifndef __SSE2__
+#	pragma GCC push_options
+#	pragma GCC target("sse2")
+#	define DRAWING_MODE_SSE2_TARGET	1
+#endif
+
+#include <emmintrin.h>
+
+
+// pixel_for
+static inline uint32
+pixel_for(uint8 red, uint8 green, uint8 blue)
+{
+	return blue | (green << 8) | (red << 16) | 0xff000000;
+}
+
+// color_channels
+//
+// Returns the channels of the color for two pixels: b, g, r, 0, b, g, r, 0.
+static inline __m128i
+color_channels(uint8 red, uint8 green, uint8 blue)
+{
+	return _mm_set_epi16(0, red, green, blue, 0, red, green, blue);
+}
+
+// load_covers
+//
+// Returns the four covers in the lower four 16 bit lanes.
+static inline __m128i
+load_covers(uint32 covers)
+{
+	return _mm_unpacklo_epi8(_mm_cvtsi32_si128(covers), _mm_setzero_si128());
+}
+
+// spread_alphas
+//
+// Spreads the alpha values in the lower four 16 bit lanes to all channels of
+// their pixels, the first two pixels end up in low, the others in high.
+static inline void
+spread_alphas(__m128i alphas, __m128i& low, __m128i& high)
+{
+	__m128i pairs = _mm_unpacklo_epi16(alphas, alphas);
+	low = _mm_unpacklo_epi32(pairs, pairs);
+	high = _mm_unpackhi_epi32(pairs, pairs);
+}
+
+// select_pixels
+static inline __m128i
+select_pixels(__m128i mask, __m128i ifSet, __m128i ifClear)
+{
+	return _mm_or_si128(_mm_and_si128(mask, ifSet),
+		_mm_andnot_si128(mask, ifClear));
+}
+
+// blend8
+//
+// (color * alpha + dest * (256 - alpha)) >> 8 for alpha in 0..256, which is
+// what the BLEND macro computes. An alpha of 256 assigns the color.
+static inline __m128i
+blend8(__m128i color, __m128i dest, __m128i alpha)
+{
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), alpha);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(color, alpha),
+		_mm_mullo_epi16(dest, inverse)), 8);
+}
+
+// blend16
+//
+// (color * alpha + dest * (65536 - alpha)) >> 16 for alpha in 0..65535,
+// which is what the BLEND16 macro computes. The sum doesn't fit into 16 bits,
+// so the high and low halves of the products are added separately.
+static inline __m128i
+blend16(__m128i color, __m128i dest, __m128i alpha)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i inverse = _mm_sub_epi16(zero, alpha);
+		// wraps around to 0 for an alpha of 0, which is handled below
+
+	__m128i low1 = _mm_mullo_epi16(color, alpha);
+	__m128i high1 = _mm_mulhi_epu16(color, alpha);
+	__m128i low2 = _mm_mullo_epi16(dest, inverse);
+	__m128i high2 = _mm_mulhi_epu16(dest, inverse);
+
+	// the saturated sum of the low halves differs from the wrapped one
+	// exactly when there is a carry
+	__m128i noCarry = _mm_cmpeq_epi16(_mm_add_epi16(low1, low2),
+		_mm_adds_epu16(low1, low2));
+	__m128i result = _mm_add_epi16(_mm_add_epi16(high1, high2),
+		_mm_add_epi16(_mm_set1_epi16(1), noCarry));
+
+	return select_pixels(_mm_cmpeq_epi16(alpha, zero), dest, result);
+}
+
+// blend_pixels8
+static inline __m128i
+blend_pixels8(__m128i dest, __m128i color, __m128i alphaLow,
+	__m128i alphaHigh)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = blend8(color, _mm_unpacklo_epi8(dest, zero), alphaLow);
+	__m128i high = blend8(color, _mm_unpackhi_epi8(dest, zero), alphaHigh);
+	return _mm_or_si128(_mm_packus_epi16(low, high),
+		_mm_set1_epi32(0xff000000));
+}
+
+// blend_pixels16
+static inline __m128i
+blend_pixels16(__m128i dest, __m128i colorLow, __m128i colorHigh,
+	__m128i alphaLow, __m128i alphaHigh)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = blend16(colorLow, _mm_unpacklo_epi8(dest, zero), alphaLow);
+	__m128i high = blend16(colorHigh, _mm_unpackhi_epi8(dest, zero),
+		alphaHigh);
+	return _mm_or_si128(_mm_packus_epi16(low, high),
+		_mm_set1_epi32(0xff000000));
+}
+
+// pixel_mask
+//
+// Returns a mask with all bits of a pixel set, if the 16 bit lanes of the
+// pixel are set in the given masks.
+static inline __m128i
+pixel_mask(__m128i maskLow, __m128i maskHigh)
+{
+	return _mm_packs_epi16(maskLow, maskHigh);
+}
+
+// load32
+static inline uint32
+load32(const uint8* data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+// #pragma mark - B_OP_OVER
+
+
+// blend_hline_over_solid_sse2
+void
+blend_hline_over_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, uint8 cover, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	if (pattern->IsSolidLow())
+		return;
+
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	if (cover == 255) {
+		__m128i solid = _mm_set1_epi32(pixel_for(c.r, c.g, c.b));
+		for (; len >= 4; len -= 4, p += 16)
+			_mm_storeu_si128((__m128i*)p, solid);
+		for (; len > 0; len--, p += 4)
+			*(uint32*)p = pixel_for(c.r, c.g, c.b);
+		return;
+	}
+
+	__m128i color = color_channels(c.r, c.g, c.b);
+	__m128i alpha = _mm_set1_epi16(cover);
+	for (; len >= 4; len -= 4, p += 16) {
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		_mm_storeu_si128((__m128i*)p,
+			blend_pixels8(dest, color, alpha, alpha));
+	}
+
+	for (; len > 0; len--, p += 4)
+		BLEND(p, c.r, c.g, c.b, cover);
+}
+
+
+// blend_solid_hspan_over_solid_sse2
+void
+blend_solid_hspan_over_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	if (pattern->IsSolidLow())
+		return;
+
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	__m128i zero = _mm_setzero_si128();
+	__m128i full = _mm_set1_epi16(255);
+	__m128i solid = _mm_set1_epi32(pixel_for(c.r, c.g, c.b));
+	__m128i color = color_channels(c.r, c.g, c.b);
+
+	for (; len >= 4; len -= 4, covers += 4, p += 16) {
+		uint32 covers4 = load32(covers);
+		if (covers4 == 0)
+			continue;
+		if (covers4 == 0xffffffff) {
+			_mm_storeu_si128((__m128i*)p, solid);
+			continue;
+		}
+
+		// a cover of 255 assigns the color, which is the same as blending
+		// with an alpha of 256
+		__m128i alphas = load_covers(covers4);
+		alphas = _mm_sub_epi16(alphas, _mm_cmpeq_epi16(alphas, full));
+
+		__m128i alphaLow;
+		__m128i alphaHigh;
+		spread_alphas(alphas, alphaLow, alphaHigh);
+
+		// pixels without coverage are not touched
+		__m128i keep = pixel_mask(_mm_cmpeq_epi16(alphaLow, zero),
+			_mm_cmpeq_epi16(alphaHigh, zero));
+
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		__m128i result = blend_pixels8(dest, color, alphaLow, alphaHigh);
+		_mm_storeu_si128((__m128i*)p, select_pixels(keep, dest, result));
+	}
+
+	for (; len > 0; len--, covers++, p += 4) {
+		if (*covers) {
+			if (*covers == 255) {
+				*(uint32*)p = pixel_for(c.r, c.g, c.b);
+			} else {
+				BLEND(p, c.r, c.g, c.b, *covers);
+			}
+		}
+	}
+}
+
+
+// blend_solid_hspan_over_solid_subpix_sse2
+void
+blend_solid_hspan_over_solid_subpix_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	if (pattern->IsSolidLow())
+		return;
+
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	const int subpixelL = gSubpixelOrderingRGB ? 2 : 0;
+	const int subpixelM = 1;
+	const int subpixelR = gSubpixelOrderingRGB ? 0 : 2;
+	__m128i color = color_channels(c.r, c.g, c.b);
+
+	// len counts the subpixels, three per pixel
+	for (; len >= 12; len -= 12, covers += 12, p += 16) {
+		__m128i alphaLow = _mm_set_epi16(0, covers[3 + subpixelR],
+			covers[3 + subpixelM], covers[3 + subpixelL], 0,
+			covers[subpixelR], covers[subpixelM], covers[subpixelL]);
+		__m128i alphaHigh = _mm_set_epi16(0, covers[9 + subpixelR],
+			covers[9 + subpixelM], covers[9 + subpixelL], 0,
+			covers[6 + subpixelR], covers[6 + subpixelM],
+			covers[6 + subpixelL]);
+
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		_mm_storeu_si128((__m128i*)p,
+			blend_pixels8(dest, color, alphaLow, alphaHigh));
+	}
+
+	for (; len > 0; len -= 3, covers += 3, p += 4) {
+		BLEND_SUBPIX(p, c.r, c.g, c.b,
+			covers[subpixelL], covers[subpixelM], covers[subpixelR]);
+	}
+}
+
+
+// #pragma mark - B_OP_ALPHA, constant overlay
+
+
+// blend_hline_alpha_co_solid_sse2
+void
+blend_hline_alpha_co_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, uint8 cover, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	uint16 alpha = pattern->HighColor().alpha * cover;
+	if (alpha == 255 * 255) {
+		__m128i solid = _mm_set1_epi32(pixel_for(c.r, c.g, c.b));
+		for (; len >= 4; len -= 4, p += 16)
+			_mm_storeu_si128((__m128i*)p, solid);
+		for (; len > 0; len--, p += 4)
+			*(uint32*)p = pixel_for(c.r, c.g, c.b);
+		return;
+	}
+
+	if (len < 4) {
+		do {
+			BLEND16(p, c.r, c.g, c.b, alpha);
+			p += 4;
+		} while (--len);
+		return;
+	}
+
+	// like blend_line32(): the premultiplied color is added to the scaled
+	// destination
+	uint8 alpha8 = alpha >> 8;
+	__m128i zero = _mm_setzero_si128();
+	__m128i color = _mm_srli_epi16(_mm_mullo_epi16(
+		color_channels(c.r, c.g, c.b), _mm_set1_epi16(alpha8)), 8);
+	__m128i inverse = _mm_set1_epi16(255 - alpha8);
+	__m128i opaque = _mm_set1_epi32(0xff000000);
+
+	for (; len >= 4; len -= 4, p += 16) {
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		__m128i low = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(
+			_mm_unpacklo_epi8(dest, zero), inverse), 8), color);
+		__m128i high = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(
+			_mm_unpackhi_epi8(dest, zero), inverse), 8), color);
+		_mm_storeu_si128((__m128i*)p,
+			_mm_or_si128(_mm_packus_epi16(low, high), opaque));
+	}
+
+	if (len > 0)
+		blend_line32(p, len, c.r, c.g, c.b, alpha8);
+}
+
+
+// blend_solid_hspan_alpha_co_solid_sse2
+void
+blend_solid_hspan_alpha_co_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	uint8 hAlpha = pattern->HighColor().alpha;
+	__m128i zero = _mm_setzero_si128();
+	__m128i highAlpha = _mm_set1_epi16(hAlpha);
+	__m128i opaque = _mm_set1_epi16(255 * 255);
+	__m128i solid = _mm_set1_epi32(pixel_for(c.r, c.g, c.b));
+	__m128i color = color_channels(c.r, c.g, c.b);
+
+	for (; len >= 4; len -= 4, covers += 4, p += 16) {
+		uint32 covers4 = load32(covers);
+		if (covers4 == 0)
+			continue;
+		if (covers4 == 0xffffffff && hAlpha == 255) {
+			_mm_storeu_si128((__m128i*)p, solid);
+			continue;
+		}
+
+		__m128i alphaLow;
+		__m128i alphaHigh;
+		spread_alphas(_mm_mullo_epi16(load_covers(covers4), highAlpha),
+			alphaLow, alphaHigh);
+
+		__m128i keep = pixel_mask(_mm_cmpeq_epi16(alphaLow, zero),
+			_mm_cmpeq_epi16(alphaHigh, zero));
+		__m128i assign = pixel_mask(_mm_cmpeq_epi16(alphaLow, opaque),
+			_mm_cmpeq_epi16(alphaHigh, opaque));
+
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		__m128i result = blend_pixels16(dest, color, color, alphaLow,
+			alphaHigh);
+		result = select_pixels(assign, solid, result);
+		_mm_storeu_si128((__m128i*)p, select_pixels(keep, dest, result));
+	}
+
+	for (; len > 0; len--, covers++, p += 4) {
+		uint16 alpha = hAlpha * *covers;
+		if (alpha) {
+			if (alpha == 255 * 255) {
+				*(uint32*)p = pixel_for(c.r, c.g, c.b);
+			} else {
+				BLEND16(p, c.r, c.g, c.b, alpha);
+			}
+		}
+	}
+}
+
+
+// blend_solid_hspan_alpha_co_solid_subpix_sse2
+void
+blend_solid_hspan_alpha_co_solid_subpix_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern)
+{
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+	uint8 hAlpha = pattern->HighColor().alpha;
+	const int subpixelL = gSubpixelOrderingRGB ? 2 : 0;
+	const int subpixelM = 1;
+	const int subpixelR = gSubpixelOrderingRGB ? 0 : 2;
+	__m128i highAlpha = _mm_set1_epi16(hAlpha);
+	__m128i color = color_channels(c.r, c.g, c.b);
+
+	// len counts the subpixels, three per pixel
+	for (; len >= 12; len -= 12, covers += 12, p += 16) {
+		__m128i alphaLow = _mm_mullo_epi16(highAlpha, _mm_set_epi16(0,
+			covers[3 + subpixelL], covers[3 + subpixelM],
+			covers[3 + subpixelR], 0, covers[subpixelL], covers[subpixelM],
+			covers[subpixelR]));
+		__m128i alphaHigh = _mm_mullo_epi16(highAlpha, _mm_set_epi16(0,
+			covers[9 + subpixelL], covers[9 + subpixelM],
+			covers[9 + subpixelR], 0, covers[6 + subpixelL],
+			covers[6 + subpixelM], covers[6 + subpixelR]));
+
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		_mm_storeu_si128((__m128i*)p,
+			blend_pixels16(dest, color, color, alphaLow, alphaHigh));
+	}
+
+	for (; len > 0; len -= 3, covers += 3, p += 4) {
+		uint16 alphaRed = hAlpha * covers[subpixelL];
+		uint16 alphaGreen = hAlpha * covers[subpixelM];
+		uint16 alphaBlue = hAlpha * covers[subpixelR];
+		BLEND16_SUBPIX(p, c.r, c.g, c.b,
+			alphaBlue, alphaGreen, alphaRed);
+	}
+}
+
+
+// #pragma mark - B_OP_ALPHA, pixel overlay
+
+
+// blend_color_hspan_alpha_po_sse2
+void
+blend_color_hspan_alpha_po_sse2(int x, int y, unsigned len,
+	const color_type* colors, const uint8* covers, uint8 cover,
+	agg_buffer* buffer, const PatternHandler* pattern)
+{
+	uint8* p = buffer->row_ptr(y) + (x << 2);
+
+	// Without covers, the alpha of the first color is used for the whole
+	// span, just like in blend_color_hspan_alpha_po().
+	uint16 spanAlpha = 0;
+	if (covers == NULL) {
+		spanAlpha = colors->a * cover;
+		if (spanAlpha == 0)
+			return;
+	}
+
+	__m128i zero = _mm_setzero_si128();
+	__m128i opaque = _mm_set1_epi16(255 * 255);
+	__m128i opaquePixels = _mm_set1_epi32(0xff000000);
+
+	for (; len >= 4; len -= 4, colors += 4, p += 16) {
+		// agg::rgba8 is r, g, b, a in memory, we need b, g, r
+		__m128i source = _mm_loadu_si128((const __m128i*)colors);
+		__m128i sourceLow = _mm_unpacklo_epi8(source, zero);
+		__m128i sourceHigh = _mm_unpackhi_epi8(source, zero);
+		__m128i colorLow = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sourceLow,
+			_MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+		__m128i colorHigh = _mm_shufflehi_epi16(_mm_shufflelo_epi16(
+			sourceHigh, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+
+		__m128i alphaLow;
+		__m128i alphaHigh;
+		if (covers != NULL) {
+			spread_alphas(load_covers(load32(covers)), alphaLow, alphaHigh);
+			covers += 4;
+			alphaLow = _mm_mullo_epi16(alphaLow, _mm_shufflehi_epi16(
+				_mm_shufflelo_epi16(sourceLow, _MM_SHUFFLE(3, 3, 3, 3)),
+				_MM_SHUFFLE(3, 3, 3, 3)));
+			alphaHigh = _mm_mullo_epi16(alphaHigh, _mm_shufflehi_epi16(
+				_mm_shufflelo_epi16(sourceHigh, _MM_SHUFFLE(3, 3, 3, 3)),
+				_MM_SHUFFLE(3, 3, 3, 3)));
+		} else {
+			alphaLow = _mm_set1_epi16(spanAlpha);
+			alphaHigh = alphaLow;
+		}
+
+		__m128i keep = pixel_mask(_mm_cmpeq_epi16(alphaLow, zero),
+			_mm_cmpeq_epi16(alphaHigh, zero));
+		__m128i assign = pixel_mask(_mm_cmpeq_epi16(alphaLow, opaque),
+			_mm_cmpeq_epi16(alphaHigh, opaque));
+
+		__m128i dest = _mm_loadu_si128((__m128i*)p);
+		__m128i result = blend_pixels16(dest, colorLow, colorHigh, alphaLow,
+			alphaHigh);
+		__m128i assigned = _mm_or_si128(
+			_mm_packus_epi16(colorLow, colorHigh), opaquePixels);
+		result = select_pixels(assign, assigned, result);
+		_mm_storeu_si128((__m128i*)p, select_pixels(keep, dest, result));
+	}
+
+	for (; len > 0; len--, colors++, p += 4) {
+		uint16 alpha = spanAlpha;
+		if (covers != NULL)
+			alpha = colors->a * *covers++;
+
+		if (alpha) {
+			if (alpha == 255 * 255) {
+				*(uint32*)p = pixel_for(colors->r, colors->g, colors->b);
+			} else {
+				BLEND16(p, colors->r, colors->g, colors->b, alpha);
+			}
+		}
+	}
+}
+
+#ifdef DRAWING_MODE_SSE2_TARGET
+#	pragma GCC pop_options
+#endif
+
+#endif	// DRAWING_MODE_SSE2
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * SIMD versions of the span functions of the most common drawing modes on
+ * B_RGBA32. They produce exactly the same pixels as the C versions.
+ *
+ */
+
+#ifndef DRAWING_MODE_SIMD_H
+#define DRAWING_MODE_SIMD_H
+
+#include "PixelFormat.h"
+
+// Defines for SIMD support.
+#define APPSERVER_SIMD_MMX	(1 << 0)
+#define APPSERVER_SIMD_SSE	(1 << 1)
+#define APPSERVER_SIMD_SSE2	(1 << 2)
+
+// On x86 the SSE2 functions need a compiler that can enable SSE2 for single
+// functions, since the rest of the app_server must run on CPUs without it.
+// On x86_64 SSE2 is always available.
+#if defined(__x86_64__) || (defined(__INTEL__) && (__GNUC__ > 4 \
+		|| (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#	define DRAWING_MODE_SSE2	1
+#endif
+
+#if DRAWING_MODE_SSE2
+
+typedef PixelFormat::color_type		color_type;
+typedef PixelFormat::agg_buffer		agg_buffer;
+
+// B_OP_OVER with a solid pattern
+void blend_hline_over_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, uint8 cover, agg_buffer* buffer,
+	const PatternHandler* pattern);
+void blend_solid_hspan_over_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern);
+void blend_solid_hspan_over_solid_subpix_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern);
+
+// B_OP_ALPHA, B_CONSTANT_ALPHA, B_ALPHA_OVERLAY with a solid pattern
+void blend_hline_alpha_co_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, uint8 cover, agg_buffer* buffer,
+	const PatternHandler* pattern);
+void blend_solid_hspan_alpha_co_solid_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern);
+void blend_solid_hspan_alpha_co_solid_subpix_sse2(int x, int y, unsigned len,
+	const color_type& c, const uint8* covers, agg_buffer* buffer,
+	const PatternHandler* pattern);
+
+// B_OP_ALPHA, B_PIXEL_ALPHA, B_ALPHA_OVERLAY
+void blend_color_hspan_alpha_po_sse2(int x, int y, unsigned len,
+	const color_type* colors, const uint8* covers, uint8 cover,
+	agg_buffer* buffer, const PatternHandler* pattern);
+
+#endif	// DRAWING_MODE_SSE2
+
+#endif // DRAWING_MODE_SIMD_H
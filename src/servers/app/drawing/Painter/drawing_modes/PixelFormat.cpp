@@ -55,6 +55,7 @@
 #include "DrawingModeSelectSUBPIX.h"
 #include "DrawingModeSubtractSUBPIX.h"
 
+#include "DrawingModeSIMD.h"
 #include "PatternHandler.h"
 
 // blend_pixel_empty
@@ -139,6 +140,7 @@ PixelFormat::PixelFormat(agg::rendering_buffer& rb,
 	: fBuffer(&rb),
 	  fPatternHandler(handler),
 	  fUsesOpCopyForText(false),
+	  fSIMDFlags(0),
 
 	  fBlendPixel(blend_pixel_empty),
 	  fBlendHLine(blend_hline_empty),
@@ -342,4 +344,39 @@ fprintf(stderr, "PixelFormat::SetDrawingMode() - drawing_mode not implemented\n"
 //			return fDrawingModeBGRA32Copy;
 			break;
 	}
+
+	if (fSIMDFlags != 0)
+		_UseSIMDFunctions();
+}
+
+// _UseSIMDFunctions
+void
+PixelFormat::_UseSIMDFunctions()
+{
+	// replaces the functions chosen for the drawing mode with their SIMD
+	// versions, where there are any
+#if DRAWING_MODE_SSE2
+	if ((fSIMDFlags & APPSERVER_SIMD_SSE2) == 0)
+		return;
+
+	if (fBlendHLine == blend_hline_over_solid)
+		fBlendHLine = blend_hline_over_solid_sse2;
+	else if (fBlendHLine == blend_hline_alpha_co_solid)
+		fBlendHLine = blend_hline_alpha_co_solid_sse2;
+
+	if (fBlendSolidHSpan == blend_solid_hspan_over_solid)
+		fBlendSolidHSpan = blend_solid_hspan_over_solid_sse2;
+	else if (fBlendSolidHSpan == blend_solid_hspan_alpha_co_solid)
+		fBlendSolidHSpan = blend_solid_hspan_alpha_co_solid_sse2;
+
+	if (fBlendSolidHSpanSubpix == blend_solid_hspan_over_solid_subpix) {
+		fBlendSolidHSpanSubpix = blend_solid_hspan_over_solid_subpix_sse2;
+	} else if (fBlendSolidHSpanSubpix
+			== blend_solid_hspan_alpha_co_solid_subpix) {
+		fBlendSolidHSpanSubpix = blend_solid_hspan_alpha_co_solid_subpix_sse2;
+	}
+
+	if (fBlendColorHSpan == blend_color_hspan_alpha_po)
+		fBlendColorHSpan = blend_color_hspan_alpha_po_sse2;
+#endif
 }
@@ -74,6 +74,11 @@ class PixelFormat {
 	inline	bool				UsesOpCopyForText() const
 									{ return fUsesOpCopyForText; }
 
+			// the SIMD versions of the blending functions are used
+			// for the drawing modes set after this call
+	inline	void				SetSIMDFlags(uint32 flags)
+									{ fSIMDFlags = flags; }
+
 			// AGG "pixel format" interface
 	inline	unsigned			width() const
 									{ return fBuffer->width(); }
@@ -138,9 +143,12 @@ class PixelFormat {
 												  uint8 cover);
 
  private:
+			void				_UseSIMDFunctions();
+
 	agg::rendering_buffer*		fBuffer;
 	const PatternHandler*		fPatternHandler;
 	bool						fUsesOpCopyForText;
+	uint32						fSIMDFlags;
 
 	blend_pixel_f				fBlendPixel;
 	blend_line					fBlendHLine;
@@ -134,6 +134,7 @@ blend_line32(uint8* buffer, int32 pixels, uint8 r, uint8 g, uint8 b, uint8 a)
 		t[0] = ((p.data8[0] * a) >> 8) + b;
 		t[1] = ((p.data8[1] * a) >> 8) + g;
 		t[2] = ((p.data8[2] * a) >> 8) + r;
+		t[3] = 255;
 
 		t += 4;
 		s += 4;
@@ -12,6 +12,7 @@
 
 #include "FontFamily.h"
 #include "FontManager.h"
+#include "GlyphAdvanceCache.h"
 #include "ServerConfig.h"
 #include "ServerFont.h"
 
@@ -405,6 +406,9 @@ FontManager::_RemoveStyle(font_directory& directory, FontStyle* style)
 
 	fStyleHashTable.RemoveItem(*style);
 
+	// the IDs of the style might be reused
+	GlyphAdvanceCache::Default()->Invalidate();
+
 	style->Release();
 }
 
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "GlyphAdvanceCache.h"
+
+#include <string.h>
+
+#include <Autolock.h>
+
+#include "GlyphLayoutEngine.h"
+#include "ServerFont.h"
+
+
+// When more slots are used, the probe sequences get long, and it's time to
+// start over.
+static const int32 kMaxUsedSlots = kGlyphAdvanceSlotCount * 3 / 4;
+
+
+class AdvanceRecorder {
+public:
+	AdvanceRecorder(server_glyph_advances* shared, int32 fontIndex,
+			int32& usedSlots)
+		:
+		fShared(shared),
+		fFontIndex(fontIndex),
+		fUsedSlots(usedSlots)
+	{
+	}
+
+	void Start() {}
+	void Finish(double x, double y) {}
+	void ConsumeEmptyGlyph(int32 index, uint32 charCode, double x, double y)
+	{
+		// the glyph may only have failed to load this time, so there is
+		// nothing to remember
+	}
+
+	bool ConsumeGlyph(int32 index, uint32 charCode, const GlyphCache* glyph,
+		FontCacheEntry* entry, double x, double y)
+	{
+		int32 key = glyph_advance_key(fFontIndex, charCode);
+		int32 slotIndex = glyph_advance_slot_index(key);
+
+		for (int32 i = 0; i < kGlyphAdvanceMaxProbes; i++) {
+			glyph_advance_slot& slot = fShared->slots[slotIndex];
+			if (slot.key == key)
+				return true;
+
+			if (slot.key == 0) {
+				// the key must become visible after the advance
+				slot.advance = glyph->advance_x;
+				atomic_set(&slot.key, key);
+				fUsedSlots++;
+				return true;
+			}
+
+			slotIndex = (slotIndex + 1) & (kGlyphAdvanceSlotCount - 1);
+		}
+
+		// no room for this one
+		return true;
+	}
+
+private:
+	server_glyph_advances*	fShared;
+	int32					fFontIndex;
+	int32&					fUsedSlots;
+};
+
+
+//	#pragma mark -
+
+
+GlyphAdvanceCache
+GlyphAdvanceCache::sDefaultInstance;
+
+
+GlyphAdvanceCache::GlyphAdvanceCache()
+	:
+	fLock("glyph advances"),
+	fArea(-1),
+	fShared(NULL),
+	fUsedSlots(0)
+{
+}
+
+
+GlyphAdvanceCache::~GlyphAdvanceCache()
+{
+	if (fArea >= 0)
+		delete_area(fArea);
+}
+
+
+/*static*/ GlyphAdvanceCache*
+GlyphAdvanceCache::Default()
+{
+	return &sDefaultInstance;
+}
+
+
+/*!	Returns the area the applications need to clone to read the advances.
+*/
+area_id
+GlyphAdvanceCache::Area()
+{
+	BAutolock _(fLock);
+
+	status_t status = _Init();
+	if (status != B_OK)
+		return status;
+
+	return fArea;
+}
+
+
+/*!	Publishes the advances of the glyphs of \a string in \a font. Only the
+	advances of upright, regularly antialiased fonts are published, since
+	BFont::StringWidth() always measures with those.
+*/
+void
+GlyphAdvanceCache::AddGlyphs(const ServerFont& font, const char* string,
+	int32 length)
+{
+	if (string == NULL || length <= 0 || font.Rotation() != 0.0
+		|| font.Shear() != 90.0 || font.FalseBoldWidth() != 0.0
+		|| (font.Flags() & B_DISABLE_ANTIALIASING) != 0) {
+		return;
+	}
+
+	BAutolock _(fLock);
+
+	if (_Init() != B_OK)
+		return;
+
+	if (fUsedSlots > kMaxUsedSlots)
+		_Invalidate();
+
+	int32 fontIndex = _FontIndex(font);
+	if (fontIndex < 0)
+		return;
+
+	// measure the string exactly like ServerFont::StringWidth() does
+	AdvanceRecorder recorder(fShared, fontIndex, fUsedSlots);
+	GlyphLayoutEngine::LayoutGlyphs(recorder, font, string, length, NULL,
+		true, font.Spacing());
+}
+
+
+/*!	Forgets all advances, to be called whenever they might have changed,
+	ie. when fonts are removed, or the font rendering settings change.
+*/
+void
+GlyphAdvanceCache::Invalidate()
+{
+	BAutolock _(fLock);
+
+	if (fShared != NULL)
+		_Invalidate();
+}
+
+
+status_t
+GlyphAdvanceCache::_Init()
+{
+	if (fShared != NULL)
+		return B_OK;
+
+	size_t size = (sizeof(server_glyph_advances) + B_PAGE_SIZE - 1)
+		& ~(B_PAGE_SIZE - 1);
+	fArea = create_area("glyph advances", (void**)&fShared, B_ANY_ADDRESS,
+		size, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (fArea < 0) {
+		fShared = NULL;
+		return fArea;
+	}
+
+	memset(fShared, 0, sizeof(server_glyph_advances));
+	return B_OK;
+}
+
+
+int32
+GlyphAdvanceCache::_FontIndex(const ServerFont& font)
+{
+	uint16 familyID = font.FamilyID();
+	uint16 styleID = font.StyleID();
+	float size = font.Size();
+
+	int32 count = fShared->font_count;
+	for (int32 i = 0; i < count; i++) {
+		const glyph_advance_font& entry = fShared->fonts[i];
+		if (entry.family_id == familyID && entry.style_id == styleID
+			&& entry.size == size) {
+			return i;
+		}
+	}
+
+	if (count == kGlyphAdvanceFontCount) {
+		_Invalidate();
+		count = 0;
+	}
+
+	glyph_advance_font& entry = fShared->fonts[count];
+	entry.family_id = familyID;
+	entry.style_id = styleID;
+	entry.size = size;
+	atomic_set(&fShared->font_count, count + 1);
+
+	return count;
+}
+
+
+void
+GlyphAdvanceCache::_Invalidate()
+{
+	// an odd generation tells the readers to stay away
+	atomic_add(&fShared->generation, 1);
+
+	atomic_set(&fShared->font_count, 0);
+	for (int32 i = 0; i < kGlyphAdvanceSlotCount; i++)
+		fShared->slots[i].key = 0;
+	fUsedSlots = 0;
+
+	atomic_add(&fShared->generation, 1);
+}
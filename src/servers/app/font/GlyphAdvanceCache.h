@@ -0,0 +1,51 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef GLYPH_ADVANCE_CACHE_H
+#define GLYPH_ADVANCE_CACHE_H
+
+
+#include <Locker.h>
+#include <OS.h>
+
+#include <ServerGlyphAdvances.h>
+
+
+class ServerFont;
+
+
+/*!	Publishes the glyph advances of the fonts the applications measure
+	strings with in an area they can read, see ServerGlyphAdvances.h.
+	Shared by all applications, since the advances only depend on the font
+	and the global font rendering settings.
+*/
+class GlyphAdvanceCache {
+public:
+								GlyphAdvanceCache();
+								~GlyphAdvanceCache();
+
+	// global instance
+	static	GlyphAdvanceCache*	Default();
+
+			area_id				Area();
+
+			void				AddGlyphs(const ServerFont& font,
+									const char* string, int32 length);
+			void				Invalidate();
+
+private:
+			status_t			_Init();
+			int32				_FontIndex(const ServerFont& font);
+			void				_Invalidate();
+
+	static	GlyphAdvanceCache	sDefaultInstance;
+
+			BLocker				fLock;
+			area_id				fArea;
+			server_glyph_advances* fShared;
+			int32				fUsedSlots;
+};
+
+
+#endif	// GLYPH_ADVANCE_CACHE_H
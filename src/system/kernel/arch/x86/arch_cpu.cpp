@@ -506,6 +506,94 @@ dump_feature_string(int currentCPU, cpu_ent* cpu)
 #endif	// DUMP_FEATURE_STRING
 
 
+static uint32
+topology_field_width(uint32 count)
+{
+	uint32 width = 0;
+	while ((1U << width) < count)
+		width++;
+	return width;
+}
+
+
+/*!	Splits the initial APIC ID of the current CPU into its SMT, core, and
+	package parts, as described in Intel's "Intel 64 Architecture Processor
+	Topology Enumeration" and AMD's CPUID specification.
+*/
+static void
+detect_cpu_topology(int currentCPU, cpu_ent* cpu)
+{
+	cpuid_info cpuid;
+
+	get_current_cpuid(&cpuid, 0);
+	uint32 maxBasicLeaf = cpuid.eax_0.max_eax;
+
+	get_current_cpuid(&cpuid, 1);
+	uint32 apicID = cpuid.eax_1.apic_id;
+	uint32 logicalCount = 1;
+	if ((cpu->arch.feature[FEATURE_COMMON] & IA32_FEATURE_HTT) != 0
+		&& cpuid.eax_1.logical_cpus > 1) {
+		logicalCount = cpuid.eax_1.logical_cpus;
+	}
+
+	uint32 coreCount = 1;
+	uint32 threadsPerCore = 0;
+	if (cpu->arch.vendor == VENDOR_INTEL && maxBasicLeaf >= 4) {
+		get_current_cpuid(&cpuid, 4);
+		coreCount = (cpuid.regs.eax >> 26) + 1;
+	} else if (cpu->arch.vendor == VENDOR_AMD) {
+		get_current_cpuid(&cpuid, 0x80000000);
+		uint32 maxExtendedLeaf = cpuid.eax_0.max_eax;
+		if (maxExtendedLeaf >= 0x80000008) {
+			// this is the number of threads in the package, not the number
+			// of cores, on CPUs that support SMT
+			get_current_cpuid(&cpuid, 0x80000008);
+			coreCount = (cpuid.regs.ecx & 0xff) + 1;
+			if (coreCount > logicalCount)
+				logicalCount = coreCount;
+		}
+
+		// the topology extensions know how many threads share a core
+		get_current_cpuid(&cpuid, 0x80000001);
+		if (maxExtendedLeaf >= 0x8000001e
+			&& (cpuid.regs.ecx & IA32_FEATURE_AMD_EXT_TOPOEXT) != 0) {
+			get_current_cpuid(&cpuid, 0x8000001e);
+			threadsPerCore = ((cpuid.regs.ebx >> 8) & 0xff) + 1;
+		}
+	}
+
+	if (threadsPerCore == 0 && maxBasicLeaf >= 0xb) {
+		// the first level of leaf 0xb describes the SMT level
+		get_current_cpuid(&cpuid, 0xb);
+		if (((cpuid.regs.ecx >> 8) & 0xff) == 1)
+			threadsPerCore = cpuid.regs.ebx & 0xffff;
+	}
+
+	if (threadsPerCore > 0) {
+		coreCount = logicalCount / threadsPerCore;
+		if (coreCount == 0)
+			coreCount = 1;
+	}
+
+	if (coreCount > logicalCount)
+		logicalCount = coreCount;
+
+	uint32 smtWidth = topology_field_width(logicalCount / coreCount);
+	uint32 coreWidth = topology_field_width(coreCount);
+
+	cpu->topology_id[CPU_TOPOLOGY_SMT] = apicID & ((1U << smtWidth) - 1);
+	cpu->topology_id[CPU_TOPOLOGY_CORE]
+		= (apicID >> smtWidth) & ((1U << coreWidth) - 1);
+	cpu->topology_id[CPU_TOPOLOGY_PACKAGE] = apicID >> (smtWidth + coreWidth);
+
+	dprintf("CPU %d: apic id %" B_PRIu32 ", package %" B_PRId32 ", core %"
+		B_PRId32 ", smt %" B_PRId32 "\n", currentCPU, apicID,
+		cpu->topology_id[CPU_TOPOLOGY_PACKAGE],
+		cpu->topology_id[CPU_TOPOLOGY_CORE],
+		cpu->topology_id[CPU_TOPOLOGY_SMT]);
+}
+
+
 static void
 detect_cpu(int currentCPU)
 {
@@ -616,6 +704,8 @@ detect_cpu(int currentCPU)
 #if DUMP_FEATURE_STRING
 	dump_feature_string(currentCPU, cpu);
 #endif
+
+	detect_cpu_topology(currentCPU, cpu);
 }
 
 
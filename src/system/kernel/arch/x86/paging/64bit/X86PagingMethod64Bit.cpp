@@ -327,10 +327,14 @@ X86PagingMethod64Bit::PageTableForAddress(uint64* virtualPML4,
 		mapCount++;
 	}
 
-	// No proper large page support at the moment, but they are used for the
-	// physical map area. Ensure that nothing tries to treat that as normal
-	// address space.
-	ASSERT(!(*pde & X86_64_PDE_LARGE_PAGE));
+	// Large pages are used for the physical map area and for some user
+	// areas. There is no page table for them; the callers that can encounter
+	// them check the page directory entry first, for everyone else there
+	// isn't anything mapped here.
+	if ((*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+		ASSERT(!allocateTables);
+		return NULL;
+	}
 
 	return (uint64*)pageMapper->GetPageTableAt(*pde & X86_64_PDE_ADDRESS_MASK);
 }
@@ -39,6 +39,7 @@ X86VMTranslationMap64Bit::X86VMTranslationMap64Bit()
 	:
 	fPagingStructures(NULL)
 {
+	fLargePageReservation.count = 0;
 }
 
 
@@ -71,6 +72,11 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
 						continue;
 
+					// All areas should have been unmapped by now, but in any
+					// case a large page is not a page table we could free.
+					if ((virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0)
+						continue;
+
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
 					if (page == NULL) {
@@ -107,6 +113,8 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		fPageMapper->Delete();
 	}
 
+	vm_page_unreserve_pages(&fLargePageReservation);
+
 	fPagingStructures->RemoveReference();
 }
 
@@ -222,6 +230,68 @@ X86VMTranslationMap64Bit::Map(addr_t virtualAddress, phys_addr_t physicalAddress
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	// The kernel address space uses large pages only for the physical map
+	// area, which isn't managed by the VM.
+	return fIsKernelMap ? 0 : k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::MapLarge(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	TRACE("X86VMTranslationMap64Bit::MapLarge(%#" B_PRIxADDR ", %#"
+		B_PRIxPHYSADDR ")\n", virtualAddress, physicalAddress);
+
+	ASSERT(virtualAddress % k64BitPageTableRange == 0);
+	ASSERT(physicalAddress % k64BitPageTableRange == 0);
+
+	if (fIsKernelMap)
+		return B_NOT_SUPPORTED;
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPML4(), virtualAddress, fIsKernelMap,
+		true, reservation, fPageMapper, fMapCount);
+	ASSERT(pde != NULL);
+
+	// If there is a page table already (even if it is empty), the caller has
+	// to map the range page by page.
+	if ((*pde & X86_64_PDE_PRESENT) != 0)
+		return B_BUSY;
+
+	// We keep the page that would have been used for the page table, so that
+	// the large page can always be split later without having to allocate
+	// memory.
+	if (reservation->count == 0)
+		return B_NO_MEMORY;
+
+	uint64 entry = (physicalAddress & X86_64_PDE_ADDRESS_MASK)
+		| X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE
+		| X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(memoryType);
+	if ((attributes & B_USER_PROTECTION) != 0) {
+		entry |= X86_64_PDE_USER;
+		if ((attributes & B_WRITE_AREA) != 0)
+			entry |= X86_64_PDE_WRITABLE;
+	} else if ((attributes & B_KERNEL_WRITE_AREA) != 0)
+		entry |= X86_64_PDE_WRITABLE;
+
+	X86PagingMethod64Bit::SetTableEntry(pde, entry);
+
+	reservation->count--;
+	fLargePageReservation.count++;
+
+	fMapCount += k64BitTableEntryCount;
+
+	return B_OK;
+}
+
+
 status_t
 X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 {
@@ -235,6 +305,19 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		uint64* pde = _LargePageEntryForAddress(start);
+		if (pde != NULL) {
+			addr_t largePageStart = ROUNDDOWN(start, k64BitPageTableRange);
+			if (start == largePageStart
+				&& end - start >= k64BitPageTableRange - 1) {
+				_UnmapLargePage(pde, start);
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, largePageStart);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -402,6 +485,30 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		uint64* pde = _LargePageEntryForAddress(start);
+		if (pde != NULL) {
+			addr_t largePageStart = ROUNDDOWN(start, k64BitPageTableRange);
+			if (start == largePageStart
+				&& end - start >= k64BitPageTableRange - 1) {
+				uint64 oldEntry = _UnmapLargePage(pde, start);
+
+				if (area->cache_type != CACHE_TYPE_DEVICE) {
+					// The flags of the large page apply to all of its pages,
+					// and their physical addresses are consecutive.
+					for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+						_PageUnmapped(area, oldEntry + i * B_PAGE_SIZE,
+							updatePageQueue, queue);
+					}
+				}
+
+				Flush();
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, largePageStart);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -428,54 +535,8 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 				InvalidatePage(start);
 			}
 
-			if (area->cache_type != CACHE_TYPE_DEVICE) {
-				// get the page
-				vm_page* page = vm_lookup_page(
-					(oldEntry & X86_64_PTE_ADDRESS_MASK) / B_PAGE_SIZE);
-				ASSERT(page != NULL);
-
-				DEBUG_PAGE_ACCESS_START(page);
-
-				// transfer the accessed/dirty flags to the page
-				if ((oldEntry & X86_64_PTE_ACCESSED) != 0)
-					page->accessed = true;
-				if ((oldEntry & X86_64_PTE_DIRTY) != 0)
-					page->modified = true;
-
-				// remove the mapping object/decrement the wired_count of the
-				// page
-				if (area->wiring == B_NO_LOCK) {
-					vm_page_mapping* mapping = NULL;
-					vm_page_mappings::Iterator iterator
-						= page->mappings.GetIterator();
-					while ((mapping = iterator.Next()) != NULL) {
-						if (mapping->area == area)
-							break;
-					}
-
-					ASSERT(mapping != NULL);
-
-					area->mappings.Remove(mapping);
-					page->mappings.Remove(mapping);
-					queue.Add(mapping);
-				} else
-					page->DecrementWiredCount();
-
-				if (!page->IsMapped()) {
-					atomic_add(&gMappedPagesCount, -1);
-
-					if (updatePageQueue) {
-						if (page->Cache()->temporary)
-							vm_page_set_state(page, PAGE_STATE_INACTIVE);
-						else if (page->modified)
-							vm_page_set_state(page, PAGE_STATE_MODIFIED);
-						else
-							vm_page_set_state(page, PAGE_STATE_CACHED);
-					}
-				}
-
-				DEBUG_PAGE_ACCESS_END(page);
-			}
+			if (area->cache_type != CACHE_TYPE_DEVICE)
+				_PageUnmapped(area, oldEntry, updatePageQueue, queue);
 		}
 
 		Flush();
@@ -677,6 +738,38 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		uint64* pde = _LargePageEntryForAddress(start);
+		if (pde != NULL) {
+			addr_t largePageStart = ROUNDDOWN(start, k64BitPageTableRange);
+			if (start == largePageStart
+				&& end - start >= k64BitPageTableRange - 1) {
+				// The protection and memory type bits are the same in page
+				// directory and page table entries.
+				uint64 entry = *pde;
+				uint64 oldEntry;
+				while (true) {
+					oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+						(entry & ~(X86_64_PTE_PROTECTION_MASK
+								| X86_64_PTE_MEMORY_TYPE_MASK))
+							| newProtectionFlags
+							| X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(
+								memoryType),
+						entry);
+					if (oldEntry == entry)
+						break;
+					entry = oldEntry;
+				}
+
+				if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+					InvalidatePage(start);
+
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, largePageStart);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPML4(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -837,3 +930,161 @@ X86VMTranslationMap64Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+/*!	Returns the page directory entry for the given address, if it maps a
+	large page, or \c NULL otherwise.
+	The thread must be pinned.
+*/
+uint64*
+X86VMTranslationMap64Bit::_LargePageEntryForAddress(addr_t address)
+{
+	if (fIsKernelMap)
+		return NULL;
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPML4(), address, fIsKernelMap, false, NULL,
+		fPageMapper, fMapCount);
+	if (pde == NULL || (*pde & (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE))
+			!= (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE)) {
+		return NULL;
+	}
+
+	return pde;
+}
+
+
+/*!	Replaces the large page mapped by \a pde with a page table that maps the
+	same physical pages with the same attributes, so that the pages can be
+	unmapped or protected individually.
+	The map must be locked and the thread pinned.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(uint64* pde, addr_t address)
+{
+	TRACE("X86VMTranslationMap64Bit::_SplitLargePage(%#" B_PRIxADDR ")\n",
+		address);
+
+	ASSERT(fLargePageReservation.count > 0);
+
+	vm_page* page = vm_page_allocate_page(&fLargePageReservation,
+		PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+
+	DEBUG_PAGE_ACCESS_END(page);
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	uint64 entry = *pde;
+	while (true) {
+		uint64 flags = entry & (X86_64_PTE_PRESENT | X86_64_PTE_WRITABLE
+			| X86_64_PTE_USER | X86_64_PTE_WRITE_THROUGH
+			| X86_64_PTE_CACHING_DISABLED | X86_64_PTE_ACCESSED
+			| X86_64_PTE_DIRTY | X86_64_PTE_NOT_EXECUTABLE);
+		phys_addr_t physicalAddress = entry & X86_64_PDE_ADDRESS_MASK;
+
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			pageTable[i] = ((physicalAddress + i * B_PAGE_SIZE)
+				& X86_64_PTE_ADDRESS_MASK) | flags;
+		}
+
+		// replace the entry atomically, the CPU might have set the accessed
+		// or dirty flag in the meantime
+		uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(physicalPageTable & X86_64_PDE_ADDRESS_MASK)
+				| X86_64_PDE_PRESENT | X86_64_PDE_WRITABLE | X86_64_PDE_USER,
+			entry);
+		if (oldEntry == entry)
+			break;
+		entry = oldEntry;
+	}
+
+	// the page table
+	fMapCount++;
+
+	InvalidatePage(address);
+}
+
+
+/*!	Removes the large page mapped by \a pde and returns the old entry.
+	The map must be locked and the thread pinned.
+*/
+uint64
+X86VMTranslationMap64Bit::_UnmapLargePage(uint64* pde, addr_t address)
+{
+	TRACE("X86VMTranslationMap64Bit::_UnmapLargePage(%#" B_PRIxADDR ")\n",
+		address);
+
+	uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntry(pde);
+	fMapCount -= k64BitTableEntryCount;
+
+	if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+		InvalidatePage(address);
+
+	// the page we kept for splitting the large page is no longer needed
+	ASSERT(fLargePageReservation.count > 0);
+	fLargePageReservation.count--;
+
+	vm_page_reservation reservation;
+	reservation.count = 1;
+	vm_page_unreserve_pages(&reservation);
+
+	return oldEntry;
+}
+
+
+/*!	Does the bookkeeping for the page mapped by the page table entry
+	\a oldEntry, which has just been removed from \a area.
+	The map must be locked.
+*/
+void
+X86VMTranslationMap64Bit::_PageUnmapped(VMArea* area, uint64 oldEntry,
+	bool updatePageQueue, VMAreaMappings& queue)
+{
+	// get the page
+	vm_page* page = vm_lookup_page(
+		(oldEntry & X86_64_PTE_ADDRESS_MASK) / B_PAGE_SIZE);
+	ASSERT(page != NULL);
+
+	DEBUG_PAGE_ACCESS_START(page);
+
+	// transfer the accessed/dirty flags to the page
+	if ((oldEntry & X86_64_PTE_ACCESSED) != 0)
+		page->accessed = true;
+	if ((oldEntry & X86_64_PTE_DIRTY) != 0)
+		page->modified = true;
+
+	// remove the mapping object/decrement the wired_count of the page
+	if (area->wiring == B_NO_LOCK) {
+		vm_page_mapping* mapping = NULL;
+		vm_page_mappings::Iterator iterator = page->mappings.GetIterator();
+		while ((mapping = iterator.Next()) != NULL) {
+			if (mapping->area == area)
+				break;
+		}
+
+		ASSERT(mapping != NULL);
+
+		area->mappings.Remove(mapping);
+		page->mappings.Remove(mapping);
+		queue.Add(mapping);
+	} else
+		page->DecrementWiredCount();
+
+	if (!page->IsMapped()) {
+		atomic_add(&gMappedPagesCount, -1);
+
+		if (updatePageQueue) {
+			if (page->Cache()->temporary)
+				vm_page_set_state(page, PAGE_STATE_INACTIVE);
+			else if (page->modified)
+				vm_page_set_state(page, PAGE_STATE_MODIFIED);
+			else
+				vm_page_set_state(page, PAGE_STATE_CACHED);
+		}
+	}
+
+	DEBUG_PAGE_ACCESS_END(page);
+}
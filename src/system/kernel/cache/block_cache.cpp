@@ -23,6 +23,7 @@
 #include <util/DoublyLinkedList.h>
 #include <util/AutoLock.h>
 #include <util/khash.h>
+#include <util/OpenHashTable.h>
 #include <vm/vm_page.h>
 
 #include "kernel_debug_config.h"
@@ -104,11 +105,35 @@ struct cached_block {
 	bool CanBeWritten() const;
 	int32 LastAccess() const
 		{ return system_time() / 1000000L - last_accessed; }
+};
+
+struct BlockHashDefinition {
+	typedef off_t			KeyType;
+	typedef	cached_block	ValueType;
+
+	size_t HashKey(off_t key) const
+	{
+		return key;
+	}
 
-	static int Compare(void* _cacheEntry, const void* _block);
-	static uint32 Hash(void* _cacheEntry, const void* _block, uint32 range);
+	size_t Hash(cached_block* block) const
+	{
+		return block->block_number;
+	}
+
+	bool Compare(off_t key, cached_block* block) const
+	{
+		return block->block_number == key;
+	}
+
+	cached_block*& GetLink(cached_block* value) const
+	{
+		return value->next;
+	}
 };
 
+typedef BOpenHashTable<BlockHashDefinition> BlockTable;
+
 typedef DoublyLinkedList<cached_block,
 	DoublyLinkedListMemberGetLink<cached_block,
 		&cached_block::link> > block_list;
@@ -125,7 +150,11 @@ struct cache_notification : DoublyLinkedListLinkImpl<cache_notification> {
 typedef DoublyLinkedList<cache_notification> NotificationList;
 
 struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
-	hash_table*		hash;
+	BlockTable		hash;
+	rw_lock			hash_lock;
+		// Protects the hash against concurrent changes for lookups that are
+		// done without holding the cache lock; changes to the hash must be
+		// done with both locks held.
 	mutex			lock;
 	int				fd;
 	off_t			max_blocks;
@@ -149,6 +178,13 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 	uint32			num_dirty_blocks;
 	bool			read_only;
 
+	// statistics, see get_cached_block_unlocked()
+	vint64			unlocked_gets;
+	vint64			unlocked_puts;
+	vint64			locked_gets;
+	vint64			locked_puts;
+	vint64			lock_contention;
+
 	NotificationList pending_notifications;
 	ConditionVariable condition_variable;
 
@@ -165,7 +201,10 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 	void			FreeBlockParentData(cached_block* block);
 
 	void			RemoveUnusedBlocks(int32 count, int32 minSecondsOld = 0);
+	void			InsertBlock(cached_block* block);
 	void			RemoveBlock(cached_block* block);
+	void			RemoveBlockFromHash(cached_block* block);
+	bool			RemoveFromHashIfUnreferenced(cached_block* block);
 	void			DiscardBlock(cached_block* block);
 
 private:
@@ -1017,33 +1056,6 @@ cached_block::CanBeWritten() const
 }
 
 
-/*static*/ int
-cached_block::Compare(void* _cacheEntry, const void* _block)
-{
-	cached_block* cacheEntry = (cached_block*)_cacheEntry;
-	const off_t* block = (const off_t*)_block;
-
-	off_t diff = cacheEntry->block_number - *block;
-	if (diff > 0)
-		return 1;
-
-	return diff < 0 ? -1 : 0;
-}
-
-
-/*static*/ uint32
-cached_block::Hash(void* _cacheEntry, const void* _block, uint32 range)
-{
-	cached_block* cacheEntry = (cached_block*)_cacheEntry;
-	const off_t* block = (const off_t*)_block;
-
-	if (cacheEntry != NULL)
-		return cacheEntry->block_number % range;
-
-	return (uint64)*block % range;
-}
-
-
 //	#pragma mark - BlockWriter
 
 
@@ -1338,7 +1350,6 @@ BlockWriter::_CompareBlocks(const void* _blockA, const void* _blockB)
 block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 		bool readOnly)
 	:
-	hash(NULL),
 	fd(_fd),
 	max_blocks(numBlocks),
 	block_size(blockSize),
@@ -1352,7 +1363,12 @@ block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 	busy_writing_count(0),
 	busy_writing_waiters(0),
 	num_dirty_blocks(0),
-	read_only(readOnly)
+	read_only(readOnly),
+	unlocked_gets(0),
+	unlocked_puts(0),
+	locked_gets(0),
+	locked_puts(0),
+	lock_contention(0)
 {
 }
 
@@ -1363,10 +1379,10 @@ block_cache::~block_cache()
 	unregister_low_resource_handler(&_LowMemoryHandler, this);
 
 	hash_uninit(transaction_hash);
-	hash_uninit(hash);
 
 	delete_object_cache(buffer_cache);
 
+	rw_lock_destroy(&hash_lock);
 	mutex_destroy(&lock);
 }
 
@@ -1378,16 +1394,14 @@ block_cache::Init()
 	busy_writing_condition.Init(this, "cache block busy writing");
 	condition_variable.Init(this, "cache transaction sync");
 	mutex_init(&lock, "block cache");
+	rw_lock_init(&hash_lock, "block cache hash");
 
 	buffer_cache = create_object_cache_etc("block cache buffers", block_size,
 		8, 0, 0, 0, CACHE_LARGE_SLAB, NULL, NULL, NULL, NULL);
 	if (buffer_cache == NULL)
 		return B_NO_MEMORY;
 
-	cached_block dummyBlock;
-	hash = hash_init(1024, offset_of_member(dummyBlock, next),
-		&cached_block::Compare, &cached_block::Hash);
-	if (hash == NULL)
+	if (hash.Init(1024) != B_OK)
 		return B_NO_MEMORY;
 
 	cache_transaction dummyTransaction;
@@ -1538,7 +1552,13 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 		// remove block from lists
 		iterator.Remove();
 		unused_block_count--;
-		RemoveBlock(block);
+
+		if (!RemoveFromHashIfUnreferenced(block)) {
+			// someone got hold of the block without locking the cache
+			block->unused = false;
+			continue;
+		}
+		FreeBlock(block);
 
 		if (--count <= 0)
 			break;
@@ -1546,14 +1566,50 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 }
 
 
+/*!	Adds the block to the hash. The cache must be locked. */
+void
+block_cache::InsertBlock(cached_block* block)
+{
+	WriteLocker locker(hash_lock);
+	hash.Insert(block);
+}
+
+
 void
 block_cache::RemoveBlock(cached_block* block)
 {
-	hash_remove(hash, block);
+	RemoveBlockFromHash(block);
 	FreeBlock(block);
 }
 
 
+/*!	Removes the block from the hash; once this method returns, no unlocked
+	lookup can find the block anymore. The cache must be locked.
+*/
+void
+block_cache::RemoveBlockFromHash(cached_block* block)
+{
+	WriteLocker locker(hash_lock);
+	hash.Remove(block);
+}
+
+
+/*!	Like RemoveBlockFromHash(), but leaves the block alone if an unlocked
+	lookup has acquired a reference to it in the meantime.
+	Returns whether or not the block has been removed.
+*/
+bool
+block_cache::RemoveFromHashIfUnreferenced(cached_block* block)
+{
+	WriteLocker locker(hash_lock);
+	if (block->ref_count != 0)
+		return false;
+
+	hash.Remove(block);
+	return true;
+}
+
+
 /*!	Discards the block from a transaction (this method must not be called
 	for blocks not part of a transaction).
 */
@@ -1638,10 +1694,14 @@ block_cache::_GetUnusedBlock()
 		// remove block from lists
 		iterator.Remove();
 		unused_block_count--;
-		hash_remove(hash, block);
+		block->unused = false;
+
+		if (!RemoveFromHashIfUnreferenced(block)) {
+			// someone got hold of the block without locking the cache
+			continue;
+		}
 
 		ASSERT(block->original_data == NULL && block->parent_data == NULL);
-		block->unused = false;
 
 		// TODO: see if compare data is handled correctly here!
 #if BLOCK_CACHE_DEBUG_CHANGED
@@ -1765,6 +1825,90 @@ wait_for_busy_writing_blocks(block_cache* cache)
 }
 
 
+/*!	Locks the cache, and keeps track of whether that had to wait for another
+	thread.
+*/
+static inline void
+lock_block_cache(block_cache* cache)
+{
+	if (mutex_trylock(&cache->lock) != B_OK) {
+		atomic_add64(&cache->lock_contention, 1);
+		mutex_lock(&cache->lock);
+	}
+}
+
+
+/*!	Tries to get a reference to the block \a blockNumber without locking the
+	cache. This only works for blocks that are cached already, and that are
+	clean, not busy, and not part of any transaction; everything else has to
+	go through get_cached_block().
+	Since the block's reference count is only changed atomically, and blocks
+	are only ever removed from the hash when unreferenced with the hash write
+	locked, holding the hash read lock is enough to safely grab a reference.
+	Only the locked path moves blocks in and out of the unused list, so the
+	block might stay in there while being referenced; those who remove blocks
+	from the unused list need to check for that.
+
+	Returns \c NULL if the block cannot be retrieved this way.
+*/
+static cached_block*
+get_cached_block_unlocked(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	return NULL;
+#else
+	ReadLocker locker(cache->hash_lock);
+
+	cached_block* block = cache->hash.Lookup(blockNumber);
+	if (block == NULL || block->busy_reading || block->busy_writing
+		|| block->is_dirty || block->is_writing || block->discard
+		|| block->transaction != NULL || block->previous_transaction != NULL) {
+		return NULL;
+	}
+
+	atomic_add(&block->ref_count, 1);
+	block->last_accessed = system_time() / 1000000L;
+
+	atomic_add64(&cache->unlocked_gets, 1);
+	return block;
+#endif
+}
+
+
+/*!	Releases a reference to the block \a blockNumber without locking the
+	cache, if this is possible, that is, if it isn't the last reference.
+	Returns \c true if the reference could be released.
+*/
+static bool
+put_cached_block_unlocked(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	return false;
+#else
+	ReadLocker locker(cache->hash_lock);
+
+	cached_block* block = cache->hash.Lookup(blockNumber);
+	if (block == NULL)
+		return false;
+
+	int32 refCount = block->ref_count;
+	while (refCount > 1) {
+		int32 oldCount = atomic_test_and_set(&block->ref_count, refCount - 1,
+			refCount);
+		if (oldCount == refCount) {
+			TB(Put(cache, block));
+			atomic_add64(&cache->unlocked_puts, 1);
+			return true;
+		}
+
+		refCount = oldCount;
+	}
+
+	return false;
+#endif
+}
+
+
 /*!	Removes a reference from the specified \a block. If this was the last
 	reference, the block is moved into the unused list.
 	In low memory situations, it will also free some blocks from that list,
@@ -1794,16 +1938,24 @@ put_cached_block(block_cache* cache, cached_block* block)
 		return;
 	}
 
-	if (--block->ref_count == 0
+	if (atomic_add(&block->ref_count, -1) == 1
 		&& block->transaction == NULL && block->previous_transaction == NULL) {
 		// This block is not used anymore, and not part of any transaction
 		block->is_writing = false;
 
+		if (block->unused) {
+			// The block has been referenced by get_cached_block_unlocked()
+			// while it was in the unused list already.
+			cache->unused_blocks.Remove(block);
+			cache->unused_block_count--;
+			block->unused = false;
+		}
+
 		if (block->discard) {
-			cache->RemoveBlock(block);
+			if (cache->RemoveFromHashIfUnreferenced(block))
+				cache->FreeBlock(block);
 		} else {
 			// put this block in the list of unused blocks
-			ASSERT(!block->unused);
 			block->unused = true;
 
 			ASSERT(block->original_data == NULL && block->parent_data == NULL);
@@ -1822,7 +1974,7 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 			blockNumber, cache->max_blocks - 1);
 	}
 
-	cached_block* block = (cached_block*)hash_lookup(cache->hash, &blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	if (block != NULL)
 		put_cached_block(cache, block);
 	else {
@@ -1838,9 +1990,10 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 	\param _allocated tells you whether or not a new block has been allocated
 		to satisfy your request.
 	\param readBlock if \c false, the block will not be read in case it was
-		not already in the cache. The block you retrieve may contain random
-		data. If \c true, the cache will be temporarily unlocked while the
-		block is read in.
+		not already in the cache. A newly allocated block then contains
+		random data, and stays marked busy_reading until the caller has
+		initialized it, and calls mark_block_unbusy_reading(). If \c true,
+		the cache will be temporarily unlocked while the block is read in.
 */
 static cached_block*
 get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
@@ -1855,8 +2008,7 @@ get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
 	}
 
 retry:
-	cached_block* block = (cached_block*)hash_lookup(cache->hash,
-		&blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	*_allocated = false;
 
 	if (block == NULL) {
@@ -1865,7 +2017,11 @@ retry:
 		if (block == NULL)
 			return NULL;
 
-		hash_insert_grow(cache->hash, block);
+		// the block must be marked busy before it can be found by an unlocked
+		// lookup, and stay so until it contains valid data
+		mark_block_busy_reading(cache, block);
+
+		cache->InsertBlock(block);
 		*_allocated = true;
 	} else if (block->busy_reading) {
 		// The block is currently busy_reading - wait and try again later
@@ -1884,7 +2040,6 @@ retry:
 		// read block into cache
 		int32 blockSize = cache->block_size;
 
-		mark_block_busy_reading(cache, block);
 		mutex_unlock(&cache->lock);
 
 		ssize_t bytesRead = read_pos(cache->fd, blockNumber * blockSize,
@@ -1904,7 +2059,7 @@ retry:
 		mark_block_unbusy_reading(cache, block);
 	}
 
-	block->ref_count++;
+	atomic_add(&block->ref_count, 1);
 	block->last_accessed = system_time() / 1000000L;
 
 	return block;
@@ -1936,6 +2091,16 @@ get_writable_cached_block(block_cache* cache, off_t blockNumber, off_t base,
 	if (block == NULL)
 		return NULL;
 
+	if (allocated && cleared) {
+		// the new block was not read, and is still busy
+		mutex_unlock(&cache->lock);
+
+		memset(block->current_data, 0, cache->block_size);
+
+		mutex_lock(&cache->lock);
+		mark_block_unbusy_reading(cache, block);
+	}
+
 	if (block->busy_writing)
 		wait_for_busy_writing_block(cache, block);
 
@@ -1943,7 +2108,7 @@ get_writable_cached_block(block_cache* cache, off_t blockNumber, off_t base,
 
 	// if there is no transaction support, we just return the current block
 	if (transactionID == -1) {
-		if (cleared) {
+		if (cleared && !allocated) {
 			mark_block_busy_reading(cache, block);
 			mutex_unlock(&cache->lock);
 
@@ -2046,7 +2211,7 @@ get_writable_cached_block(block_cache* cache, off_t blockNumber, off_t base,
 		&& block->parent_data == NULL && wasUnchanged)
 		transaction->sub_num_blocks++;
 
-	if (cleared) {
+	if (cleared && !allocated) {
 		mark_block_busy_reading(cache, block);
 		mutex_unlock(&cache->lock);
 
@@ -2179,8 +2344,7 @@ dump_cache(int argc, char** argv)
 	off_t blockNumber = -1;
 	if (i + 1 < argc) {
 		blockNumber = parse_expression(argv[i + 1]);
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block != NULL)
 			dump_block_long(block);
 		else
@@ -2241,10 +2405,9 @@ dump_cache(int argc, char** argv)
 	uint32 count = 0;
 	uint32 dirty = 0;
 	uint32 discarded = 0;
-	hash_iterator iterator;
-	hash_open(cache->hash, &iterator);
-	cached_block* block;
-	while ((block = (cached_block*)hash_next(cache->hash, &iterator)) != NULL) {
+	BlockTable::Iterator iterator(&cache->hash);
+	while (iterator.HasNext()) {
+		cached_block* block = iterator.Next();
 		if (showBlocks)
 			dump_block(block);
 
@@ -2261,8 +2424,11 @@ dump_cache(int argc, char** argv)
 		", %" B_PRIu32 " referenced, %" B_PRIu32 " busy, %" B_PRIu32 " in unused.\n",
 		count, dirty, discarded, referenced, cache->busy_reading_count,
 		cache->unused_block_count);
-
-	hash_close(cache->hash, &iterator, false);
+	kprintf(" gets:         %" B_PRId64 " unlocked, %" B_PRId64 " locked\n",
+		cache->unlocked_gets, cache->locked_gets);
+	kprintf(" puts:         %" B_PRId64 " unlocked, %" B_PRId64 " locked\n",
+		cache->unlocked_puts, cache->locked_puts);
+	kprintf(" lock contention: %" B_PRId64 "\n", cache->lock_contention);
 	return 0;
 }
 
@@ -2346,13 +2512,18 @@ static int
 dump_caches(int argc, char** argv)
 {
 	kprintf("Block caches:\n");
+	kprintf("  address      unlocked gets/puts        locked gets/puts  "
+		"contention\n");
 	DoublyLinkedList<block_cache>::Iterator i = sCaches.GetIterator();
 	while (i.HasNext()) {
 		block_cache* cache = i.Next();
 		if (cache == (block_cache*)&sMarkCache)
 			continue;
 
-		kprintf("  %p\n", cache);
+		kprintf("  %p %10" B_PRId64 "/%-10" B_PRId64 " %10" B_PRId64 "/%-10"
+			B_PRId64 " %10" B_PRId64 "\n", cache, cache->unlocked_gets,
+			cache->unlocked_puts, cache->locked_gets, cache->locked_puts,
+			cache->lock_contention);
 	}
 
 	return 0;
@@ -2534,17 +2705,12 @@ block_notifier_and_writer(void* /*data*/)
 			if (cache->num_dirty_blocks) {
 				// This cache is not using transactions, we'll scan the blocks
 				// directly
-				hash_iterator iterator;
-				hash_open(cache->hash, &iterator);
-
-				cached_block* block;
-				while ((block = (cached_block*)hash_next(cache->hash, &iterator))
-						!= NULL) {
+				BlockTable::Iterator iterator(&cache->hash);
+				while (iterator.HasNext()) {
+					cached_block* block = iterator.Next();
 					if (block->CanBeWritten() && !writer.Add(block))
 						break;
 				}
-
-				hash_close(cache->hash, &iterator, false);
 			} else {
 				hash_iterator iterator;
 				hash_open(cache->transaction_hash, &iterator);
@@ -2671,7 +2837,7 @@ block_cache_init(void)
 
 #if DEBUG_BLOCK_CACHE
 	add_debugger_command_etc("block_caches", &dump_caches,
-		"dumps all block caches", "\n", 0);
+		"dumps all block caches and their lock statistics", "\n", 0);
 	add_debugger_command_etc("block_cache", &dump_cache,
 		"dumps a specific block cache",
 		"[-bt] <cache-address> [block-number]\n"
@@ -3326,16 +3492,16 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	uint32 cookie = 0;
-	cached_block* block;
-	while ((block = (cached_block*)hash_remove_first(cache->hash,
-			&cookie)) != NULL) {
+	cached_block* block = cache->hash.Clear(true);
+	while (block != NULL) {
+		cached_block* next = block->next;
 		cache->FreeBlock(block);
+		block = next;
 	}
 
 	// free all transactions (they will all be aborted)
 
-	cookie = 0;
+	uint32 cookie = 0;
 	cache_transaction* transaction;
 	while ((transaction = (cache_transaction*)hash_remove_first(
 			cache->transaction_hash, &cookie)) != NULL) {
@@ -3377,17 +3543,14 @@ block_cache_sync(void* _cache)
 	MutexLocker locker(&cache->lock);
 
 	BlockWriter writer(cache);
-	hash_iterator iterator;
-	hash_open(cache->hash, &iterator);
+	BlockTable::Iterator iterator(&cache->hash);
 
-	cached_block* block;
-	while ((block = (cached_block*)hash_next(cache->hash, &iterator)) != NULL) {
+	while (iterator.HasNext()) {
+		cached_block* block = iterator.Next();
 		if (block->CanBeWritten())
 			writer.Add(block);
 	}
 
-	hash_close(cache->hash, &iterator, false);
-
 	status_t status = writer.Write();
 
 	locker.Unlock();
@@ -3417,8 +3580,7 @@ block_cache_sync_etc(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3452,8 +3614,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block != NULL && block->previous_transaction != NULL)
 			writer.Add(block);
 	}
@@ -3465,8 +3626,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		// reset blockNumber to its original value
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = (cached_block*)hash_lookup(cache->hash,
-			&blockNumber);
+		cached_block* block = cache->hash.Lookup(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3475,17 +3635,25 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		if (block->unused) {
 			cache->unused_blocks.Remove(block);
 			cache->unused_block_count--;
-			cache->RemoveBlock(block);
-		} else {
-			if (block->transaction != NULL && block->parent_data != NULL
-				&& block->parent_data != block->current_data) {
-				panic("Discarded block %" B_PRIdOFF " has already been changed in this "
-					"transaction!", blockNumber);
+			block->unused = false;
+
+			if (cache->RemoveFromHashIfUnreferenced(block)) {
+				cache->FreeBlock(block);
+				continue;
 			}
 
-			// mark it as discarded (in the current transaction only, if any)
-			block->discard = true;
+			// the block has been referenced without locking the cache in the
+			// meantime, it will be removed once it is put
 		}
+
+		if (block->transaction != NULL && block->parent_data != NULL
+			&& block->parent_data != block->current_data) {
+			panic("Discarded block %" B_PRIdOFF " has already been changed in this "
+				"transaction!", blockNumber);
+		}
+
+		// mark it as discarded (in the current transaction only, if any)
+		block->discard = true;
 	}
 }
 
@@ -3558,9 +3726,21 @@ const void*
 block_cache_get_etc(void* _cache, off_t blockNumber, off_t base, off_t length)
 {
 	block_cache* cache = (block_cache*)_cache;
-	MutexLocker locker(&cache->lock);
+
+	if (blockNumber >= 0 && blockNumber < cache->max_blocks) {
+		cached_block* block = get_cached_block_unlocked(cache, blockNumber);
+		if (block != NULL) {
+			TB(Get(cache, block));
+			return block->current_data;
+		}
+	}
+
+	lock_block_cache(cache);
+	MutexLocker locker(&cache->lock, true);
 	bool allocated;
 
+	atomic_add64(&cache->locked_gets, 1);
+
 	cached_block* block = get_cached_block(cache, blockNumber, &allocated);
 	if (block == NULL)
 		return NULL;
@@ -3598,8 +3778,7 @@ block_cache_set_dirty(void* _cache, off_t blockNumber, bool dirty,
 	block_cache* cache = (block_cache*)_cache;
 	MutexLocker locker(&cache->lock);
 
-	cached_block* block = (cached_block*)hash_lookup(cache->hash,
-		&blockNumber);
+	cached_block* block = cache->hash.Lookup(blockNumber);
 	if (block == NULL)
 		return B_BAD_VALUE;
 	if (block->is_dirty == dirty) {
@@ -3619,8 +3798,13 @@ void
 block_cache_put(void* _cache, off_t blockNumber)
 {
 	block_cache* cache = (block_cache*)_cache;
-	MutexLocker locker(&cache->lock);
+	if (put_cached_block_unlocked(cache, blockNumber))
+		return;
+
+	lock_block_cache(cache);
+	MutexLocker locker(&cache->lock, true);
 
+	atomic_add64(&cache->locked_puts, 1);
 	put_cached_block(cache, blockNumber);
 }
 
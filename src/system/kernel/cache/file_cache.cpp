@@ -42,6 +42,10 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// read-ahead window limits
+#define MIN_READ_AHEAD		(16 * B_PAGE_SIZE)
+#define MAX_READ_AHEAD		(512 * B_PAGE_SIZE)
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -52,6 +56,16 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	off_t			read_ahead_next;
+		// where the next read is expected to start, if the file is read
+		// sequentially
+	off_t			read_ahead_end;
+		// the end of the range that has been read (ahead) already
+	size_t			read_ahead_window;
+		// the current read-ahead size, 0 when not reading ahead
+	off_t			last_accessed_page;
+		// offset of the page the last access via the cache hit
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -106,6 +120,7 @@ static void add_to_iovec(generic_io_vec* vecs, uint32 &index, uint32 max,
 
 
 static struct cache_module_info* sCacheModule;
+static file_cache_stats sStats;
 
 
 static const uint32 kZeroVecCount = 32;
@@ -212,6 +227,7 @@ PrecacheIO::IOFinished(status_t status, bool partialTransfer,
 
 		DEBUG_PAGE_ACCESS_TRANSFER(fPages[i], fAllocatingThread);
 
+		vm_page_refault(fPages[i]);
 		fCache->MarkPageUnbusy(fPages[i]);
 
 		DEBUG_PAGE_ACCESS_END(fPages[i]);
@@ -447,6 +463,7 @@ read_into_cache(file_cache_ref* ref, void* cookie, off_t offset,
 
 	// make the pages accessible in the cache
 	for (int32 i = pageIndex; i-- > 0;) {
+		vm_page_refault(pages[i]);
 		DEBUG_PAGE_ACCESS_END(pages[i]);
 
 		cache->MarkPageUnbusy(pages[i]);
@@ -836,12 +853,12 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 				cache->MarkPageUnbusy(page);
 			}
 
-			// If it is cached only, requeue the page, so the respective queue
-			// roughly remains LRU first sorted.
-			if (page->State() == PAGE_STATE_CACHED
-					|| page->State() == PAGE_STATE_MODIFIED) {
+			// Let the page replacement know about the access, but count a
+			// series of small accesses to the same page only once.
+			if (offset != ref->last_accessed_page) {
+				ref->last_accessed_page = offset;
 				DEBUG_PAGE_ACCESS_START(page);
-				vm_page_requeue(page, true);
+				vm_page_mark_accessed(page);
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 
@@ -885,6 +902,166 @@ cache_io(void* _cacheRef, void* cookie, off_t offset, addr_t buffer,
 }
 
 
+/*!	Reads the pages of the given range that are not yet in the cache
+	asynchronously. \a offset and \a size must be page aligned, and the
+	reservation must cover all of the pages.
+	The cache must be locked; it is temporarily unlocked to start the I/O.
+	Returns the number of pages that are being read.
+*/
+static size_t
+prefetch_pages(file_cache_ref* ref, off_t offset, size_t size,
+	vm_page_reservation* reservation)
+{
+	VMCache* cache = ref->cache;
+	size_t bytesToRead = 0;
+	size_t pagesRead = 0;
+	off_t lastOffset = offset;
+
+	while (true) {
+		// check if this page is already in memory
+		if (size > 0) {
+			vm_page* page = cache->LookupPage(offset);
+
+			offset += B_PAGE_SIZE;
+			size -= B_PAGE_SIZE;
+
+			if (page == NULL) {
+				bytesToRead += B_PAGE_SIZE;
+				continue;
+			}
+		}
+		if (bytesToRead != 0) {
+			// read the part before the current page (or the end of the request)
+			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
+				bytesToRead);
+			if (io == NULL || io->Prepare(reservation) != B_OK) {
+				delete io;
+				break;
+			}
+
+			// we must not have the cache locked during I/O
+			cache->Unlock();
+			io->ReadAsync();
+			cache->Lock();
+
+			pagesRead += bytesToRead / B_PAGE_SIZE;
+			bytesToRead = 0;
+		}
+
+		if (size == 0) {
+			// we have reached the end of the request
+			break;
+		}
+
+		lastOffset = offset;
+	}
+
+	return pagesRead;
+}
+
+
+/*!	Follows the read pattern of the file, and starts reading ahead
+	asynchronously when it is read sequentially. The read-ahead window grows
+	with every sequential read up to MAX_READ_AHEAD, and is shrunk again on
+	random access.
+	When less than half of the window is left ahead of the current read,
+	another window is read in the background, so that a sequential reader
+	should never have to wait for the disk.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	VMCache* cache = ref->cache;
+	AutoLocker<VMCache> locker(cache);
+
+	off_t fileSize = cache->virtual_end;
+	off_t end = min_c(offset + (off_t)size, fileSize);
+	if (offset >= end)
+		return;
+
+	int64 pages = (ROUNDUP(end, B_PAGE_SIZE) - ROUNDDOWN(offset, B_PAGE_SIZE))
+		/ B_PAGE_SIZE;
+
+	if (offset < ROUNDDOWN(ref->read_ahead_next, B_PAGE_SIZE)
+		|| offset > ref->read_ahead_next) {
+		// random access - everything we read ahead beyond the expected
+		// offset has been in vain
+		if (ref->read_ahead_end > ref->read_ahead_next) {
+			atomic_add64(&sStats.read_ahead_wasted,
+				(ref->read_ahead_end - ROUNDUP(ref->read_ahead_next,
+					B_PAGE_SIZE)) / B_PAGE_SIZE);
+		}
+
+		ref->read_ahead_window /= 2;
+		if (ref->read_ahead_window < MIN_READ_AHEAD)
+			ref->read_ahead_window = 0;
+
+		// nothing has been read ahead of this one
+		ref->read_ahead_next = end;
+		ref->read_ahead_end = 0;
+		return;
+	}
+
+	// sequential access
+
+	int64 covered = 0;
+	if (ref->read_ahead_end > offset) {
+		covered = (ROUNDUP(min_c(ref->read_ahead_end, end), B_PAGE_SIZE)
+			- ROUNDDOWN(offset, B_PAGE_SIZE)) / B_PAGE_SIZE;
+	}
+	if (ref->read_ahead_window > 0) {
+		atomic_add64(&sStats.read_ahead_hits, covered);
+		atomic_add64(&sStats.read_ahead_misses, pages - covered);
+	} else
+		atomic_add64(&sStats.read_ahead_streams, 1);
+
+	if (ref->read_ahead_window == 0)
+		ref->read_ahead_window = MIN_READ_AHEAD;
+	else if (ref->read_ahead_window < MAX_READ_AHEAD)
+		ref->read_ahead_window *= 2;
+
+	ref->read_ahead_next = end;
+
+	// the read-ahead end only moves when pages are actually requested
+	off_t aheadEnd = max_c(ref->read_ahead_end, end);
+	if (aheadEnd - end >= (off_t)ref->read_ahead_window / 2
+		|| aheadEnd >= fileSize) {
+		// there is still enough left that has been read ahead
+		return;
+	}
+
+	off_t readAheadOffset = ROUNDUP(aheadEnd, B_PAGE_SIZE);
+	off_t readAheadEnd = ROUNDUP(min_c(end + (off_t)ref->read_ahead_window,
+		fileSize), B_PAGE_SIZE);
+	if (readAheadOffset >= readAheadEnd)
+		return;
+
+	size_t readAheadSize = readAheadEnd - readAheadOffset;
+	uint32 reservePages = readAheadSize / B_PAGE_SIZE;
+
+	// reading ahead is optional - don't do it if memory is getting low
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE
+		|| vm_page_num_unused_pages() < 2 * reservePages) {
+		return;
+	}
+
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, reservePages,
+			VM_PRIORITY_USER)) {
+		return;
+	}
+
+	ref->read_ahead_end = readAheadEnd;
+
+	size_t pagesRead = prefetch_pages(ref, readAheadOffset, readAheadSize,
+		&reservation);
+	atomic_add64(&sStats.read_ahead_pages, pagesRead);
+
+	locker.Unlock();
+	vm_page_unreserve_pages(&reservation);
+}
+
+
 static status_t
 file_cache_control(const char* subsystem, uint32 function, void* buffer,
 	size_t bufferSize)
@@ -929,6 +1106,16 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_GET_STATS:
+		{
+			if (buffer == NULL || bufferSize != sizeof(file_cache_stats)
+				|| !IS_USER_ADDRESS(buffer)) {
+				return B_BAD_VALUE;
+			}
+
+			return user_memcpy(buffer, &sStats, sizeof(file_cache_stats));
+		}
 	}
 
 	return B_BAD_HANDLER;
@@ -968,51 +1155,12 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 		return;
 	}
 
-	size_t bytesToRead = 0;
-	off_t lastOffset = offset;
-
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, reservePages, VM_PRIORITY_USER);
 
 	cache->Lock();
 
-	while (true) {
-		// check if this page is already in memory
-		if (size > 0) {
-			vm_page* page = cache->LookupPage(offset);
-
-			offset += B_PAGE_SIZE;
-			size -= B_PAGE_SIZE;
-
-			if (page == NULL) {
-				bytesToRead += B_PAGE_SIZE;
-				continue;
-			}
-		}
-		if (bytesToRead != 0) {
-			// read the part before the current page (or the end of the request)
-			PrecacheIO* io = new(std::nothrow) PrecacheIO(ref, lastOffset,
-				bytesToRead);
-			if (io == NULL || io->Prepare(&reservation) != B_OK) {
-				delete io;
-				break;
-			}
-
-			// we must not have the cache locked during I/O
-			cache->Unlock();
-			io->ReadAsync();
-			cache->Lock();
-
-			bytesToRead = 0;
-		}
-
-		if (size == 0) {
-			// we have reached the end of the request
-			break;
-		}
-
-		lastOffset = offset;
-	}
+	prefetch_pages(ref, offset, size, &reservation);
 
 	cache->ReleaseRefAndUnlock();
 	vm_page_unreserve_pages(&reservation);
@@ -1132,6 +1280,10 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	ref->read_ahead_next = 0;
+	ref->read_ahead_end = 0;
+	ref->read_ahead_window = 0;
+	ref->last_accessed_page = -1;
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1172,6 +1324,12 @@ file_cache_delete(void* _cacheRef)
 
 	TRACE(("file_cache_delete(ref = %p)\n", ref));
 
+	if (ref->read_ahead_end > ref->read_ahead_next) {
+		atomic_add64(&sStats.read_ahead_wasted,
+			(ref->read_ahead_end - ROUNDUP(ref->read_ahead_next, B_PAGE_SIZE))
+				/ B_PAGE_SIZE);
+	}
+
 	ref->cache->ReleaseRef();
 	delete ref;
 }
@@ -1298,7 +1456,14 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
-	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
+	status_t status = cache_io(ref, cookie, offset, (addr_t)buffer, _size,
+		false);
+
+	// only now, so that the read-ahead doesn't delay the read itself
+	if (status == B_OK)
+		read_ahead(ref, offset, *_size);
+
+	return status;
 }
 
 
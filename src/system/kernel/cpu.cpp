@@ -61,6 +61,12 @@ cpu_preboot_init_percpu(kernel_args *args, int curr_cpu)
 	memset(&gCPU[curr_cpu], 0, sizeof(gCPU[curr_cpu]));
 	gCPU[curr_cpu].cpu_num = curr_cpu;
 
+	// Unless the architecture specific code knows better, every CPU is a
+	// core of its own in a single package.
+	gCPU[curr_cpu].topology_id[CPU_TOPOLOGY_SMT] = 0;
+	gCPU[curr_cpu].topology_id[CPU_TOPOLOGY_CORE] = curr_cpu;
+	gCPU[curr_cpu].topology_id[CPU_TOPOLOGY_PACKAGE] = 0;
+
 	return arch_cpu_preboot_init_percpu(args, curr_cpu);
 }
 
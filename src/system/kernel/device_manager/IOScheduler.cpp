@@ -72,3 +72,24 @@ void
 IOScheduler::MediaChanged()
 {
 }
+
+
+uint32
+IOScheduler::Mode() const
+{
+	return IO_SCHEDULER_MODE_NONE;
+}
+
+
+status_t
+IOScheduler::SetMode(uint32 mode)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+void
+IOScheduler::GetStatistics(io_scheduler_stats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+}
@@ -8,6 +8,7 @@
 
 #include <KernelExport.h>
 
+#include <io_scheduler_defs.h>
 #include <util/DoublyLinkedList.h>
 
 #include "IOCallback.h"
@@ -48,6 +49,10 @@ public:
 	virtual	void				SetDeviceCapacity(off_t deviceCapacity);
 	virtual void				MediaChanged();
 
+	virtual	uint32				Mode() const;
+	virtual	status_t			SetMode(uint32 mode);
+	virtual	void				GetStatistics(io_scheduler_stats& stats);
+
 	virtual	status_t			ScheduleRequest(IORequest* request) = 0;
 
 	virtual	void				AbortRequest(IORequest* request,
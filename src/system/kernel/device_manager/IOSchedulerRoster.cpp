@@ -6,16 +6,104 @@
 
 #include "IOSchedulerRoster.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <driver_settings.h>
+#include <generic_syscall.h>
+#include <kernel.h>
 #include <util/AutoLock.h>
 
 
 /*static*/ IOSchedulerRoster IOSchedulerRoster::sDefaultInstance;
 
 
+static uint32
+mode_for_name(const char* name)
+{
+	if (strcmp(name, "round_robin") == 0)
+		return IO_SCHEDULER_MODE_ROUND_ROBIN;
+	if (strcmp(name, "fair") == 0)
+		return IO_SCHEDULER_MODE_FAIR;
+	if (strcmp(name, "deadline") == 0)
+		return IO_SCHEDULER_MODE_DEADLINE;
+
+	return IO_SCHEDULER_MODE_NONE;
+}
+
+
+static status_t
+io_scheduler_control(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case IO_SCHEDULER_GET_NEXT_INFO:
+		{
+			io_scheduler_info info;
+			if (!IS_USER_ADDRESS(buffer))
+				return B_BAD_ADDRESS;
+			if (bufferSize != sizeof(io_scheduler_info))
+				return B_BAD_VALUE;
+			if (user_memcpy(&info, buffer, sizeof(info)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			status_t status = IOSchedulerRoster::Default()->GetNextInfo(
+				info.id, info);
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, &info, sizeof(info));
+		}
+
+		case IO_SCHEDULER_SET_MODE:
+		{
+			io_scheduler_mode_control control;
+			if (!IS_USER_ADDRESS(buffer))
+				return B_BAD_ADDRESS;
+			if (bufferSize != sizeof(io_scheduler_mode_control))
+				return B_BAD_VALUE;
+			if (user_memcpy(&control, buffer, sizeof(control)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			return IOSchedulerRoster::Default()->SetMode(control.id,
+				control.mode);
+		}
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+// #pragma mark -
+
+
 /*static*/ void
 IOSchedulerRoster::Init()
 {
 	new(&sDefaultInstance) IOSchedulerRoster;
+
+	// the scheduling mode can be chosen in the kernel settings
+	void* handle = load_driver_settings("kernel");
+	if (handle != NULL) {
+		const char* name = get_driver_parameter(handle, "io_scheduler", NULL,
+			NULL);
+		if (name != NULL) {
+			uint32 mode = mode_for_name(name);
+			if (mode != IO_SCHEDULER_MODE_NONE)
+				sDefaultInstance.fDefaultMode = mode;
+			else
+				dprintf("unknown I/O scheduler mode \"%s\"\n", name);
+		}
+
+		unload_driver_settings(handle);
+	}
+
+	register_generic_syscall(IO_SCHEDULER_SYSCALLS, io_scheduler_control, 1,
+		0);
 }
 
 
@@ -41,6 +129,61 @@ IOSchedulerRoster::RemoveScheduler(IOScheduler* scheduler)
 }
 
 
+status_t
+IOSchedulerRoster::SetMode(int32 id, uint32 mode)
+{
+	if (mode != IO_SCHEDULER_MODE_ROUND_ROBIN && mode != IO_SCHEDULER_MODE_FAIR
+		&& mode != IO_SCHEDULER_MODE_DEADLINE)
+		return B_BAD_VALUE;
+
+	AutoLocker<IOSchedulerRoster> locker(this);
+
+	if (id < 0)
+		fDefaultMode = mode;
+
+	for (IOSchedulerList::Iterator it = fSchedulers.GetIterator();
+			IOScheduler* scheduler = it.Next();) {
+		if (id < 0) {
+			scheduler->SetMode(mode);
+				// schedulers that do not support modes are ignored
+		} else if (scheduler->ID() == id)
+			return scheduler->SetMode(mode);
+	}
+
+	return id < 0 ? B_OK : B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Fills in the \a info of the scheduler with the smallest ID greater than
+	\a previousID.
+*/
+status_t
+IOSchedulerRoster::GetNextInfo(int32 previousID, io_scheduler_info& info)
+{
+	AutoLocker<IOSchedulerRoster> locker(this);
+
+	IOScheduler* next = NULL;
+	for (IOSchedulerList::Iterator it = fSchedulers.GetIterator();
+			IOScheduler* scheduler = it.Next();) {
+		if (scheduler->ID() > previousID
+			&& (next == NULL || scheduler->ID() < next->ID()))
+			next = scheduler;
+	}
+
+	if (next == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	memset(&info, 0, sizeof(info));
+	info.id = next->ID();
+	info.mode = next->Mode();
+	strlcpy(info.name, next->Name() != NULL ? next->Name() : "",
+		sizeof(info.name));
+	next->GetStatistics(info.stats);
+
+	return B_OK;
+}
+
+
 void
 IOSchedulerRoster::Notify(uint32 eventCode, const IOScheduler* scheduler,
 	IORequest* request, IOOperation* operation)
@@ -75,6 +218,7 @@ IOSchedulerRoster::NextID()
 IOSchedulerRoster::IOSchedulerRoster()
 	:
 	fNextID(1),
+	fDefaultMode(IO_SCHEDULER_MODE_ROUND_ROBIN),
 	fNotificationService("I/O")
 {
 	mutex_init(&fLock, "IOSchedulerRoster");
@@ -41,6 +41,15 @@ public:
 			void				AddScheduler(IOScheduler* scheduler);
 			void				RemoveScheduler(IOScheduler* scheduler);
 
+			uint32				DefaultMode() const
+									{ return fDefaultMode; }
+			status_t			SetMode(int32 id, uint32 mode);
+									// an ID of -1 changes the default mode,
+									// and the one of all schedulers
+
+			status_t			GetNextInfo(int32 previousID,
+									io_scheduler_info& info);
+
 			void				Notify(uint32 eventCode,
 									const IOScheduler* scheduler,
 									IORequest* request = NULL,
@@ -55,6 +64,7 @@ private:
 private:
 			mutex				fLock;
 			int32				fNextID;
+			uint32				fDefaultMode;
 			IOSchedulerList		fSchedulers;
 			DefaultNotificationService fNotificationService;
 			char				fEventBuffer[256];
@@ -31,6 +31,12 @@
 #endif
 
 
+// In deadline mode, requests that have been waiting for longer than this are
+// served before all others.
+static const bigtime_t kReadExpiryTime = 500000;
+static const bigtime_t kWriteExpiryTime = 5000000;
+
+
 // #pragma mark -
 
 
@@ -95,8 +101,12 @@ IOSchedulerSimple::IOSchedulerSimple(DMAResource* resource)
 	fRequestOwners(NULL),
 	fBlockSize(0),
 	fPendingOperations(0),
+	fMode(IOSchedulerRoster::Default()->DefaultMode()),
+	fServedExpiredOwner(false),
 	fTerminating(false)
 {
+	memset(&fStats, 0, sizeof(fStats));
+
 	mutex_init(&fLock, "I/O scheduler");
 	B_INITIALIZE_SPINLOCK(&fFinisherLock);
 
@@ -109,6 +119,12 @@ IOSchedulerSimple::IOSchedulerSimple(DMAResource* resource)
 
 IOSchedulerSimple::~IOSchedulerSimple()
 {
+	// make sure nobody asks us for our statistics anymore
+	if (fSchedulerRegistered) {
+		IOSchedulerRoster::Default()->RemoveScheduler(this);
+		fSchedulerRegistered = false;
+	}
+
 	// shutdown threads
 	MutexLocker locker(fLock);
 	InterruptsSpinLocker finisherLocker(fFinisherLock);
@@ -226,6 +242,7 @@ IOSchedulerSimple::ScheduleRequest(IORequest* request)
 	TRACE("%p->IOSchedulerSimple::ScheduleRequest(%p)\n", this, request);
 
 	IOBuffer* buffer = request->Buffer();
+	request->SetScheduledTime(system_time());
 
 	// TODO: it would be nice to be able to lock the memory later, but we can't
 	// easily do it in the I/O scheduler without being able to asynchronously
@@ -257,6 +274,9 @@ IOSchedulerSimple::ScheduleRequest(IORequest* request)
 	request->SetOwner(owner);
 	owner->requests.Add(request);
 
+	if (++fStats.queue_depth > fStats.max_queue_depth)
+		fStats.max_queue_depth = fStats.queue_depth;
+
 	int32 priority = thread_get_io_priority(request->ThreadID());
 	if (priority >= 0)
 		owner->priority = priority;
@@ -305,11 +325,46 @@ IOSchedulerSimple::OperationCompleted(IOOperation* operation, status_t status,
 }
 
 
+uint32
+IOSchedulerSimple::Mode() const
+{
+	return fMode;
+}
+
+
+status_t
+IOSchedulerSimple::SetMode(uint32 mode)
+{
+	if (mode != IO_SCHEDULER_MODE_ROUND_ROBIN && mode != IO_SCHEDULER_MODE_FAIR
+		&& mode != IO_SCHEDULER_MODE_DEADLINE)
+		return B_BAD_VALUE;
+
+	MutexLocker _(fLock);
+	fMode = mode;
+	return B_OK;
+}
+
+
+void
+IOSchedulerSimple::GetStatistics(io_scheduler_stats& stats)
+{
+	MutexLocker _(fLock);
+	stats = fStats;
+}
+
+
 void
 IOSchedulerSimple::Dump() const
 {
 	kprintf("IOSchedulerSimple at %p\n", this);
 	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  mode:           %" B_PRIu32 "\n", fMode);
+	kprintf("  queue depth:    %" B_PRId32 " (max %" B_PRId32 ")\n",
+		fStats.queue_depth, fStats.max_queue_depth);
+	kprintf("  requests:       %" B_PRId64 " read, %" B_PRId64 " write, %"
+		B_PRId64 " expired, %" B_PRId64 " merged\n", fStats.read_requests,
+		fStats.write_requests, fStats.expired_requests,
+		fStats.merged_requests);
 
 	kprintf("  active request owners:");
 	for (RequestOwnerList::ConstIterator it
@@ -383,6 +438,8 @@ IOSchedulerSimple::_Finisher()
 				owner->requests.Remove(request);
 				request->SetOwner(NULL);
 
+				_RequestFinished(request);
+
 				if (!owner->IsActive()) {
 					fActiveRequestOwners.Remove(owner);
 					fUnusedRequestOwners.Add(owner);
@@ -483,10 +540,76 @@ IOSchedulerSimple::_PrepareRequestOperations(IORequest* request,
 
 
 off_t
-IOSchedulerSimple::_ComputeRequestOwnerBandwidth(int32 priority) const
+IOSchedulerSimple::_ComputeRequestOwnerBandwidth(
+	const IORequestOwner* owner) const
 {
+	switch (fMode) {
+		case IO_SCHEDULER_MODE_FAIR:
+		{
+			// Every team gets the maximum bandwidth per round, which is split
+			// among those of its threads that currently have requests.
+			int32 threads = 0;
+			for (RequestOwnerList::ConstIterator it
+						= fActiveRequestOwners.GetIterator();
+					const IORequestOwner* other = it.Next();) {
+				if (other->thread >= 0 && other->team == owner->team)
+					threads++;
+			}
+
+			off_t bandwidth = fMaxOwnerBandwidth / std::max(threads, (int32)1);
+			bandwidth -= bandwidth % fBlockSize;
+			return std::max(bandwidth, (off_t)fBlockSize);
+		}
+
+		case IO_SCHEDULER_MODE_DEADLINE:
+		{
+			// Prefer reads, since usually someone is waiting for them, while
+			// writes are mostly done in the background.
+			IORequest* request = owner->requests.Head();
+			if (request != NULL && request->IsRead())
+				return fMaxOwnerBandwidth;
+			return fMinOwnerBandwidth;
+		}
+
+		default:
 // TODO: Use a priority dependent quantum!
-	return fMinOwnerBandwidth;
+			return fMinOwnerBandwidth;
+	}
+}
+
+
+bigtime_t
+IOSchedulerSimple::_ExpiryTime(const IORequest* request) const
+{
+	return request->IsWrite() ? kWriteExpiryTime : kReadExpiryTime;
+}
+
+
+/*!	Returns the active request owner whose first request has expired the
+	longest time ago, or \c NULL if there is none.
+*/
+IORequestOwner*
+IOSchedulerSimple::_ExpiredRequestOwner() const
+{
+	bigtime_t now = system_time();
+	IORequestOwner* expiredOwner = NULL;
+	bigtime_t expiredTime = 0;
+
+	for (RequestOwnerList::ConstIterator it
+				= fActiveRequestOwners.GetIterator();
+			IORequestOwner* owner = it.Next();) {
+		IORequest* request = owner->requests.Head();
+		if (owner->thread < 0 || request == NULL)
+			continue;
+
+		bigtime_t expiry = request->ScheduledTime() + _ExpiryTime(request);
+		if (expiry <= now && (expiredOwner == NULL || expiry < expiredTime)) {
+			expiredOwner = owner;
+			expiredTime = expiry;
+		}
+	}
+
+	return expiredOwner;
 }
 
 
@@ -498,13 +621,27 @@ IOSchedulerSimple::_NextActiveRequestOwner(IORequestOwner*& owner,
 		if (fTerminating)
 			return false;
 
+		if (fMode == IO_SCHEDULER_MODE_DEADLINE && !fServedExpiredOwner) {
+			// Expired requests are served first, and completely. But the
+			// owner after the expired one gets its turn in between, or an
+			// owner whose requests keep expiring would starve the others.
+			IORequestOwner* expiredOwner = _ExpiredRequestOwner();
+			if (expiredOwner != NULL) {
+				owner = expiredOwner;
+				quantum = fMaxOwnerBandwidth;
+				fServedExpiredOwner = true;
+				return true;
+			}
+		}
+		fServedExpiredOwner = false;
+
 		if (owner != NULL)
 			owner = fActiveRequestOwners.GetNext(owner);
 		if (owner == NULL)
 			owner = fActiveRequestOwners.Head();
 
 		if (owner != NULL) {
-			quantum = _ComputeRequestOwnerBandwidth(owner->priority);
+			quantum = _ComputeRequestOwnerBandwidth(owner);
 			return true;
 		}
 
@@ -533,6 +670,55 @@ IOSchedulerSimple::_NextActiveRequestOwner(IORequestOwner*& owner,
 }
 
 
+/*!	Adds the following requests of the owner of \a previous to this
+	iteration as long as they continue where the one before ended, so that
+	they end up next to each other on the device, even when the owner's
+	quantum is used up. Requests of other owners are left alone, as they
+	would then be served with this owner's bandwidth.
+	Returns \c false when resources ran out, like _PrepareRequestOperations().
+*/
+bool
+IOSchedulerSimple::_MergeAdjacentRequests(IORequest* previous,
+	IOOperationList& operations, int32& operationsPrepared,
+	off_t& iterationBandwidth)
+{
+	IORequestOwner* owner = previous->Owner();
+	off_t endOffset = previous->Offset() + previous->Length();
+	bool isWrite = previous->IsWrite();
+
+	while (iterationBandwidth >= (off_t)fBlockSize) {
+		IORequest* request = owner->requests.Head();
+		if (request == NULL || request->Offset() != endOffset
+			|| request->IsWrite() != isWrite
+			|| request->RemainingBytes() != request->Length()) {
+			return true;
+		}
+
+		off_t bandwidth = 0;
+		bool resourcesAvailable = _PrepareRequestOperations(request,
+			operations, operationsPrepared, iterationBandwidth, bandwidth);
+		iterationBandwidth -= bandwidth;
+		if (bandwidth > 0)
+			fStats.merged_requests++;
+
+		if (request->RemainingBytes() > 0 && request->Status() > 0) {
+			// the rest will be done when it's the owner's turn
+			return resourcesAvailable;
+		}
+
+		owner->requests.Remove(request);
+		owner->completed_requests.Add(request);
+
+		if (!resourcesAvailable)
+			return false;
+
+		endOffset = request->Offset() + request->Length();
+	}
+
+	return true;
+}
+
+
 struct OperationComparator {
 	inline bool operator()(const IOOperation* a, const IOOperation* b)
 	{
@@ -591,6 +777,7 @@ status_t
 IOSchedulerSimple::_Scheduler()
 {
 	IORequestOwner marker;
+	marker.team = -1;
 	marker.thread = -1;
 	{
 		MutexLocker locker(fLock);
@@ -668,6 +855,12 @@ panic("no more requests for owner %p (thread %" B_PRId32 ")", owner, owner->thre
 					// completed list, so we don't pick it up again.
 					owner->requests.Remove(request);
 					owner->completed_requests.Add(request);
+
+					if (fMode == IO_SCHEDULER_MODE_DEADLINE
+						&& resourcesAvailable && request->Status() > 0) {
+						resourcesAvailable = _MergeAdjacentRequests(request,
+							operations, operationCount, iterationBandwidth);
+					}
 				}
 			}
 
@@ -826,3 +1019,34 @@ IOSchedulerSimple::_GetRequestOwner(team_id team, thread_id thread,
 	fUnusedRequestOwners.MoveFrom(&existingOwners);
 	return owner;
 }
+
+
+/*!	Updates the statistics for the finished \a request.
+	Must be called with \c fLock held.
+*/
+void
+IOSchedulerSimple::_RequestFinished(IORequest* request)
+{
+	bigtime_t latency = system_time() - request->ScheduledTime();
+
+	int32 bucket = 0;
+	while (bucket < IO_SCHEDULER_LATENCY_BUCKETS - 1
+		&& latency >= (64LL << bucket)) {
+		bucket++;
+	}
+
+	if (request->IsWrite()) {
+		fStats.write_requests++;
+		fStats.write_bytes += request->TransferredBytes();
+		fStats.write_latency[bucket]++;
+	} else {
+		fStats.read_requests++;
+		fStats.read_bytes += request->TransferredBytes();
+		fStats.read_latency[bucket]++;
+	}
+
+	if (latency > _ExpiryTime(request))
+		fStats.expired_requests++;
+
+	fStats.queue_depth--;
+}
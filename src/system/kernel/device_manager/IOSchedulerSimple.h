@@ -35,6 +35,10 @@ public:
 									// has been completed successfully or failed
 									// for some reason
 
+	virtual	uint32				Mode() const;
+	virtual	status_t			SetMode(uint32 mode);
+	virtual	void				GetStatistics(io_scheduler_stats& stats);
+
 	virtual	void				Dump() const;
 
 private:
@@ -46,7 +50,9 @@ private:
 			void				_Finisher();
 			bool				_FinisherWorkPending();
 			off_t				_ComputeRequestOwnerBandwidth(
-									int32 priority) const;
+									const IORequestOwner* owner) const;
+			bigtime_t			_ExpiryTime(const IORequest* request) const;
+			IORequestOwner*		_ExpiredRequestOwner() const;
 			bool				_NextActiveRequestOwner(IORequestOwner*& owner,
 									off_t& quantum);
 			bool				_PrepareRequestOperations(IORequest* request,
@@ -56,6 +62,10 @@ private:
 									IOOperationList& operations,
 									int32& operationsPrepared, off_t quantum,
 									off_t& usedBandwidth);
+			bool				_MergeAdjacentRequests(IORequest* previous,
+									IOOperationList& operations,
+									int32& operationsPrepared,
+									off_t& iterationBandwidth);
 			void				_SortOperations(IOOperationList& operations,
 									off_t& lastOffset);
 			status_t			_Scheduler();
@@ -66,6 +76,7 @@ private:
 			void				_AddRequestOwner(IORequestOwner* owner);
 			IORequestOwner*		_GetRequestOwner(team_id team, thread_id thread,
 									bool allocate);
+			void				_RequestFinished(IORequest* request);
 
 private:
 			spinlock			fFinisherLock;
@@ -90,6 +101,9 @@ private:
 			off_t				fIterationBandwidth;
 			off_t				fMinOwnerBandwidth;
 			off_t				fMaxOwnerBandwidth;
+			uint32				fMode;
+			bool				fServedExpiredOwner;
+			io_scheduler_stats	fStats;
 	volatile bool				fTerminating;
 };
 
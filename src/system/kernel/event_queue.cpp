@@ -0,0 +1,812 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Event queues keep objects selected across calls, like epoll or kqueue do
+	elsewhere. Each object in a queue has its own select_sync that is hooked
+	up to the queue via select_sync_ops: notifying it puts the entry on the
+	queue's ready list, and wakes up the waiters. The entries are reference
+	counted via their sync, as the object they are selected on keeps a
+	reference, too.
+	File descriptors are looked up in the I/O context of the team selecting
+	them, and the entry remembers that context, as the queue may be closed
+	or changed from another team later on.
+*/
+
+
+#include <event_queue.h>
+
+#include <new>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <AutoDeleter.h>
+#include <DPC.h>
+#include <Referenceable.h>
+
+#include <fs/fd.h>
+#include <lock.h>
+#include <syscall_restart.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+#include <vfs.h>
+#include <wait_for_objects.h>
+
+
+//#define TRACE_EVENT_QUEUE
+#ifdef TRACE_EVENT_QUEUE
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+static const uint16 kEventQueueFlags = B_EVENT_LEVEL_TRIGGERED
+	| B_EVENT_ONE_SHOT;
+static const uint16 kAlwaysSelectedEvents = B_EVENT_INVALID | B_EVENT_ERROR
+	| B_EVENT_DISCONNECTED;
+
+
+struct EventQueue;
+
+
+struct EventQueueEntry : select_sync,
+		DoublyLinkedListLinkImpl<EventQueueEntry> {
+	select_info			info;
+	EventQueue*			queue;
+	int32				object;
+	uint16				type;
+	uint16				events;
+		// the events asked for, including the event queue flags
+	void*				user_data;
+
+	// protected by the queue's lock
+	EventQueueEntry*	hash_next;
+	EventQueueEntry*	rearm_next;
+	io_context*			context;
+		// the context the FD is selected in, not referenced
+	bool				selected;
+
+	// protected by the queue's spinlock
+	bool				registered;
+	bool				queued;
+	bool				rearming;
+	bool				detached;
+		// the object reported B_EVENT_INVALID, and has already let go of
+		// the entry
+};
+
+typedef DoublyLinkedList<EventQueueEntry> EventQueueEntryList;
+
+
+struct EventQueueEntryKey {
+	int32	object;
+	uint16	type;
+
+	EventQueueEntryKey(int32 object, uint16 type)
+		:
+		object(object),
+		type(type)
+	{
+	}
+};
+
+
+struct EventQueueEntryHashDefinition {
+	typedef EventQueueEntryKey	KeyType;
+	typedef	EventQueueEntry		ValueType;
+
+	size_t HashKey(const EventQueueEntryKey& key) const
+	{
+		return ((size_t)key.object << 2) ^ key.type;
+	}
+
+	size_t Hash(EventQueueEntry* value) const
+	{
+		return HashKey(EventQueueEntryKey(value->object, value->type));
+	}
+
+	bool Compare(const EventQueueEntryKey& key, EventQueueEntry* value) const
+	{
+		return value->object == key.object && value->type == key.type;
+	}
+
+	EventQueueEntry*& GetLink(EventQueueEntry* value) const
+	{
+		return value->hash_next;
+	}
+};
+
+typedef BOpenHashTable<EventQueueEntryHashDefinition> EventQueueEntryTable;
+
+
+struct EventQueue : BReferenceable {
+								EventQueue(bool kernel);
+	virtual						~EventQueue();
+
+			status_t			Init();
+			void				Close();
+
+			status_t			Select(event_wait_info& info);
+			ssize_t				Wait(event_wait_info* infos, int numInfos,
+									uint32 flags, bigtime_t timeout);
+
+			status_t			Notify(EventQueueEntry* entry, uint16 events);
+
+private:
+			status_t			_SelectEntry(EventQueueEntry* entry,
+									io_context* context);
+			void				_DeselectEntry(EventQueueEntry* entry);
+			void				_RemoveEntry(EventQueueEntry* entry);
+			ssize_t				_CollectEvents(event_wait_info* infos,
+									int numInfos);
+			void				_RearmEntries(EventQueueEntry* entries);
+			void				_ReselectEntry(EventQueueEntry* entry);
+
+private:
+			mutex				fLock;
+				// protects the registrations
+			spinlock			fSpinlock;
+				// protects the ready list
+			sem_id				fSem;
+			EventQueueEntryTable fEntries;
+			EventQueueEntryList	fReadyList;
+			bool				fKernel;
+			bool				fClosed;
+};
+
+
+/*!	Gets a reference to \a context, unless it is already on its way to be
+	freed.
+*/
+static bool
+acquire_io_context(io_context* context)
+{
+	int32 count = atomic_get(&context->ref_count);
+	while (count > 0) {
+		int32 previous = atomic_test_and_set(&context->ref_count, count + 1,
+			count);
+		if (previous == count)
+			return true;
+
+		count = previous;
+	}
+
+	return false;
+}
+
+
+static void
+put_io_context(void* context)
+{
+	vfs_put_io_context((io_context*)context);
+}
+
+
+/*!	Releases a reference acquired by acquire_io_context(). Freeing the
+	context closes its FDs, which might include the queue whose lock the
+	caller holds, so the last reference is put by a DPC instead.
+*/
+static void
+release_io_context(io_context* context)
+{
+	int32 count = atomic_get(&context->ref_count);
+	while (count > 1) {
+		int32 previous = atomic_test_and_set(&context->ref_count, count - 1,
+			count);
+		if (previous == count)
+			return;
+
+		count = previous;
+	}
+
+	if (DPCQueue::DefaultQueue(B_NORMAL_PRIORITY)->Add(&put_io_context,
+			context, false) != B_OK) {
+		vfs_put_io_context(context);
+	}
+}
+
+
+static status_t
+event_queue_entry_notify(select_info* info, uint16 events)
+{
+	EventQueueEntry* entry = static_cast<EventQueueEntry*>(info->sync);
+	return entry->queue->Notify(entry, events);
+}
+
+
+static void
+event_queue_entry_free(select_sync* sync)
+{
+	EventQueueEntry* entry = static_cast<EventQueueEntry*>(sync);
+	entry->queue->ReleaseReference();
+	delete entry;
+}
+
+
+static const select_sync_ops kEventQueueSyncOps = {
+	&event_queue_entry_notify,
+	&event_queue_entry_free
+};
+
+
+EventQueue::EventQueue(bool kernel)
+	:
+	fSem(-1),
+	fKernel(kernel),
+	fClosed(false)
+{
+	mutex_init(&fLock, "event queue");
+	B_INITIALIZE_SPINLOCK(&fSpinlock);
+}
+
+
+EventQueue::~EventQueue()
+{
+	if (fSem >= 0)
+		delete_sem(fSem);
+
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+EventQueue::Init()
+{
+	fSem = create_sem(0, "event queue");
+	if (fSem < 0)
+		return fSem;
+
+	return fEntries.Init();
+}
+
+
+/*!	Removes all entries, and wakes up everyone waiting for events. Entries
+	that are still referenced by their object go away when that is done with
+	them; the queue itself lives on until its last entry is gone.
+*/
+void
+EventQueue::Close()
+{
+	MutexLocker locker(fLock);
+
+	InterruptsSpinLocker spinLocker(fSpinlock);
+	fClosed = true;
+	spinLocker.Unlock();
+
+	delete_sem(fSem);
+	fSem = -1;
+
+	EventQueueEntry* entry = fEntries.Clear(true);
+	while (entry != NULL) {
+		EventQueueEntry* next = entry->hash_next;
+
+		if (entry->selected)
+			_DeselectEntry(entry);
+
+		spinLocker.Lock();
+		entry->registered = false;
+		if (entry->queued) {
+			fReadyList.Remove(entry);
+			entry->queued = false;
+		}
+		spinLocker.Unlock();
+
+		put_select_sync(entry);
+		entry = next;
+	}
+}
+
+
+/*!	Adds the object described by \a info, changes its events, or removes it
+	from the queue when no events are given.
+*/
+status_t
+EventQueue::Select(event_wait_info& info)
+{
+	MutexLocker locker(fLock);
+
+	if (fClosed)
+		return B_FILE_ERROR;
+
+	EventQueueEntry* entry = fEntries.Lookup(
+		EventQueueEntryKey(info.object, info.type));
+
+	if (info.events == 0) {
+		if (entry == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		_RemoveEntry(entry);
+		return B_OK;
+	}
+
+	if (entry != NULL) {
+		// changes the events and user data of an existing entry, and
+		// selects it again, as the selected events might differ
+		if (entry->selected)
+			_DeselectEntry(entry);
+
+		InterruptsSpinLocker spinLocker(fSpinlock);
+		if (entry->queued) {
+			fReadyList.Remove(entry);
+			entry->queued = false;
+		}
+		atomic_set(&entry->info.events, 0);
+		spinLocker.Unlock();
+
+		entry->events = info.events;
+		entry->user_data = info.user_data;
+
+		status_t status = _SelectEntry(entry,
+			get_current_io_context(fKernel));
+		if (status != B_OK)
+			_RemoveEntry(entry);
+		return status;
+	}
+
+	entry = new(std::nothrow) EventQueueEntry;
+	if (entry == NULL)
+		return B_NO_MEMORY;
+
+	entry->ref_count = 1;
+		// the queue's reference
+	entry->sem = -1;
+	entry->count = 1;
+	entry->set = &entry->info;
+	entry->ops = &kEventQueueSyncOps;
+
+	entry->info.next = NULL;
+	entry->info.sync = entry;
+	entry->info.events = 0;
+
+	entry->queue = this;
+	entry->object = info.object;
+	entry->type = info.type;
+	entry->events = info.events;
+	entry->user_data = info.user_data;
+	entry->context = NULL;
+	entry->selected = false;
+	entry->registered = true;
+	entry->queued = false;
+	entry->rearming = false;
+	entry->detached = false;
+
+	status_t status = fEntries.Insert(entry);
+	if (status != B_OK) {
+		delete entry;
+		return status;
+	}
+
+	AcquireReference();
+		// released when the entry is freed
+
+	status = _SelectEntry(entry, get_current_io_context(fKernel));
+	if (status != B_OK)
+		_RemoveEntry(entry);
+
+	return status;
+}
+
+
+/*!	Waits until at least one entry has pending events, and returns up to
+	\a numInfos of them.
+*/
+ssize_t
+EventQueue::Wait(event_wait_info* infos, int numInfos, uint32 flags,
+	bigtime_t timeout)
+{
+	while (true) {
+		ssize_t count = _CollectEvents(infos, numInfos);
+		if (count != 0)
+			return count;
+
+		// Since the semaphore is released once for every entry that is
+		// queued, waiters may see an empty list, and just try again.
+		status_t status = acquire_sem_etc(fSem, 1, flags | B_CAN_INTERRUPT,
+			timeout);
+		if (status == B_BAD_SEM_ID)
+			return B_FILE_ERROR;
+		if (status != B_OK)
+			return status;
+	}
+}
+
+
+/*!	Called by notify_select_events(), possibly with interrupts disabled, and
+	with the object's spinlocks held.
+*/
+status_t
+EventQueue::Notify(EventQueueEntry* entry, uint16 events)
+{
+	InterruptsSpinLocker locker(fSpinlock);
+
+	if ((events & B_EVENT_INVALID) != 0)
+		entry->detached = true;
+
+	if ((entry->info.selected_events & events) == 0 || !entry->registered
+		|| entry->queued || fClosed) {
+		return B_OK;
+	}
+
+	fReadyList.Add(entry);
+	entry->queued = true;
+
+	locker.Unlock();
+
+	return release_sem_etc(fSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+/*!	Selects the object of \a entry; if it is a FD, it is looked up in
+	\a context, which the caller must keep alive.
+*/
+status_t
+EventQueue::_SelectEntry(EventQueueEntry* entry, io_context* context)
+{
+	entry->info.selected_events = (entry->events & ~kEventQueueFlags)
+		| kAlwaysSelectedEvents;
+
+	InterruptsSpinLocker locker(fSpinlock);
+	entry->detached = false;
+	locker.Unlock();
+
+	status_t status;
+	if (entry->type == B_OBJECT_TYPE_FD) {
+		entry->context = context;
+		status = select_fd_etc(context, entry->object, &entry->info);
+	} else {
+		status = select_object(entry->type, entry->object, &entry->info,
+			fKernel);
+	}
+	entry->selected = status == B_OK;
+
+	TRACE(("event queue %p: select %" B_PRId32 "/%u: %s\n", this,
+		entry->object, entry->type, strerror(status)));
+	return status;
+}
+
+
+void
+EventQueue::_DeselectEntry(EventQueueEntry* entry)
+{
+	entry->selected = false;
+
+	if (entry->type != B_OBJECT_TYPE_FD) {
+		deselect_object(entry->type, entry->object, &entry->info, fKernel);
+		return;
+	}
+
+	// Closing the FD or freeing its context deselects it, too; until then,
+	// the context cannot go away, as it still has the entry selected.
+	InterruptsSpinLocker locker(fSpinlock);
+	bool selected = !entry->detached && acquire_io_context(entry->context);
+	locker.Unlock();
+
+	if (selected) {
+		deselect_fd_etc(entry->context, entry->object, &entry->info);
+		release_io_context(entry->context);
+	}
+}
+
+
+void
+EventQueue::_RemoveEntry(EventQueueEntry* entry)
+{
+	if (entry->selected)
+		_DeselectEntry(entry);
+
+	fEntries.RemoveUnchecked(entry);
+
+	InterruptsSpinLocker locker(fSpinlock);
+	entry->registered = false;
+	if (entry->queued) {
+		fReadyList.Remove(entry);
+		entry->queued = false;
+	}
+	locker.Unlock();
+
+	put_select_sync(entry);
+}
+
+
+/*!	Moves the events of up to \a numInfos ready entries into \a infos.
+	Edge triggered entries are done with that, the others are rearmed
+	afterwards: level triggered entries are selected again, so that the
+	object reports its state anew, unless it already did so in the meantime,
+	and one-shot entries are deselected.
+*/
+ssize_t
+EventQueue::_CollectEvents(event_wait_info* infos, int numInfos)
+{
+	EventQueueEntry* rearmEntries = NULL;
+	ssize_t count = 0;
+
+	InterruptsSpinLocker locker(fSpinlock);
+
+	if (fClosed)
+		return B_FILE_ERROR;
+
+	while (count < numInfos) {
+		EventQueueEntry* entry = fReadyList.RemoveHead();
+		if (entry == NULL)
+			break;
+
+		entry->queued = false;
+
+		uint16 events = atomic_and(&entry->info.events, 0)
+			& entry->info.selected_events;
+		if (events == 0)
+			continue;
+
+		event_wait_info& info = infos[count++];
+		info.object = entry->object;
+		info.type = entry->type;
+		info.events = events;
+		info.user_data = entry->user_data;
+
+		if (((entry->events & kEventQueueFlags) != 0
+				|| (events & B_EVENT_INVALID) != 0)
+			&& !entry->rearming) {
+			entry->rearming = true;
+			atomic_add(&entry->ref_count, 1);
+			entry->rearm_next = rearmEntries;
+			rearmEntries = entry;
+		}
+	}
+
+	locker.Unlock();
+
+	if (rearmEntries != NULL)
+		_RearmEntries(rearmEntries);
+
+	return count;
+}
+
+
+void
+EventQueue::_RearmEntries(EventQueueEntry* entries)
+{
+	MutexLocker locker(fLock);
+
+	while (entries != NULL) {
+		EventQueueEntry* entry = entries;
+		entries = entry->rearm_next;
+
+		InterruptsSpinLocker spinLocker(fSpinlock);
+		bool registered = entry->registered;
+		bool queued = entry->queued;
+		uint16 events = entry->info.events;
+		entry->rearming = false;
+		spinLocker.Unlock();
+
+		if (registered) {
+			if ((events & B_EVENT_INVALID) != 0) {
+				// the object is gone
+				_RemoveEntry(entry);
+			} else if ((entry->events & B_EVENT_ONE_SHOT) != 0) {
+				if (entry->selected)
+					_DeselectEntry(entry);
+			} else if (entry->selected && !queued)
+				_ReselectEntry(entry);
+		}
+
+		put_select_sync(entry);
+	}
+}
+
+
+/*!	Selects a level triggered entry again, in the same context, so that the
+	object reports its current state. Entries that cannot be selected anymore
+	are removed.
+*/
+void
+EventQueue::_ReselectEntry(EventQueueEntry* entry)
+{
+	io_context* context = NULL;
+	if (entry->type == B_OBJECT_TYPE_FD) {
+		InterruptsSpinLocker locker(fSpinlock);
+		if (!entry->detached && acquire_io_context(entry->context))
+			context = entry->context;
+		locker.Unlock();
+
+		if (context == NULL) {
+			// the FD or its context is gone
+			_RemoveEntry(entry);
+			return;
+		}
+	}
+
+	_DeselectEntry(entry);
+	if (_SelectEntry(entry, context) != B_OK)
+		_RemoveEntry(entry);
+
+	if (context != NULL)
+		release_io_context(context);
+}
+
+
+//	#pragma mark - file descriptor ops
+
+
+static status_t
+event_queue_close(struct file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->Close();
+	return B_OK;
+}
+
+
+static void
+event_queue_free(struct file_descriptor* descriptor)
+{
+	EventQueue* queue = (EventQueue*)descriptor->cookie;
+	queue->ReleaseReference();
+}
+
+
+static struct fd_ops sEventQueueFDOps = {
+	NULL,	// fd_read
+	NULL,	// fd_write
+	NULL,	// fd_seek
+	NULL,	// fd_ioctl
+	NULL,	// fd_set_flags
+	NULL,	// fd_select
+	NULL,	// fd_deselect
+	NULL,	// fd_read_dir
+	NULL,	// fd_rewind_dir
+	NULL,	// fd_read_stat
+	NULL,	// fd_write_stat
+	&event_queue_close,
+	&event_queue_free
+};
+
+
+static EventQueue*
+get_event_queue(int fd, file_descriptor*& _descriptor)
+{
+	file_descriptor* descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return NULL;
+
+	if (descriptor->type != FDTYPE_EVENT_QUEUE) {
+		put_fd(descriptor);
+		return NULL;
+	}
+
+	_descriptor = descriptor;
+	return (EventQueue*)descriptor->cookie;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_event_queue_create(int openFlags)
+{
+	EventQueue* queue = new(std::nothrow) EventQueue(false);
+	if (queue == NULL)
+		return B_NO_MEMORY;
+	BReference<EventQueue> queueReference(queue, true);
+
+	status_t status = queue->Init();
+	if (status != B_OK)
+		return status;
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL)
+		return B_NO_MEMORY;
+
+	descriptor->type = FDTYPE_EVENT_QUEUE;
+	descriptor->ops = &sEventQueueFDOps;
+	descriptor->cookie = queue;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		return B_NO_MORE_FDS;
+	}
+
+	mutex_lock(&context->io_mutex);
+	fd_set_close_on_exec(context, fd, (openFlags & O_CLOEXEC) != 0);
+	mutex_unlock(&context->io_mutex);
+
+	queueReference.Detach();
+		// now owned by the descriptor
+	return fd;
+}
+
+
+status_t
+_user_event_queue_select(int queueFD, event_wait_info* userInfos,
+	int numInfos)
+{
+	if (numInfos <= 0)
+		return B_BAD_VALUE;
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	event_wait_info* infos = (event_wait_info*)malloc(
+		sizeof(event_wait_info) * numInfos);
+	if (infos == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter infosDeleter(infos);
+
+	if (user_memcpy(infos, userInfos, sizeof(event_wait_info) * numInfos)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	file_descriptor* descriptor;
+	EventQueue* queue = get_event_queue(queueFD, descriptor);
+	if (queue == NULL)
+		return B_FILE_ERROR;
+
+	status_t result = B_OK;
+	for (int i = 0; i < numInfos; i++) {
+		status_t status = queue->Select(infos[i]);
+		if (status != B_OK) {
+			infos[i].events = B_EVENT_INVALID;
+			if (result == B_OK)
+				result = status;
+		}
+	}
+
+	put_fd(descriptor);
+
+	if (result != B_OK
+		&& user_memcpy(userInfos, infos, sizeof(event_wait_info) * numInfos)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
+ssize_t
+_user_event_queue_wait(int queueFD, event_wait_info* userInfos, int numInfos,
+	uint32 flags, bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (numInfos <= 0)
+		return B_BAD_VALUE;
+	if (userInfos == NULL || !IS_USER_ADDRESS(userInfos))
+		return B_BAD_ADDRESS;
+
+	event_wait_info* infos = (event_wait_info*)malloc(
+		sizeof(event_wait_info) * numInfos);
+	if (infos == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter infosDeleter(infos);
+
+	file_descriptor* descriptor;
+	EventQueue* queue = get_event_queue(queueFD, descriptor);
+	if (queue == NULL)
+		return B_FILE_ERROR;
+
+	ssize_t result = queue->Wait(infos, numInfos, flags, timeout);
+
+	put_fd(descriptor);
+
+	if (result < 0)
+		return syscall_restart_handle_timeout_post(result, timeout);
+
+	if (user_memcpy(userInfos, infos, sizeof(event_wait_info) * result)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
@@ -50,7 +50,9 @@ EntryCacheGeneration::Init()
 
 EntryCache::EntryCache()
 	:
-	fCurrentGeneration(0)
+	fCurrentGeneration(0),
+	fChangeCount(0),
+	fCacheMissingEntries(false)
 {
 	rw_lock_init(&fLock, "entry cache");
 
@@ -92,37 +94,37 @@ EntryCache::Init()
 status_t
 EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID)
 {
-	EntryCacheKey key(dirID, name);
-
 	WriteLocker _(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
-	if (entry != NULL) {
-		entry->node_id = nodeID;
-		if (entry->generation != fCurrentGeneration) {
-			if (entry->index >= 0) {
-				fGenerations[entry->generation].entries[entry->index] = NULL;
-				_AddEntryToCurrentGeneration(entry);
-			}
-		}
-		return B_OK;
-	}
+	return _Add(dirID, name, nodeID, false);
+}
 
-	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
-	if (entry == NULL)
-		return B_NO_MEMORY;
 
-	entry->node_id = nodeID;
-	entry->dir_id = dirID;
-	entry->generation = fCurrentGeneration;
-	entry->index = kEntryNotInArray;
-	strcpy(entry->name, name);
+/*!	Adds a negative entry, i.e. remembers that the directory \a dirID does not
+	contain an entry \a name.
+	\a changeCount must be the value ChangeCount() returned before the file
+	system was asked for the entry. If an entry has been created in the
+	meantime, the negative entry is not added, since it might already be stale.
+	An existing positive entry is never replaced.
+*/
+status_t
+EntryCache::AddMissing(ino_t dirID, const char* name, uint32 changeCount)
+{
+	if (!fCacheMissingEntries)
+		return B_NOT_SUPPORTED;
 
-	fEntries.Insert(entry);
+	EntryCacheKey key(dirID, name);
 
-	_AddEntryToCurrentGeneration(entry);
+	WriteLocker _(fLock);
 
-	return B_OK;
+	if (fChangeCount != changeCount)
+		return B_BUSY;
+
+	EntryCacheEntry* entry = fEntries.Lookup(key);
+	if (entry != NULL && !entry->missing)
+		return B_FILE_EXISTS;
+
+	return _Add(dirID, name, -1, true);
 }
 
 
@@ -137,25 +139,44 @@ EntryCache::Remove(ino_t dirID, const char* name)
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
-	fEntries.Remove(entry);
+	_Remove(entry);
+	return B_OK;
+}
 
-	if (entry->index >= 0) {
-		// remove the entry from its generation and delete it
-		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
-	} else {
-		// We can't free it, since another thread is about to try to move it
-		// to another generation. We mark it removed and the other thread will
-		// take care of deleting it.
-		entry->index = kEntryRemoved;
-	}
 
+/*!	Invalidates a negative entry for \a name in \a dirID, if there is one.
+	Must be called whenever an entry is created in a directory, so that
+	concurrent lookups won't add a stale negative entry either.
+*/
+status_t
+EntryCache::RemoveMissing(ino_t dirID, const char* name)
+{
+	if (!fCacheMissingEntries)
+		return B_OK;
+
+	EntryCacheKey key(dirID, name);
+
+	WriteLocker writeLocker(fLock);
+
+	fChangeCount++;
+
+	EntryCacheEntry* entry = fEntries.Lookup(key);
+	if (entry == NULL || !entry->missing)
+		return B_ENTRY_NOT_FOUND;
+
+	_Remove(entry);
 	return B_OK;
 }
 
 
+/*!	Looks up the entry \a name in the directory \a dirID.
+	Returns \c false, if the cache doesn't know anything about the entry.
+	Otherwise \a _missing is set to \c true, if the entry is known not to
+	exist, and \a _nodeID to the ID of the node the entry refers to, if not.
+*/
 bool
-EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
+EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
+	bool& _missing)
 {
 	EntryCacheKey key(dirID, name);
 
@@ -170,6 +191,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
 		// The entry is already in the current generation or is being moved to
 		// it by another thread.
 		_nodeID = entry->node_id;
+		_missing = entry->missing;
 		return true;
 	}
 
@@ -183,6 +205,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
 		fGenerations[fCurrentGeneration].entries[index] = entry;
 		entry->index = index;
 		_nodeID = entry->node_id;
+		_missing = entry->missing;
 		return true;
 	}
 
@@ -200,6 +223,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID)
 	_AddEntryToCurrentGeneration(entry);
 
 	_nodeID = entry->node_id;
+	_missing = entry->missing;
 	return true;
 }
 
@@ -209,7 +233,7 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
 	for (EntryTable::Iterator it = fEntries.GetIterator();
 			EntryCacheEntry* entry = it.Next();) {
-		if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
+		if (nodeID == entry->node_id && !entry->missing && strcmp(entry->name, ".") != 0
 				&& strcmp(entry->name, "..") != 0) {
 			_dirID = entry->dir_id;
 			return entry->name;
@@ -220,6 +244,61 @@ EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 }
 
 
+status_t
+EntryCache::_Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
+{
+	EntryCacheKey key(dirID, name);
+
+	EntryCacheEntry* entry = fEntries.Lookup(key);
+	if (entry != NULL) {
+		entry->node_id = nodeID;
+		entry->missing = missing;
+		if (entry->generation != fCurrentGeneration) {
+			if (entry->index >= 0) {
+				fGenerations[entry->generation].entries[entry->index] = NULL;
+				_AddEntryToCurrentGeneration(entry);
+			}
+		}
+		return B_OK;
+	}
+
+	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
+	if (entry == NULL)
+		return B_NO_MEMORY;
+
+	entry->node_id = nodeID;
+	entry->dir_id = dirID;
+	entry->generation = fCurrentGeneration;
+	entry->index = kEntryNotInArray;
+	entry->missing = missing;
+	strcpy(entry->name, name);
+
+	fEntries.Insert(entry);
+
+	_AddEntryToCurrentGeneration(entry);
+
+	return B_OK;
+}
+
+
+void
+EntryCache::_Remove(EntryCacheEntry* entry)
+{
+	fEntries.Remove(entry);
+
+	if (entry->index >= 0) {
+		// remove the entry from its generation and delete it
+		fGenerations[entry->generation].entries[entry->index] = NULL;
+		free(entry);
+	} else {
+		// We can't free it, since another thread is about to try to move it
+		// to another generation. We mark it removed and the other thread will
+		// take care of deleting it.
+		entry->index = kEntryRemoved;
+	}
+}
+
+
 void
 EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
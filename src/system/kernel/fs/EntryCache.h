@@ -36,6 +36,7 @@ struct EntryCacheEntry {
 			ino_t				dir_id;
 			vint32				generation;
 			vint32				index;
+			bool				missing;
 			char				name[1];
 };
 
@@ -86,13 +87,24 @@ public:
 
 			status_t			Init();
 
+			void				SetCacheMissingEntries(bool cache)
+									{ fCacheMissingEntries = cache; }
+			bool				CachesMissingEntries() const
+									{ return fCacheMissingEntries; }
+
 			status_t			Add(ino_t dirID, const char* name,
 									ino_t nodeID);
+			status_t			AddMissing(ino_t dirID, const char* name,
+									uint32 changeCount);
 
 			status_t			Remove(ino_t dirID, const char* name);
+			status_t			RemoveMissing(ino_t dirID, const char* name);
 
 			bool				Lookup(ino_t dirID, const char* name,
-									ino_t& nodeID);
+									ino_t& nodeID, bool& missing);
+
+			uint32				ChangeCount() const
+									{ return fChangeCount; }
 
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
@@ -103,6 +115,9 @@ private:
 			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
 
 private:
+			status_t			_Add(ino_t dirID, const char* name,
+									ino_t nodeID, bool missing);
+			void				_Remove(EntryCacheEntry* entry);
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
 
@@ -111,6 +126,8 @@ private:
 			EntryTable			fEntries;
 			EntryCacheGeneration fGenerations[kGenerationCount];
 			int32				fCurrentGeneration;
+			vuint32				fChangeCount;
+			bool				fCacheMissingEntries;
 };
 
 
@@ -40,8 +40,6 @@ static const size_t kMaxReadDirBufferSize = 64 * 1024;
 static struct file_descriptor* get_fd_locked(struct io_context* context,
 	int fd);
 static struct file_descriptor* remove_fd(struct io_context* context, int fd);
-static void deselect_select_infos(file_descriptor* descriptor,
-	select_info* infos);
 
 
 struct FDGetterLocking {
@@ -523,7 +521,11 @@ fd_ioctl(bool kernelFD, int fd, uint32 op, void* buffer, size_t length)
 }
 
 
-static void
+/*!	Deselects the given list of select infos from \a descriptor, notifies
+	them with \c B_EVENT_INVALID, and releases the references to their sync
+	objects that were acquired in select_fd().
+*/
+void
 deselect_select_infos(file_descriptor* descriptor, select_info* infos)
 {
 	TRACE(("deselect_select_infos(%p, %p)\n", descriptor, infos));
@@ -552,6 +554,16 @@ deselect_select_infos(file_descriptor* descriptor, select_info* infos)
 
 status_t
 select_fd(int32 fd, struct select_info* info, bool kernel)
+{
+	return select_fd_etc(get_current_io_context(kernel), fd, info);
+}
+
+
+/*!	Like select_fd(), but \a fd is looked up in the given \a context instead
+	of the current one.
+*/
+status_t
+select_fd_etc(struct io_context* context, int32 fd, struct select_info* info)
 {
 	TRACE(("select_fd(fd = %ld, info = %p (%p), 0x%x)\n", fd, info,
 		info->sync, info->selected_events));
@@ -559,7 +571,6 @@ select_fd(int32 fd, struct select_info* info, bool kernel)
 	FDGetter fdGetter;
 		// define before the context locker, so it will be destroyed after it
 
-	io_context* context = get_current_io_context(kernel);
 	MutexLocker locker(context->io_mutex);
 
 	struct file_descriptor* descriptor = fdGetter.SetTo(context, fd, true);
@@ -598,8 +609,10 @@ select_fd(int32 fd, struct select_info* info, bool kernel)
 	locker.Lock();
 	if (context->fds[fd] != descriptor) {
 		// Someone close()d the index in the meantime. deselect() all
-		// events.
+		// events. deselect_select_infos() releases a sync reference, so
+		// we need to acquire one first.
 		info->next = NULL;
+		atomic_add(&info->sync->ref_count, 1);
 		deselect_select_infos(descriptor, info);
 
 		// Release our open reference of the descriptor.
@@ -627,6 +640,16 @@ select_fd(int32 fd, struct select_info* info, bool kernel)
 
 status_t
 deselect_fd(int32 fd, struct select_info* info, bool kernel)
+{
+	return deselect_fd_etc(get_current_io_context(kernel), fd, info);
+}
+
+
+/*!	Like deselect_fd(), but \a fd is looked up in the given \a context
+	instead of the current one.
+*/
+status_t
+deselect_fd_etc(struct io_context* context, int32 fd, struct select_info* info)
 {
 	TRACE(("deselect_fd(fd = %ld, info = %p (%p), 0x%x)\n", fd, info,
 		info->sync, info->selected_events));
@@ -634,7 +657,6 @@ deselect_fd(int32 fd, struct select_info* info, bool kernel)
 	FDGetter fdGetter;
 		// define before the context locker, so it will be destroyed after it
 
-	io_context* context = get_current_io_context(kernel);
 	MutexLocker locker(context->io_mutex);
 
 	struct file_descriptor* descriptor = fdGetter.SetTo(context, fd, true);
@@ -7,9 +7,12 @@
 
 
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <stdlib.h>
 
 #include <module.h>
 
@@ -31,6 +34,7 @@
 #define MAX_SOCKET_ADDRESS_LENGTH	(sizeof(sockaddr_storage))
 #define MAX_SOCKET_OPTION_LENGTH	128
 #define MAX_ANCILLARY_DATA_LENGTH	1024
+#define SENDFILE_CHUNK_SIZE			65536
 
 #define GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor)	\
 	do {												\
@@ -542,6 +546,114 @@ common_sendmsg(int fd, const struct msghdr *message, int flags, bool kernel)
 }
 
 
+struct sendfile_buffer {
+	int32	ref_count;
+	uint8	data[SENDFILE_CHUNK_SIZE];
+};
+
+
+static void
+put_sendfile_buffer(void* _buffer)
+{
+	sendfile_buffer* buffer = (sendfile_buffer*)_buffer;
+	if (atomic_add(&buffer->ref_count, -1) == 1)
+		free(buffer);
+}
+
+
+/*!	Reads up to \a count bytes from \a fileFD, and sends them over the
+	socket \a socketFD. The file data is read once into a kernel buffer that
+	is then passed on to the stack by reference; it is not copied again on
+	its way to the network interface. The buffer is reused for the next
+	chunk as soon as the stack is done with it, and only while it is still
+	queued, another one is needed. Since the chunks are a snapshot of the
+	file contents, changing the file afterwards does not affect data that
+	is still queued in the socket.
+	If \a _offset is \c NULL, the file position is used and updated,
+	otherwise \a _offset is used and updated instead.
+*/
+static ssize_t
+common_sendfile(int socketFD, int fileFD, off_t* _offset, size_t count,
+	bool kernel)
+{
+	file_descriptor* descriptor;
+	GET_SOCKET_FD_OR_RETURN(socketFD, kernel, descriptor);
+	FDPutter _(descriptor);
+
+	if (fileFD < 0)
+		return EBADF;
+
+	file_descriptor* file = get_fd(get_current_io_context(kernel), fileFD);
+	if (file == NULL)
+		return EBADF;
+	FDPutter filePutter(file);
+
+	if ((file->open_mode & O_RWMASK) == O_WRONLY)
+		return EBADF;
+	if (file->ops->fd_read == NULL || file->type == FDTYPE_SOCKET)
+		return B_BAD_VALUE;
+
+	off_t pos = _offset != NULL ? *_offset : file->pos;
+	if (pos < 0)
+		return B_BAD_VALUE;
+
+	if (count > SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	status_t status = B_OK;
+	size_t bytesSent = 0;
+	sendfile_buffer* buffer = NULL;
+
+	while (bytesSent < count) {
+		if (buffer == NULL || atomic_get(&buffer->ref_count) > 1) {
+			// the stack still references the data we sent last
+			if (buffer != NULL)
+				put_sendfile_buffer(buffer);
+
+			buffer = (sendfile_buffer*)malloc(sizeof(sendfile_buffer));
+			if (buffer == NULL) {
+				status = B_NO_MEMORY;
+				break;
+			}
+			buffer->ref_count = 1;
+		}
+
+		size_t length = min_c(count - bytesSent, SENDFILE_CHUNK_SIZE);
+		status = file->ops->fd_read(file, pos, buffer->data, &length);
+		if (status != B_OK || length == 0)
+			break;
+
+		// the stack releases its reference when it is done with the data
+		atomic_add(&buffer->ref_count, 1);
+		ssize_t sent = sStackInterface->send_external(descriptor->u.socket,
+			buffer->data, length, 0, &put_sendfile_buffer, buffer);
+		if (sent < 0) {
+			status = sent;
+			break;
+		}
+
+		pos += sent;
+		bytesSent += sent;
+
+		if ((size_t)sent < length)
+			break;
+	}
+
+	if (buffer != NULL)
+		put_sendfile_buffer(buffer);
+
+	if (_offset != NULL)
+		*_offset = pos;
+	else
+		file->pos = pos;
+
+	if (bytesSent == 0 && status != B_OK)
+		return status;
+
+	return bytesSent;
+}
+
+
 static status_t
 common_getsockopt(int fd, int level, int option, void *value,
 	socklen_t *_length, bool kernel)
@@ -753,6 +865,14 @@ sendmsg(int socket, const struct msghdr *message, int flags)
 }
 
 
+ssize_t
+sendfile(int socket, int fd, off_t *offset, size_t count)
+{
+	SyscallFlagUnsetter _;
+	RETURN_AND_SET_ERRNO(common_sendfile(socket, fd, offset, count, true));
+}
+
+
 int
 getsockopt(int socket, int level, int option, void *value, socklen_t *_length)
 {
@@ -1104,6 +1224,30 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_sendfile(int socket, int fd, off_t *userOffset, size_t count)
+{
+	off_t offset;
+	if (userOffset != NULL) {
+		if (!IS_USER_ADDRESS(userOffset)
+			|| user_memcpy(&offset, userOffset, sizeof(off_t)) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+	}
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_sendfile(socket, fd, userOffset != NULL ? &offset : NULL,
+		count, false);
+
+	if (userOffset != NULL
+		&& user_memcpy(userOffset, &offset, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
 status_t
 _user_getsockopt(int socket, int level, int option, void *userValue,
 	socklen_t *_length)
@@ -2084,14 +2084,26 @@ entry_ref_to_vnode(dev_t mountID, ino_t directoryID, const char* name,
 static status_t
 lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode)
 {
+	EntryCache& entryCache = dir->mount->entry_cache;
 	ino_t id;
+	bool missing;
 
-	if (dir->mount->entry_cache.Lookup(dir->id, name, id))
+	if (entryCache.Lookup(dir->id, name, id, missing)) {
+		if (missing)
+			return B_ENTRY_NOT_FOUND;
 		return get_vnode(dir->device, id, _vnode, true, false);
+	}
+
+	uint32 changeCount = entryCache.ChangeCount();
 
 	status_t status = FS_CALL(dir, lookup, name, &id);
-	if (status != B_OK)
+	if (status != B_OK) {
+		// remember the entry doesn't exist -- looking up non-existing entries
+		// is common enough (search paths, lock files, ...)
+		if (status == B_ENTRY_NOT_FOUND && entryCache.CachesMissingEntries())
+			entryCache.AddMissing(dir->id, name, changeCount);
 		return status;
+	}
 
 	// The lookup() hook call get_vnode() or publish_vnode(), so we do already
 	// have a reference and just need to look the node up.
@@ -4017,6 +4029,24 @@ entry_cache_remove(dev_t mountID, ino_t dirID, const char* name)
 //	Functions the VFS exports for other parts of the kernel
 
 
+/*!	Invalidates the negative entry cache entry for \a name in the given
+	directory, if any. Called by the node monitor for every entry that is
+	created or moved, so that the file systems don't need to care about
+	negative entries themselves.
+*/
+status_t
+vfs_entry_cache_remove_missing(dev_t mountID, ino_t dirID, const char* name)
+{
+	MutexLocker locker(sMountMutex);
+	struct fs_mount* mount = find_mount(mountID);
+	if (mount == NULL)
+		return B_BAD_VALUE;
+	locker.Unlock();
+
+	return mount->entry_cache.RemoveMissing(dirID, name);
+}
+
+
 /*! Acquires another reference to the vnode that has to be released
 	by calling vfs_put_vnode().
 */
@@ -4883,6 +4913,12 @@ vfs_free_io_context(io_context* context)
 
 	for (i = 0; i < context->table_size; i++) {
 		if (struct file_descriptor* descriptor = context->fds[i]) {
+			// event queues may still have the FD selected
+			if (context->select_infos[i] != NULL) {
+				deselect_select_infos(descriptor, context->select_infos[i]);
+				context->select_infos[i] = NULL;
+			}
+
 			close_fd(descriptor);
 			put_fd(descriptor);
 		}
@@ -7414,6 +7450,20 @@ fs_mount(char* path, const char* device, const char* fsName, uint32 flags,
 	}
 	rw_lock_write_unlock(&sVnodeLock);
 
+	// Negative entries are only invalidated by the exact name that is
+	// created, so they are only cached for file systems that ask for it:
+	// they must compare names exactly, and send a node monitoring
+	// notification for every entry that appears on the volume.
+	if (mount->volume->sub_volume == NULL
+		&& HAS_FS_MOUNT_CALL(mount, read_fs_info)) {
+		fs_info info;
+		if (FS_MOUNT_CALL(mount, read_fs_info, &info) == B_OK
+			&& (info.flags & B_FS_CACHES_MISSING_ENTRIES) != 0
+			&& (info.flags & B_FS_IS_SHARED) == 0) {
+			mount->entry_cache.SetCacheMissingEntries(true);
+		}
+	}
+
 	if (!sRoot) {
 		sRoot = mount->root_vnode;
 		mutex_lock(&sIOContextRootLock);
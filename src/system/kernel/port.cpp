@@ -27,6 +27,7 @@
 #include <kernel.h>
 #include <Notifications.h>
 #include <sem.h>
+#include <slab/Slab.h>
 #include <syscall_restart.h>
 #include <team.h>
 #include <tracing.h>
@@ -46,14 +47,19 @@
 
 // Locking:
 // * sPortsLock: Protects the sPorts hash table, Team::port_list, and
-//   Port::owner.
+//   Port::owner. It is a read-write lock: looking up ports only needs a read
+//   lock, which doesn't serialize the lookups of different threads; only
+//   creating, deleting, and transferring ports needs a write lock.
 // * Port::lock: Protects all Port members save team_link, hash_link, and lock.
 //   id is immutable.
-// * sPortQuotaLock: Protects sTotalSpaceInUse, sAreaChangeCounter,
-//   sWaitingForSpace and the critical section of creating/adding areas for the
-//   port heap in the grow case. It also has to be held when reading
-//   sWaitingForSpace to determine whether or not to notify the
-//   sNoSpaceCondition condition variable.
+// * sPortQuotaLock: Protects sAreaChangeCounter, the sNoSpaceCondition
+//   condition variable, and the critical section of creating/adding areas for
+//   the port heap in the grow case.
+//   sTotalSpaceInUse and sWaitingForSpace are changed atomically, so that
+//   small messages can be allocated and freed without the quota lock. A
+//   thread that wants to wait for space increments sWaitingForSpace before it
+//   checks the quota, and put_port_message() decrements sTotalSpaceInUse
+//   before it checks sWaitingForSpace, so that no wakeup can get lost.
 //
 // The locking order is sPortsLock -> Port::lock. A port must be looked up
 // in sPorts and locked with sPortsLock held. Afterwards sPortsLock can be
@@ -72,6 +78,7 @@ struct port_message : DoublyLinkedListLinkImpl<port_message> {
 	uid_t				sender;
 	gid_t				sender_group;
 	team_id				sender_team;
+	bool				from_cache;
 	char				buffer[0];
 };
 
@@ -333,6 +340,8 @@ static const size_t kInitialPortBufferSize = 4 * 1024 * 1024;
 static const size_t kTotalSpaceLimit = 64 * 1024 * 1024;
 static const size_t kTeamSpaceLimit = 8 * 1024 * 1024;
 static const size_t kBufferGrowRate = kInitialPortBufferSize;
+static const size_t kSmallPortMessageSize = 256;
+	// messages up to this size are allocated from sSmallMessageCache
 
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
@@ -342,13 +351,14 @@ static int32 sUsedPorts = 0;
 
 static PortHashTable sPorts;
 static heap_allocator* sPortAllocator;
+static object_cache* sSmallMessageCache;
 static ConditionVariable sNoSpaceCondition;
 static int32 sTotalSpaceInUse;
 static int32 sAreaChangeCounter;
 static int32 sWaitingForSpace;
 static port_id sNextPortID = 1;
 static bool sPortsActive = false;
-static mutex sPortsLock = MUTEX_INITIALIZER("ports list");
+static rw_lock sPortsLock = RW_LOCK_INITIALIZER("ports list");
 static mutex sPortQuotaLock = MUTEX_INITIALIZER("port quota");
 
 static PortNotificationService sNotificationService;
@@ -503,7 +513,7 @@ notify_port_select_events(Port* port, uint16 events)
 static Port*
 get_locked_port(port_id id)
 {
-	MutexLocker portsLocker(sPortsLock);
+	ReadLocker portsLocker(sPortsLock);
 
 	Port* port = sPorts.Lookup(id);
 	if (port != NULL)
@@ -520,16 +530,71 @@ is_port_closed(Port* port)
 }
 
 
+/*!	Adds \a size bytes to the space in use by port messages, if that doesn't
+	exceed the limit.
+*/
+static bool
+reserve_port_space(size_t size)
+{
+	int32 space = atomic_get(&sTotalSpaceInUse);
+	while (space + size <= kTotalSpaceLimit) {
+		int32 oldSpace = atomic_test_and_set(&sTotalSpaceInUse, space + size,
+			space);
+		if (oldSpace == space)
+			return true;
+
+		space = oldSpace;
+	}
+
+	return false;
+}
+
+
+/*!	Allocates the memory for a message with a buffer of \a bufferSize bytes.
+	Small messages come from an object cache, whose per-CPU magazines can
+	usually serve them without any lock; the others come from the port heap.
+	If the object cache can't get more memory, small messages come from the
+	port heap as well.
+	Since the caller usually holds a port lock, this never waits for memory.
+*/
+static port_message*
+allocate_port_message(size_t bufferSize)
+{
+	port_message* message;
+	if (bufferSize <= kSmallPortMessageSize) {
+		message = (port_message*)object_cache_alloc(sSmallMessageCache,
+			CACHE_DONT_WAIT_FOR_MEMORY);
+		if (message != NULL) {
+			message->from_cache = true;
+			return message;
+		}
+	}
+
+	message = (port_message*)heap_memalign(sPortAllocator, 0,
+		sizeof(port_message) + bufferSize);
+	if (message != NULL)
+		message->from_cache = false;
+
+	return message;
+}
+
+
 static void
 put_port_message(port_message* message)
 {
 	size_t size = sizeof(port_message) + message->size;
-	heap_free(sPortAllocator, message);
+	if (message->from_cache) {
+		// the caller may hold a port lock, too
+		object_cache_free(sSmallMessageCache, message,
+			CACHE_DONT_WAIT_FOR_MEMORY);
+	} else
+		heap_free(sPortAllocator, message);
 
-	MutexLocker quotaLocker(sPortQuotaLock);
-	sTotalSpaceInUse -= size;
-	if (sWaitingForSpace > 0)
+	atomic_add(&sTotalSpaceInUse, -(int32)size);
+	if (atomic_get(&sWaitingForSpace) > 0) {
+		MutexLocker quotaLocker(sPortQuotaLock);
 		sNoSpaceCondition.NotifyAll();
+	}
 }
 
 
@@ -540,10 +605,27 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 	size_t size = sizeof(port_message) + bufferSize;
 	bool needToWait = false;
 
+	// Fast path for small messages: neither the quota lock nor the heap lock
+	// is needed, unless we have to wait for memory.
+	if (bufferSize <= kSmallPortMessageSize && reserve_port_space(size)) {
+		port_message* message = allocate_port_message(bufferSize);
+		if (message != NULL) {
+			message->code = code;
+			message->size = bufferSize;
+
+			*_message = message;
+			return B_OK;
+		}
+
+		atomic_add(&sTotalSpaceInUse, -(int32)size);
+	}
+
 	MutexLocker quotaLocker(sPortQuotaLock);
 
 	while (true) {
-		while (sTotalSpaceInUse + size > kTotalSpaceLimit || needToWait) {
+		atomic_add(&sWaitingForSpace, 1);
+
+		if (needToWait || !reserve_port_space(size)) {
 			// TODO: add per team limit
 			// We are not allowed to create another heap area, as our
 			// space limit has been reached - just wait until we get
@@ -551,13 +633,14 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 
 			// TODO: we don't want to wait - but does that also mean we
 			// shouldn't wait for the area creation?
-			if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+			if ((flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0) {
+				atomic_add(&sWaitingForSpace, -1);
 				return B_WOULD_BLOCK;
+			}
 
 			ConditionVariableEntry entry;
 			sNoSpaceCondition.Add(&entry);
 
-			sWaitingForSpace++;
 			quotaLocker.Unlock();
 
 			port_id portID = port.id;
@@ -568,7 +651,7 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 			// re-lock the port and the quota
 			Port* newPort = get_locked_port(portID);
 			quotaLocker.Lock();
-			sWaitingForSpace--;
+			atomic_add(&sWaitingForSpace, -1);
 
 			if (newPort != &port || is_port_closed(&port)) {
 				// the port is no longer usable
@@ -582,14 +665,14 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 			continue;
 		}
 
+		atomic_add(&sWaitingForSpace, -1);
+
 		int32 areaChangeCounter = sAreaChangeCounter;
-		sTotalSpaceInUse += size;
 		quotaLocker.Unlock();
 
 		// Quota is fulfilled, try to allocate the buffer
 
-		port_message* message
-			= (port_message*)heap_memalign(sPortAllocator, 0, size);
+		port_message* message = allocate_port_message(bufferSize);
 		if (message != NULL) {
 			message->code = code;
 			message->size = bufferSize;
@@ -603,7 +686,7 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		// We weren't able to allocate and we'll start over, including
 		// re-acquireing the quota, so we remove our size from the in-use
 		// counter again.
-		sTotalSpaceInUse -= size;
+		atomic_add(&sTotalSpaceInUse, -(int32)size);
 
 		if (areaChangeCounter != sAreaChangeCounter) {
 			// There was already an area added since we tried allocating,
@@ -628,7 +711,7 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		heap_add_area(sPortAllocator, area, base, kBufferGrowRate);
 
 		sAreaChangeCounter++;
-		if (sWaitingForSpace > 0)
+		if (atomic_get(&sWaitingForSpace) > 0)
 			sNoSpaceCondition.NotifyAll();
 	}
 }
@@ -700,7 +783,7 @@ delete_owned_ports(Team* team)
 {
 	TRACE(("delete_owned_ports(owner = %ld)\n", team->id));
 
-	MutexLocker portsLocker(sPortsLock);
+	WriteLocker portsLocker(sPortsLock);
 
 	// move the ports from the team's port list to a local list
 	struct list queue;
@@ -772,6 +855,13 @@ port_init(kernel_args *args)
 		return B_NO_MEMORY;
 	}
 
+	sSmallMessageCache = create_object_cache("port small messages",
+		sizeof(port_message) + kSmallPortMessageSize, 8, NULL, NULL, NULL);
+	if (sSmallMessageCache == NULL) {
+		panic("unable to create port message cache");
+		return B_NO_MEMORY;
+	}
+
 	sNoSpaceCondition.Init(&sPorts, "port space");
 
 	// add debugger commands
@@ -831,7 +921,7 @@ create_port(int32 queueLength, const char* name)
 	}
 	ObjectDeleter<Port> portDeleter(port);
 
-	MutexLocker locker(sPortsLock);
+	WriteLocker locker(sPortsLock);
 
 	// check the ports limit
 	if (sUsedPorts >= sMaxPorts)
@@ -909,7 +999,7 @@ delete_port(port_id id)
 	Port* port;
 	MutexLocker locker;
 	{
-		MutexLocker portsLocker(sPortsLock);
+		WriteLocker portsLocker(sPortsLock);
 
 		port = sPorts.Lookup(id);
 		if (port == NULL) {
@@ -1021,7 +1111,7 @@ find_port(const char* name)
 	if (name == NULL)
 		return B_BAD_VALUE;
 
-	MutexLocker portsLocker(sPortsLock);
+	ReadLocker portsLocker(sPortsLock);
 
 	for (PortHashTable::Iterator it = sPorts.GetIterator();
 		Port* port = it.Next();) {
@@ -1076,7 +1166,7 @@ _get_next_port_info(team_id teamID, int32* _cookie, struct port_info* info,
 	BReference<Team> teamReference(team, true);
 
 	// iterate through the team's port list
-	MutexLocker portsLocker(sPortsLock);
+	ReadLocker portsLocker(sPortsLock);
 
 	int32 stopIndex = *_cookie;
 	int32 index = 0;
@@ -1497,7 +1587,7 @@ set_port_owner(port_id id, team_id newTeamID)
 	BReference<Team> teamReference(team, true);
 
 	// get the port
-	MutexLocker portsLocker(sPortsLock);
+	WriteLocker portsLocker(sPortsLock);
 	Port* port = sPorts.Lookup(id);
 	if (port == NULL) {
 		TRACE(("set_port_owner: invalid port_id %ld\n", id));
@@ -5,8 +5,11 @@
  */
 
 
+#include <string.h>
+
 #include <kscheduler.h>
 #include <listeners.h>
+#include <safemode.h>
 #include <smp.h>
 
 #include "scheduler_affine.h"
@@ -68,13 +71,18 @@ scheduler_init(void)
 		cpuCount != 1 ? "s" : "");
 
 	if (cpuCount > 1) {
-#if 0
-		dprintf("scheduler_init: using affine scheduler\n");
-		scheduler_affine_init();
-#else
-		dprintf("scheduler_init: using simple SMP scheduler\n");
-		scheduler_simple_smp_init();
-#endif
+		// The topology aware affine scheduler can be selected via the
+		// "scheduler" safe mode/kernel settings option.
+		char mode[16];
+		size_t modeLength = sizeof(mode);
+		if (get_safemode_option(B_SAFEMODE_SCHEDULER, mode, &modeLength)
+				== B_OK && strcmp(mode, "affine") == 0) {
+			dprintf("scheduler_init: using affine scheduler\n");
+			scheduler_affine_init();
+		} else {
+			dprintf("scheduler_init: using simple SMP scheduler\n");
+			scheduler_simple_smp_init();
+		}
 	} else {
 		dprintf("scheduler_init: using simple scheduler\n");
 		scheduler_simple_init();
@@ -38,12 +38,117 @@
 #endif
 
 // The run queues. Holds the threads ready to run ordered by priority.
-// One queue per schedulable target (CPU, core, etc.).
-// TODO: consolidate this such that HT/SMT entities on the same physical core
-// share a queue, once we have the necessary API for retrieving the topology
-// information
-static Thread* sRunQueue[B_MAX_CPU_COUNT];
-static int32 sRunQueueSize[B_MAX_CPU_COUNT];
+// There is one queue per physical core, shared by all of its SMT siblings.
+// Within a queue there is a FIFO list per priority level and a bitmap of the
+// non-empty levels, so that finding the next thread to run is O(1).
+const int32 kPriorityLevels = B_REAL_TIME_PRIORITY + 1;
+const int32 kPriorityBitmapSize = (kPriorityLevels + 31) / 32;
+
+struct RunQueue {
+	void Init(int32 package, int32 core)
+	{
+		memset(this, 0, sizeof(RunQueue));
+		fPackage = package;
+		fCore = core;
+	}
+
+	inline int32 HighestPriority() const
+	{
+		return HighestPriorityBelow(kPriorityLevels);
+	}
+
+	int32 HighestPriorityBelow(int32 priority) const
+	{
+		// clear the bits of the given and all higher priorities in the
+		// first word we look at
+		int32 index = priority / 32;
+		uint32 mask = (1U << (priority % 32)) - 1;
+		if (index >= kPriorityBitmapSize) {
+			index = kPriorityBitmapSize - 1;
+			mask = ~(uint32)0;
+		}
+
+		for (; index >= 0; index--, mask = ~(uint32)0) {
+			uint32 bits = fBitmap[index] & mask;
+			if (bits != 0)
+				return index * 32 + _HighestBit(bits);
+		}
+
+		return -1;
+	}
+
+	inline Thread* Head(int32 priority) const
+	{
+		return fHeads[priority];
+	}
+
+	void Append(Thread* thread, int32 priority)
+	{
+		T(EnqueueThread(thread, fTails[priority], NULL));
+
+		thread->queue_next = NULL;
+		if (fTails[priority] != NULL)
+			fTails[priority]->queue_next = thread;
+		else {
+			fHeads[priority] = thread;
+			fBitmap[priority / 32] |= 1U << (priority % 32);
+		}
+		fTails[priority] = thread;
+		fCount++;
+	}
+
+	void Remove(Thread* thread, Thread* previous, int32 priority)
+	{
+		if (previous != NULL)
+			previous->queue_next = thread->queue_next;
+		else
+			fHeads[priority] = thread->queue_next;
+
+		if (fTails[priority] == thread)
+			fTails[priority] = previous;
+		if (fHeads[priority] == NULL)
+			fBitmap[priority / 32] &= ~(1U << (priority % 32));
+
+		thread->queue_next = NULL;
+		fCount--;
+	}
+
+	static inline int32 _HighestBit(uint32 value)
+	{
+		int32 bit = 0;
+		if ((value & 0xffff0000) != 0) {
+			value >>= 16;
+			bit += 16;
+		}
+		if ((value & 0xff00) != 0) {
+			value >>= 8;
+			bit += 8;
+		}
+		if ((value & 0xf0) != 0) {
+			value >>= 4;
+			bit += 4;
+		}
+		if ((value & 0xc) != 0) {
+			value >>= 2;
+			bit += 2;
+		}
+		if ((value & 0x2) != 0)
+			bit += 1;
+		return bit;
+	}
+
+	Thread*	fHeads[kPriorityLevels];
+	Thread*	fTails[kPriorityLevels];
+	uint32	fBitmap[kPriorityBitmapSize];
+	int32	fCount;
+	int32	fCPUCount;
+	int32	fPackage;
+	int32	fCore;
+};
+
+static RunQueue sRunQueues[B_MAX_CPU_COUNT];
+static int32 sRunQueueCount;
+static int32 sCPUToRunQueue[B_MAX_CPU_COUNT];
 static Thread* sIdleThreads;
 
 const int32 kMaxTrackingQuantums = 5;
@@ -63,6 +168,7 @@ struct scheduler_thread_data {
 		fQuantumAverage = 0;
 		fLastQuantumSlot = 0;
 		fLastQueue = -1;
+		fQueuePriority = -1;
 		memset(fLastThreadQuantums, 0, sizeof(fLastThreadQuantums));
 	}
 
@@ -86,6 +192,7 @@ struct scheduler_thread_data {
 	int32 fLastThreadQuantums[kMaxTrackingQuantums];
 	int16 fLastQuantumSlot;
 	int32 fLastQueue;
+	int32 fQueuePriority;
 };
 
 
@@ -105,20 +212,29 @@ _rand(void)
 static int
 dump_run_queue(int argc, char **argv)
 {
-	Thread *thread = NULL;
+	for (int32 i = 0; i < sRunQueueCount; i++) {
+		RunQueue& queue = sRunQueues[i];
+		kprintf("Run queue %" B_PRId32 " (package %" B_PRId32 ", core %"
+			B_PRId32 ", %" B_PRId32 " threads), cpus:", i, queue.fPackage,
+			queue.fCore, queue.fCount);
+		for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+			if (sCPUToRunQueue[cpu] == i)
+				kprintf(" %" B_PRId32, cpu);
+		}
+		kprintf("\n");
 
-	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
-		thread = sRunQueue[i];
-		kprintf("Run queue for cpu %" B_PRId32 " (%" B_PRId32 " threads)\n", i,
-			sRunQueueSize[i]);
-		if (sRunQueueSize[i] > 0) {
-			kprintf("thread      id      priority  avg. quantum  name\n");
-			while (thread) {
+		if (queue.fCount == 0)
+			continue;
+
+		kprintf("thread      id      priority  avg. quantum  name\n");
+		for (int32 priority = queue.HighestPriority(); priority >= 0;
+				priority = queue.HighestPriorityBelow(priority)) {
+			for (Thread* thread = queue.Head(priority); thread != NULL;
+					thread = thread->queue_next) {
 				kprintf("%p  %-7" B_PRId32 " %-8" B_PRId32 "  %-12" B_PRId32
 					"  %s\n", thread, thread->id, thread->priority,
 					thread->scheduler_data->GetAverageQuantumUsage(),
 					thread->name);
-				thread = thread->queue_next;
 			}
 		}
 	}
@@ -126,17 +242,97 @@ dump_run_queue(int argc, char **argv)
 }
 
 
-/*!	Returns the most idle CPU based on the active time counters.
+/*!	Returns whether the given thread may be run on the given CPU. Only pinned
+	threads are restricted, they must stay on the CPU they ran on last.
+*/
+static inline bool
+affine_can_run_on(Thread* thread, int32 cpu)
+{
+	return thread->pinned_to_cpu <= 0 || thread->previous_cpu == NULL
+		|| thread->previous_cpu->cpu_num == cpu;
+}
+
+
+/*!	Returns the run queue with the fewest threads per CPU.
 	Note: thread lock must be held when entering this function
 */
 static int32
-affine_get_most_idle_cpu()
+affine_get_most_idle_queue()
+{
+	int32 targetQueue = -1;
+	for (int32 i = 0; i < sRunQueueCount; i++) {
+		RunQueue& queue = sRunQueues[i];
+		if (queue.fCPUCount == 0)
+			continue;
+		if (targetQueue < 0 || queue.fCount * sRunQueues[targetQueue].fCPUCount
+				< sRunQueues[targetQueue].fCount * queue.fCPUCount) {
+			targetQueue = i;
+		}
+	}
+
+	// before any CPU has started, the boot CPU's queue is used
+	return targetQueue >= 0 ? targetQueue : 0;
+}
+
+
+/*!	Returns the CPU serving the given run queue that runs the least important
+	thread, or -1, if none of them would be preempted by \a priority.
+*/
+static int32
+affine_get_cpu_to_preempt(int32 queue, int32 priority)
+{
+	int32 targetCPU = -1;
+	int32 lowestPriority = priority;
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		if (sCPUToRunQueue[i] != queue || gCPU[i].disabled)
+			continue;
+
+		int32 runningPriority = gCPU[i].running_thread->priority;
+		if (runningPriority < lowestPriority) {
+			targetCPU = i;
+			lowestPriority = runningPriority;
+		}
+	}
+
+	return targetCPU;
+}
+
+
+/*!	Returns whether all CPUs serving the given run queue are running a thread,
+	so that none of them will pick up a waiting thread soon.
+*/
+static bool
+affine_is_queue_busy(int32 queue)
+{
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		if (sCPUToRunQueue[i] == queue && !gCPU[i].disabled
+			&& thread_is_idle_thread(gCPU[i].running_thread)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Looks for an idle CPU outside of the given run queue that could steal a
+	thread from it, preferring CPUs in the same package.
+*/
+static int32
+affine_get_idle_cpu_for_stealing(int32 queue)
 {
 	int32 targetCPU = -1;
 	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
-		if (gCPU[i].disabled)
+		int32 cpuQueue = sCPUToRunQueue[i];
+		if (cpuQueue < 0 || cpuQueue == queue || gCPU[i].disabled
+			|| !thread_is_idle_thread(gCPU[i].running_thread)
+			|| sRunQueues[cpuQueue].fCount > 0) {
 			continue;
-		if (targetCPU < 0 || sRunQueueSize[i] < sRunQueueSize[targetCPU])
+		}
+
+		if (sRunQueues[cpuQueue].fPackage == sRunQueues[queue].fPackage)
+			return i;
+		if (targetCPU < 0)
 			targetCPU = i;
 	}
 
@@ -144,45 +340,50 @@ affine_get_most_idle_cpu()
 }
 
 
+static inline void
+affine_invoke_scheduler(int32 cpu)
+{
+	if (cpu == smp_get_current_cpu()) {
+		gCPU[cpu].invoke_scheduler = true;
+		gCPU[cpu].invoke_scheduler_if_idle = false;
+	} else {
+		smp_send_ici(cpu, SMP_MSG_RESCHEDULE, 0, 0, 0, NULL,
+			SMP_MSG_FLAG_ASYNC);
+	}
+}
+
+
 /*!	Enqueues the thread into the run queue.
 	Note: thread lock must be held when entering this function
 */
 static void
 affine_enqueue_in_run_queue(Thread *thread)
 {
-	int32 targetCPU = -1;
-	if (thread->pinned_to_cpu > 0)
-		targetCPU = thread->previous_cpu->cpu_num;
-	else if (thread->previous_cpu == NULL || thread->previous_cpu->disabled)
-		targetCPU = affine_get_most_idle_cpu();
-	else
-		targetCPU = thread->previous_cpu->cpu_num;
+	int32 targetQueue = -1;
+	if (thread->previous_cpu != NULL
+		&& (thread->pinned_to_cpu > 0 || !thread->previous_cpu->disabled)) {
+		targetQueue = sCPUToRunQueue[thread->previous_cpu->cpu_num];
+	}
+	if (targetQueue < 0) {
+		// the previous CPU may not have been started yet
+		targetQueue = affine_get_most_idle_queue();
+	}
 
 	thread->state = thread->next_state = B_THREAD_READY;
 
+	int32 priority = thread->next_priority;
 	if (thread->priority == B_IDLE_PRIORITY) {
 		thread->queue_next = sIdleThreads;
 		sIdleThreads = thread;
 	} else {
-		Thread *curr, *prev;
-		for (curr = sRunQueue[targetCPU], prev = NULL; curr
-			&& curr->priority >= thread->next_priority;
-			curr = curr->queue_next) {
-			if (prev)
-				prev = prev->queue_next;
-			else
-				prev = sRunQueue[targetCPU];
-		}
-
-		T(EnqueueThread(thread, prev, curr));
-		sRunQueueSize[targetCPU]++;
-		thread->queue_next = curr;
-		if (prev)
-			prev->queue_next = thread;
-		else
-			sRunQueue[targetCPU] = thread;
-
-		thread->scheduler_data->fLastQueue = targetCPU;
+		if (priority < 0)
+			priority = 0;
+		else if (priority >= kPriorityLevels)
+			priority = kPriorityLevels - 1;
+
+		sRunQueues[targetQueue].Append(thread, priority);
+		thread->scheduler_data->fLastQueue = targetQueue;
+		thread->scheduler_data->fQueuePriority = priority;
 	}
 
 	thread->next_priority = thread->priority;
@@ -191,82 +392,172 @@ affine_enqueue_in_run_queue(Thread *thread)
 	NotifySchedulerListeners(&SchedulerListener::ThreadEnqueuedInRunQueue,
 		thread);
 
-	if (thread->priority > gCPU[targetCPU].running_thread->priority) {
-		if (targetCPU == smp_get_current_cpu()) {
-			gCPU[targetCPU].invoke_scheduler = true;
-			gCPU[targetCPU].invoke_scheduler_if_idle = false;
-		} else {
-			smp_send_ici(targetCPU, SMP_MSG_RESCHEDULE, 0, 0, 0, NULL,
-				SMP_MSG_FLAG_ASYNC);
-		}
+	if (thread->priority == B_IDLE_PRIORITY)
+		return;
+
+	// preempt a CPU serving the queue, if the new thread is more important
+	// than what it currently runs
+	int32 targetCPU;
+	if (thread->pinned_to_cpu > 0 && thread->previous_cpu != NULL) {
+		targetCPU = thread->previous_cpu->cpu_num;
+		if (thread->priority <= gCPU[targetCPU].running_thread->priority)
+			targetCPU = -1;
+	} else
+		targetCPU = affine_get_cpu_to_preempt(targetQueue, thread->priority);
+
+	if (targetCPU >= 0) {
+		affine_invoke_scheduler(targetCPU);
+		return;
+	}
+
+	// All CPUs of the queue are busy, even if this is the only thread waiting
+	// in it. If another core idles, let it come and steal the thread.
+	if (thread->pinned_to_cpu <= 0) {
+		targetCPU = affine_get_idle_cpu_for_stealing(targetQueue);
+		if (targetCPU >= 0)
+			affine_invoke_scheduler(targetCPU);
 	}
 }
 
 
-/*!	Dequeues the thread after the given \a prevThread from the run queue.
+/*!	Removes the given thread from its run queue.
 */
-static inline Thread *
-dequeue_from_run_queue(Thread *prevThread, int32 currentCPU)
+static void
+dequeue_from_run_queue(Thread* thread)
 {
-	Thread *resultThread = NULL;
-	if (prevThread != NULL) {
-		resultThread = prevThread->queue_next;
-		prevThread->queue_next = resultThread->queue_next;
-	} else {
-		resultThread = sRunQueue[currentCPU];
-		sRunQueue[currentCPU] = resultThread->queue_next;
+	scheduler_thread_data* data = thread->scheduler_data;
+	RunQueue& queue = sRunQueues[data->fLastQueue];
+
+	Thread* previous = NULL;
+	for (Thread* item = queue.Head(data->fQueuePriority); item != thread;
+			item = item->queue_next) {
+		ASSERT(item != NULL);
+		previous = item;
 	}
-	sRunQueueSize[currentCPU]--;
-	resultThread->scheduler_data->fLastQueue = -1;
 
-	return resultThread;
+	queue.Remove(thread, previous, data->fQueuePriority);
+	data->fLastQueue = -1;
+	data->fQueuePriority = -1;
 }
 
 
-/*!	Looks for a possible thread to grab/run from another CPU.
+/*!	Returns the first thread of the given priority level that may run on the
+	given CPU, or \c NULL, if there is none.
+*/
+static Thread*
+first_runnable_thread(RunQueue& queue, int32 priority, int32 cpu)
+{
+	for (Thread* thread = queue.Head(priority); thread != NULL;
+			thread = thread->queue_next) {
+		if (affine_can_run_on(thread, cpu))
+			return thread;
+	}
+
+	return NULL;
+}
+
+
+/*!	Picks the next thread to run on \a cpu from the given queue, or returns
+	\c NULL, if there is no thread for it.
+	Real time threads are always picked first; otherwise lower priorities are
+	sometimes preferred, twice as probable per priority level, to avoid
+	starving them.
+*/
+static Thread*
+select_thread(RunQueue& queue, int32 cpu)
+{
+	Thread* nextThread = NULL;
+	int32 priority = queue.HighestPriority();
+	for (; priority >= 0; priority = queue.HighestPriorityBelow(priority)) {
+		nextThread = first_runnable_thread(queue, priority, cpu);
+		if (nextThread != NULL)
+			break;
+	}
+
+	while (nextThread != NULL && priority < B_FIRST_REAL_TIME_PRIORITY) {
+		// find next thread with lower priority
+		Thread* lowerThread = NULL;
+		int32 lowerPriority = queue.HighestPriorityBelow(priority);
+		for (; lowerPriority >= 0;
+				lowerPriority = queue.HighestPriorityBelow(lowerPriority)) {
+			lowerThread = first_runnable_thread(queue, lowerPriority, cpu);
+			if (lowerThread != NULL)
+				break;
+		}
+		if (lowerThread == NULL)
+			break;
+
+		int32 priorityDiff = priority - lowerPriority;
+		if (priorityDiff > 15)
+			break;
+
+		// skip normal threads sometimes
+		if ((_rand() >> (15 - priorityDiff)) != 0)
+			break;
+
+		nextThread = lowerThread;
+		priority = lowerPriority;
+	}
+
+	return nextThread;
+}
+
+
+/*!	Looks for a possible thread to grab/run from another core.
+	Queues of cores in the same package are considered first, since the
+	stolen thread will likely still find its data in the shared caches there.
 	Note: thread lock must be held when entering this function
 */
 static Thread *
-steal_thread_from_other_cpus(int32 currentCPU)
+steal_thread_from_other_queues(int32 currentCPU)
 {
-	// look through the active CPUs - find the one
-	// that has a) threads available to steal, and
-	// b) out of those, the one that's the most CPU-bound
-	// TODO: make this more intelligent along with enqueue
-	// - we need to try and maintain a reasonable balance
-	// in run queue sizes across CPUs, and also try to maintain
-	// an even distribution of cpu bound / interactive threads
-	int32 targetCPU = -1;
-	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
-		// skip CPUs that have either no or only one thread
-		if (i == currentCPU || sRunQueueSize[i] < 2)
+	int32 currentQueue = sCPUToRunQueue[currentCPU];
+	if (currentQueue < 0)
+		return NULL;
+
+	int32 package = sRunQueues[currentQueue].fPackage;
+
+	int32 targetQueue = -1;
+	for (int32 i = 0; i < sRunQueueCount; i++) {
+		RunQueue& queue = sRunQueues[i];
+		// skip queues that have no thread, or only one that one of their
+		// own CPUs is about to pick up
+		if (i == currentQueue || queue.fCount == 0
+			|| (queue.fCount == 1 && !affine_is_queue_busy(i))) {
 			continue;
+		}
 
-		// out of the CPUs with threads available to steal,
-		// pick whichever one is generally the most CPU bound.
-		if (targetCPU < 0
-			|| sRunQueue[i]->priority > sRunQueue[targetCPU]->priority
-			|| (sRunQueue[i]->priority == sRunQueue[targetCPU]->priority
-				&& sRunQueueSize[i] > sRunQueueSize[targetCPU]))
-			targetCPU = i;
+		if (targetQueue < 0) {
+			targetQueue = i;
+			continue;
+		}
+
+		RunQueue& target = sRunQueues[targetQueue];
+		bool samePackage = queue.fPackage == package;
+		bool targetSamePackage = target.fPackage == package;
+		if ((samePackage && !targetSamePackage)
+			|| (samePackage == targetSamePackage
+				&& (queue.HighestPriority() > target.HighestPriority()
+					|| (queue.HighestPriority() == target.HighestPriority()
+						&& queue.fCount > target.fCount)))) {
+			targetQueue = i;
+		}
 	}
 
-	if (targetCPU < 0)
+	if (targetQueue < 0)
 		return NULL;
 
-	Thread* nextThread = sRunQueue[targetCPU];
-	Thread* prevThread = NULL;
-
-	while (nextThread != NULL) {
-		// grab the highest priority non-pinned thread
-		// out of this CPU's queue, dequeue and return it
-		if (nextThread->pinned_to_cpu <= 0) {
-			dequeue_from_run_queue(prevThread, targetCPU);
-			return nextThread;
+	// grab the highest priority non-pinned thread out of the queue
+	RunQueue& queue = sRunQueues[targetQueue];
+	for (int32 priority = queue.HighestPriority(); priority >= 0;
+			priority = queue.HighestPriorityBelow(priority)) {
+		for (Thread* thread = queue.Head(priority); thread != NULL;
+				thread = thread->queue_next) {
+			if (thread->pinned_to_cpu <= 0) {
+				dequeue_from_run_queue(thread);
+				return thread;
+			}
 		}
-
-		prevThread = nextThread;
-		nextThread = nextThread->queue_next;
 	}
 
 	return NULL;
@@ -279,8 +570,6 @@ steal_thread_from_other_cpus(int32 currentCPU)
 static void
 affine_set_thread_priority(Thread *thread, int32 priority)
 {
-	int32 targetCPU = -1;
-
 	if (priority == thread->priority)
 		return;
 
@@ -298,22 +587,8 @@ affine_set_thread_priority(Thread *thread, int32 priority)
 	NotifySchedulerListeners(&SchedulerListener::ThreadRemovedFromRunQueue,
 		thread);
 
-	// search run queues for the thread
-	Thread *item = NULL, *prev = NULL;
-	targetCPU = thread->scheduler_data->fLastQueue;
-
-	for (item = sRunQueue[targetCPU], prev = NULL; item && item != thread;
-			item = item->queue_next) {
-		if (prev)
-			prev = prev->queue_next;
-		else
-			prev = item;
-	}
-
-	ASSERT(item == thread);
-
 	// remove the thread
-	thread = dequeue_from_run_queue(prev, targetCPU);
+	dequeue_from_run_queue(thread);
 
 	// set priority and re-insert
 	thread->priority = thread->next_priority = priority;
@@ -371,7 +646,7 @@ affine_reschedule(void)
 		}
 	}
 
-	Thread *nextThread, *prevThread;
+	Thread *nextThread;
 
 	TRACE(("reschedule(): cpu %ld, cur_thread = %ld\n", currentCPU, oldThread->id));
 
@@ -392,57 +667,25 @@ affine_reschedule(void)
 			break;
 	}
 
-	nextThread = sRunQueue[currentCPU];
-	prevThread = NULL;
-
-	if (sRunQueue[currentCPU] != NULL) {
-		TRACE(("dequeueing next thread from cpu %ld\n", currentCPU));
-		// select next thread from the run queue
-		while (nextThread->queue_next) {
-			// always extract real time threads
-			if (nextThread->priority >= B_FIRST_REAL_TIME_PRIORITY)
-				break;
-
-			// find next thread with lower priority
-			Thread *lowerNextThread = nextThread->queue_next;
-			Thread *lowerPrevThread = nextThread;
-			int32 priority = nextThread->priority;
-
-			while (lowerNextThread != NULL
-				&& priority == lowerNextThread->priority) {
-				lowerPrevThread = lowerNextThread;
-				lowerNextThread = lowerNextThread->queue_next;
-			}
-			if (lowerNextThread == NULL)
-				break;
-
-			int32 priorityDiff = priority - lowerNextThread->priority;
-			if (priorityDiff > 15)
-				break;
-
-			// skip normal threads sometimes
-			// (twice as probable per priority level)
-			if ((_rand() >> (15 - priorityDiff)) != 0)
-				break;
-
-			nextThread = lowerNextThread;
-			prevThread = lowerPrevThread;
-		}
+	int32 currentQueue = sCPUToRunQueue[currentCPU];
+	nextThread = NULL;
+	if (currentQueue >= 0)
+		nextThread = select_thread(sRunQueues[currentQueue], currentCPU);
 
+	if (nextThread != NULL) {
 		TRACE(("dequeuing thread %ld from cpu %ld\n", nextThread->id,
 			currentCPU));
 		// extract selected thread from the run queue
-		dequeue_from_run_queue(prevThread, currentCPU);
+		dequeue_from_run_queue(nextThread);
 	} else {
 		if (!gCPU[currentCPU].disabled) {
-			TRACE(("CPU %ld stealing thread from other CPUs\n", currentCPU));
-			nextThread = steal_thread_from_other_cpus(currentCPU);
-		} else
-			nextThread = NULL;
+			TRACE(("CPU %ld stealing thread from other cores\n", currentCPU));
+			nextThread = steal_thread_from_other_queues(currentCPU);
+		}
 
 		if (nextThread == NULL) {
 			TRACE(("No threads to steal, grabbing from idle pool\n"));
-			// no other CPU had anything for us to take,
+			// no other core had anything for us to take,
 			// grab one from the kernel's idle pool
 			nextThread = sIdleThreads;
 			if (nextThread)
@@ -549,6 +792,26 @@ affine_start(void)
 {
 	SpinLocker schedulerLocker(gSchedulerLock);
 
+	// Add the CPU to the run queue of its core, creating the queue, if this
+	// is the first of the core's SMT siblings to start.
+	int32 currentCPU = smp_get_current_cpu();
+	int32 package = gCPU[currentCPU].topology_id[CPU_TOPOLOGY_PACKAGE];
+	int32 core = gCPU[currentCPU].topology_id[CPU_TOPOLOGY_CORE];
+
+	int32 queue = 0;
+	for (; queue < sRunQueueCount; queue++) {
+		if (sRunQueues[queue].fPackage == package
+			&& sRunQueues[queue].fCore == core) {
+			break;
+		}
+	}
+
+	if (queue == sRunQueueCount)
+		sRunQueues[sRunQueueCount++].Init(package, core);
+
+	sRunQueues[queue].fCPUCount++;
+	sCPUToRunQueue[currentCPU] = queue;
+
 	affine_reschedule();
 }
 
@@ -572,8 +835,17 @@ void
 scheduler_affine_init()
 {
 	gScheduler = &kAffineOps;
-	memset(sRunQueue, 0, sizeof(sRunQueue));
-	memset(sRunQueueSize, 0, sizeof(sRunQueueSize));
+
+	// The run queues are created when the CPUs start, since only then their
+	// topology is known. Until then everything goes to the boot CPU's queue.
+	sRunQueues[0].Init(gCPU[0].topology_id[CPU_TOPOLOGY_PACKAGE],
+		gCPU[0].topology_id[CPU_TOPOLOGY_CORE]);
+	sRunQueues[0].fCPUCount = 0;
+	sRunQueueCount = 1;
+	for (int32 i = 0; i < B_MAX_CPU_COUNT; i++)
+		sCPUToRunQueue[i] = -1;
+	sCPUToRunQueue[0] = 0;
+
 	add_debugger_command_etc("run_queue", &dump_run_queue,
 		"List threads in run queue", "\nLists threads in run queue", 0);
 }
@@ -22,13 +22,17 @@ RANGE_MARKER_FUNCTION_BEGIN(SlabObjectCache)
 
 
 static void
-object_cache_return_object_wrapper(object_depot* depot, void* cookie,
-	void* object, uint32 flags)
+object_cache_return_objects_wrapper(object_depot* depot, void* cookie,
+	void** objects, uint32 count, uint32 flags)
 {
 	ObjectCache* cache = (ObjectCache*)cookie;
 
+	// return all objects of a magazine with a single lock acquisition
 	MutexLocker _(cache->lock);
-	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
+	for (uint32 i = 0; i < count; i++) {
+		cache->ReturnObjectToSlab(cache->ObjectSlab(objects[i]), objects[i],
+			flags);
+	}
 }
 
 
@@ -69,6 +73,8 @@ ObjectCache::Init(const char* name, size_t objectSize, size_t alignment,
 	total_objects = 0;
 	used_count = 0;
 	empty_count = 0;
+	alloc_count = 0;
+	free_count = 0;
 	pressure = 0;
 	min_object_reserve = 0;
 
@@ -100,7 +106,7 @@ ObjectCache::Init(const char* name, size_t objectSize, size_t alignment,
 			maxMagazineCount = magazineCapacity / 2;
 
 		status_t status = object_depot_init(&depot, magazineCapacity,
-			maxMagazineCount, flags, this, object_cache_return_object_wrapper);
+			maxMagazineCount, flags, this, object_cache_return_objects_wrapper);
 		if (status != B_OK) {
 			mutex_destroy(&lock);
 			return status;
@@ -224,6 +230,7 @@ ObjectCache::ReturnObjectToSlab(slab* source, void* object, uint32 flags)
 	_push(source->free, link);
 	source->count++;
 	used_count--;
+	free_count++;
 
 	ADD_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, source, &link->next, sizeof(void*));
 
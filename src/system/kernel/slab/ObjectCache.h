@@ -56,6 +56,8 @@ struct ObjectCache : DoublyLinkedListLinkImpl<ObjectCache> {
 			size_t				total_objects;		// total number of objects
 			size_t				used_count;			// used objects
 			size_t				empty_count;		// empty slabs
+			int64				alloc_count;		// allocated from slabs
+			int64				free_count;			// returned to slabs
 			size_t				pressure;
 			size_t				min_object_reserve;
 									// minimum number of free objects
@@ -14,6 +14,7 @@
 #include <int.h>
 #include <slab/Slab.h>
 #include <smp.h>
+#include <util/atomic.h>
 #include <util/AutoLock.h>
 
 #include "slab_debug.h"
@@ -42,7 +43,19 @@ public:
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
-};
+	int64			obtained;
+	int64			stored;
+} __attribute__((aligned(64)));
+	// Each CPU gets its own cache line, since the counters are written on
+	// every operation.
+
+
+static const int32 kContentionThreshold = 32;
+	// number of contended depot list operations after which the magazine
+	// capacity is increased
+static const size_t kMaxMagazineCapacity = 256;
+static const size_t kMagazineCapacityGrowFactor = 4;
+	// a depot's magazines grow up to this factor of their initial capacity
 
 
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
@@ -102,13 +115,13 @@ DepotMagazine::ContainsObject(void* object) const
 static DepotMagazine*
 alloc_magazine(object_depot* depot, uint32 flags)
 {
+	size_t capacity = depot->magazine_capacity;
 	DepotMagazine* magazine = (DepotMagazine*)slab_internal_alloc(
-		sizeof(DepotMagazine) + depot->magazine_capacity * sizeof(void*),
-		flags);
+		sizeof(DepotMagazine) + capacity * sizeof(void*), flags);
 	if (magazine) {
 		magazine->next = NULL;
 		magazine->current_round = 0;
-		magazine->round_count = depot->magazine_capacity;
+		magazine->round_count = capacity;
 	}
 
 	return magazine;
@@ -125,68 +138,144 @@ free_magazine(DepotMagazine* magazine, uint32 flags)
 static void
 empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
 {
-	for (uint16 i = 0; i < magazine->current_round; i++)
-		depot->return_object(depot, depot->cookie, magazine->rounds[i], flags);
+	if (magazine->current_round > 0) {
+		depot->return_objects(depot, depot->cookie, magazine->rounds,
+			magazine->current_round, flags);
+	}
 	free_magazine(magazine, flags);
 }
 
 
+/*!	Called whenever two CPUs got in each other's way when accessing the depot's
+	magazine lists. Following Bonwick, the magazines are made larger when that
+	happens too often, so that the CPUs need to go to the depot less often.
+	Magazines that are already in use keep their size; only newly allocated
+	ones are bigger.
+*/
+static void
+depot_contended(object_depot* depot)
+{
+	if (atomic_add(&depot->contention, 1) % kContentionThreshold
+			!= kContentionThreshold - 1) {
+		return;
+	}
+
+	size_t capacity = depot->magazine_capacity;
+	if (capacity >= depot->max_magazine_capacity)
+		return;
+
+	capacity = std::min(capacity + (capacity + 1) / 2,
+		depot->max_magazine_capacity);
+	depot->magazine_capacity = capacity;
+}
+
+
+/*!	Pushes the chain of magazines from \a first to \a last onto \a list.
+	This is safe without any lock; pushing doesn't suffer from the ABA problem.
+*/
+static void
+push_magazines(object_depot* depot, DepotMagazine*& list, DepotMagazine* first,
+	DepotMagazine* last)
+{
+	while (true) {
+		DepotMagazine* head = atomic_pointer_get(&list);
+		last->next = head;
+		if (atomic_pointer_test_and_set(&list, first, head) == head)
+			return;
+
+		depot_contended(depot);
+	}
+}
+
+
+static inline void
+push_magazine(object_depot* depot, DepotMagazine*& list, vint32& count,
+	DepotMagazine* magazine)
+{
+	push_magazines(depot, list, magazine, magazine);
+	atomic_add(&count, 1);
+}
+
+
+/*!	Pops a magazine off \a list.
+	Pushing is lock-free, but popping a single element with a compare-and-swap
+	alone would be prone to the ABA problem, since the magazines are
+	constantly recycled. Therefore only one CPU at a time may pop magazines:
+	as long as nobody else can take the head off the list, its \c next pointer
+	cannot change, and the compare-and-swap only has to deal with concurrent
+	pushers.
+	Interrupts must be disabled.
+*/
+static DepotMagazine*
+pop_magazine(object_depot* depot, DepotMagazine*& list, vint32& count)
+{
+	if (atomic_pointer_get(&list) == NULL)
+		return NULL;
+
+	SpinLocker locker(depot->pop_lock);
+
+	while (true) {
+		DepotMagazine* magazine = atomic_pointer_get(&list);
+		if (magazine == NULL)
+			return NULL;
+
+		if (atomic_pointer_test_and_set(&list, magazine->next, magazine)
+				== magazine) {
+			atomic_add(&count, -1);
+			magazine->next = NULL;
+			return magazine;
+		}
+
+		depot_contended(depot);
+	}
+}
+
+
 static bool
 exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
-
-	if (depot->full == NULL)
+	DepotMagazine* full = pop_magazine(depot, depot->full, depot->full_count);
+	if (full == NULL)
 		return false;
 
-	depot->full_count--;
-	depot->empty_count++;
-
-	_push(depot->empty, magazine);
-	magazine = _pop(depot->full);
+	push_magazine(depot, depot->empty, depot->empty_count, magazine);
+	magazine = full;
 	return true;
 }
 
 
 static bool
 exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
-	DepotMagazine*& freeMagazine)
+	DepotMagazine*& freeMagazines)
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
-
-	if (depot->empty == NULL)
+	DepotMagazine* empty = pop_magazine(depot, depot->empty,
+		depot->empty_count);
+	if (empty == NULL)
 		return false;
 
-	depot->empty_count--;
+	if (empty->round_count < depot->magazine_capacity) {
+		// The magazine stems from before the capacity was increased -- get
+		// rid of it, the caller will allocate a bigger one.
+		_push(freeMagazines, empty);
+		return false;
+	}
 
 	if (magazine != NULL) {
-		if (depot->full_count < depot->max_count) {
-			_push(depot->full, magazine);
-			depot->full_count++;
-			freeMagazine = NULL;
-		} else
-			freeMagazine = magazine;
+		if ((size_t)depot->full_count < depot->max_count)
+			push_magazine(depot, depot->full, depot->full_count, magazine);
+		else
+			_push(freeMagazines, magazine);
 	}
 
-	magazine = _pop(depot->empty);
+	magazine = empty;
 	return true;
 }
 
 
-static void
-push_empty_magazine(object_depot* depot, DepotMagazine* magazine)
-{
-	SpinLocker _(depot->inner_lock);
-
-	_push(depot->empty, magazine);
-	depot->empty_count++;
-}
-
-
 static inline depot_cpu_store*
 object_depot_cpu(object_depot* depot)
 {
@@ -199,17 +288,21 @@ object_depot_cpu(object_depot* depot)
 
 status_t
 object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
-	uint32 flags, void* cookie, void (*return_object)(object_depot* depot,
-		void* cookie, void* object, uint32 flags))
+	uint32 flags, void* cookie, void (*return_objects)(object_depot* depot,
+		void* cookie, void** objects, uint32 count, uint32 flags))
 {
 	depot->full = NULL;
 	depot->empty = NULL;
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
 	depot->magazine_capacity = capacity;
+	depot->max_magazine_capacity = std::max(capacity,
+		std::min(capacity * kMagazineCapacityGrowFactor, kMaxMagazineCapacity));
+	depot->contention = 0;
+	depot->store_misses = 0;
 
 	rw_lock_init(&depot->outer_lock, "object depot");
-	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
+	B_INITIALIZE_SPINLOCK(&depot->pop_lock);
 
 	int cpuCount = smp_get_num_cpus();
 	depot->stores = (depot_cpu_store*)slab_internal_alloc(
@@ -222,10 +315,12 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	for (int i = 0; i < cpuCount; i++) {
 		depot->stores[i].loaded = NULL;
 		depot->stores[i].previous = NULL;
+		depot->stores[i].obtained = 0;
+		depot->stores[i].stored = 0;
 	}
 
 	depot->cookie = cookie;
-	depot->return_object = return_object;
+	depot->return_objects = return_objects;
 
 	return B_OK;
 }
@@ -261,8 +356,10 @@ object_depot_obtain(object_depot* depot)
 		return NULL;
 
 	while (true) {
-		if (!store->loaded->IsEmpty())
+		if (!store->loaded->IsEmpty()) {
+			store->obtained++;
 			return store->loaded->Pop();
+		}
 
 		if (store->previous
 			&& (store->previous->IsFull()
@@ -288,43 +385,47 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// we return the object directly to the slab.
 
 	while (true) {
-		if (store->loaded != NULL && store->loaded->Push(object))
+		if (store->loaded != NULL && store->loaded->Push(object)) {
+			store->stored++;
 			return;
+		}
 
-		DepotMagazine* freeMagazine = NULL;
-		if ((store->previous != NULL && store->previous->IsEmpty())
-			|| exchange_with_empty(depot, store->previous, freeMagazine)) {
+		DepotMagazine* freeMagazines = NULL;
+		bool exchanged = (store->previous != NULL && store->previous->IsEmpty())
+			|| exchange_with_empty(depot, store->previous, freeMagazines);
+		if (exchanged)
 			std::swap(store->loaded, store->previous);
 
-			if (freeMagazine != NULL) {
-				// Free the magazine that didn't have space in the list
-				interruptsLocker.Unlock();
-				readLocker.Unlock();
+		if (exchanged && freeMagazines == NULL)
+			continue;
 
-				empty_magazine(depot, freeMagazine, flags);
+		interruptsLocker.Unlock();
+		readLocker.Unlock();
 
-				readLocker.Lock();
-				interruptsLocker.Lock();
+		// Free the magazines that didn't have space in the list or are too
+		// small
+		while (freeMagazines != NULL)
+			empty_magazine(depot, _pop(freeMagazines), flags);
 
-				store = object_depot_cpu(depot);
-			}
-		} else {
+		if (!exchanged) {
 			// allocate a new empty magazine
-			interruptsLocker.Unlock();
-			readLocker.Unlock();
-
 			DepotMagazine* magazine = alloc_magazine(depot, flags);
 			if (magazine == NULL) {
-				depot->return_object(depot, depot->cookie, object, flags);
+				atomic_add64(&depot->store_misses, 1);
+				depot->return_objects(depot, depot->cookie, &object, 1, flags);
 				return;
 			}
 
 			readLocker.Lock();
 			interruptsLocker.Lock();
 
-			push_empty_magazine(depot, magazine);
-			store = object_depot_cpu(depot);
+			push_magazine(depot, depot->empty, depot->empty_count, magazine);
+		} else {
+			readLocker.Lock();
+			interruptsLocker.Lock();
 		}
+
+		store = object_depot_cpu(depot);
 	}
 }
 
@@ -355,11 +456,13 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 
 	// detach the depot's full and empty magazines
 
-	DepotMagazine* fullMagazines = depot->full;
-	depot->full = NULL;
+	DepotMagazine* fullMagazines = atomic_pointer_set(&depot->full,
+		(DepotMagazine*)NULL);
+	depot->full_count = 0;
 
-	DepotMagazine* emptyMagazines = depot->empty;
-	depot->empty = NULL;
+	DepotMagazine* emptyMagazines = atomic_pointer_set(&depot->empty,
+		(DepotMagazine*)NULL);
+	depot->empty_count = 0;
 
 	writeLocker.Unlock();
 
@@ -410,16 +513,46 @@ object_depot_contains_object(object_depot* depot, void* object)
 #endif // PARANOID_KERNEL_FREE
 
 
+/*!	Returns the number of objects that were handed out from and put into the
+	magazines, and the number of objects that were freed directly, since there
+	was no magazine to store them in.
+	The per-CPU counters are read without any locking, so the values are only
+	approximate while the depot is in use.
+*/
+void
+object_depot_get_stats(object_depot* depot, int64* _obtained, int64* _stored,
+	int64* _storeMisses)
+{
+	int64 obtained = 0;
+	int64 stored = 0;
+
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		obtained += depot->stores[i].obtained;
+		stored += depot->stores[i].stored;
+	}
+
+	*_obtained = obtained;
+	*_stored = stored;
+	*_storeMisses = depot->store_misses;
+}
+
+
 // #pragma mark - private kernel API
 
 
 void
 dump_object_depot(object_depot* depot)
 {
-	kprintf("  full:     %p, count %lu\n", depot->full, depot->full_count);
-	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
-	kprintf("  max full: %lu\n", depot->max_count);
-	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  full:       %p, count %" B_PRId32 "\n", depot->full,
+		depot->full_count);
+	kprintf("  empty:      %p, count %" B_PRId32 "\n", depot->empty,
+		depot->empty_count);
+	kprintf("  max full:   %lu\n", depot->max_count);
+	kprintf("  capacity:   %lu (max %lu)\n", depot->magazine_capacity,
+		depot->max_magazine_capacity);
+	kprintf("  contention: %" B_PRId32 "\n", depot->contention);
+	kprintf("  store misses: %" B_PRId64 "\n", depot->store_misses);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
@@ -427,6 +560,8 @@ dump_object_depot(object_depot* depot)
 	for (int i = 0; i < cpuCount; i++) {
 		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
 		kprintf("      previous: %p\n", depot->stores[i].previous);
+		kprintf("      obtained: %" B_PRId64 ", stored: %" B_PRId64 "\n",
+			depot->stores[i].obtained, depot->stores[i].stored);
 	}
 }
 
@@ -18,9 +18,11 @@
 
 #include <condition_variable.h>
 #include <elf.h>
+#include <generic_syscall.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
 #include <slab/ObjectDepot.h>
+#include <slab_statistics.h>
 #include <smp.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -295,6 +297,8 @@ dump_cache_info(int argc, char* argv[])
 	kprintf("total_objects:     %lu\n", cache->total_objects);
 	kprintf("used_count:        %lu\n", cache->used_count);
 	kprintf("empty_count:       %lu\n", cache->empty_count);
+	kprintf("alloc_count:       %" B_PRId64 "\n", cache->alloc_count);
+	kprintf("free_count:        %" B_PRId64 "\n", cache->free_count);
 	kprintf("pressure:          %lu\n", cache->pressure);
 	kprintf("slab_size:         %lu\n", cache->slab_size);
 	kprintf("usage:             %lu\n", cache->usage);
@@ -1255,6 +1259,7 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 	object_link* link = _pop(source->free);
 	source->count--;
 	cache->used_count++;
+	cache->alloc_count++;
 
 	if (cache->total_objects - cache->used_count < cache->min_object_reserve)
 		increase_object_reserve(cache);
@@ -1340,6 +1345,101 @@ object_cache_get_usage(object_cache* cache, size_t* _allocatedMemory)
 }
 
 
+static void
+get_object_cache_statistics(ObjectCache* cache,
+	slab_cache_statistics& statistics)
+{
+	strlcpy(statistics.name, cache->name, sizeof(statistics.name));
+	statistics.object_size = cache->object_size;
+	statistics.usage = cache->usage;
+	statistics.total_objects = cache->total_objects;
+	statistics.used_objects = cache->used_count;
+	statistics.flags = cache->flags;
+
+	if ((cache->flags & CACHE_NO_DEPOT) != 0) {
+		statistics.magazine_capacity = 0;
+		statistics.allocations = cache->alloc_count;
+		statistics.frees = cache->free_count;
+		statistics.allocation_misses = cache->alloc_count;
+		statistics.free_misses = cache->free_count;
+		statistics.depot_contention = 0;
+		return;
+	}
+
+	int64 obtained;
+	int64 stored;
+	int64 storeMisses;
+	object_depot_get_stats(&cache->depot, &obtained, &stored, &storeMisses);
+
+	statistics.magazine_capacity = cache->depot.magazine_capacity;
+	statistics.allocations = obtained + cache->alloc_count;
+	statistics.frees = stored + storeMisses;
+	statistics.allocation_misses = cache->alloc_count;
+	statistics.free_misses = storeMisses;
+	statistics.depot_contention = cache->depot.contention;
+}
+
+
+static status_t
+slab_statistics_syscall(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	if (function != GET_SLAB_CACHE_STATISTICS)
+		return B_BAD_VALUE;
+
+	if (buffer != NULL && !IS_USER_ADDRESS(buffer))
+		return B_BAD_ADDRESS;
+
+	uint32 maxCount = buffer != NULL
+		? bufferSize / sizeof(slab_cache_statistics) : 0;
+
+	// Don't let the caller decide how much we allocate: there is no need
+	// for more entries than there are caches. Caches created in the meantime
+	// are still counted below, but not reported.
+	if (maxCount > 0) {
+		MutexLocker cacheListLocker(sObjectCacheListLock);
+
+		uint32 cacheCount = 0;
+		ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+		while (it.Next() != NULL)
+			cacheCount++;
+
+		maxCount = std::min(maxCount, cacheCount);
+	}
+
+	slab_cache_statistics* statistics = NULL;
+	if (maxCount > 0) {
+		statistics = (slab_cache_statistics*)malloc(
+			maxCount * sizeof(slab_cache_statistics));
+		if (statistics == NULL)
+			return B_NO_MEMORY;
+	}
+
+	// The caches can't go away while they are in the list. The counters are
+	// read without locking the caches, which is fine for statistics.
+	MutexLocker cacheListLocker(sObjectCacheListLock);
+
+	uint32 count = 0;
+	ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+	while (ObjectCache* cache = it.Next()) {
+		if (count < maxCount)
+			get_object_cache_statistics(cache, statistics[count]);
+		count++;
+	}
+
+	cacheListLocker.Unlock();
+
+	status_t status = B_OK;
+	if (maxCount > 0) {
+		status = user_memcpy(buffer, statistics,
+			std::min(count, maxCount) * sizeof(slab_cache_statistics));
+		free(statistics);
+	}
+
+	return status == B_OK ? (status_t)count : B_BAD_ADDRESS;
+}
+
+
 void
 slab_init(kernel_args* args)
 {
@@ -1423,6 +1523,8 @@ slab_init_post_thread()
 	}
 
 	resume_thread(objectCacheResizer);
+
+	register_generic_syscall(SLAB_STATISTICS, &slab_statistics_syscall, 0, 0);
 }
 
 
@@ -82,6 +82,13 @@
 #define SWAP_BLOCK_SHIFT 5		/* 1 << SWAP_BLOCK_SHIFT == SWAP_BLOCK_PAGES */
 #define SWAP_BLOCK_MASK  (SWAP_BLOCK_PAGES - 1)
 
+// maximum number of pages written to a contiguous slot range at once; the
+// radix bitmap can't allocate more than BITMAP_RADIX slots at once
+#define SWAP_CLUSTER_PAGES	BITMAP_RADIX
+
+// size of the aligned cluster of pages read in on a page fault
+#define SWAP_READ_CLUSTER_PAGES	16
+
 
 static const char* const kDefaultSwapPath = "/var/swap";
 
@@ -155,6 +162,14 @@ static mutex sAvailSwapSpaceLock;
 
 static object_cache* sSwapBlockCache;
 
+// statistics
+static int64 sSwapInPages;
+static int64 sSwapInReads;
+static int64 sSwapInTime;
+static int64 sSwapOutPages;
+static int64 sSwapOutWrites;
+static int64 sSwapOutClusters[SWAP_CLUSTER_BUCKETS];
+
 
 #if SWAP_TRACING
 namespace SwapTracing {
@@ -293,7 +308,11 @@ swap_slot_alloc(uint32 count)
 
 	if (j == sSwapFileCount) {
 		mutex_unlock(&sSwapFileListLock);
-		panic("swap_slot_alloc: swap space exhausted!\n");
+
+		// If we didn't find a range of the requested size, the caller can
+		// still try smaller ones.
+		if (count == 1)
+			panic("swap_slot_alloc: swap space exhausted!\n");
 		return SWAP_SLOT_NONE;
 	}
 
@@ -366,6 +385,19 @@ swap_space_unreserve(off_t amount)
 }
 
 
+static void
+swap_count_write(uint32 pageCount)
+{
+	atomic_add64(&sSwapOutPages, pageCount);
+	atomic_add64(&sSwapOutWrites, 1);
+
+	int32 bucket = 0;
+	while ((pageCount >>= 1) != 0 && bucket < SWAP_CLUSTER_BUCKETS - 1)
+		bucket++;
+	atomic_add64(&sSwapOutClusters[bucket], 1);
+}
+
+
 static void
 swap_hash_resizer(void*, int)
 {
@@ -403,25 +435,27 @@ public:
 	{
 	}
 
-	void SetTo(page_num_t pageIndex, swap_addr_t slotIndex, bool newSlot)
+	void SetTo(page_num_t pageIndex, swap_addr_t slotIndex, uint32 pageCount,
+		bool newSlots)
 	{
 		fPageIndex = pageIndex;
 		fSlotIndex = slotIndex;
-		fNewSlot = newSlot;
+		fPageCount = pageCount;
+		fNewSlots = newSlots;
 	}
 
 	virtual void IOFinished(status_t status, bool partialTransfer,
 		generic_size_t bytesTransferred)
 	{
-		if (fNewSlot) {
+		if (fNewSlots) {
 			if (status == B_OK) {
-				fCache->_SwapBlockBuild(fPageIndex, fSlotIndex, 1);
+				fCache->_SwapBlockBuild(fPageIndex, fSlotIndex, fPageCount);
 			} else {
 				AutoLocker<VMCache> locker(fCache);
-				fCache->fAllocatedSwapSize -= B_PAGE_SIZE;
+				fCache->fAllocatedSwapSize -= (off_t)fPageCount * B_PAGE_SIZE;
 				locker.Unlock();
 
-				swap_slot_dealloc(fSlotIndex, 1);
+				swap_slot_dealloc(fSlotIndex, fPageCount);
 			}
 		}
 
@@ -434,7 +468,8 @@ private:
 	VMAnonymousCache*	fCache;
 	page_num_t			fPageIndex;
 	swap_addr_t			fSlotIndex;
-	bool				fNewSlot;
+	uint32				fPageCount;
+	bool				fNewSlots;
 };
 
 
@@ -594,13 +629,17 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 	uint32 flags, generic_size_t* _numBytes)
 {
 	off_t pageIndex = offset >> PAGE_SHIFT;
+	generic_size_t totalBytes = 0;
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+		generic_size_t bytes = vecs[i].length;
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
 			if (slotIndex != startSlotIndex + j - i)
 				break;
+
+			bytes += vecs[j].length;
 		}
 
 		T(ReadPage(this, pageIndex, startSlotIndex));
@@ -611,12 +650,26 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 		off_t pos = (off_t)(startSlotIndex - swapFile->first_slot)
 			* B_PAGE_SIZE;
 
+		bigtime_t startTime = system_time();
+
+		// every group of contiguous slots is read on its own, and only as
+		// much as its vecs can hold
+		generic_size_t groupBytes = bytes;
 		status_t status = vfs_read_pages(swapFile->vnode, swapFile->cookie, pos,
-			vecs + i, j - i, flags, _numBytes);
+			vecs + i, j - i, flags, &bytes);
 		if (status != B_OK)
 			return status;
+
+		atomic_add64(&sSwapInTime, system_time() - startTime);
+		atomic_add64(&sSwapInPages, j - i);
+		atomic_add64(&sSwapInReads, 1);
+
+		totalBytes += bytes;
+		if (bytes < groupBytes)
+			break;
 	}
 
+	*_numBytes = totalBytes;
 	return B_OK;
 }
 
@@ -632,11 +685,17 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 	page_num_t totalPages = 0;
 	for (uint32 i = 0; i < count; i++) {
 		page_num_t pageCount = (vecs[i].length + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-		swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + totalPages);
-		if (slotIndex != SWAP_SLOT_NONE) {
-			swap_slot_dealloc(slotIndex, pageCount);
-			_SwapBlockFree(pageIndex + totalPages, pageCount);
-			fAllocatedSwapSize -= pageCount * B_PAGE_SIZE;
+
+		// The slots of the pages of a vector don't need to be contiguous, if
+		// they were written by an earlier, split up Write().
+		for (page_num_t j = 0; j < pageCount; j++) {
+			swap_addr_t slotIndex
+				= _SwapBlockGetAddress(pageIndex + totalPages + j);
+			if (slotIndex != SWAP_SLOT_NONE) {
+				swap_slot_dealloc(slotIndex, 1);
+				_SwapBlockFree(pageIndex + totalPages + j, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
 		}
 
 		totalPages += pageCount;
@@ -660,6 +719,9 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 		page_num_t n = pageCount;
 
 		for (page_num_t j = 0; j < pageCount; j += n) {
+			// don't write beyond the vector, when n has been halved before
+			n = min_c(n, pageCount - j);
+
 			swap_addr_t slotIndex;
 			// try to allocate n slots, if fail, try to allocate n/2
 			while ((slotIndex = swap_slot_alloc(n)) == SWAP_SLOT_NONE && n >= 2)
@@ -668,14 +730,15 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 			if (slotIndex == SWAP_SLOT_NONE)
 				panic("VMAnonymousCache::Write(): can't allocate swap space\n");
 
-			T(WritePage(this, pageIndex, slotIndex));
+			T(WritePage(this, pageIndex + totalPages + j, slotIndex));
 				// TODO: Assumes that only one page is written.
 
 			swap_file* swapFile = find_swap_file(slotIndex);
 
 			off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
 
-			generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
+			generic_size_t length
+				= min_c((generic_size_t)n * B_PAGE_SIZE, vectorLength);
 			generic_io_vec vector[1];
 			vector->base = vectorBase;
 			vector->length = length;
@@ -691,13 +754,13 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 				return status;
 			}
 
-			_SwapBlockBuild(pageIndex + totalPages, slotIndex, n);
+			_SwapBlockBuild(pageIndex + totalPages + j, slotIndex, n);
 			pagesLeft -= n;
 
-			if (n != pageCount) {
-				vectorBase = vectorBase + n * B_PAGE_SIZE;
-				vectorLength -= n * B_PAGE_SIZE;
-			}
+			swap_count_write(n);
+
+			vectorBase += (generic_addr_t)n * B_PAGE_SIZE;
+			vectorLength -= vector->length;
 		}
 
 		totalPages += pageCount;
@@ -713,27 +776,52 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 	size_t count, generic_size_t numBytes, uint32 flags,
 	AsyncIOCallback* _callback)
 {
-	// TODO: Currently this method is only used for single pages. Either make
-	// more flexible use of it or change the interface!
-	// This implementation relies on the current usage!
-	ASSERT(count == 1);
-	ASSERT(numBytes <= B_PAGE_SIZE);
-
 	page_num_t pageIndex = offset >> PAGE_SHIFT;
+	uint32 pageCount = (numBytes + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
+	ASSERT(pageCount > 0 && pageCount <= SWAP_CLUSTER_PAGES);
+
+	// If the pages already have contiguous swap space, we just write them
+	// there again. Otherwise they get a new contiguous slot range, so that
+	// they can be read back in one go.
 	swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex);
-	bool newSlot = slotIndex == SWAP_SLOT_NONE;
+	bool newSlots = slotIndex == SWAP_SLOT_NONE;
+	for (uint32 i = 1; !newSlots && i < pageCount; i++) {
+		if (_SwapBlockGetAddress(pageIndex + i) != slotIndex + i)
+			newSlots = true;
+	}
 
-	// If the page doesn't have any swap space yet, allocate it.
-	if (newSlot) {
+	if (newSlots) {
 		AutoLocker<VMCache> locker(this);
-		if (fAllocatedSwapSize + B_PAGE_SIZE > fCommittedSwapSize) {
+
+		for (uint32 i = 0; i < pageCount; i++) {
+			swap_addr_t oldSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+			if (oldSlotIndex != SWAP_SLOT_NONE) {
+				swap_slot_dealloc(oldSlotIndex, 1);
+				_SwapBlockFree(pageIndex + i, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
+		}
+
+		off_t size = (off_t)pageCount * B_PAGE_SIZE;
+		if (fAllocatedSwapSize + size > fCommittedSwapSize) {
 			_callback->IOFinished(B_ERROR, true, 0);
 			return B_ERROR;
 		}
 
-		fAllocatedSwapSize += B_PAGE_SIZE;
+		slotIndex = swap_slot_alloc(pageCount);
+		if (slotIndex == SWAP_SLOT_NONE) {
+			// There is no free slot range large enough, let Write() split
+			// up the pages.
+			locker.Unlock();
 
-		slotIndex = swap_slot_alloc(1);
+			generic_size_t bytesWritten = numBytes;
+			status_t status = Write(offset, vecs, count, flags, &bytesWritten);
+			_callback->IOFinished(status, status != B_OK,
+				status == B_OK ? bytesWritten : 0);
+			return status;
+		}
+
+		fAllocatedSwapSize += size;
 	}
 
 	// create our callback
@@ -741,29 +829,30 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 		? new(malloc_flags(HEAP_PRIORITY_VIP)) WriteCallback(this, _callback)
 		: new(std::nothrow) WriteCallback(this, _callback);
 	if (callback == NULL) {
-		if (newSlot) {
+		if (newSlots) {
 			AutoLocker<VMCache> locker(this);
-			fAllocatedSwapSize -= B_PAGE_SIZE;
+			fAllocatedSwapSize -= (off_t)pageCount * B_PAGE_SIZE;
 			locker.Unlock();
 
-			swap_slot_dealloc(slotIndex, 1);
+			swap_slot_dealloc(slotIndex, pageCount);
 		}
 		_callback->IOFinished(B_NO_MEMORY, true, 0);
 		return B_NO_MEMORY;
 	}
-	// TODO: If the page already had swap space assigned, we don't need an own
+	// TODO: If the pages already had swap space assigned, we don't need an own
 	// callback.
 
-	callback->SetTo(pageIndex, slotIndex, newSlot);
+	callback->SetTo(pageIndex, slotIndex, pageCount, newSlots);
 
 	T(WritePage(this, pageIndex, slotIndex));
+	swap_count_write(pageCount);
 
-	// write the page asynchrounously
+	// write the pages asynchrounously
 	swap_file* swapFile = find_swap_file(slotIndex);
 	off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
 
 	return vfs_asynchronous_write_pages(swapFile->vnode, swapFile->cookie, pos,
-		vecs, 1, numBytes, flags, callback);
+		vecs, count, numBytes, flags, callback);
 }
 
 
@@ -780,7 +869,14 @@ VMAnonymousCache::CanWritePage(off_t offset)
 int32
 VMAnonymousCache::MaxPagesPerAsyncWrite() const
 {
-	return 1;
+	return SWAP_CLUSTER_PAGES;
+}
+
+
+uint32
+VMAnonymousCache::FaultClusterSize() const
+{
+	return SWAP_READ_CLUSTER_PAGES;
 }
 
 
@@ -1672,9 +1768,23 @@ swap_get_info(struct system_memory_info* info)
 #if ENABLE_SWAP_SUPPORT
 	info->max_swap_space = (uint64)swap_total_swap_pages() * B_PAGE_SIZE;
 	info->free_swap_space = (uint64)swap_available_pages() * B_PAGE_SIZE;
+	info->swap_in_pages = sSwapInPages;
+	info->swap_in_reads = sSwapInReads;
+	info->swap_in_time = sSwapInTime;
+	info->swap_out_pages = sSwapOutPages;
+	info->swap_out_writes = sSwapOutWrites;
+	for (int32 i = 0; i < SWAP_CLUSTER_BUCKETS; i++)
+		info->swap_out_clusters[i] = sSwapOutClusters[i];
 #else
 	info->max_swap_space = 0;
 	info->free_swap_space = 0;
+	info->swap_in_pages = 0;
+	info->swap_in_reads = 0;
+	info->swap_in_time = 0;
+	info->swap_out_pages = 0;
+	info->swap_out_writes = 0;
+	for (int32 i = 0; i < SWAP_CLUSTER_BUCKETS; i++)
+		info->swap_out_clusters[i] = 0;
 #endif
 }
 
@@ -60,6 +60,7 @@ public:
 	virtual	bool				CanWritePage(off_t offset);
 
 	virtual	int32				MaxPagesPerAsyncWrite() const;
+	virtual	uint32				FaultClusterSize() const;
 
 	virtual	status_t			Fault(struct VMAddressSpace* aspace,
 									off_t offset);
@@ -31,6 +31,32 @@ VMTranslationMap::~VMTranslationMap()
 }
 
 
+/*!	Returns the size of the large pages the map can use, or 0, if it doesn't
+	support large pages (the default).
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Maps a large page, i.e. LargePageSize() bytes of physically contiguous
+	memory, with a single entry.
+	Both addresses must be aligned to the large page size, and the range must
+	not be mapped yet. Like Map(), the \a reservation must contain the pages
+	MaxPagesNeededToMap() returned for the range; the map may keep one of them
+	to be able to split the large page later.
+	The map must be locked.
+*/
+status_t
+VMTranslationMap::MapLarge(addr_t virtualAddress, phys_addr_t physicalAddress,
+	uint32 attributes, uint32 memoryType, vm_page_reservation* reservation)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 status_t
 VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 	bool markPresent)
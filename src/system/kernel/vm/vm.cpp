@@ -57,6 +57,7 @@
 #include "VMAnonymousCache.h"
 #include "VMAnonymousNoSwapCache.h"
 #include "IORequest.h"
+#include "VMPageQueue.h"
 
 
 //#define TRACE_VM
@@ -246,6 +247,15 @@ static off_t sAvailableMemory;
 static off_t sNeededMemory;
 static mutex sAvailableMemoryLock = MUTEX_INITIALIZER("available memory lock");
 static uint32 sPageFaults;
+static int64 sReadAheadPages;
+
+// upper limit for VMCache::FaultClusterSize()
+static const uint32 kMaxFaultClusterSize = 32;
+
+// After failing to find a free large page run, we don't look for one again
+// for a while, since chances are that physical memory is still fragmented.
+static const bigtime_t kLargePageRunRetryDelay = 1000000;
+static bigtime_t sNextLargePageRunAttempt;
 
 static VMPhysicalPageMapper* sPhysicalPageMapper;
 
@@ -576,6 +586,64 @@ map_page(VMArea* area, vm_page* page, addr_t address, uint32 protection,
 }
 
 
+/*!	Inserts the physically contiguous run of large page size starting with
+	\a firstPage into the area's cache and maps it with a single large page,
+	or page by page, if the translation map can't do that.
+	The caller must have reserved enough pages the translation map
+	implementation might need to map this range.
+	The area's cache must be locked.
+*/
+static void
+map_large_page(VMArea* area, vm_page* firstPage, addr_t address, off_t offset,
+	uint32 protection, vm_page_reservation* reservation)
+{
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	page_num_t pageCount = map->LargePageSize() / B_PAGE_SIZE;
+
+	map->Lock();
+	bool mapped = map->MapLarge(address,
+		firstPage->physical_page_number * B_PAGE_SIZE, protection,
+		area->MemoryType(), reservation) == B_OK;
+	map->Unlock();
+
+	for (page_num_t i = 0; i < pageCount; i++) {
+		vm_page* page = vm_lookup_page(firstPage->physical_page_number + i);
+		if (page == NULL)
+			panic("couldn't lookup physical page just allocated\n");
+
+		area->cache->InsertPage(page, offset + i * B_PAGE_SIZE);
+
+		if (mapped)
+			increment_page_wired_count(page);
+		else {
+			map_page(area, page, address + i * B_PAGE_SIZE, protection,
+				reservation);
+		}
+
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+}
+
+
+/*!	Frees the physically contiguous runs of \a pagesPerRun pages each, whose
+	first pages are in \a runs.
+*/
+static void
+free_page_runs(VMPageQueue::PageList& runs, page_num_t pagesPerRun)
+{
+	while (vm_page* firstPage = runs.RemoveHead()) {
+		page_num_t pageNumber = firstPage->physical_page_number;
+		for (page_num_t i = 0; i < pagesPerRun; i++) {
+			vm_page* page = vm_lookup_page(pageNumber + i);
+			if (page == NULL)
+				panic("couldn't lookup physical page just allocated\n");
+
+			vm_page_set_state(page, PAGE_STATE_FREE);
+		}
+	}
+}
+
+
 /*!	If \a preserveModified is \c true, the caller must hold the lock of the
 	page's cache.
 */
@@ -1233,6 +1301,21 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 		wiring = B_CONTIGUOUS;
 	}
 
+	// Large pages are only used for resident memory. Unless the area could
+	// actually use them, though, the flag is ignored.
+	if ((protection & B_LARGE_PAGE_AREA) != 0
+		&& (wiring == B_NO_LOCK || wiring == B_LAZY_LOCK)) {
+		size_t largePageSize = 0;
+		VMAddressSpace* addressSpace = VMAddressSpace::Get(team);
+		if (addressSpace != NULL) {
+			largePageSize = addressSpace->TranslationMap()->LargePageSize();
+			addressSpace->Put();
+		}
+
+		if (largePageSize != 0 && size >= largePageSize)
+			wiring = B_FULL_LOCK;
+	}
+
 	physical_address_restrictions stackPhysicalRestrictions;
 	bool doReserveMemory = false;
 	switch (wiring) {
@@ -1288,6 +1371,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	// For full lock or contiguous areas we're also going to map the pages and
 	// thus need to reserve pages for the mapping backend upfront.
 	addr_t reservedMapPages = 0;
+	size_t largePageSize = 0;
 	if (wiring == B_FULL_LOCK || wiring == B_CONTIGUOUS) {
 		AddressSpaceWriteLocker locker;
 		status_t status = locker.SetTo(team);
@@ -1296,6 +1380,46 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 
 		VMTranslationMap* map = locker.AddressSpace()->TranslationMap();
 		reservedMapPages = map->MaxPagesNeededToMap(0, size - 1);
+
+		// Full lock userland areas are mapped with large pages where possible,
+		// which saves a lot of TLB misses for big areas. Since allocating the
+		// page runs might have to wait, we don't try that for
+		// CREATE_AREA_DONT_WAIT.
+		if (wiring == B_FULL_LOCK && !isStack
+			&& team != VMAddressSpace::KernelID()
+			&& (flags & CREATE_AREA_DONT_WAIT) == 0
+			&& system_time() >= sNextLargePageRunAttempt) {
+			largePageSize = map->LargePageSize();
+		}
+	}
+
+	// Determine the number of large pages the area can contain. If we can
+	// choose the address, we align it accordingly.
+	virtual_address_restrictions largePageAddressRestrictions;
+	page_num_t largePageCount = 0;
+	if (largePageSize != 0 && size >= largePageSize) {
+		switch (virtualAddressRestrictions->address_specification) {
+			case B_ANY_ADDRESS:
+			case B_BASE_ADDRESS:
+				largePageAddressRestrictions = *virtualAddressRestrictions;
+				if (largePageAddressRestrictions.alignment < largePageSize)
+					largePageAddressRestrictions.alignment = largePageSize;
+				virtualAddressRestrictions = &largePageAddressRestrictions;
+				largePageCount = size / largePageSize;
+				break;
+
+			case B_EXACT_ADDRESS:
+			{
+				addr_t start = ROUNDUP(
+					(addr_t)virtualAddressRestrictions->address, largePageSize);
+				addr_t end = ROUNDDOWN(
+					(addr_t)virtualAddressRestrictions->address + size,
+					largePageSize);
+				if (end > start)
+					largePageCount = (end - start) / largePageSize;
+				break;
+			}
+		}
 	}
 
 	int priority;
@@ -1327,12 +1451,39 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	VMAddressSpace* addressSpace;
 	status_t status;
 
+	// Allocate the page runs for the large pages upfront as well. Since
+	// vm_page_allocate_page_run() reserves the pages of a run itself, this
+	// has to happen before we reserve the remaining pages. This is only an
+	// attempt, that neither waits for memory nor steals cached pages. If there
+	// are no suitable runs (left), e.g. because the physical memory is
+	// fragmented, the rest of the area just uses small pages, and we don't
+	// try again for a while.
+	VMPageQueue::PageList largePages;
+	page_num_t largePagesAllocated = 0;
+	while (largePagesAllocated < largePageCount) {
+		physical_address_restrictions largePageRestrictions = {};
+		largePageRestrictions.alignment = largePageSize;
+
+		vm_page* firstPage = vm_page_allocate_page_run(
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_TRY | pageAllocFlags,
+			largePageSize / B_PAGE_SIZE, &largePageRestrictions, priority);
+		if (firstPage == NULL) {
+			sNextLargePageRunAttempt = system_time() + kLargePageRunRetryDelay;
+			break;
+		}
+
+		largePages.Add(firstPage);
+		largePagesAllocated++;
+	}
+
 	// For full lock areas reserve the pages before locking the address
 	// space. E.g. block caches can't release their memory while we hold the
 	// address space lock.
 	page_num_t reservedPages = reservedMapPages;
-	if (wiring == B_FULL_LOCK)
-		reservedPages += size / B_PAGE_SIZE;
+	if (wiring == B_FULL_LOCK) {
+		reservedPages += size / B_PAGE_SIZE
+			- largePagesAllocated * (largePageSize / B_PAGE_SIZE);
+	}
 
 	vm_page_reservation reservation;
 	if (reservedPages > 0) {
@@ -1424,6 +1575,16 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 #	endif
 					continue;
 #endif
+				if (!largePages.IsEmpty() && address % largePageSize == 0
+					&& area->Base() + (area->Size() - 1) - address
+						>= largePageSize - 1) {
+					map_large_page(area, largePages.RemoveHead(), address,
+						offset, protection, &reservation);
+					address += largePageSize - B_PAGE_SIZE;
+					offset += largePageSize - B_PAGE_SIZE;
+					continue;
+				}
+
 				vm_page* page = vm_page_allocate_page(&reservation,
 					PAGE_STATE_WIRED | pageAllocFlags);
 				cache->InsertPage(page, offset);
@@ -1432,6 +1593,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 				DEBUG_PAGE_ACCESS_END(page);
 			}
 
+			ASSERT(largePages.IsEmpty());
 			break;
 		}
 
@@ -1541,6 +1703,7 @@ err1:
 	}
 
 err0:
+	free_page_runs(largePages, largePageSize / B_PAGE_SIZE);
 	if (reservedPages > 0)
 		vm_page_unreserve_pages(&reservation);
 	if (reservedMemory > 0)
@@ -4251,43 +4414,130 @@ fault_get_page(PageFaultContext& context)
 
 		// see if the backing store has it
 		if (cache->HasPage(context.cacheOffset)) {
-			// insert a fresh page and mark it busy -- we're going to read it in
-			page = vm_page_allocate_page(&context.reservation,
-				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
-			cache->InsertPage(page, context.cacheOffset);
+			// Determine the pages around the faulting one in its cluster that
+			// the backing store has as well, but that aren't in the cache yet,
+			// so that we can read them in one go. We only do that if we can
+			// get the pages for them right away.
+			off_t firstOffset = context.cacheOffset;
+			off_t lastOffset = context.cacheOffset;
+			uint32 clusterSize = std::min(cache->FaultClusterSize(),
+				kMaxFaultClusterSize);
+			vm_page_reservation readAheadReservation;
+			readAheadReservation.count = 0;
+
+			if (clusterSize > 1) {
+				off_t clusterStart = ROUNDDOWN(context.cacheOffset,
+					(off_t)clusterSize * B_PAGE_SIZE);
+				off_t clusterEnd = std::min(
+					clusterStart + (off_t)clusterSize * B_PAGE_SIZE,
+					cache->virtual_end);
+				clusterStart = std::max(clusterStart, cache->virtual_base);
+
+				while (firstOffset - B_PAGE_SIZE >= clusterStart
+					&& cache->LookupPage(firstOffset - B_PAGE_SIZE) == NULL
+					&& cache->HasPage(firstOffset - B_PAGE_SIZE)) {
+					firstOffset -= B_PAGE_SIZE;
+				}
+				while (lastOffset + B_PAGE_SIZE < clusterEnd
+					&& cache->LookupPage(lastOffset + B_PAGE_SIZE) == NULL
+					&& cache->HasPage(lastOffset + B_PAGE_SIZE)) {
+					lastOffset += B_PAGE_SIZE;
+				}
+
+				uint32 readAheadPages
+					= (lastOffset - firstOffset) / B_PAGE_SIZE;
+				if (readAheadPages > 0
+					&& !vm_page_try_reserve_pages(&readAheadReservation,
+						readAheadPages, VM_PRIORITY_USER)) {
+					firstOffset = lastOffset = context.cacheOffset;
+				}
+			}
+
+			// insert fresh pages and mark them busy -- we're going to read
+			// them in
+			uint32 pageCount = (lastOffset - firstOffset) / B_PAGE_SIZE + 1;
+			vm_page* pages[kMaxFaultClusterSize];
+			generic_io_vec vecs[kMaxFaultClusterSize];
+
+			for (uint32 i = 0; i < pageCount; i++) {
+				off_t offset = firstOffset + (off_t)i * B_PAGE_SIZE;
+				if (offset == context.cacheOffset) {
+					page = vm_page_allocate_page(&context.reservation,
+						PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
+					pages[i] = page;
+				} else {
+					// the pages read ahead may not be needed at all
+					pages[i] = vm_page_allocate_page(&readAheadReservation,
+						PAGE_STATE_INACTIVE | VM_PAGE_ALLOC_BUSY);
+				}
+
+				cache->InsertPage(pages[i], offset);
+
+				vecs[i].base
+					= (phys_addr_t)pages[i]->physical_page_number * B_PAGE_SIZE;
+				vecs[i].length = B_PAGE_SIZE;
+			}
+
+			vm_page_unreserve_pages(&readAheadReservation);
 
 			// We need to unlock all caches and the address space while reading
-			// the page in. Keep a reference to the cache around.
+			// the pages in. Keep a reference to the cache around.
 			cache->AcquireRefLocked();
 			context.UnlockAll();
 
-			// read the page in
-			generic_io_vec vec;
-			vec.base = (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
-			generic_size_t bytesRead = vec.length = B_PAGE_SIZE;
-
-			status_t status = cache->Read(context.cacheOffset, &vec, 1,
+			// read the pages in
+			generic_size_t bytesRead = (generic_size_t)pageCount * B_PAGE_SIZE;
+			status_t status = cache->Read(firstOffset, vecs, pageCount,
 				B_PHYSICAL_IO_REQUEST, &bytesRead);
 
 			cache->Lock();
 
+			// When reading ahead, only the pages that were read completely
+			// can be used, and the faulting page has to be among them. A
+			// single page may be short, as vnode caches clear the rest.
+			uint32 pagesRead = pageCount;
+			if (status == B_OK && pageCount > 1) {
+				pagesRead = std::min((uint32)(bytesRead / B_PAGE_SIZE),
+					pageCount);
+				if (firstOffset + (off_t)pagesRead * B_PAGE_SIZE
+						<= context.cacheOffset)
+					status = B_IO_ERROR;
+			}
+
 			if (status < B_OK) {
-				// on error remove and free the page
+				// on error remove and free the pages
 				dprintf("reading page from cache %p returned: %s!\n",
 					cache, strerror(status));
 
-				cache->NotifyPageEvents(page, PAGE_EVENT_NOT_BUSY);
-				cache->RemovePage(page);
-				vm_page_set_state(page, PAGE_STATE_FREE);
+				for (uint32 i = 0; i < pageCount; i++) {
+					cache->NotifyPageEvents(pages[i], PAGE_EVENT_NOT_BUSY);
+					cache->RemovePage(pages[i]);
+					vm_page_set_state(pages[i], PAGE_STATE_FREE);
+				}
 
 				cache->ReleaseRefAndUnlock();
 				return status;
 			}
 
-			// mark the page unbusy again
-			cache->MarkPageUnbusy(page);
+			// mark the pages unbusy again, activating those that belong to
+			// the working set
+			// the pages read ahead, and free those that could not be read
+			for (uint32 i = 0; i < pageCount; i++) {
+				if (i >= pagesRead) {
+					cache->NotifyPageEvents(pages[i], PAGE_EVENT_NOT_BUSY);
+					cache->RemovePage(pages[i]);
+					vm_page_set_state(pages[i], PAGE_STATE_FREE);
+					continue;
+				}
+
+				vm_page_refault(pages[i]);
+				cache->MarkPageUnbusy(pages[i]);
+
+				DEBUG_PAGE_ACCESS_END(pages[i]);
+			}
 
-			DEBUG_PAGE_ACCESS_END(page);
+			if (pagesRead > 1)
+				atomic_add64(&sReadAheadPages, pagesRead - 1);
 
 			// Since we needed to unlock everything temporarily, the area
 			// situation might have changed. So we need to restart the whole
@@ -4611,9 +4861,11 @@ void
 vm_get_info(system_memory_info* info)
 {
 	swap_get_info(info);
+	vm_page_get_memory_info(info);
 
 	info->max_memory = vm_page_num_pages() * B_PAGE_SIZE;
 	info->page_faults = sPageFaults;
+	info->read_ahead_pages = sReadAheadPages;
 
 	MutexLocker locker(sAvailableMemoryLock);
 	info->free_memory = sAvailableMemory;
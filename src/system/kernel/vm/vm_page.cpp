@@ -27,6 +27,7 @@
 #include <heap.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <system_info.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -99,6 +100,9 @@ static const int32 kPageUsageMax = 64;
 static const int32 kPageUsageAdvance = 3;
 // vm_page::usage_count debuff an unaccessed page receives in a scan.
 static const int32 kPageUsageDecline = 1;
+// vm_page::usage_count a page that is read in again shortly after it had been
+// evicted starts with.
+static const int32 kPageUsageRefault = 16;
 
 int32 gMappedPagesCount;
 
@@ -123,6 +127,26 @@ static vint32 sUnreservedFreePages;
 static vint32 sUnsatisfiedPageReservations;
 static vint32 sModifiedTemporaryPages;
 
+// Shadow entries remember recently evicted cached pages, so that we can tell
+// how long a page had been gone when it is read in again (see
+// vm_page_refault()).
+struct page_shadow_entry {
+	VMCache*	cache;
+	uint32		offset;
+		// the lower bits of the page's cache offset
+	uint32		eviction;
+		// the lower bits of sPageEvictions when the page was evicted
+};
+
+static page_shadow_entry* sPageShadows;
+static uint32 sPageShadowMask;
+static spinlock sPageShadowLock = B_SPINLOCK_INITIALIZER;
+static uint64 sPageEvictions;
+	// number of cached pages evicted so far
+static int64 sPageRefaults;
+static int64 sPageRefaultActivations;
+static int64 sPageCacheActivations;
+
 static ConditionVariable sFreePageCondition;
 static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 
@@ -1118,6 +1142,10 @@ dump_page_stats(int argc, char **argv)
 	kprintf("unsatisfied page reservations: %" B_PRId32 "\n",
 		sUnsatisfiedPageReservations);
 	kprintf("mapped pages: %" B_PRId32 "\n", gMappedPagesCount);
+	kprintf("evicted cached pages: %" B_PRIu64 ", refaults: %" B_PRId64
+		" (%" B_PRId64 " activated), activated on access: %" B_PRId64 "\n",
+		sPageEvictions, sPageRefaults, sPageRefaultActivations,
+		sPageCacheActivations);
 	kprintf("longest free pages run: %" B_PRIuPHYSADDR " pages (at %"
 		B_PRIuPHYSADDR ")\n", longestFreeRun.Length(),
 		sPages[longestFreeRun.start].physical_page_number);
@@ -2285,6 +2313,50 @@ PageWriterRun::PageWritten(PageWriteTransfer* transfer, status_t status,
 }
 
 
+/*!	Adds the modified pages adjacent to \a page in its cache to \a run, as
+	many as can be written together with it, but no more than \a maxPages.
+	The page's cache must be locked and a store reference must have been
+	acquired for \a page.
+	\return The number of pages added.
+*/
+static uint32
+add_adjacent_modified_pages(PageWriterRun& run, vm_page* page,
+	uint32 maxPages)
+{
+	VMCache* cache = page->Cache();
+	maxPages = std::min(maxPages, (uint32)cache->MaxPagesPerAsyncWrite() - 1);
+
+	uint32 added = 0;
+	for (int32 direction = 1; direction >= -1; direction -= 2) {
+		for (off_t index = (off_t)page->cache_offset + direction;
+				index >= 0 && added < maxPages; index += direction) {
+			vm_page* neighbor = cache->LookupPage(index << PAGE_SHIFT);
+			if (neighbor == NULL || neighbor->busy
+				|| neighbor->State() != PAGE_STATE_MODIFIED
+				|| neighbor->WiredCount() > 0
+				|| !cache->CanWritePage(index << PAGE_SHIFT)) {
+				break;
+			}
+
+			DEBUG_PAGE_ACCESS_START(neighbor);
+
+			// we already have a store reference for the first page
+			cache->AcquireStoreRef();
+			run.AddPage(neighbor);
+
+			DEBUG_PAGE_ACCESS_END(neighbor);
+
+			TPW(WritePage(neighbor));
+
+			cache->AcquireRefLocked();
+			added++;
+		}
+	}
+
+	return added;
+}
+
+
 /*!	The page writer continuously takes some pages from the modified
 	queue, writes them back, and moves them back to the active queue.
 	It runs in its own thread, and is only there to keep the number
@@ -2429,6 +2501,13 @@ page_writer(void* /*unused*/)
 
 			cache->AcquireRefLocked();
 			numPages++;
+
+			// Temporary pages go to swap space. Write their modified neighbors
+			// along with them, so that they get a contiguous swap range and
+			// can be read back in one go.
+			if (cache->temporary && cache->MaxPagesPerAsyncWrite() > 1)
+				numPages += add_adjacent_modified_pages(run, page,
+					kNumPages - numPages);
 		}
 
 #ifdef TRACE_VM_PAGE
@@ -2508,6 +2587,31 @@ free_page_swap_space(int32 index)
 #endif	// 0
 
 
+static inline page_shadow_entry&
+page_shadow_entry_for(VMCache* cache, page_num_t cacheOffset)
+{
+	uint32 hash = (uint32)((addr_t)cache >> 4)
+		^ (uint32)cacheOffset * 0x9e3779b1;
+	return sPageShadows[hash & sPageShadowMask];
+}
+
+
+/*!	Leaves a shadow entry for a cached page that is about to be evicted.
+	The page's cache must be locked.
+*/
+static void
+remember_evicted_page(VMCache* cache, vm_page* page)
+{
+	page_shadow_entry& entry = page_shadow_entry_for(cache,
+		page->cache_offset);
+
+	InterruptsSpinLocker locker(sPageShadowLock);
+	entry.cache = cache;
+	entry.offset = (uint32)page->cache_offset;
+	entry.eviction = (uint32)++sPageEvictions;
+}
+
+
 static vm_page *
 find_cached_page_candidate(struct vm_page &marker)
 {
@@ -2568,6 +2672,7 @@ free_cached_page(vm_page *page, bool dontWait)
 
 	// we can now steal this page
 
+	remember_evicted_page(cache, page);
 	cache->RemovePage(page);
 		// Now the page doesn't have cache anymore, so no one else (e.g.
 		// vm_page_allocate_page_run() can pick it up), since they would be
@@ -3304,6 +3409,18 @@ vm_page_init(kernel_args *args)
 
 	TRACE(("initialized table\n"));
 
+	// Allocate the shadow entries for evicted pages. With one entry per two
+	// pages, we can recognize the refault of a page that was evicted about
+	// half the memory size ago.
+	uint32 shadowCount = 256;
+	while (shadowCount < sNumPages / 2 && shadowCount < (1 << 30))
+		shadowCount *= 2;
+	sPageShadows = (page_shadow_entry*)vm_allocate_early(args,
+		shadowCount * sizeof(page_shadow_entry), ~0L,
+		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA, 0);
+	memset(sPageShadows, 0, shadowCount * sizeof(page_shadow_entry));
+	sPageShadowMask = shadowCount - 1;
+
 	// mark the ranges between usable physical memory unused
 	phys_addr_t previousEnd = 0;
 	for (uint32 i = 0; i < args->num_physical_memory_ranges; i++) {
@@ -3357,6 +3474,11 @@ vm_page_init_post_area(kernel_args *args)
 		PAGE_ALIGN(sNumPages * sizeof(vm_page)), B_ALREADY_WIRED,
 		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
 
+	dummy = sPageShadows;
+	create_area("page shadow entries", &dummy, B_EXACT_ADDRESS,
+		PAGE_ALIGN((sPageShadowMask + 1) * sizeof(page_shadow_entry)),
+		B_ALREADY_WIRED, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+
 	add_debugger_command("page_stats", &dump_page_stats,
 		"Dump statistics about page usage");
 	add_debugger_command_etc("page", &dump_page,
@@ -3793,8 +3915,11 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 
 	\param flags Page allocation flags. Encodes the state the function shall
 		set the allocated pages to, whether the pages shall be marked busy
-		(VM_PAGE_ALLOC_BUSY), and whether the pages shall be cleared
-		(VM_PAGE_ALLOC_CLEAR).
+		(VM_PAGE_ALLOC_BUSY), whether the pages shall be cleared
+		(VM_PAGE_ALLOC_CLEAR), and whether the allocation is only an
+		opportunistic attempt (VM_PAGE_ALLOC_TRY), that neither waits for
+		pages to become available, nor reclaims cached pages, nor logs its
+		failure.
 	\param length The number of contiguous pages to allocate.
 	\param restrictions Restrictions to the physical addresses of the page run
 		to allocate, including \c low_address, the first acceptable physical
@@ -3846,8 +3971,19 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		boundaryMask = -boundary;
 	}
 
+	bool tryOnly = (flags & VM_PAGE_ALLOC_TRY) != 0;
+
 	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, length, priority);
+	if (tryOnly) {
+		// Don't even bother to scan the pages when there can't be a run made
+		// of free pages only.
+		int32 freePages = sUnreservedFreePages;
+		if (freePages <= 0 || (page_num_t)freePages <= 2 * length
+			|| !vm_page_try_reserve_pages(&reservation, length, priority)) {
+			return NULL;
+		}
+	} else
+		vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
 
@@ -3876,7 +4012,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		}
 
 		if (start + length > end) {
-			if (useCached == 0) {
+			if (useCached == 0 && !tryOnly) {
 				// The first iteration with free pages only was unsuccessful.
 				// Try again also considering cached pages.
 				useCached = 1;
@@ -3884,11 +4020,14 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				continue;
 			}
 
-			dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
-				"length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
-				B_PRIuPHYSADDR ") in second iteration (align: %" B_PRIuPHYSADDR
-				" boundary: %" B_PRIuPHYSADDR ") !", length, requestedStart,
-				end, restrictions->alignment, restrictions->boundary);
+			if (!tryOnly) {
+				dprintf("vm_page_allocate_page_run(): Failed to allocate run "
+					"of length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
+					B_PRIuPHYSADDR ") in second iteration (align: %"
+					B_PRIuPHYSADDR " boundary: %" B_PRIuPHYSADDR ") !", length,
+					requestedStart, end, restrictions->alignment,
+					restrictions->boundary);
+			}
 
 			freeClearQueueLocker.Unlock();
 			vm_page_unreserve_pages(&reservation);
@@ -4029,6 +4168,92 @@ vm_page_requeue(struct vm_page *page, bool tail)
 }
 
 
+/*!	Notes an access to a page that didn't go through a mapping, i.e. a read
+	or write via the file cache.
+	A cached page is only activated when it is accessed again, so that pages
+	used once -- like those of a large file that is read sequentially -- stay
+	in the cached queue and don't push the working set out of memory.
+	The page must have a cache and the cache must be locked!
+*/
+void
+vm_page_mark_accessed(struct vm_page *page)
+{
+	PAGE_ASSERT(page, page->Cache() != NULL);
+	page->Cache()->AssertLocked();
+
+	switch (page->State()) {
+		case PAGE_STATE_CACHED:
+			if (page->usage_count == 0) {
+				// the first access -- just move it to the end of the queue
+				page->usage_count = 1;
+				vm_page_requeue(page, true);
+				break;
+			}
+
+			atomic_add64(&sPageCacheActivations, 1);
+			// fall through
+		case PAGE_STATE_INACTIVE:
+			set_page_state(page, PAGE_STATE_ACTIVE);
+			// fall through
+		case PAGE_STATE_ACTIVE:
+			page->usage_count = std::min(
+				(int32)page->usage_count + kPageUsageAdvance, kPageUsageMax);
+			break;
+
+		case PAGE_STATE_MODIFIED:
+			vm_page_requeue(page, true);
+			break;
+	}
+}
+
+
+/*!	Called when a page has been newly inserted into a cache to be read in
+	from the cache's backing store.
+	If the same page had been evicted before, the number of pages that have
+	been evicted since then is the refault distance: the page would still be
+	in memory, if the inactive part of the memory had been that much larger.
+	If the distance isn't greater than the number of active pages, the page
+	is therefore part of the working set, only that it lost the competition
+	against pages used only once, and it is activated right away.
+	Returns whether the page has been activated.
+	The page must have a cache and the cache must be locked!
+*/
+bool
+vm_page_refault(struct vm_page *page)
+{
+	VMCache* cache = page->Cache();
+	PAGE_ASSERT(page, cache != NULL);
+	cache->AssertLocked();
+
+	page_shadow_entry& entry = page_shadow_entry_for(cache,
+		page->cache_offset);
+
+	InterruptsSpinLocker locker(sPageShadowLock);
+	if (entry.cache != cache || entry.offset != (uint32)page->cache_offset)
+		return false;
+
+	// Note: The cache might as well be a new one at the same address. That
+	// can only cause a needless activation, though.
+	uint32 distance = (uint32)sPageEvictions - entry.eviction;
+	entry.cache = NULL;
+	locker.Unlock();
+
+	atomic_add64(&sPageRefaults, 1);
+
+	if (distance > (uint32)sActivePageQueue.Count())
+		return false;
+
+	if (page->State() == PAGE_STATE_CACHED
+		|| page->State() == PAGE_STATE_INACTIVE) {
+		set_page_state(page, PAGE_STATE_ACTIVE);
+	}
+	page->usage_count = std::max((int32)page->usage_count, kPageUsageRefault);
+
+	atomic_add64(&sPageRefaultActivations, 1);
+	return true;
+}
+
+
 page_num_t
 vm_page_num_pages(void)
 {
@@ -4115,6 +4340,23 @@ vm_page_get_stats(system_info *info)
 }
 
 
+void
+vm_page_get_memory_info(system_memory_info* info)
+{
+	info->active_pages = sActivePageQueue.Count();
+	info->inactive_pages = sInactivePageQueue.Count();
+
+	// a 64 bit value can't be read atomically everywhere
+	InterruptsSpinLocker locker(sPageShadowLock);
+	info->evicted_pages = sPageEvictions;
+	locker.Unlock();
+
+	info->refault_pages = sPageRefaults;
+	info->refault_activations = sPageRefaultActivations;
+	info->cache_activations = sPageCacheActivations;
+}
+
+
 /*!	Returns the greatest address within the last page of accessible physical
 	memory.
 	The value is inclusive, i.e. in case of a 32 bit phys_addr_t 0xffffffff
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures BMessage round trips between two BLoopers, both within the same
+	team, and between two teams. Every request carries a payload of the given
+	size, and is answered with a reply of the same size.
+	Small messages are flattened and pushed through the port, large ones are
+	passed by area. Only within a team are the areas of large messages taken
+	from the pool again; between teams, each message gets a new area.
+*/
+
+
+#include <Looper.h>
+#include <Message.h>
+#include <Messenger.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+
+static const uint32 kRequest = 'rqst';
+static const uint32 kReply = 'rply';
+static const uint32 kRun = 'run_';
+
+
+class Peer : public BLooper {
+public:
+	Peer()
+		:
+		BLooper("peer"),
+		fReplySize(-1)
+	{
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		if (message->what != kRequest) {
+			BLooper::MessageReceived(message);
+			return;
+		}
+
+		const void* data;
+		ssize_t size;
+		if (message->FindData("payload", B_RAW_TYPE, &data, &size) != B_OK)
+			size = 0;
+
+		if (size != fReplySize) {
+			void* payload = calloc(1, size + 1);
+			fReply.MakeEmpty();
+			fReply.what = kReply;
+			fReply.AddData("payload", B_RAW_TYPE, payload, size);
+			fReplySize = size;
+			free(payload);
+		}
+
+		message->SendReply(&fReply);
+	}
+
+private:
+	BMessage	fReply;
+	ssize_t		fReplySize;
+};
+
+
+class Client : public BLooper {
+public:
+	Client(const BMessenger& peer, size_t size, int32 roundTrips)
+		:
+		BLooper("client"),
+		fPeer(peer),
+		fSize(size),
+		fRoundTrips(roundTrips),
+		fTime(-1)
+	{
+		fDone = create_sem(0, "client done");
+	}
+
+	~Client()
+	{
+		delete_sem(fDone);
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		if (message->what != kRun) {
+			BLooper::MessageReceived(message);
+			return;
+		}
+
+		void* payload = malloc(fSize);
+		if (payload != NULL) {
+			memset(payload, 0xcc, fSize);
+
+			BMessage request(kRequest);
+			request.AddData("payload", B_RAW_TYPE, payload, fSize);
+			free(payload);
+
+			// warm up, then measure
+			if (_RoundTrips(request, fRoundTrips / 10 + 1) >= 0)
+				fTime = _RoundTrips(request, fRoundTrips);
+		}
+
+		release_sem(fDone);
+	}
+
+	bigtime_t Wait()
+	{
+		while (acquire_sem(fDone) == B_INTERRUPTED)
+			;
+		return fTime;
+	}
+
+private:
+	bigtime_t _RoundTrips(BMessage& request, int32 count)
+	{
+		bigtime_t startTime = system_time();
+
+		for (int32 i = 0; i < count; i++) {
+			BMessage reply;
+			status_t status = fPeer.SendMessage(&request, &reply);
+			if (status != B_OK || reply.what != kReply) {
+				fprintf(stderr, "Round trip failed: %s\n", strerror(status));
+				return -1;
+			}
+		}
+
+		return system_time() - startTime;
+	}
+
+private:
+	BMessenger	fPeer;
+	size_t		fSize;
+	int32		fRoundTrips;
+	bigtime_t	fTime;
+	sem_id		fDone;
+};
+
+
+static bool
+run(const char* label, const BMessenger& peer, size_t size, int32 roundTrips)
+{
+	Client* client = new Client(peer, size, roundTrips);
+	client->Run();
+	client->PostMessage(kRun);
+	bigtime_t time = client->Wait();
+
+	client->Lock();
+	client->Quit();
+
+	if (time < 0)
+		return false;
+
+	printf("%-8s %10" B_PRIuSIZE " %10.2f %10.2f\n", label, size,
+		(double)time / roundTrips,
+		2.0 * size * roundTrips / time * 1000000.0 / 1024 / 1024);
+	return true;
+}
+
+
+/*!	Forks a child team that runs a Peer looper, and returns a messenger
+	targeting it.
+*/
+static bool
+start_remote_peer(BMessenger& _peer, pid_t& _child)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	pid_t child = fork();
+	if (child < 0) {
+		fprintf(stderr, "Failed to fork: %s\n", strerror(errno));
+		return false;
+	}
+
+	if (child == 0) {
+		close(fds[0]);
+
+		Peer* peer = new Peer;
+		thread_id thread = peer->Run();
+
+		// pass a messenger to the parent
+		BMessage info;
+		info.AddMessenger("peer", BMessenger(peer));
+		ssize_t size = info.FlattenedSize();
+		char* buffer = (char*)malloc(size);
+		if (buffer == NULL || info.Flatten(buffer, size) != B_OK
+			|| write(fds[1], &size, sizeof(size)) != sizeof(size)
+			|| write(fds[1], buffer, size) != size) {
+			exit(1);
+		}
+		free(buffer);
+		close(fds[1]);
+
+		status_t status;
+		wait_for_thread(thread, &status);
+		exit(0);
+	}
+
+	close(fds[1]);
+
+	ssize_t size;
+	char* buffer = NULL;
+	BMessage info;
+	bool success = read(fds[0], &size, sizeof(size)) == sizeof(size)
+		&& size > 0 && (buffer = (char*)malloc(size)) != NULL
+		&& read(fds[0], buffer, size) == size
+		&& info.Unflatten(buffer) == B_OK
+		&& info.FindMessenger("peer", &_peer) == B_OK;
+
+	free(buffer);
+	close(fds[0]);
+
+	if (!success) {
+		fprintf(stderr, "Failed to start the remote peer.\n");
+		kill(child, SIGKILL);
+		waitpid(child, NULL, 0);
+		return false;
+	}
+
+	_child = child;
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -n <round trips> ] [ <size> ... ]\n"
+		"The sizes default to 1 KB, 64 KB, and 4 MB.\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 roundTrips = 2000;
+
+	int c;
+	while ((c = getopt(argc, argv, "n:h")) != -1) {
+		switch (c) {
+			case 'n':
+				roundTrips = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (roundTrips < 1) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	size_t sizes[16] = { 1024, 64 * 1024, 4 * 1024 * 1024 };
+	int32 sizeCount = 3;
+	if (optind < argc) {
+		sizeCount = 0;
+		for (; optind < argc && sizeCount < 16; optind++)
+			sizes[sizeCount++] = strtoul(argv[optind], NULL, 0);
+	}
+
+	// fork before starting any threads
+	BMessenger remotePeer;
+	pid_t child;
+	if (!start_remote_peer(remotePeer, child))
+		return 1;
+
+	Peer* localPeer = new Peer;
+	localPeer->Run();
+
+	printf("%-8s %10s %10s %10s\n", "peer", "size", "us/trip", "MB/s");
+
+	bool success = true;
+	for (int32 i = 0; success && i < sizeCount; i++) {
+		// the round trips get fewer as the messages get larger
+		int32 count = roundTrips;
+		if (sizes[i] > 64 * 1024)
+			count = std::max(roundTrips / 20, (int32)10);
+
+		success = run("local", BMessenger(localPeer), sizes[i], count)
+			&& run("remote", remotePeer, sizes[i], count);
+	}
+
+	remotePeer.SendMessage(B_QUIT_REQUESTED);
+	waitpid(child, NULL, 0);
+
+	localPeer->Lock();
+	localPeer->Quit();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how long a BListView takes to lay out a large number of string
+	items, which is mostly spent measuring the strings. Every pass changes
+	the font size, so the first two passes have to get the glyph advances
+	from the app_server, while the later ones find them published already.
+	Before that, it checks that the widths and escapements BFont computes
+	from the published advances are exactly those the app_server returns
+	when it is asked directly.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Application.h>
+#include <ListView.h>
+#include <String.h>
+#include <StringItem.h>
+#include <Window.h>
+
+#include <AppServerLink.h>
+#include <ServerProtocol.h>
+
+
+static const char* const kStrings[] = {
+	"The quick brown fox jumps over the lazy dog",
+	"Gr\xc3\xbc\xc3\x9f""e aus K\xc3\xb6ln",
+	"\xce\x95\xce\xbb\xce\xbb\xce\xb7\xce\xbd\xce\xb9\xce\xba\xce\xac",
+	"\xe2\x82\xac 12,50 \xc2\xbd \xc2\xa9 \xe2\x80\x94 ok",
+	"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\x86"
+		"\xe3\x82\xad\xe3\x82\xb9\xe3\x83\x88",
+	"\xf0\x9d\x84\x9e clef"
+};
+
+static int sFailures;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+class App : public BApplication {
+public:
+								App(int32 itemCount, int32 passes);
+
+	virtual	void				ReadyToRun();
+
+private:
+			void				_CheckMeasurements();
+			void				_CheckFont(const BFont& font);
+			void				_MeasureLayout();
+
+			int32				fItemCount;
+			int32				fPasses;
+};
+
+
+/*!	Asks the app_server for the width of the first \a length bytes of
+	\a string, like BFont::StringWidth() did before it could use the
+	published advances.
+*/
+static float
+server_string_width(const BFont& font, const char* string, int32 length)
+{
+	uint32 familyAndStyle = font.FamilyAndStyle();
+
+	BPrivate::AppServerLink link;
+	link.StartMessage(AS_GET_STRING_WIDTHS);
+	link.Attach<uint16>(familyAndStyle >> 16);
+	link.Attach<uint16>(familyAndStyle & 0xffff);
+	link.Attach<float>(font.Size());
+	link.Attach<uint8>(font.Spacing());
+	link.Attach<int32>(1);
+	link.AttachString(string, length);
+
+	status_t status;
+	float width = -1.0f;
+	if (link.FlushWithReply(status) == B_OK && status == B_OK)
+		link.Read<float>(&width);
+
+	return width;
+}
+
+
+//!	Asks the app_server for the escapements of \a numChars characters.
+static bool
+server_escapements(const BFont& font, const char* string, int32 numChars,
+	float* escapements)
+{
+	uint32 familyAndStyle = font.FamilyAndStyle();
+
+	BPrivate::AppServerLink link;
+	link.StartMessage(AS_GET_ESCAPEMENTS_AS_FLOATS);
+	link.Attach<uint16>(familyAndStyle >> 16);
+	link.Attach<uint16>(familyAndStyle & 0xffff);
+	link.Attach<float>(font.Size());
+	link.Attach<uint8>(font.Spacing());
+	link.Attach<float>(font.Rotation());
+	link.Attach<uint32>(font.Flags());
+	link.Attach<float>(0.0f);
+	link.Attach<float>(0.0f);
+	link.Attach<int32>(numChars);
+	link.Attach<int32>(strlen(string));
+	link.Attach(string, strlen(string));
+
+	int32 code;
+	if (link.FlushWithReply(code) != B_OK || code != B_OK)
+		return false;
+
+	return link.Read(escapements, numChars * sizeof(float)) == B_OK;
+}
+
+
+App::App(int32 itemCount, int32 passes)
+	:
+	BApplication("application/x-vnd.Haiku-ListViewLayoutTest"),
+	fItemCount(itemCount),
+	fPasses(passes)
+{
+}
+
+
+void
+App::ReadyToRun()
+{
+	_CheckMeasurements();
+	_MeasureLayout();
+	Quit();
+}
+
+
+void
+App::_CheckMeasurements()
+{
+	BFont font(be_plain_font);
+	float size = font.Size();
+
+	// the first round can make the server publish the advances, the second
+	// finds them
+	for (int32 round = 0; round < 2; round++) {
+		font.SetSize(size);
+		_CheckFont(font);
+
+		// a size change must not use the advances of the other size
+		font.SetSize(size + 3.5f);
+		_CheckFont(font);
+		font.SetSize(size * 2);
+		_CheckFont(font);
+	}
+
+	font.SetSize(size);
+	font.SetFace(B_BOLD_FACE);
+	_CheckFont(font);
+	_CheckFont(font);
+
+	if (sFailures > 0)
+		printf("ListViewLayoutTest: %d checks FAILED\n", sFailures);
+	else
+		printf("ListViewLayoutTest: all checks passed\n");
+}
+
+
+void
+App::_CheckFont(const BFont& font)
+{
+	for (size_t i = 0; i < sizeof(kStrings) / sizeof(kStrings[0]); i++) {
+		const char* string = kStrings[i];
+		int32 length = strlen(string);
+
+		CHECK(font.StringWidth(string)
+			== server_string_width(font, string, length));
+
+		// every length, including those that end within a character
+		for (int32 cut = 1; cut < length; cut++) {
+			float width = font.StringWidth(string, cut);
+			float serverWidth = server_string_width(font, string, cut);
+			if (width != serverWidth) {
+				fprintf(stderr, "  string %" B_PRIuSIZE ", %" B_PRId32 " of %"
+					B_PRId32 " bytes at %.1fpt: %g instead of %g\n", i, cut,
+					length, font.Size(), width, serverWidth);
+			}
+			CHECK(width == serverWidth);
+		}
+
+		int32 numChars = BString(string).CountChars();
+		float escapements[numChars];
+		float serverEscapements[numChars];
+		font.GetEscapements(string, numChars, escapements);
+		CHECK(server_escapements(font, string, numChars, serverEscapements));
+		CHECK(memcmp(escapements, serverEscapements,
+			numChars * sizeof(float)) == 0);
+	}
+}
+
+
+void
+App::_MeasureLayout()
+{
+	BWindow* window = new BWindow(BRect(100, 100, 499, 599),
+		"ListView layout", B_TITLED_WINDOW, B_ASYNCHRONOUS_CONTROLS);
+	BListView* listView = new BListView(window->Bounds(), "list",
+		B_SINGLE_SELECTION_LIST, B_FOLLOW_ALL);
+	window->AddChild(listView);
+	window->Lock();
+
+	BList items(fItemCount);
+	for (int32 i = 0; i < fItemCount; i++) {
+		BString text;
+		text.SetToFormat("%" B_PRId32 ": The quick brown fox jumps over the "
+			"lazy dog", i);
+		items.AddItem(new BStringItem(text.String()));
+	}
+
+	printf("%-20s %10s %12s\n", "pass", "ms", "us/item");
+
+	bigtime_t start = system_time();
+	listView->AddList(&items);
+	bigtime_t time = system_time() - start;
+	printf("%-20s %10.2f %12.2f\n", "add items", time / 1000.0,
+		(double)time / fItemCount);
+
+	BFont font(be_plain_font);
+	float size = font.Size();
+
+	for (int32 pass = 0; pass < fPasses; pass++) {
+		font.SetSize(size + 1 + pass % 2);
+
+		start = system_time();
+		listView->SetFont(&font);
+		time = system_time() - start;
+
+		BString name;
+		name.SetToFormat("relayout %" B_PRId32 " (%.0fpt)", pass + 1,
+			font.Size());
+		printf("%-20s %10.2f %12.2f\n", name.String(), time / 1000.0,
+			(double)time / fItemCount);
+	}
+
+	window->Quit();
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 itemCount = 10000;
+	int32 passes = 6;
+	if (argc > 1)
+		itemCount = atol(argv[1]);
+	if (argc > 2)
+		passes = atol(argv[2]);
+
+	if (itemCount < 1 || passes < 1) {
+		fprintf(stderr, "Usage: %s [ <items> [ <passes> ] ]\n", argv[0]);
+		return 1;
+	}
+
+	App app(itemCount, passes);
+	app.Run();
+	return sFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the number of small UDP datagrams per second that can be passed
+	through the loopback device, using one or more sender/receiver pairs that
+	each have their own port, so that they can be spread over the receive
+	queues of the stack.
+*/
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int32 kMaxFlows = 16;
+
+struct flow {
+	int				sender;
+	int				receiver;
+	size_t			packet_size;
+	int64			sent;
+	int64			received;
+	pthread_t		sender_thread;
+	pthread_t		receiver_thread;
+};
+
+static volatile bool sQuit;
+
+
+static void*
+sender_thread(void* _flow)
+{
+	flow& flow = *(struct flow*)_flow;
+	char buffer[65536];
+	memset(buffer, 'x', flow.packet_size);
+
+	while (!sQuit) {
+		if (send(flow.sender, buffer, flow.packet_size, 0) >= 0)
+			flow.sent++;
+		else if (errno != ENOBUFS && errno != EAGAIN)
+			break;
+	}
+
+	return NULL;
+}
+
+
+static void*
+receiver_thread(void* _flow)
+{
+	flow& flow = *(struct flow*)_flow;
+	char buffer[65536];
+
+	while (recv(flow.receiver, buffer, sizeof(buffer), 0) > 0)
+		flow.received++;
+
+	return NULL;
+}
+
+
+static bool
+open_flow(flow& flow)
+{
+	flow.sender = socket(AF_INET, SOCK_DGRAM, 0);
+	flow.receiver = socket(AF_INET, SOCK_DGRAM, 0);
+	if (flow.sender < 0 || flow.receiver < 0)
+		return false;
+
+	int size = 1024 * 1024;
+	setsockopt(flow.receiver, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t addressLength = sizeof(address);
+	if (bind(flow.receiver, (sockaddr*)&address, sizeof(address)) != 0
+		|| getsockname(flow.receiver, (sockaddr*)&address, &addressLength) != 0
+		|| connect(flow.sender, (sockaddr*)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "Failed to set up flow: %s\n", strerror(errno));
+		return false;
+	}
+
+	flow.sent = 0;
+	flow.received = 0;
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -f <flows> ] [ -s <packet size> ] "
+		"[ -t <seconds> ]\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 flowCount = 1;
+	size_t packetSize = 64;
+	int32 seconds = 5;
+
+	int c;
+	while ((c = getopt(argc, argv, "f:s:t:h")) != -1) {
+		switch (c) {
+			case 'f':
+				flowCount = atol(optarg);
+				break;
+			case 's':
+				packetSize = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				seconds = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (flowCount < 1 || flowCount > kMaxFlows || packetSize < 1
+		|| packetSize > 65000 || seconds < 1) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	flow flows[kMaxFlows];
+	for (int32 i = 0; i < flowCount; i++) {
+		flows[i].packet_size = packetSize;
+		if (!open_flow(flows[i]))
+			return 1;
+	}
+
+	for (int32 i = 0; i < flowCount; i++) {
+		pthread_create(&flows[i].receiver_thread, NULL, &receiver_thread,
+			&flows[i]);
+		pthread_create(&flows[i].sender_thread, NULL, &sender_thread,
+			&flows[i]);
+	}
+
+	bigtime_t startTime = system_time();
+	snooze(seconds * 1000000LL);
+	sQuit = true;
+
+	for (int32 i = 0; i < flowCount; i++)
+		pthread_join(flows[i].sender_thread, NULL);
+
+	// give the stack a moment to deliver what is still queued
+	snooze(100000);
+	bigtime_t time = system_time() - startTime;
+
+	int64 sent = 0;
+	int64 received = 0;
+	for (int32 i = 0; i < flowCount; i++) {
+		shutdown(flows[i].receiver, SHUT_RDWR);
+		close(flows[i].receiver);
+		pthread_join(flows[i].receiver_thread, NULL);
+		close(flows[i].sender);
+
+		sent += flows[i].sent;
+		received += flows[i].received;
+	}
+
+	printf("%" B_PRId32 " flows, %" B_PRIuSIZE " bytes: %" B_PRId64 " sent, %"
+		B_PRId64 " received, %.0f packets/s\n", flowCount, packetSize, sent,
+		received, received * 1000000.0 / time);
+
+	return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the throughput of sending a file over a loopback TCP connection,
+	once with read() and send(), and once with sendfile(). Before that, both
+	are run once with the receiver comparing what arrives to the file.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kBufferSize = 65536;
+
+
+struct receiver_data {
+	int		socket;
+	int		file;
+		// compare the received data to this file, if >= 0
+	off_t	received;
+	bool	matches;
+};
+
+
+static void*
+receiver_thread(void* _data)
+{
+	receiver_data* data = (receiver_data*)_data;
+	char* buffer = (char*)malloc(kBufferSize);
+	char* fileBuffer = (char*)malloc(kBufferSize);
+	if (buffer == NULL || fileBuffer == NULL) {
+		free(buffer);
+		free(fileBuffer);
+		data->matches = false;
+		return NULL;
+	}
+
+	while (true) {
+		ssize_t bytesReceived = recv(data->socket, buffer, kBufferSize, 0);
+		if (bytesReceived <= 0)
+			break;
+
+		if (data->file >= 0 && data->matches
+			&& (pread(data->file, fileBuffer, bytesReceived, data->received)
+					!= bytesReceived
+				|| memcmp(buffer, fileBuffer, bytesReceived) != 0)) {
+			fprintf(stderr, "Received data differs from the file after "
+				"offset %" B_PRIdOFF "\n", data->received);
+			data->matches = false;
+		}
+
+		data->received += bytesReceived;
+	}
+
+	free(buffer);
+	free(fileBuffer);
+	return NULL;
+}
+
+
+static bool
+connect_loopback(int& _sender, int& _receiver)
+{
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	if (server < 0)
+		return false;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t addressLength = sizeof(address);
+	if (bind(server, (sockaddr*)&address, sizeof(address)) != 0
+		|| listen(server, 1) != 0
+		|| getsockname(server, (sockaddr*)&address, &addressLength) != 0) {
+		close(server);
+		return false;
+	}
+
+	_sender = socket(AF_INET, SOCK_STREAM, 0);
+	if (_sender < 0
+		|| connect(_sender, (sockaddr*)&address, sizeof(address)) != 0) {
+		close(server);
+		return false;
+	}
+
+	_receiver = accept(server, NULL, NULL);
+	close(server);
+
+	return _receiver >= 0;
+}
+
+
+static bigtime_t
+send_file(int file, off_t size, bool useSendfile, bool verify = false)
+{
+	int sender, receiver;
+	if (!connect_loopback(sender, receiver)) {
+		fprintf(stderr, "Failed to connect: %s\n", strerror(errno));
+		return -1;
+	}
+
+	receiver_data data;
+	data.socket = receiver;
+	data.file = verify ? file : -1;
+	data.received = 0;
+	data.matches = true;
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, &receiver_thread, &data);
+
+	char* buffer = (char*)malloc(kBufferSize);
+	bigtime_t startTime = system_time();
+	off_t offset = 0;
+
+	while (offset < size) {
+		ssize_t bytesSent;
+		if (useSendfile) {
+			bytesSent = sendfile(sender, file, &offset, size - offset);
+		} else {
+			ssize_t bytesRead = pread(file, buffer, kBufferSize, offset);
+			if (bytesRead <= 0)
+				break;
+
+			bytesSent = send(sender, buffer, bytesRead, 0);
+			if (bytesSent > 0)
+				offset += bytesSent;
+		}
+
+		if (bytesSent <= 0) {
+			fprintf(stderr, "Failed to send: %s\n", strerror(errno));
+			break;
+		}
+	}
+
+	close(sender);
+	pthread_join(thread, NULL);
+
+	bigtime_t time = system_time() - startTime;
+
+	close(receiver);
+	free(buffer);
+
+	if (data.received != size || !data.matches) {
+		fprintf(stderr, "%s: received %" B_PRIdOFF " of %" B_PRIdOFF
+			" bytes%s\n", useSendfile ? "sendfile()" : "read()/send()",
+			data.received, size, data.matches ? "" : ", with wrong data");
+		return -1;
+	}
+
+	return offset == size ? time : -1;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -s <size in MB> ] [ <file> ]\n",
+		programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	off_t size = 256;
+
+	int c;
+	while ((c = getopt(argc, argv, "s:h")) != -1) {
+		switch (c) {
+			case 's':
+				size = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	size *= 1024 * 1024;
+
+	const char* path = optind < argc ? argv[optind] : "/tmp/sendfile_bench";
+	bool created = optind >= argc;
+
+	int file;
+	if (created) {
+		file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) {
+			fprintf(stderr, "Failed to create %s: %s\n", path, strerror(errno));
+			return 1;
+		}
+
+		// every 32 bit word contains its offset, so that data arriving in
+		// the wrong order is detected, too
+		uint32* buffer = (uint32*)malloc(kBufferSize);
+		for (off_t offset = 0; offset < size; offset += kBufferSize) {
+			for (size_t i = 0; i < kBufferSize / sizeof(uint32); i++)
+				buffer[i] = (uint32)(offset + i * sizeof(uint32));
+			write(file, buffer, kBufferSize);
+		}
+		free(buffer);
+	} else {
+		file = open(path, O_RDONLY);
+		if (file < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+			return 1;
+		}
+		size = lseek(file, 0, SEEK_END);
+	}
+
+	// warm up the file cache, and check that both get the data across
+	if (send_file(file, size, false, true) < 0
+		|| send_file(file, size, true, true) < 0) {
+		close(file);
+		if (created)
+			unlink(path);
+		return 1;
+	}
+
+	bigtime_t sendTime = send_file(file, size, false);
+	bigtime_t sendfileTime = send_file(file, size, true);
+
+	close(file);
+	if (created)
+		unlink(path);
+
+	if (sendTime <= 0 || sendfileTime <= 0)
+		return 1;
+
+	printf("read()/send(): %8.2f MB/s\n",
+		1.0 * size / sendTime * 1000000 / (1024 * 1024));
+	printf("sendfile():    %8.2f MB/s\n",
+		1.0 * size / sendfileTime * 1000000 / (1024 * 1024));
+
+	return 0;
+}
@@ -140,6 +140,50 @@ main()
 	add(500, 1000);
 	dump("added data covered by next");
 
+	// SACK scoreboard of a send queue
+
+	BufferQueue sendQueue(32768);
+	sendQueue.SetInitialSequence(1000);
+	for (int i = 0; i < 5; i++)
+		sendQueue.Add(create_filled_buffer(100));
+
+	sendQueue.AddSack(1200, 1300);
+	sendQueue.AddSack(1400, 1500);
+	ASSERT(sendQueue.SackedBytes() == 200);
+	sendQueue.AddSack(1250, 1450);
+	ASSERT(sendQueue.SackedBytes() == 300);
+	ASSERT(sendQueue.HighestSacked() == 1500);
+	ASSERT(sendQueue.SackedBytes(1000, 1300) == 100);
+
+	tcp_sequence start;
+	tcp_sequence end;
+	ASSERT(sendQueue.FindHole(1000, 1500, start, end));
+	ASSERT(start == 1000 && end == 1200);
+	ASSERT(!sendQueue.FindHole(1200, 1500, start, end));
+
+	sendQueue.RemoveUntil(1250);
+	ASSERT(sendQueue.SackedBytes() == 250);
+	sendQueue.RemoveUntil(1500);
+	ASSERT(sendQueue.SackedBytes() == 0);
+	puts("SACK scoreboard okay");
+
+	// SACK blocks of a receive queue
+
+	BufferQueue receiveQueue(32768);
+	receiveQueue.SetInitialSequence(1000);
+	receiveQueue.Add(create_filled_buffer(100), 1000);
+	receiveQueue.Add(create_filled_buffer(100), 1200);
+	receiveQueue.Add(create_filled_buffer(100), 1400);
+	receiveQueue.Add(create_filled_buffer(50), 1150);
+
+	tcp_sack sacks[4];
+	int sackCount = receiveQueue.PopulateSackInfo(
+		receiveQueue.NextSequence(), 4, sacks);
+	ASSERT(sackCount == 2);
+	ASSERT(sacks[0].left_edge == 1150 && sacks[0].right_edge == 1300);
+	ASSERT(sacks[1].left_edge == 1400 && sacks[1].right_edge == 1500);
+	puts("SACK blocks okay");
+
 	put_module(NET_BUFFER_MODULE_NAME);
 	return 0;
 }
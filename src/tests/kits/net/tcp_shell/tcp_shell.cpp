@@ -29,7 +29,9 @@
 #include <Locker.h>
 
 #include <ctype.h>
+#include <deque>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <new>
 #include <set>
 #include <stdio.h>
@@ -37,10 +39,15 @@
 #include <string.h>
 
 
+struct queued_packet {
+	net_buffer*	buffer;
+	bigtime_t	due;
+};
+
 struct context {
 	BLocker		lock;
 	sem_id		wait_sem;
-	struct list list;
+	deque<queued_packet> packets;
 	net_route	route;
 	bool		server;
 	thread_id	thread;
@@ -99,6 +106,17 @@ static bool sSimultaneousConnect = false;
 static bool sSimultaneousClose = false;
 static bool sServerActiveClose = false;
 
+// loss recovery test state
+static uint32 sDataSegmentNumber;
+static set<uint32> sDropDataSegments;
+static bool sHaveClientSequence;
+static uint32 sClientSequenceEnd;
+static vint32 sRetransmittedSegments;
+static vint32 sDroppedSegments;
+static vint32 sSackAcknowledges;
+static vint32 sServerReceived;
+static bool sServerCorrupt;
+
 static struct net_domain sDomain = {
 	"ipv4",
 	AF_INET,
@@ -141,6 +159,81 @@ is_fin(net_buffer* buffer)
 }
 
 
+static bool
+has_sack_option(net_buffer* buffer, const tcp_header& header)
+{
+	int32 size = header.HeaderLength() - sizeof(tcp_header);
+	if (size <= 0)
+		return false;
+
+	uint8 options[64];
+	if (size > (int32)sizeof(options)
+		|| gBufferModule->read(buffer, sizeof(tcp_header), options, size)
+			!= B_OK) {
+		return false;
+	}
+
+	int32 offset = 0;
+	while (offset < size) {
+		uint8 kind = options[offset];
+		if (kind == TCP_OPTION_END)
+			break;
+		if (kind == TCP_OPTION_NOP) {
+			offset++;
+			continue;
+		}
+		if (kind == TCP_OPTION_SACK)
+			return true;
+		if (offset + 1 >= size || options[offset + 1] < 2)
+			break;
+
+		offset += options[offset + 1];
+	}
+
+	return false;
+}
+
+
+/*!	Keeps track of the segments the loss recovery test is interested in, and
+	returns whether \a buffer is a data segment that should be dropped.
+	Only the first transmission of a data segment from the client is ever
+	dropped, so that the test doesn't have to rely on retransmission timeouts.
+*/
+static bool
+account_segment(net_buffer* buffer)
+{
+	NetBufferHeaderReader<tcp_header> bufferHeader(buffer);
+	if (bufferHeader.Status() < B_OK)
+		return false;
+
+	tcp_header& header = bufferHeader.Data();
+
+	if (is_server((sockaddr*)buffer->source)) {
+		if ((header.flags & TCP_FLAG_ACKNOWLEDGE) != 0
+			&& has_sack_option(buffer, header))
+			atomic_add(&sSackAcknowledges, 1);
+		return false;
+	}
+
+	int32 length = buffer->size - header.HeaderLength();
+	if (length <= 0)
+		return false;
+
+	uint32 sequence = header.Sequence();
+	if (sHaveClientSequence
+		&& (int32)(sequence - sClientSequenceEnd) < 0) {
+		atomic_add(&sRetransmittedSegments, 1);
+		return false;
+	}
+
+	sHaveClientSequence = true;
+	sClientSequenceEnd = sequence + length;
+
+	return sDropDataSegments.find(++sDataSegmentNumber)
+		!= sDropDataSegments.end();
+}
+
+
 //	#pragma mark - stack
 
 
@@ -720,8 +813,27 @@ datalink_send_data(struct net_route *route, net_buffer *buffer)
 
 	buffer->interface = &gInterface;
 
+	// the packet is delayed on the link, but the link doesn't stall while
+	// it is on its way
+	bigtime_t delay = 0;
+	if (sRoundTripTime > 0 || sRandomRoundTrip || sIncreasingRoundTrip) {
+		bigtime_t add = 0;
+		if (sRandomRoundTrip)
+			add = (bigtime_t)(1.0 * rand() / RAND_MAX * 500000) - 250000;
+		if (sIncreasingRoundTrip)
+			sRoundTripTime += (bigtime_t)(1.0 * rand() / RAND_MAX * 150000);
+
+		delay = max_c(sRoundTripTime / 2 + add, 0);
+	}
+
 	context->lock.Lock();
-	list_add_item(&context->list, buffer);
+	queued_packet packet;
+	packet.buffer = buffer;
+	packet.due = system_time() + delay;
+	if (!context->packets.empty() && context->packets.back().due > packet.due)
+		packet.due = context->packets.back().due;
+			// the link never reorders by itself
+	context->packets.push_back(packet);
 	context->lock.Unlock();
 
 	release_sem(context->wait_sem);
@@ -919,17 +1031,11 @@ domain_receive_data(net_buffer *buffer)
 
 	bool drop = false;
 	if (sDropList.find(packetNumber) != sDropList.end()
-		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) > sRandomDrop))
+		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) < sRandomDrop))
 		drop = true;
-
-	if (!drop && (sRoundTripTime > 0 || sRandomRoundTrip || sIncreasingRoundTrip)) {
-		bigtime_t add = 0;
-		if (sRandomRoundTrip)
-			add = (bigtime_t)(1.0 * rand() / RAND_MAX * 500000) - 250000;
-		if (sIncreasingRoundTrip)
-			sRoundTripTime += (bigtime_t)(1.0 * rand() / RAND_MAX * 150000);
-
-		snooze(sRoundTripTime / 2 + add);
+	if (account_segment(buffer) && !drop) {
+		drop = true;
+		atomic_add(&sDroppedSegments, 1);
 	}
 
 	if (sTCPDump) {
@@ -1006,6 +1112,27 @@ domain_receive_data(net_buffer *buffer)
 						printf(" <ts %lu:%lu>", option->timestamp.value, option->timestamp.reply);
 						length = 10;
 						break;
+					case TCP_OPTION_SACK_PERMITTED:
+						printf(" <sackOK>");
+						length = 2;
+						break;
+					case TCP_OPTION_SACK:
+					{
+						length = option->length;
+						if (length < 2) {
+							size = 0;
+							break;
+						}
+
+						printf(" <sack");
+						for (uint32 i = 0; i < (length - 2) / sizeof(tcp_sack);
+								i++) {
+							printf(" %lu:%lu", ntohl(option->sack[i].left_edge),
+								ntohl(option->sack[i].right_edge));
+						}
+						putchar('>');
+						break;
+					}
 
 					default:
 						length = option->length;
@@ -1108,12 +1235,23 @@ receiving_thread(void* _data)
 
 		while (true) {
 			context->lock.Lock();
-			net_buffer* buffer = (net_buffer*)list_remove_head_item(
-				&context->list);
+			if (context->packets.empty()) {
+				context->lock.Unlock();
+				break;
+			}
+
+			queued_packet packet = context->packets.front();
+			if (packet.due > system_time()) {
+				// wait until it has crossed the link
+				context->lock.Unlock();
+				snooze_until(packet.due, B_SYSTEM_TIMEBASE);
+				continue;
+			}
+
+			context->packets.pop_front();
 			context->lock.Unlock();
 
-			if (buffer == NULL)
-				break;
+			net_buffer* buffer = packet.buffer;
 
 			if (sSimultaneousConnect && context->server && is_syn(buffer)) {
 				// delay getting the SYN request, and connect as well
@@ -1134,10 +1272,10 @@ receiving_thread(void* _data)
 				close_protocol(gClientSocket->first_protocol);
 				sSimultaneousClose = false;
 			}
-			if ((sRandomReorder > 0.0
-					|| sReorderList.find(sPacketNumber) != sReorderList.end())
-				&& reorderBuffer == NULL
-				&& (1.0 * rand() / RAND_MAX) > sRandomReorder) {
+			if ((sReorderList.find(sPacketNumber) != sReorderList.end()
+					|| (sRandomReorder > 0.0
+						&& (1.0 * rand() / RAND_MAX) < sRandomReorder))
+				&& reorderBuffer == NULL) {
 				reorderBuffer = buffer;
 			} else {
 				if (sDomain.module->receive_data(buffer) < B_OK)
@@ -1175,9 +1313,23 @@ server_thread(void*)
 
 		char buffer[1024];
 		ssize_t bytesRead;
+		off_t totalBytes = 0;
+		bigtime_t startTime = system_time();
 		while ((bytesRead = socket_recv(connectionSocket, buffer,
 				sizeof(buffer), 0)) > 0) {
-			printf("server: received %ld bytes\n", bytesRead);
+			if (sTCPDump)
+				printf("server: received %ld bytes\n", bytesRead);
+
+			// the client always sends the same pattern
+			for (ssize_t i = 0; i < bytesRead; i++) {
+				if (buffer[i] != (char)((totalBytes + i) & 0xff)) {
+					sServerCorrupt = true;
+					break;
+				}
+			}
+
+			totalBytes += bytesRead;
+			atomic_add(&sServerReceived, bytesRead);
 
 			if (sServerActiveClose) {
 				printf("server: active close\n");
@@ -1190,6 +1342,10 @@ server_thread(void*)
 		else
 			printf("server: peer closed connection.\n");
 
+		bigtime_t time = system_time() - startTime;
+		printf("server: received %lld bytes in %g s (%g KB/s)\n", totalBytes,
+			time / 1000000.0, time > 0 ? totalBytes * 1000000.0 / 1024 / time : 0);
+
 		snooze(1000000);
 		close_protocol(connectionSocket->first_protocol);
 	}
@@ -1236,7 +1392,6 @@ setup_server()
 void
 setup_context(struct context& context, bool server)
 {
-	list_init(&context.list);
 	context.route.interface = &gInterface;
 	context.route.gateway = (sockaddr *)&context;
 		// backpointer to the context
@@ -1529,6 +1684,187 @@ do_round_trip_time(int argc, char** argv)
 }
 
 
+static void
+do_congestion_control(int argc, char** argv)
+{
+	if (argc != 2) {
+		char name[32];
+		int length = sizeof(name);
+		if (gTCPModule->getsockopt(gClientSocket->first_protocol, IPPROTO_TCP,
+				TCP_CONGESTION, name, &length) == B_OK)
+			printf("Congestion control: %s\n", name);
+
+		puts("usage: cc <newreno|cubic>\n\n"
+			"Sets the congestion control algorithm of the client; it must be\n"
+			"set before connecting.");
+		return;
+	}
+
+	status_t status = gTCPModule->setsockopt(gClientSocket->first_protocol,
+		IPPROTO_TCP, TCP_CONGESTION, argv[1], strlen(argv[1]));
+	if (status != B_OK) {
+		fprintf(stderr, "Could not set congestion control: %s\n",
+			strerror(status));
+	}
+}
+
+
+/*!	Sends \a size bytes over a new connection using \a algorithm, while the
+	data segments in \a drops are lost, and checks that everything arrives
+	intact, and that only the lost segments are sent again, as SACK allows.
+*/
+static bool
+run_recovery_test(const char* algorithm, size_t size, const uint32* drops,
+	int32 dropCount)
+{
+	sDropDataSegments.clear();
+	for (int32 i = 0; i < dropCount; i++)
+		sDropDataSegments.insert(drops[i]);
+
+	sDataSegmentNumber = 0;
+	sHaveClientSequence = false;
+	sServerCorrupt = false;
+	atomic_set(&sRetransmittedSegments, 0);
+	atomic_set(&sDroppedSegments, 0);
+	atomic_set(&sSackAcknowledges, 0);
+	atomic_set(&sServerReceived, 0);
+
+	char* buffer = (char*)malloc(size);
+	net_socket* socket = NULL;
+	net_protocol* client = init_protocol(&socket);
+	if (buffer == NULL || client == NULL) {
+		free(buffer);
+		fprintf(stderr, "%s: could not create the client\n", algorithm);
+		return false;
+	}
+
+	for (size_t i = 0; i < size; i++)
+		buffer[i] = (char)(i & 0xff);
+
+	status_t status = gTCPModule->setsockopt(client, IPPROTO_TCP,
+		TCP_CONGESTION, algorithm, strlen(algorithm));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(1024);
+	address.sin_addr.s_addr = htonl(0xc0a80001);
+
+	if (status == B_OK) {
+		status = socket_connect(socket, (struct sockaddr*)&address,
+			sizeof(struct sockaddr));
+	}
+
+	bigtime_t startTime = system_time();
+	if (status == B_OK) {
+		ssize_t bytesSent = socket_send(socket, buffer, size, 0);
+		if (bytesSent < 0)
+			status = bytesSent;
+	}
+
+	// give it a generous amount of time; recovering via retransmission
+	// timeouts would take much longer, though
+	while (status == B_OK && (size_t)sServerReceived < size
+		&& system_time() - startTime < 20000000) {
+		snooze(10000);
+	}
+	bigtime_t time = system_time() - startTime;
+
+	close_protocol(client);
+	free(buffer);
+
+	int32 retransmitted = sRetransmittedSegments;
+	bool passed = status == B_OK && (size_t)sServerReceived == size
+		&& !sServerCorrupt && sDroppedSegments == dropCount
+		&& sSackAcknowledges > 0 && retransmitted >= dropCount
+		&& retransmitted <= dropCount + 2;
+
+	printf("%-8s %s: %" B_PRId32 " of %" B_PRIuSIZE " bytes%s in %g s, "
+		"%" B_PRId32 " dropped, %" B_PRId32 " retransmitted, %" B_PRId32
+		" SACKs\n", algorithm, passed ? "PASSED" : "FAILED",
+		(int32)sServerReceived, size, sServerCorrupt ? " (corrupt)" : "",
+		time / 1000000.0, (int32)sDroppedSegments, retransmitted,
+		(int32)sSackAcknowledges);
+	if (status != B_OK)
+		printf("         %s\n", strerror(status));
+
+	return passed;
+}
+
+
+/*!	Runs the loss recovery test with all congestion control algorithms,
+	and returns whether all of them passed.
+*/
+static bool
+run_recovery_tests()
+{
+	static const uint32 kDrops[] = { 30, 33, 36, 80 };
+		// three holes in one window, and a single loss later on
+	static const char* const kAlgorithms[] = { "newreno", "cubic" };
+
+	// only the losses of the test itself, on a link with a fixed delay
+	bool dump = sTCPDump;
+	bigtime_t roundTripTime = sRoundTripTime;
+	bool randomRoundTrip = sRandomRoundTrip;
+	bool increasingRoundTrip = sIncreasingRoundTrip;
+	double randomDrop = sRandomDrop;
+	double randomReorder = sRandomReorder;
+	set<uint32> dropList = sDropList;
+	set<uint32> reorderList = sReorderList;
+
+	sTCPDump = false;
+	sRoundTripTime = 20000;
+	sRandomRoundTrip = false;
+	sIncreasingRoundTrip = false;
+	sRandomDrop = 0.0;
+	sRandomReorder = 0.0;
+	sDropList.clear();
+	sReorderList.clear();
+
+	bool passed = true;
+	for (size_t i = 0; i < sizeof(kAlgorithms) / sizeof(kAlgorithms[0]);
+			i++) {
+		if (!run_recovery_test(kAlgorithms[i], 512 * 1024, kDrops,
+				sizeof(kDrops) / sizeof(kDrops[0]))) {
+			passed = false;
+		}
+
+		// the server waits a second before it accepts the next connection
+		snooze(1500000);
+	}
+
+	sDropDataSegments.clear();
+	sTCPDump = dump;
+	sRoundTripTime = roundTripTime;
+	sRandomRoundTrip = randomRoundTrip;
+	sIncreasingRoundTrip = increasingRoundTrip;
+	sRandomDrop = randomDrop;
+	sRandomReorder = randomReorder;
+	sDropList = dropList;
+	sReorderList = reorderList;
+	return passed;
+}
+
+
+static void
+do_test(int argc, char** argv)
+{
+	run_recovery_tests();
+}
+
+
+static void
+do_dump(int argc, char** argv)
+{
+	if (argc > 1)
+		sTCPDump = !strcmp(argv[1], "on");
+	else
+		sTCPDump = !sTCPDump;
+
+	printf("packet dump turned %s.\n", sTCPDump ? "on" : "off");
+}
+
+
 static void
 do_dprintf(int argc, char** argv)
 {
@@ -1545,11 +1881,14 @@ static cmd_entry sBuiltinCommands[] = {
 	{"connect", do_connect, "Connects the client"},
 	{"send", do_send, "Sends data from the client to the server"},
 	{"close", do_close, "Performs an active or simultaneous close"},
+	{"cc", do_congestion_control, "Selects the congestion control algorithm"},
 	{"dprintf", do_dprintf, "Toggles debug output"},
+	{"dump", do_dump, "Toggles the packet dump"},
 	{"drop", do_drop, "Lets you drop packets during transfer"},
 	{"reorder", do_reorder, "Lets you reorder packets during transfer"},
 	{"help", do_help, "prints this help text"},
 	{"rtt", do_round_trip_time, "Specifies the round trip time"},
+	{"test", do_test, "Runs the loss recovery test on new connections"},
 	{"quit", NULL, "exits the application"},
 	{NULL, NULL, NULL},
 };
@@ -1619,6 +1958,11 @@ main(int argc, char** argv)
 
 	setup_server();
 
+	if (argc > 1 && !strcmp(argv[1], "--test")) {
+		// run the recovery test, and exit with its result
+		return run_recovery_tests() ? 0 : 1;
+	}
+
 	while (true) {
 		printf("> ");
 		fflush(stdout);
@@ -0,0 +1,370 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the data compression algorithms of the hpkg format. The given
+	files (by default some of the system's libraries) are compressed in
+	chunks the way the package writer does it, and then read back in
+	patterns like those of an application launch from packagefs: the first
+	and the last chunk (ELF headers and section tables), followed by random
+	chunks (page faults in the code), and finally a sequential read of the
+	whole file, for comparison.
+	Before it is timed, every chunk is decompressed once and compared to the
+	original data.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/Lz4Compressor.h>
+#include <package/hpkg/Lz4Decompressor.h>
+#include <package/hpkg/ZlibCompressor.h>
+#include <package/hpkg/ZlibDecompressor.h>
+
+
+using namespace BPackageKit::BHPKG;
+using namespace BPackageKit::BHPKG::BPrivate;
+
+
+static const size_t kChunkSize = B_HPKG_DEFAULT_DATA_CHUNK_SIZE_ZLIB;
+
+static const char* const kDefaultFiles[] = {
+	"/boot/system/lib/libbe.so",
+	"/boot/system/lib/libroot.so",
+	"/boot/system/lib/libtracker.so",
+	"/boot/system/lib/libstdc++.so",
+	NULL
+};
+
+
+struct compressed_chunk {
+	uint8*	data;
+	size_t	size;
+	size_t	uncompressedSize;
+	bool	compressed;
+};
+
+struct compressed_file {
+	compressed_chunk*	chunks;
+	int32				chunkCount;
+};
+
+struct codec_info {
+	const char*	name;
+	status_t	(*compress)(const void* input, size_t inputSize, void* output,
+					size_t outputSize, size_t& _compressedSize);
+	status_t	(*decompress)(const void* input, size_t inputSize,
+					void* output, size_t outputSize,
+					size_t& _uncompressedSize);
+};
+
+static const codec_info kCodecs[] = {
+	{ "zlib", &ZlibCompressor::CompressSingleBuffer,
+		&ZlibDecompressor::DecompressSingleBuffer },
+	{ "lz4", &Lz4Compressor::CompressSingleBuffer,
+		&Lz4Decompressor::DecompressSingleBuffer },
+};
+static const int32 kCodecCount = sizeof(kCodecs) / sizeof(kCodecs[0]);
+
+
+static uint8*
+read_file(const char* path, size_t& _size)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	struct stat st;
+	uint8* buffer = NULL;
+	if (fstat(fd, &st) == 0)
+		buffer = (uint8*)malloc(st.st_size > 0 ? st.st_size : 1);
+
+	if (buffer == NULL
+		|| read(fd, buffer, st.st_size) != (ssize_t)st.st_size) {
+		fprintf(stderr, "Failed to read \"%s\"\n", path);
+		free(buffer);
+		buffer = NULL;
+	} else
+		_size = st.st_size;
+
+	close(fd);
+	return buffer;
+}
+
+
+static bool
+compress_file(const codec_info& codec, const uint8* data, size_t size,
+	compressed_file& file, uint64& _compressedSize)
+{
+	file.chunkCount = (size + kChunkSize - 1) / kChunkSize;
+	if (file.chunkCount == 0) {
+		file.chunks = NULL;
+		return true;
+	}
+
+	file.chunks = (compressed_chunk*)calloc(file.chunkCount,
+		sizeof(compressed_chunk));
+	if (file.chunks == NULL)
+		return false;
+
+	for (int32 i = 0; i < file.chunkCount; i++) {
+		compressed_chunk& chunk = file.chunks[i];
+		size_t offset = i * kChunkSize;
+		chunk.uncompressedSize = size - offset < kChunkSize
+			? size - offset : kChunkSize;
+		chunk.data = (uint8*)malloc(chunk.uncompressedSize);
+		if (chunk.data == NULL)
+			return false;
+
+		status_t status = codec.compress(data + offset, chunk.uncompressedSize,
+			chunk.data, chunk.uncompressedSize, chunk.size);
+		chunk.compressed = status == B_OK;
+		if (!chunk.compressed) {
+			// store the chunk uncompressed, like the package writer
+			memcpy(chunk.data, data + offset, chunk.uncompressedSize);
+			chunk.size = chunk.uncompressedSize;
+		}
+
+		_compressedSize += chunk.size;
+	}
+
+	return true;
+}
+
+
+static void
+free_file(compressed_file& file)
+{
+	if (file.chunks == NULL)
+		return;
+
+	for (int32 i = 0; i < file.chunkCount; i++)
+		free(file.chunks[i].data);
+	free(file.chunks);
+	file.chunks = NULL;
+}
+
+
+static bool
+read_chunk(const codec_info& codec, const compressed_file& file, int32 index,
+	uint8* buffer)
+{
+	const compressed_chunk& chunk = file.chunks[index];
+	if (!chunk.compressed) {
+		memcpy(buffer, chunk.data, chunk.size);
+		return true;
+	}
+
+	size_t uncompressedSize;
+	return codec.decompress(chunk.data, chunk.size, buffer,
+			chunk.uncompressedSize, uncompressedSize) == B_OK
+		&& uncompressedSize == chunk.uncompressedSize;
+}
+
+
+/*!	Decompresses all chunks of \a file, and compares them to the original
+	\a data.
+*/
+static bool
+verify_file(const codec_info& codec, const compressed_file& file,
+	const uint8* data, uint8* buffer)
+{
+	for (int32 i = 0; i < file.chunkCount; i++) {
+		const compressed_chunk& chunk = file.chunks[i];
+		if (!read_chunk(codec, file, i, buffer)
+			|| memcmp(buffer, data + i * kChunkSize, chunk.uncompressedSize)
+				!= 0) {
+			fprintf(stderr, "%s: chunk %" B_PRId32 " does not match the "
+				"original data!\n", codec.name, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Reads the chunks of all files like an application launch would, and
+	returns the time it took.
+*/
+static bigtime_t
+launch_read(const codec_info& codec, const compressed_file* files,
+	int32 fileCount, int32 randomPercentage, uint8* buffer, int64& _bytesRead)
+{
+	srand(42);
+		// all codecs should get the same pattern
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < fileCount; i++) {
+		const compressed_file& file = files[i];
+		if (file.chunkCount == 0)
+			continue;
+
+		int32 last = file.chunkCount - 1;
+		read_chunk(codec, file, 0, buffer);
+		_bytesRead += file.chunks[0].uncompressedSize;
+		if (last > 0) {
+			read_chunk(codec, file, last, buffer);
+			_bytesRead += file.chunks[last].uncompressedSize;
+		}
+
+		int32 randomReads = file.chunkCount * randomPercentage / 100;
+		for (int32 k = 0; k < randomReads; k++) {
+			int32 index = rand() % file.chunkCount;
+			read_chunk(codec, file, index, buffer);
+			_bytesRead += file.chunks[index].uncompressedSize;
+		}
+	}
+
+	return system_time() - startTime;
+}
+
+
+static bigtime_t
+sequential_read(const codec_info& codec, const compressed_file* files,
+	int32 fileCount, uint8* buffer, int64& _bytesRead)
+{
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < fileCount; i++) {
+		for (int32 k = 0; k < files[i].chunkCount; k++) {
+			if (!read_chunk(codec, files[i], k, buffer)) {
+				fprintf(stderr, "%s: chunk %" B_PRId32 " is corrupt!\n",
+					codec.name, k);
+			}
+			_bytesRead += files[i].chunks[k].uncompressedSize;
+		}
+	}
+
+	return system_time() - startTime;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -i <iterations> ] [ -r <random %%> ] "
+		"[ <file> ... ]\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 iterations = 10;
+	int32 randomPercentage = 25;
+
+	int c;
+	while ((c = getopt(argc, argv, "i:r:h")) != -1) {
+		switch (c) {
+			case 'i':
+				iterations = atol(optarg);
+				break;
+			case 'r':
+				randomPercentage = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (iterations < 1)
+		iterations = 1;
+
+	const char* const* paths = optind < argc
+		? argv + optind : kDefaultFiles;
+	int32 fileCount = optind < argc ? argc - optind : 0;
+	if (fileCount == 0) {
+		while (kDefaultFiles[fileCount] != NULL)
+			fileCount++;
+	}
+
+	uint8** data = (uint8**)calloc(fileCount, sizeof(uint8*));
+	size_t* sizes = (size_t*)calloc(fileCount, sizeof(size_t));
+	compressed_file* files = (compressed_file*)calloc(fileCount,
+		sizeof(compressed_file));
+	uint8* buffer = (uint8*)malloc(kChunkSize);
+	if (data == NULL || sizes == NULL || files == NULL || buffer == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	uint64 totalSize = 0;
+	for (int32 i = 0; i < fileCount; i++) {
+		data[i] = read_file(paths[i], sizes[i]);
+		if (data[i] == NULL)
+			return 1;
+		totalSize += sizes[i];
+	}
+
+	printf("%" B_PRId32 " files, %" B_PRIu64 " bytes, %" B_PRId32
+		" iterations, %" B_PRId32 "%% random chunks\n\n", fileCount, totalSize,
+		iterations, randomPercentage);
+	printf("%-6s %7s %12s %14s %14s\n", "codec", "ratio", "compress s",
+		"launch MB/s", "sequent. MB/s");
+
+	for (int32 i = 0; i < kCodecCount; i++) {
+		const codec_info& codec = kCodecs[i];
+
+		uint64 compressedSize = 0;
+		bigtime_t startTime = system_time();
+		for (int32 k = 0; k < fileCount; k++) {
+			if (!compress_file(codec, data[k], sizes[k], files[k],
+					compressedSize)) {
+				fprintf(stderr, "Out of memory\n");
+				return 1;
+			}
+		}
+		bigtime_t compressTime = system_time() - startTime;
+
+		for (int32 k = 0; k < fileCount; k++) {
+			if (!verify_file(codec, files[k], data[k], buffer))
+				return 1;
+		}
+
+		int64 launchBytes = 0;
+		int64 sequentialBytes = 0;
+		bigtime_t launchTime = 0;
+		bigtime_t sequentialTime = 0;
+		for (int32 k = 0; k < iterations; k++) {
+			launchTime += launch_read(codec, files, fileCount,
+				randomPercentage, buffer, launchBytes);
+			sequentialTime += sequential_read(codec, files, fileCount, buffer,
+				sequentialBytes);
+		}
+
+		printf("%-6s %7.3f %12.3f %14.1f %14.1f\n", codec.name,
+			totalSize > 0 ? 1.0 * compressedSize / totalSize : 1.0,
+			compressTime / 1000000.0,
+			launchTime > 0 ? 1.0 * launchBytes / launchTime : 0.0,
+			sequentialTime > 0 ? 1.0 * sequentialBytes / sequentialTime : 0.0);
+
+		for (int32 k = 0; k < fileCount; k++)
+			free_file(files[k]);
+	}
+
+	for (int32 i = 0; i < fileCount; i++)
+		free(data[i]);
+	free(data);
+	free(sizes);
+	free(files);
+	free(buffer);
+
+	return 0;
+}
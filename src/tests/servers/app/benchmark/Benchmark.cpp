@@ -15,7 +15,9 @@
 #include "TestWindow.h"
 
 // tests
+#include "FillTest.h"
 #include "HorizontalLineTest.h"
+#include "LargeFillTest.h"
 #include "RandomLineTest.h"
 #include "StringTest.h"
 #include "VerticalLineTest.h"
@@ -27,7 +29,9 @@ struct test_info {
 };
 
 const test_info kTestInfos[] = {
+	{ "Fills",				FillTest::CreateTest },
 	{ "HorizontalLines",	HorizontalLineTest::CreateTest },
+	{ "LargeFills",			LargeFillTest::CreateTest },
 	{ "RandomLines",		RandomLineTest::CreateTest },
 	{ "Strings",			StringTest::CreateTest },
 	{ "VerticalLines",		VerticalLineTest::CreateTest },
@@ -37,12 +41,13 @@ const test_info kTestInfos[] = {
 
 class Benchmark : public BApplication {
 public:
-	Benchmark(Test* test, drawing_mode mode, bool clipping)
+	Benchmark(Test* test, drawing_mode mode, bool clipping, bool fullScreen)
 		: BApplication("application/x-vnd.haiku-benchmark"),
 		  fTest(test),
 		  fTestWindow(NULL),
 		  fDrawingMode(mode),
-		  fUseClipping(clipping)
+		  fUseClipping(clipping),
+		  fFullScreen(fullScreen)
 	{
 	}
 
@@ -61,6 +66,8 @@ public:
 		frame.top = (frame.top + frame.bottom - width) / 2;
 		frame.right = frame.left + width - 1;
 		frame.bottom = frame.top + height - 1;
+		if (fFullScreen)
+			frame = screen.Frame();
 
 		fTestWindow = new TestWindow(frame, fTest, fDrawingMode,
 			fUseClipping, BMessenger(this));
@@ -96,6 +103,7 @@ private:
 	TestWindow*		fTestWindow;
 	drawing_mode	fDrawingMode;
 	bool			fUseClipping;
+	bool			fFullScreen;
 };
 
 
@@ -127,12 +135,16 @@ main(int argc, char** argv)
 
 	testName = argv[0];
 	bool clipping = false;
+	bool fullScreen = false;
 	drawing_mode mode = B_OP_COPY;
 
 	while (argc > 0) {
 		drawing_mode possibleMode;
 		if (strcmp(argv[0], "--clipping") == 0 || strcmp(argv[0], "-c") == 0) {
 			clipping = true;
+		} else if (strcmp(argv[0], "--fullscreen") == 0
+			|| strcmp(argv[0], "-f") == 0) {
+			fullScreen = true;
 		} else if (ToDrawingMode(argv[0], possibleMode)) {
 			mode = possibleMode;
 		}
@@ -161,7 +173,7 @@ main(int argc, char** argv)
 		exit(1);
 	}
 
-	Benchmark app(test, mode, clipping);
+	Benchmark app(test, mode, clipping, fullScreen);
 	app.Run();
 	return 0;
 }
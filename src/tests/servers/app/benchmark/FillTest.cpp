@@ -0,0 +1,129 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "FillTest.h"
+
+#include <stdio.h>
+
+#include <GradientLinear.h>
+#include <View.h>
+
+#include "TestSupport.h"
+
+
+FillTest::FillTest()
+	: Test(),
+	  fTestDuration(0),
+	  fTestStart(-1),
+
+	  fShapesRendered(0),
+	  fShapesPerIteration(100),
+
+	  fIterations(0),
+	  fMaxIterations(1500),
+
+	  fViewBounds(0, 0, -1, -1)
+{
+}
+
+
+FillTest::~FillTest()
+{
+}
+
+
+void
+FillTest::Prepare(BView* view)
+{
+	fViewBounds = view->Bounds();
+
+	fTestDuration = 0;
+	fShapesRendered = 0;
+	fIterations = 0;
+	fTestStart = system_time();
+}
+
+
+bool
+FillTest::RunIteration(BView* view)
+{
+	bigtime_t now = system_time();
+
+	for (uint32 i = 0; i < fShapesPerIteration; i++) {
+		rgb_color color = { (uint8)(rand() % 255), (uint8)(rand() % 255),
+			(uint8)(rand() % 255), 160 };
+		view->SetHighColor(color);
+
+		BRect rect = _RandomRect();
+		switch (i % 4) {
+			case 0:
+				view->FillRect(rect);
+				break;
+			case 1:
+				view->FillEllipse(rect);
+				break;
+			case 2:
+				view->FillRoundRect(rect, 12, 12);
+				break;
+			case 3:
+			{
+				BGradientLinear gradient(rect.LeftTop(), rect.RightBottom());
+				gradient.AddColor(color, 0);
+				color.alpha = 64;
+				gradient.AddColor(color, 255);
+				view->FillRect(rect, gradient);
+				break;
+			}
+		}
+
+		fShapesRendered++;
+	}
+
+	view->Sync();
+
+	fTestDuration += system_time() - now;
+	fIterations++;
+
+	return fIterations < fMaxIterations;
+}
+
+
+void
+FillTest::PrintResults(BView* view)
+{
+	if (fTestDuration == 0) {
+		printf("Test was not run.\n");
+		return;
+	}
+	bigtime_t timeLeak = system_time() - fTestStart - fTestDuration;
+
+	Test::PrintResults(view);
+
+	printf("Shapes per iteration: %lu\n", fShapesPerIteration);
+	printf("Total shapes rendered: %llu\n", fShapesRendered);
+	printf("Shapes per second: %.3f\n",
+		fShapesRendered * 1000000.0 / fTestDuration);
+	printf("Average time between iterations: %.4f seconds.\n",
+		(float)timeLeak / fIterations / 1000000);
+}
+
+
+Test*
+FillTest::CreateTest()
+{
+	return new FillTest();
+}
+
+
+BRect
+FillTest::_RandomRect() const
+{
+	BRect rect;
+	rect.left = random_number_between(fViewBounds.left, fViewBounds.right);
+	rect.right = random_number_between(rect.left, fViewBounds.right);
+	rect.top = random_number_between(fViewBounds.top, fViewBounds.bottom);
+	rect.bottom = random_number_between(rect.top, fViewBounds.bottom);
+	return rect;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FILL_TEST_H
+#define FILL_TEST_H
+
+#include <Rect.h>
+
+#include "Test.h"
+
+// Fills rectangles, ellipses, round rectangles and gradients with
+// semi-transparent colors, to measure the span blending of the drawing modes.
+class FillTest : public Test {
+public:
+								FillTest();
+	virtual						~FillTest();
+
+	virtual	void				Prepare(BView* view);
+	virtual	bool				RunIteration(BView* view);
+	virtual	void				PrintResults(BView* view);
+
+	static	Test*				CreateTest();
+
+private:
+			BRect				_RandomRect() const;
+
+	bigtime_t					fTestDuration;
+	bigtime_t					fTestStart;
+	uint64						fShapesRendered;
+	uint32						fShapesPerIteration;
+
+	uint32						fIterations;
+	uint32						fMaxIterations;
+
+	BRect						fViewBounds;
+};
+
+#endif // FILL_TEST_H
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "LargeFillTest.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <Bitmap.h>
+#include <GradientRadial.h>
+#include <View.h>
+
+
+static const int32 kStarPoints = 24;
+
+
+LargeFillTest::LargeFillTest()
+	: Test(),
+	  fBitmap(NULL),
+
+	  fGradientDuration(0),
+	  fBitmapDuration(0),
+	  fPolygonDuration(0),
+	  fTestStart(-1),
+
+	  fIterations(0),
+	  fMaxIterations(200),
+
+	  fViewBounds(0, 0, -1, -1)
+{
+}
+
+
+LargeFillTest::~LargeFillTest()
+{
+	delete fBitmap;
+}
+
+
+void
+LargeFillTest::Prepare(BView* view)
+{
+	fViewBounds = view->Bounds();
+
+	// a small bitmap, so that drawing it into the view scales it up a lot
+	delete fBitmap;
+	fBitmap = new BBitmap(BRect(0, 0, 255, 255), B_RGB32);
+	uint8* bits = (uint8*)fBitmap->Bits();
+	int32 bpr = fBitmap->BytesPerRow();
+	for (int32 y = 0; y < 256; y++) {
+		uint8* pixel = bits + y * bpr;
+		for (int32 x = 0; x < 256; x++) {
+			pixel[0] = x;
+			pixel[1] = y;
+			pixel[2] = (x ^ y) & 0xff;
+			pixel[3] = 255;
+			pixel += 4;
+		}
+	}
+
+	fGradientDuration = 0;
+	fBitmapDuration = 0;
+	fPolygonDuration = 0;
+	fIterations = 0;
+	fTestStart = system_time();
+}
+
+
+bool
+LargeFillTest::RunIteration(BView* view)
+{
+	BPoint center((fViewBounds.left + fViewBounds.right) / 2,
+		(fViewBounds.top + fViewBounds.bottom) / 2);
+	float radius = max_c(fViewBounds.Width(), fViewBounds.Height()) / 2;
+
+	bigtime_t start = system_time();
+	BGradientRadial gradient(center, radius);
+	gradient.AddColor((rgb_color){ 255, 255, 255, 255 }, 0);
+	gradient.AddColor((rgb_color){ (uint8)(fIterations % 256), 80, 160, 255 },
+		255);
+	view->FillRect(fViewBounds, gradient);
+	_Time(fGradientDuration, start, view);
+
+	start = system_time();
+	view->DrawBitmap(fBitmap, fBitmap->Bounds(), fViewBounds,
+		B_FILTER_BITMAP_BILINEAR);
+	_Time(fBitmapDuration, start, view);
+
+	BPoint star[kStarPoints * 2];
+	float rotation = fIterations * M_PI / 180;
+	for (int32 i = 0; i < kStarPoints * 2; i++) {
+		float angle = rotation + i * M_PI / kStarPoints;
+		float distance = (i & 1) != 0 ? radius / 3 : radius;
+		star[i].x = center.x + cosf(angle) * distance;
+		star[i].y = center.y + sinf(angle) * distance;
+	}
+
+	start = system_time();
+	view->SetHighColor(40, 40, (uint8)(fIterations % 256));
+	view->FillPolygon(star, kStarPoints * 2);
+	_Time(fPolygonDuration, start, view);
+
+	fIterations++;
+
+	return fIterations < fMaxIterations;
+}
+
+
+void
+LargeFillTest::PrintResults(BView* view)
+{
+	bigtime_t testDuration = fGradientDuration + fBitmapDuration
+		+ fPolygonDuration;
+	if (testDuration == 0) {
+		printf("Test was not run.\n");
+		return;
+	}
+	bigtime_t timeLeak = system_time() - fTestStart - testDuration;
+
+	Test::PrintResults(view);
+
+	printf("View size: %.0fx%.0f\n", fViewBounds.Width() + 1,
+		fViewBounds.Height() + 1);
+	printf("Iterations: %lu\n", fIterations);
+	printf("Gradient fill: %.3f ms\n",
+		fGradientDuration / 1000.0 / fIterations);
+	printf("Bilinear bitmap: %.3f ms\n",
+		fBitmapDuration / 1000.0 / fIterations);
+	printf("Polygon fill: %.3f ms\n",
+		fPolygonDuration / 1000.0 / fIterations);
+	printf("Average time between iterations: %.4f seconds.\n",
+		(float)timeLeak / fIterations / 1000000);
+}
+
+
+Test*
+LargeFillTest::CreateTest()
+{
+	return new LargeFillTest();
+}
+
+
+void
+LargeFillTest::_Time(bigtime_t& duration, bigtime_t start, BView* view)
+{
+	view->Sync();
+	duration += system_time() - start;
+}
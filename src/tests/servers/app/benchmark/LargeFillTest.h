@@ -0,0 +1,45 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef LARGE_FILL_TEST_H
+#define LARGE_FILL_TEST_H
+
+#include <Rect.h>
+
+#include "Test.h"
+
+class BBitmap;
+
+// Covers the whole view with a gradient, a bilinear scaled bitmap and a
+// polygon, to measure the operations the app_server renders in bands.
+// Best run with --fullscreen.
+class LargeFillTest : public Test {
+public:
+								LargeFillTest();
+	virtual						~LargeFillTest();
+
+	virtual	void				Prepare(BView* view);
+	virtual	bool				RunIteration(BView* view);
+	virtual	void				PrintResults(BView* view);
+
+	static	Test*				CreateTest();
+
+private:
+			void				_Time(bigtime_t& duration, bigtime_t start,
+									BView* view);
+
+	BBitmap*					fBitmap;
+
+	bigtime_t					fGradientDuration;
+	bigtime_t					fBitmapDuration;
+	bigtime_t					fPolygonDuration;
+	bigtime_t					fTestStart;
+
+	uint32						fIterations;
+	uint32						fMaxIterations;
+
+	BRect						fViewBounds;
+};
+
+#endif // LARGE_FILL_TEST_H
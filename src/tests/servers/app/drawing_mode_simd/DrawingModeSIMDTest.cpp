@@ -0,0 +1,263 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that the SIMD span functions of the drawing modes produce exactly
+	the same pixels as the C versions. For every drawing mode, alpha mode and
+	pattern, a PixelFormat using the C functions and one using the SIMD
+	functions get the same random spans, covers and colors, and the results
+	are compared pixel by pixel, including the pixels around the spans.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "DrawingModeSIMD.h"
+#include "GlobalSubpixelSettings.h"
+#include "PatternHandler.h"
+#include "PixelFormat.h"
+
+
+static const int32 kWidth = 96;
+static const int32 kMaxSpan = 80;
+static const int32 kIterations = 2000;
+
+typedef PixelFormat::color_type color_type;
+
+
+struct test_buffer {
+	uint32					pixels[kWidth];
+	agg::rendering_buffer	buffer;
+
+	test_buffer()
+	{
+		buffer.attach((uint8*)pixels, kWidth, 1, kWidth * 4);
+	}
+};
+
+
+static uint8
+random_byte()
+{
+	return rand() & 0xff;
+}
+
+
+/*!	Returns a random alpha or cover, favoring the values the drawing modes
+	treat specially.
+*/
+static uint8
+random_alpha()
+{
+	switch (rand() % 4) {
+		case 0:
+			return 0;
+		case 1:
+			return 255;
+		default:
+			return random_byte();
+	}
+}
+
+
+static color_type
+random_color()
+{
+	return color_type(random_byte(), random_byte(), random_byte(),
+		random_alpha());
+}
+
+
+static void
+fill_covers(uint8* covers, int32 count)
+{
+	// runs of the same value are common, and take the shortcuts
+	int32 mode = rand() % 4;
+	for (int32 i = 0; i < count; i++) {
+		switch (mode) {
+			case 0:
+				covers[i] = 0;
+				break;
+			case 1:
+				covers[i] = 255;
+				break;
+			default:
+				covers[i] = random_alpha();
+				break;
+		}
+	}
+}
+
+
+static bool
+sse2_available()
+{
+#if DRAWING_MODE_SSE2
+#	if defined(__x86_64__)
+	return true;
+#	else
+	cpuid_info info;
+	if (get_cpuid(&info, 1, 0) != B_OK)
+		return false;
+
+	return (info.regs.edx & (1 << 26)) != 0;
+#	endif
+#else
+	return false;
+#endif
+}
+
+
+static const char*
+mode_name(drawing_mode mode)
+{
+	static const char* const kNames[] = {
+		"B_OP_COPY", "B_OP_OVER", "B_OP_ERASE", "B_OP_INVERT", "B_OP_ADD",
+		"B_OP_SUBTRACT", "B_OP_BLEND", "B_OP_MIN", "B_OP_MAX", "B_OP_SELECT",
+		"B_OP_ALPHA"
+	};
+
+	return kNames[mode];
+}
+
+
+/*!	Runs one random span through both pixel formats, and returns whether
+	the results are identical.
+*/
+static bool
+compare_span(PixelFormat& scalar, test_buffer& scalarBuffer,
+	PixelFormat& simd, test_buffer& simdBuffer, int32 function)
+{
+	for (int32 i = 0; i < kWidth; i++) {
+		scalarBuffer.pixels[i] = (uint32)rand() << 16 ^ rand();
+		if (rand() % 2 == 0)
+			scalarBuffer.pixels[i] |= 0xff000000;
+	}
+	memcpy(simdBuffer.pixels, scalarBuffer.pixels, sizeof(simdBuffer.pixels));
+
+	int32 x = rand() % 8;
+	int32 length = 1 + rand() % kMaxSpan;
+	color_type color = random_color();
+	uint8 cover = random_alpha();
+	uint8 covers[kMaxSpan * 3];
+	color_type colors[kMaxSpan];
+	for (int32 i = 0; i < length; i++)
+		colors[i] = random_color();
+
+	switch (function) {
+		case 0:
+			scalar.blend_hline(x, 0, length, color, cover);
+			simd.blend_hline(x, 0, length, color, cover);
+			break;
+		case 1:
+			fill_covers(covers, length);
+			scalar.blend_solid_hspan(x, 0, length, color, covers);
+			simd.blend_solid_hspan(x, 0, length, color, covers);
+			break;
+		case 2:
+			// the length counts subpixels
+			fill_covers(covers, length * 3);
+			scalar.blend_solid_hspan_subpix(x, 0, length * 3, color, covers);
+			simd.blend_solid_hspan_subpix(x, 0, length * 3, color, covers);
+			break;
+		case 3:
+			fill_covers(covers, length);
+			scalar.blend_color_hspan(x, 0, length, colors, covers, cover);
+			simd.blend_color_hspan(x, 0, length, colors, covers, cover);
+			break;
+		case 4:
+			scalar.blend_color_hspan(x, 0, length, colors, NULL, cover);
+			simd.blend_color_hspan(x, 0, length, colors, NULL, cover);
+			break;
+	}
+
+	for (int32 i = 0; i < kWidth; i++) {
+		if (scalarBuffer.pixels[i] != simdBuffer.pixels[i]) {
+			fprintf(stderr, "  function %" B_PRId32 ", span %" B_PRId32
+				"/%" B_PRId32 ": pixel %" B_PRId32 " is %#08" B_PRIx32
+				" instead of %#08" B_PRIx32 "\n", function, x, length, i,
+				simdBuffer.pixels[i], scalarBuffer.pixels[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	if (!sse2_available()) {
+		printf("DrawingModeSIMDTest: no SSE2, skipped\n");
+		return 0;
+	}
+
+	srand(system_time());
+
+	const pattern* patterns[] = { &B_SOLID_HIGH, &B_SOLID_LOW,
+		&B_MIXED_COLORS };
+	const source_alpha alphaModes[] = { B_PIXEL_ALPHA, B_CONSTANT_ALPHA };
+	const alpha_function alphaFunctions[] = { B_ALPHA_OVERLAY,
+		B_ALPHA_COMPOSITE };
+
+	test_buffer scalarBuffer;
+	test_buffer simdBuffer;
+	PatternHandler patternHandler;
+
+	int32 failures = 0;
+	for (int32 mode = B_OP_COPY; mode <= B_OP_ALPHA; mode++) {
+		for (int32 p = 0; p < 3; p++) {
+			for (int32 a = 0; a < 2; a++) {
+				for (int32 f = 0; f < 2; f++) {
+					patternHandler.SetPattern(*patterns[p]);
+
+					PixelFormat scalar(scalarBuffer.buffer, &patternHandler);
+					PixelFormat simd(simdBuffer.buffer, &patternHandler);
+					simd.SetSIMDFlags(APPSERVER_SIMD_SSE2);
+
+					bool failed = false;
+					for (int32 i = 0; i < kIterations && !failed; i++) {
+						rgb_color high = { random_byte(), random_byte(),
+							random_byte(), random_alpha() };
+						rgb_color low = { random_byte(), random_byte(),
+							random_byte(), random_alpha() };
+						patternHandler.SetColors(high, low);
+						gSubpixelOrderingRGB = (i & 1) != 0;
+
+						// the functions depend on the colors
+						scalar.SetDrawingMode((drawing_mode)mode,
+							alphaModes[a], alphaFunctions[f], false);
+						simd.SetDrawingMode((drawing_mode)mode,
+							alphaModes[a], alphaFunctions[f], false);
+
+						failed = !compare_span(scalar, scalarBuffer, simd,
+							simdBuffer, rand() % 5);
+					}
+
+					if (failed) {
+						fprintf(stderr, "%s, pattern %" B_PRId32 ", %s, %s: "
+							"FAILED\n", mode_name((drawing_mode)mode), p,
+							a == 0 ? "B_PIXEL_ALPHA" : "B_CONSTANT_ALPHA",
+							f == 0 ? "B_ALPHA_OVERLAY" : "B_ALPHA_COMPOSITE");
+						failures++;
+					}
+				}
+			}
+		}
+	}
+
+	if (failures > 0) {
+		printf("DrawingModeSIMDTest: %" B_PRId32 " modes FAILED\n", failures);
+		return 1;
+	}
+
+	printf("DrawingModeSIMDTest: all modes passed\n");
+	return 0;
+}
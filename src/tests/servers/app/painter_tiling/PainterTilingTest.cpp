@@ -0,0 +1,230 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that the operations the Painter splits into bands for the
+	RenderThreadPool produce exactly the same pixels as when the calling
+	thread renders them alone. A polygon, a radial gradient, and a bilinear
+	scaled bitmap are drawn into two bitmaps, once with and once without
+	bands, with a clipping that is a single rectangle and one that has holes,
+	and the bitmaps are compared byte by byte.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <GradientRadial.h>
+#include <Region.h>
+
+#include "BitmapBuffer.h"
+#include "FontManager.h"
+#include "GlobalSubpixelSettings.h"
+#include "Painter.h"
+#include "RenderThreadPool.h"
+#include "ServerBitmap.h"
+
+
+// not a multiple of the band height, and large enough to be split
+static const BRect kBounds(0, 0, 700, 522);
+
+static UtilityBitmap* sSourceBitmap;
+
+
+typedef void (*draw_function)(Painter& painter);
+
+
+static void
+draw_polygon(Painter& painter)
+{
+	// a star with many crossing, slanted edges
+	const int32 kPointCount = 23;
+	BPoint points[kPointCount];
+	for (int32 i = 0; i < kPointCount; i++) {
+		double angle = i * 2 * M_PI * 7 / kPointCount;
+		points[i].x = 350.3 + 330 * cos(angle);
+		points[i].y = 261.7 + 250 * sin(angle);
+	}
+
+	rgb_color color = { 40, 120, 220, 255 };
+	painter.SetHighColor(color);
+	painter.DrawPolygon(points, kPointCount, true, true);
+}
+
+
+static void
+draw_polygon_subpixel(Painter& painter)
+{
+	gSubpixelAntialiasing = true;
+	draw_polygon(painter);
+	gSubpixelAntialiasing = false;
+}
+
+
+static void
+draw_radial_gradient(Painter& painter)
+{
+	BGradientRadial gradient(BPoint(320.5, 240.5), 300);
+	rgb_color colors[] = {
+		{ 255, 255, 255, 255 },
+		{ 200, 30, 60, 255 },
+		{ 10, 40, 120, 255 }
+	};
+	gradient.AddColor(colors[0], 0);
+	gradient.AddColor(colors[1], 100);
+	gradient.AddColor(colors[2], 255);
+
+	painter.FillEllipse(BRect(5.5, 3.25, 690.75, 518.5), gradient);
+}
+
+
+static void
+draw_bilinear_bitmap(Painter& painter)
+{
+	painter.DrawBitmap(sSourceBitmap, sSourceBitmap->Bounds(),
+		BRect(7, 3, 693, 517), B_FILTER_BITMAP_BILINEAR);
+}
+
+
+static UtilityBitmap*
+create_source_bitmap()
+{
+	UtilityBitmap* bitmap = new UtilityBitmap(BRect(0, 0, 96, 60), B_RGBA32,
+		0);
+	if (!bitmap->IsValid()) {
+		bitmap->ReleaseReference();
+		return NULL;
+	}
+
+	for (int32 y = 0; y < bitmap->Height(); y++) {
+		uint8* row = bitmap->Bits() + y * bitmap->BytesPerRow();
+		for (int32 x = 0; x < bitmap->Width(); x++) {
+			row[x * 4 + 0] = (uint8)(x * 37 + y * 11);
+			row[x * 4 + 1] = (uint8)(x * y);
+			row[x * 4 + 2] = (uint8)((x ^ y) * 5);
+			row[x * 4 + 3] = 255;
+		}
+	}
+
+	return bitmap;
+}
+
+
+static void
+render(UtilityBitmap* bitmap, const BRegion& clipping, draw_function draw,
+	bool tiled)
+{
+	// the same background for both, with some variation in it
+	for (int32 y = 0; y < bitmap->Height(); y++) {
+		uint32* row = (uint32*)(bitmap->Bits() + y * bitmap->BytesPerRow());
+		for (int32 x = 0; x < bitmap->Width(); x++)
+			row[x] = 0xff000000 | (x * 0x010203 + y * 0x030201);
+	}
+
+	BitmapBuffer buffer(bitmap);
+	Painter painter;
+	painter.AttachToBuffer(&buffer);
+	painter.ConstrainClipping(&clipping);
+
+	RenderThreadPool::Default()->SetEnabled(tiled);
+	draw(painter);
+	RenderThreadPool::Default()->SetEnabled(true);
+
+	painter.DetachFromBuffer();
+}
+
+
+static bool
+compare_tiled(const char* name, const BRegion& clipping, draw_function draw)
+{
+	UtilityBitmap* tiled = new UtilityBitmap(kBounds, B_RGBA32, 0);
+	UtilityBitmap* untiled = new UtilityBitmap(kBounds, B_RGBA32, 0);
+
+	render(tiled, clipping, draw, true);
+	render(untiled, clipping, draw, false);
+
+	bool equal = true;
+	for (int32 y = 0; y < tiled->Height() && equal; y++) {
+		uint32* tiledRow = (uint32*)(tiled->Bits() + y * tiled->BytesPerRow());
+		uint32* untiledRow
+			= (uint32*)(untiled->Bits() + y * untiled->BytesPerRow());
+
+		for (int32 x = 0; x < tiled->Width(); x++) {
+			if (tiledRow[x] != untiledRow[x]) {
+				fprintf(stderr, "%s: pixel (%" B_PRId32 ", %" B_PRId32 ") is "
+					"%#08" B_PRIx32 " in bands, %#08" B_PRIx32 " without\n",
+					name, x, y, tiledRow[x], untiledRow[x]);
+				equal = false;
+				break;
+			}
+		}
+	}
+
+	tiled->ReleaseReference();
+	untiled->ReleaseReference();
+	return equal;
+}
+
+
+int
+main()
+{
+	if (!RenderThreadPool::Default()->IsParallel()) {
+		printf("PainterTilingTest: only one CPU, skipped\n");
+		return 0;
+	}
+
+	// the Painter's text renderer needs the default font
+	gFontManager = new FontManager;
+	if (gFontManager->InitCheck() != B_OK) {
+		fprintf(stderr, "Could not initialize the font manager\n");
+		return 1;
+	}
+	gFontManager->Run();
+
+	sSourceBitmap = create_source_bitmap();
+	if (sSourceBitmap == NULL) {
+		fprintf(stderr, "Could not create the source bitmap\n");
+		return 1;
+	}
+
+	BRegion full(kBounds);
+	BRegion holes(kBounds);
+	holes.Exclude(BRect(100, 90, 180, 300));
+	holes.Exclude(BRect(0, 250, 700, 260));
+	holes.Exclude(BRect(400, 17, 401, 500));
+
+	struct {
+		const char*		name;
+		draw_function	draw;
+	} tests[] = {
+		{ "polygon", &draw_polygon },
+		{ "subpixel polygon", &draw_polygon_subpixel },
+		{ "radial gradient", &draw_radial_gradient },
+		{ "bilinear bitmap", &draw_bilinear_bitmap }
+	};
+
+	int32 failures = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (!compare_tiled(tests[i].name, full, tests[i].draw))
+			failures++;
+		if (!compare_tiled(tests[i].name, holes, tests[i].draw))
+			failures++;
+	}
+
+	sSourceBitmap->ReleaseReference();
+
+	gFontManager->Lock();
+	gFontManager->Quit();
+
+	if (failures > 0) {
+		printf("PainterTilingTest: %" B_PRId32 " checks FAILED\n", failures);
+		return 1;
+	}
+
+	printf("PainterTilingTest: all checks passed\n");
+	return 0;
+}
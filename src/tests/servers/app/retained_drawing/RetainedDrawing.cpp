@@ -0,0 +1,270 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how long it takes until a view that is slow to draw shows up
+	on screen again after the window that covered it has been hidden. With
+	--retained, the app_server redraws the view from what it has kept of its
+	last drawing, without waiting for the client.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Application.h>
+#include <Bitmap.h>
+#include <Screen.h>
+#include <View.h>
+#include <Window.h>
+
+#include <ViewPrivate.h>
+
+
+static const rgb_color kViewColor = { 0, 96, 192, 255 };
+static const rgb_color kCoverColor = { 192, 32, 0, 255 };
+static const bigtime_t kTimeout = 5000000;
+
+
+class SlowView : public BView {
+public:
+								SlowView(BRect frame, bigtime_t drawDelay,
+									bool retained);
+
+	virtual	void				Draw(BRect updateRect);
+
+private:
+			bigtime_t			fDrawDelay;
+};
+
+
+class App : public BApplication {
+public:
+								App(int32 iterations, bigtime_t drawDelay,
+									bool retained);
+
+	virtual	void				ReadyToRun();
+
+private:
+	static	status_t			_MeasureThread(void* self);
+			void				_Measure();
+			bool				_WaitForColor(BScreen& screen,
+									BBitmap* bitmap, BRect frame,
+									rgb_color color);
+
+			BWindow*			fWindow;
+			BWindow*			fCover;
+			BRect				fFrame;
+			int32				fIterations;
+			bigtime_t			fDrawDelay;
+			bool				fRetained;
+};
+
+
+SlowView::SlowView(BRect frame, bigtime_t drawDelay, bool retained)
+	:
+	BView(frame, "slow", B_FOLLOW_ALL, B_WILL_DRAW),
+	fDrawDelay(drawDelay)
+{
+	if (retained)
+		SetFlags(Flags() | kRetainedDrawingViewFlag);
+}
+
+
+void
+SlowView::Draw(BRect updateRect)
+{
+	// pretend to lay out something complicated
+	snooze(fDrawDelay);
+
+	SetHighColor(kViewColor);
+	FillRect(updateRect);
+	SetHighColor(255, 255, 255);
+	StrokeLine(Bounds().LeftTop(), Bounds().RightBottom());
+}
+
+
+//	#pragma mark -
+
+
+App::App(int32 iterations, bigtime_t drawDelay, bool retained)
+	:
+	BApplication("application/x-vnd.Haiku-RetainedDrawing"),
+	fFrame(100, 100, 499, 399),
+	fIterations(iterations),
+	fDrawDelay(drawDelay),
+	fRetained(retained)
+{
+}
+
+
+void
+App::ReadyToRun()
+{
+	fWindow = new BWindow(fFrame, "Retained drawing", B_NO_BORDER_WINDOW_LOOK,
+		B_NORMAL_WINDOW_FEEL, B_ASYNCHRONOUS_CONTROLS);
+	fWindow->AddChild(new SlowView(fWindow->Bounds(), fDrawDelay,
+		fRetained));
+	fWindow->Show();
+
+	fCover = new BWindow(fFrame, "Cover", B_NO_BORDER_WINDOW_LOOK,
+		B_FLOATING_APP_WINDOW_FEEL, B_ASYNCHRONOUS_CONTROLS);
+	BView* view = new BView(fCover->Bounds(), "cover", B_FOLLOW_ALL, 0);
+	view->SetViewColor(kCoverColor);
+	fCover->AddChild(view);
+	fCover->Show();
+
+	thread_id thread = spawn_thread(&_MeasureThread, "measure",
+		B_NORMAL_PRIORITY, this);
+	resume_thread(thread);
+}
+
+
+/*static*/ status_t
+App::_MeasureThread(void* self)
+{
+	((App*)self)->_Measure();
+	return B_OK;
+}
+
+
+void
+App::_Measure()
+{
+	BScreen screen;
+	BRect pixel(fFrame.LeftTop() + BPoint(10, fFrame.Height() / 2),
+		fFrame.LeftTop() + BPoint(10, fFrame.Height() / 2));
+	BBitmap* bitmap = new BBitmap(BRect(0, 0, 0, 0), B_RGB32);
+
+	// the view draws itself once, partly behind the cover
+	if (!_WaitForColor(screen, bitmap, pixel, kCoverColor)) {
+		fprintf(stderr, "The cover window does not show up.\n");
+		be_app->PostMessage(B_QUIT_REQUESTED);
+		return;
+	}
+	snooze(fDrawDelay + 100000);
+
+	bigtime_t total = 0;
+	bigtime_t min = B_INFINITE_TIMEOUT;
+	bigtime_t max = 0;
+	int32 count = 0;
+
+	for (int32 i = 0; i < fIterations; i++) {
+		if (i > 0) {
+			// let a late client redraw pass before covering the view again
+			snooze(fDrawDelay + 50000);
+
+			fCover->Lock();
+			fCover->Show();
+			fCover->Sync();
+			fCover->Unlock();
+
+			if (!_WaitForColor(screen, bitmap, pixel, kCoverColor))
+				break;
+		}
+
+		bigtime_t start = system_time();
+		fCover->Lock();
+		fCover->Hide();
+		fCover->Unlock();
+
+		if (!_WaitForColor(screen, bitmap, pixel, kViewColor))
+			break;
+
+		bigtime_t latency = system_time() - start;
+		total += latency;
+		if (latency < min)
+			min = latency;
+		if (latency > max)
+			max = latency;
+		count++;
+	}
+
+	if (count > 0) {
+		printf("%s drawing, %" B_PRId32 " exposes, draw delay %g ms\n",
+			fRetained ? "retained" : "client", count, fDrawDelay / 1000.0);
+		printf("expose to pixels: min %g ms, avg %g ms, max %g ms\n",
+			min / 1000.0, total / 1000.0 / count, max / 1000.0);
+	} else
+		fprintf(stderr, "The view never showed up.\n");
+
+	delete bitmap;
+	be_app->PostMessage(B_QUIT_REQUESTED);
+}
+
+
+bool
+App::_WaitForColor(BScreen& screen, BBitmap* bitmap, BRect frame,
+	rgb_color color)
+{
+	bigtime_t timeout = system_time() + kTimeout;
+	while (system_time() < timeout) {
+		if (screen.ReadBitmap(bitmap, false, &frame) == B_OK) {
+			const uint8* bits = (const uint8*)bitmap->Bits();
+			if (bits[0] == color.blue && bits[1] == color.green
+				&& bits[2] == color.red)
+				return true;
+		}
+		snooze(500);
+	}
+
+	return false;
+}
+
+
+//	#pragma mark -
+
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr, "Usage: %s [--retained] [--delay <ms>] "
+		"[--iterations <count>]\n", name);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	static struct option kLongOptions[] = {
+		{"retained", no_argument, 0, 'r'},
+		{"delay", required_argument, 0, 'd'},
+		{"iterations", required_argument, 0, 'i'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	bool retained = false;
+	bigtime_t drawDelay = 50000;
+	int32 iterations = 20;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "rd:i:h", kLongOptions, NULL)) != -1) {
+		switch (c) {
+			case 'r':
+				retained = true;
+				break;
+			case 'd':
+				drawDelay = atol(optarg) * 1000LL;
+				break;
+			case 'i':
+				iterations = atol(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				break;
+		}
+	}
+
+	if (drawDelay < 0 || iterations < 1)
+		usage(argv[0]);
+
+	App app(iterations, drawDelay, retained);
+	app.Run();
+	return 0;
+}
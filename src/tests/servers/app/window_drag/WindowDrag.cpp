@@ -0,0 +1,308 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Drags a window across a row of other windows, and counts how often
+	these have to be redrawn by the client while they are covered and
+	exposed again. With --composited, all windows keep their contents in a
+	backing store in the app_server, which should make the redraws go away.
+	The time per step covers moving the window, and copying back whatever
+	it exposes, but not the client redrawing it.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <AppDefs.h>
+#include <Application.h>
+#include <View.h>
+#include <Window.h>
+
+#include <WindowPrivate.h>
+
+
+static const bigtime_t kIdleTime = 300000;
+static const int32 kStepSize = 8;
+
+static int32 sDrawCount;
+static int32 sUpdateCount;
+static bigtime_t sLastDraw;
+
+
+class CountingView : public BView {
+public:
+								CountingView(BRect frame, rgb_color color,
+									bigtime_t drawDelay);
+
+	virtual	void				Draw(BRect updateRect);
+
+private:
+			rgb_color			fColor;
+			bigtime_t			fDrawDelay;
+};
+
+
+class CountingWindow : public BWindow {
+public:
+								CountingWindow(BRect frame, const char* title,
+									uint32 flags);
+
+	virtual	void				DispatchMessage(BMessage* message,
+									BHandler* handler);
+};
+
+
+class App : public BApplication {
+public:
+								App(int32 windowCount, int32 passes,
+									bigtime_t drawDelay, bool composited);
+
+	virtual	void				ReadyToRun();
+
+private:
+	static	status_t			_MeasureThread(void* self);
+			void				_Measure();
+			void				_WaitForIdle();
+
+			BWindow*			fMover;
+			int32				fWindowCount;
+			int32				fPasses;
+			bigtime_t			fDrawDelay;
+			bool				fComposited;
+			int32				fDistance;
+};
+
+
+CountingView::CountingView(BRect frame, rgb_color color, bigtime_t drawDelay)
+	:
+	BView(frame, "counting", B_FOLLOW_ALL, B_WILL_DRAW),
+	fColor(color),
+	fDrawDelay(drawDelay)
+{
+}
+
+
+void
+CountingView::Draw(BRect updateRect)
+{
+	atomic_add(&sDrawCount, 1);
+
+	// pretend to draw something complicated
+	snooze(fDrawDelay);
+
+	SetHighColor(fColor);
+	FillRect(updateRect);
+	SetHighColor(255, 255, 255);
+	StrokeLine(Bounds().LeftTop(), Bounds().RightBottom());
+	StrokeLine(Bounds().LeftBottom(), Bounds().RightTop());
+
+	sLastDraw = system_time();
+}
+
+
+//	#pragma mark -
+
+
+CountingWindow::CountingWindow(BRect frame, const char* title, uint32 flags)
+	:
+	BWindow(frame, title, B_TITLED_WINDOW, flags)
+{
+}
+
+
+void
+CountingWindow::DispatchMessage(BMessage* message, BHandler* handler)
+{
+	if (message->what == _UPDATE_)
+		atomic_add(&sUpdateCount, 1);
+
+	BWindow::DispatchMessage(message, handler);
+}
+
+
+//	#pragma mark -
+
+
+App::App(int32 windowCount, int32 passes, bigtime_t drawDelay,
+		bool composited)
+	:
+	BApplication("application/x-vnd.Haiku-WindowDrag"),
+	fWindowCount(windowCount),
+	fPasses(passes),
+	fDrawDelay(drawDelay),
+	fComposited(composited),
+	fDistance(0)
+{
+}
+
+
+void
+App::ReadyToRun()
+{
+	uint32 flags = B_ASYNCHRONOUS_CONTROLS;
+	if (fComposited)
+		flags |= kBackingStoreWindowFlag;
+
+	BRect frame(50, 100, 249, 349);
+	for (int32 i = 0; i < fWindowCount; i++) {
+		rgb_color color = { 0, (uint8)(64 + i * 32), 192, 255 };
+
+		BWindow* window = new CountingWindow(frame, "Background", flags);
+		window->AddChild(new CountingView(window->Bounds(), color,
+			fDrawDelay));
+		window->Show();
+
+		frame.OffsetBy(frame.Width() + 10, 0);
+	}
+
+	// the mover travels from the first background window to the last one
+	fDistance = (int32)(frame.left - 50 - 150);
+
+	fMover = new BWindow(BRect(50, 150, 199, 299), "Mover", B_TITLED_WINDOW,
+		flags);
+	BView* view = new BView(fMover->Bounds(), "mover", B_FOLLOW_ALL, 0);
+	view->SetViewColor(192, 32, 0);
+	fMover->AddChild(view);
+	fMover->Show();
+
+	thread_id thread = spawn_thread(&_MeasureThread, "measure",
+		B_NORMAL_PRIORITY, this);
+	resume_thread(thread);
+}
+
+
+/*static*/ status_t
+App::_MeasureThread(void* self)
+{
+	((App*)self)->_Measure();
+	return B_OK;
+}
+
+
+void
+App::_Measure()
+{
+	// let all windows draw themselves once
+	_WaitForIdle();
+
+	atomic_set(&sDrawCount, 0);
+	atomic_set(&sUpdateCount, 0);
+
+	int32 steps = fDistance / kStepSize;
+	bigtime_t total = 0;
+	bigtime_t max = 0;
+	int32 count = 0;
+	bigtime_t start = system_time();
+
+	for (int32 pass = 0; pass < fPasses; pass++) {
+		int32 step = pass % 2 == 0 ? kStepSize : -kStepSize;
+
+		for (int32 i = 0; i < steps; i++) {
+			bigtime_t stepStart = system_time();
+
+			fMover->Lock();
+			fMover->MoveBy(step, 0);
+			fMover->Sync();
+			fMover->Unlock();
+
+			bigtime_t time = system_time() - stepStart;
+			total += time;
+			if (time > max)
+				max = time;
+			count++;
+		}
+	}
+
+	bigtime_t dragTime = system_time() - start;
+	_WaitForIdle();
+	bigtime_t settleTime = sLastDraw > start + dragTime
+		? sLastDraw - start - dragTime : 0;
+
+	printf("%s, %" B_PRId32 " windows, %" B_PRId32 " steps, draw delay "
+		"%g ms\n", fComposited ? "composited" : "direct", fWindowCount, count,
+		fDrawDelay / 1000.0);
+	if (count > 0) {
+		printf("step: avg %g ms, max %g ms\n", total / 1000.0 / count,
+			max / 1000.0);
+	}
+	printf("update messages: %" B_PRId32 ", Draw() calls: %" B_PRId32 "\n",
+		sUpdateCount, sDrawCount);
+	printf("redrawing after the drag: %g ms\n", settleTime / 1000.0);
+
+	be_app->PostMessage(B_QUIT_REQUESTED);
+}
+
+
+void
+App::_WaitForIdle()
+{
+	int32 drawCount;
+	do {
+		drawCount = sDrawCount;
+		snooze(kIdleTime);
+	} while (drawCount != sDrawCount);
+}
+
+
+//	#pragma mark -
+
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr, "Usage: %s [--composited] [--windows <count>] "
+		"[--passes <count>] [--delay <ms>]\n", name);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	static struct option kLongOptions[] = {
+		{"composited", no_argument, 0, 'c'},
+		{"windows", required_argument, 0, 'w'},
+		{"passes", required_argument, 0, 'p'},
+		{"delay", required_argument, 0, 'd'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+
+	bool composited = false;
+	int32 windowCount = 3;
+	int32 passes = 4;
+	bigtime_t drawDelay = 10000;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "cw:p:d:h", kLongOptions, NULL))
+			!= -1) {
+		switch (c) {
+			case 'c':
+				composited = true;
+				break;
+			case 'w':
+				windowCount = atol(optarg);
+				break;
+			case 'p':
+				passes = atol(optarg);
+				break;
+			case 'd':
+				drawDelay = atol(optarg) * 1000LL;
+				break;
+			default:
+				usage(argv[0]);
+				break;
+		}
+	}
+
+	if (windowCount < 1 || passes < 1 || drawDelay < 0)
+		usage(argv[0]);
+
+	App app(windowCount, passes, drawDelay, composited);
+	app.Run();
+	return 0;
+}
@@ -20,7 +20,7 @@ extern const char *__progname;
 void
 usage()
 {
-	fprintf(stderr, "usage: %s [clear | unset | set <module-name>]\n", __progname);
+	fprintf(stderr, "usage: %s [clear | unset | set <module-name> | stats]\n", __progname);
 	exit(0);
 }
 
@@ -50,6 +50,21 @@ main(int argc, char **argv)
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, argv[2], strlen(argv[2]));
 		if (status != B_OK)
 			fprintf(stderr, "%s: setting the module failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "stats")) {
+		file_cache_stats stats;
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_STATS, &stats, sizeof(stats));
+		if (status != B_OK) {
+			fprintf(stderr, "%s: getting the statistics failed: %s\n", __progname, strerror(status));
+			return 1;
+		}
+
+		int64 reads = stats.read_ahead_hits + stats.read_ahead_misses;
+		printf("read-ahead streams: %lld\n", stats.read_ahead_streams);
+		printf("pages read ahead:   %lld\n", stats.read_ahead_pages);
+		printf("hits:               %lld (%.1f%%)\n", stats.read_ahead_hits,
+			reads > 0 ? 100.0 * stats.read_ahead_hits / reads : 0.0);
+		printf("misses:             %lld\n", stats.read_ahead_misses);
+		printf("wasted pages:       %lld\n", stats.read_ahead_wasted);
 	} else
 		usage();
 
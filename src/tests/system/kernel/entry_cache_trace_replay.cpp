@@ -0,0 +1,258 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Replays a trace of open() and stat() calls and measures how long the path
+	resolution takes. The trace file contains one operation per line, either
+	"open <path>", "stat <path>", or "lstat <path>"; empty lines and lines
+	starting with '#' are ignored.
+	Without a trace file, a synthetic one is used that mimics what the runtime
+	loader and shells do: probing a number of search paths for files that
+	mostly don't exist. That's the case the negative entries of the VFS entry
+	cache are meant for.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+enum operation_type {
+	OPERATION_OPEN,
+	OPERATION_STAT,
+	OPERATION_LSTAT
+};
+
+struct operation {
+	operation_type	type;
+	char*			path;
+};
+
+
+static const char* const kSearchPaths[] = {
+	"/boot/home/config/non-packaged/lib",
+	"/boot/home/config/lib",
+	"/boot/system/non-packaged/lib",
+	"/boot/system/lib",
+	"/boot/home/config/non-packaged/bin",
+	"/boot/home/config/bin",
+	"/boot/system/non-packaged/bin",
+	"/boot/system/bin",
+	NULL
+};
+
+static const char* const kNames[] = {
+	"libroot.so",
+	"libbe.so",
+	"libstdc++.so",
+	"libtracker.so",
+	"libz.so.1",
+	"sh",
+	"ls",
+	"cat",
+	"make",
+	"gcc",
+	NULL
+};
+
+
+static operation* sOperations = NULL;
+static int32 sOperationCount = 0;
+static int32 sOperationCapacity = 0;
+
+
+static bool
+add_operation(operation_type type, const char* path)
+{
+	if (sOperationCount == sOperationCapacity) {
+		int32 capacity = sOperationCapacity > 0 ? sOperationCapacity * 2 : 256;
+		operation* operations = (operation*)realloc(sOperations,
+			capacity * sizeof(operation));
+		if (operations == NULL)
+			return false;
+
+		sOperations = operations;
+		sOperationCapacity = capacity;
+	}
+
+	char* pathCopy = strdup(path);
+	if (pathCopy == NULL)
+		return false;
+
+	sOperations[sOperationCount].type = type;
+	sOperations[sOperationCount].path = pathCopy;
+	sOperationCount++;
+	return true;
+}
+
+
+static bool
+read_trace(const char* fileName)
+{
+	FILE* file = fopen(fileName, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to open trace \"%s\": %s\n", fileName,
+			strerror(errno));
+		return false;
+	}
+
+	char line[B_PATH_NAME_LENGTH + 32];
+	int32 lineNumber = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		lineNumber++;
+
+		size_t length = strlen(line);
+		while (length > 0 && (line[length - 1] == '\n'
+				|| line[length - 1] == '\r')) {
+			line[--length] = '\0';
+		}
+
+		if (length == 0 || line[0] == '#')
+			continue;
+
+		char* path = strchr(line, ' ');
+		if (path == NULL) {
+			fprintf(stderr, "%s:%" B_PRId32 ": missing path\n", fileName,
+				lineNumber);
+			continue;
+		}
+		*path++ = '\0';
+
+		operation_type type;
+		if (strcmp(line, "open") == 0)
+			type = OPERATION_OPEN;
+		else if (strcmp(line, "stat") == 0)
+			type = OPERATION_STAT;
+		else if (strcmp(line, "lstat") == 0)
+			type = OPERATION_LSTAT;
+		else {
+			fprintf(stderr, "%s:%" B_PRId32 ": unknown operation \"%s\"\n",
+				fileName, lineNumber, line);
+			continue;
+		}
+
+		if (!add_operation(type, path)) {
+			fclose(file);
+			return false;
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+
+static bool
+create_synthetic_trace()
+{
+	char path[B_PATH_NAME_LENGTH];
+	for (int32 i = 0; kNames[i] != NULL; i++) {
+		for (int32 k = 0; kSearchPaths[k] != NULL; k++) {
+			snprintf(path, sizeof(path), "%s/%s", kSearchPaths[k], kNames[i]);
+			if (!add_operation(OPERATION_STAT, path))
+				return false;
+		}
+		snprintf(path, sizeof(path), "/boot/system/lib/%s", kNames[i]);
+		if (!add_operation(OPERATION_OPEN, path))
+			return false;
+	}
+
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -i <iterations> ] [ <trace file> ]\n",
+		programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 iterations = 1000;
+
+	int c;
+	while ((c = getopt(argc, argv, "i:h")) != -1) {
+		switch (c) {
+			case 'i':
+				iterations = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	bool success = optind < argc
+		? read_trace(argv[optind]) : create_synthetic_trace();
+	if (!success) {
+		fprintf(stderr, "Failed to set up the trace\n");
+		return 1;
+	}
+
+	if (sOperationCount == 0) {
+		fprintf(stderr, "The trace is empty\n");
+		return 1;
+	}
+
+	// one untimed run to warm up the caches
+	int64 found = 0;
+	for (int32 i = 0; i < sOperationCount; i++) {
+		struct stat st;
+		if (stat(sOperations[i].path, &st) == 0)
+			found++;
+	}
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < iterations; i++) {
+		for (int32 k = 0; k < sOperationCount; k++) {
+			const operation& op = sOperations[k];
+			struct stat st;
+
+			switch (op.type) {
+				case OPERATION_OPEN:
+				{
+					int fd = open(op.path, O_RDONLY);
+					if (fd >= 0)
+						close(fd);
+					break;
+				}
+				case OPERATION_STAT:
+					stat(op.path, &st);
+					break;
+				case OPERATION_LSTAT:
+					lstat(op.path, &st);
+					break;
+			}
+		}
+	}
+
+	bigtime_t totalTime = system_time() - startTime;
+	int64 totalOperations = (int64)iterations * sOperationCount;
+
+	printf("%" B_PRId32 " operations (%" B_PRId64 " existing, %" B_PRId64
+		" missing), %" B_PRId32 " iterations\n", sOperationCount, found,
+		sOperationCount - found, iterations);
+	printf("total time:    %" B_PRId64 " us\n", totalTime);
+	printf("per operation: %.3f us\n", (double)totalTime / totalOperations);
+
+	for (int32 i = 0; i < sOperationCount; i++)
+		free(sOperations[i].path);
+	free(sOperations);
+
+	return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares poll() with event queues when waiting for a few active file
+	descriptors among many idle ones: a byte is written to one of the given
+	number of pipes, and the time it takes to find and read it again is
+	measured.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+struct pipe_set {
+	int*	read_fds;
+	int*	write_fds;
+	int32	count;
+};
+
+
+static bool
+create_pipes(pipe_set& pipes, int32 count)
+{
+	pipes.read_fds = (int*)malloc(sizeof(int) * count);
+	pipes.write_fds = (int*)malloc(sizeof(int) * count);
+	pipes.count = 0;
+	if (pipes.read_fds == NULL || pipes.write_fds == NULL)
+		return false;
+
+	struct rlimit limit;
+	limit.rlim_cur = 2 * count + 64;
+	limit.rlim_max = limit.rlim_cur;
+	if (setrlimit(RLIMIT_NOFILE, &limit) != 0) {
+		fprintf(stderr, "Failed to raise the FD limit: %s\n",
+			strerror(errno));
+		return false;
+	}
+
+	for (int32 i = 0; i < count; i++) {
+		int fds[2];
+		if (pipe(fds) != 0) {
+			fprintf(stderr, "Failed to create pipe %" B_PRId32 ": %s\n", i,
+				strerror(errno));
+			return false;
+		}
+
+		pipes.read_fds[i] = fds[0];
+		pipes.write_fds[i] = fds[1];
+		pipes.count++;
+	}
+
+	return true;
+}
+
+
+static void
+delete_pipes(pipe_set& pipes)
+{
+	for (int32 i = 0; i < pipes.count; i++) {
+		close(pipes.read_fds[i]);
+		close(pipes.write_fds[i]);
+	}
+
+	free(pipes.read_fds);
+	free(pipes.write_fds);
+}
+
+
+static inline int32
+active_pipe(const pipe_set& pipes, int32 iteration)
+{
+	return (int32)((iteration * 7919LL) % pipes.count);
+}
+
+
+static bigtime_t
+poll_bench(const pipe_set& pipes, int32 iterations)
+{
+	struct pollfd* fds = (struct pollfd*)malloc(
+		sizeof(struct pollfd) * pipes.count);
+	if (fds == NULL)
+		return -1;
+
+	for (int32 i = 0; i < pipes.count; i++) {
+		fds[i].fd = pipes.read_fds[i];
+		fds[i].events = POLLIN;
+	}
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < iterations; i++) {
+		char buffer = 'x';
+		write(pipes.write_fds[active_pipe(pipes, i)], &buffer, 1);
+
+		int ready = poll(fds, pipes.count, -1);
+		for (int32 k = 0; ready > 0 && k < pipes.count; k++) {
+			if ((fds[k].revents & POLLIN) != 0) {
+				read(fds[k].fd, &buffer, 1);
+				ready--;
+			}
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+	free(fds);
+	return time;
+}
+
+
+static bigtime_t
+event_queue_bench(const pipe_set& pipes, int32 iterations,
+	bigtime_t& _setupTime)
+{
+	bigtime_t startTime = system_time();
+
+	int queue = create_event_queue(O_CLOEXEC);
+	if (queue < 0) {
+		fprintf(stderr, "Failed to create event queue: %s\n",
+			strerror(queue));
+		return -1;
+	}
+
+	for (int32 i = 0; i < pipes.count; i++) {
+		event_wait_info info;
+		info.object = pipes.read_fds[i];
+		info.type = B_OBJECT_TYPE_FD;
+		info.events = B_EVENT_READ;
+		info.user_data = (void*)(addr_t)i;
+
+		status_t status = event_queue_select(queue, &info, 1);
+		if (status != B_OK) {
+			fprintf(stderr, "Failed to select FD %d: %s\n", info.object,
+				strerror(status));
+			close(queue);
+			return -1;
+		}
+	}
+
+	_setupTime = system_time() - startTime;
+	startTime = system_time();
+
+	for (int32 i = 0; i < iterations; i++) {
+		char buffer = 'x';
+		write(pipes.write_fds[active_pipe(pipes, i)], &buffer, 1);
+
+		event_wait_info infos[16];
+		ssize_t count = event_queue_wait(queue, infos, 16, 0, 0);
+		for (ssize_t k = 0; k < count; k++) {
+			int32 index = (int32)(addr_t)infos[k].user_data;
+			read(pipes.read_fds[index], &buffer, 1);
+		}
+	}
+
+	bigtime_t time = system_time() - startTime;
+	close(queue);
+	return time;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -i <iterations> ] [ <pipes> ... ]\n",
+		programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 iterations = 10000;
+
+	int c;
+	while ((c = getopt(argc, argv, "i:h")) != -1) {
+		switch (c) {
+			case 'i':
+				iterations = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (iterations < 1)
+		iterations = 1;
+
+	static const int32 kDefaultCounts[] = { 1000, 10000 };
+	int32 runs = optind < argc ? argc - optind : 2;
+
+	printf("%8s %14s %14s %12s\n", "pipes", "poll() us", "queue us",
+		"setup ms");
+
+	for (int32 run = 0; run < runs; run++) {
+		int32 count = optind < argc
+			? atol(argv[optind + run]) : kDefaultCounts[run];
+		if (count < 1)
+			continue;
+
+		pipe_set pipes;
+		if (!create_pipes(pipes, count)) {
+			delete_pipes(pipes);
+			return 1;
+		}
+
+		bigtime_t setupTime = 0;
+		bigtime_t pollTime = poll_bench(pipes, iterations);
+		bigtime_t queueTime = event_queue_bench(pipes, iterations,
+			setupTime);
+
+		delete_pipes(pipes);
+
+		if (pollTime < 0 || queueTime < 0)
+			return 1;
+
+		printf("%8" B_PRId32 " %14.2f %14.2f %12.2f\n", count,
+			1.0 * pollTime / iterations, 1.0 * queueTime / iterations,
+			setupTime / 1000.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks the edge triggered, level triggered, and one-shot modes of event
+	queues on a pipe, the automatic removal of closed FDs, and closing a
+	queue from another team than the one that selected its FDs.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const bigtime_t kTimeout = 100000;
+
+static int sFailures;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+struct test_pipe {
+	int	read_fd;
+	int	write_fd;
+};
+
+
+static bool
+open_pipe(test_pipe& pipe)
+{
+	int fds[2];
+	if (::pipe(fds) != 0) {
+		fprintf(stderr, "Failed to create pipe: %s\n", strerror(errno));
+		return false;
+	}
+
+	pipe.read_fd = fds[0];
+	pipe.write_fd = fds[1];
+	return true;
+}
+
+
+static void
+close_pipe(test_pipe& pipe)
+{
+	if (pipe.read_fd >= 0)
+		close(pipe.read_fd);
+	if (pipe.write_fd >= 0)
+		close(pipe.write_fd);
+}
+
+
+static status_t
+select_fd(int queue, int fd, uint16 events)
+{
+	event_wait_info info;
+	info.object = fd;
+	info.type = B_OBJECT_TYPE_FD;
+	info.events = events;
+	info.user_data = (void*)(addr_t)fd;
+
+	return event_queue_select(queue, &info, 1);
+}
+
+
+/*!	Returns the events reported for \a fd, 0 if there were none within the
+	timeout.
+*/
+static uint16
+wait_for_events(int queue, int fd)
+{
+	event_wait_info infos[4];
+	ssize_t count = event_queue_wait(queue, infos, 4, B_RELATIVE_TIMEOUT,
+		kTimeout);
+	if (count == B_TIMED_OUT)
+		return 0;
+
+	CHECK(count == 1);
+	if (count != 1)
+		return 0;
+
+	CHECK(infos[0].object == fd);
+	CHECK(infos[0].user_data == (void*)(addr_t)fd);
+	return infos[0].events;
+}
+
+
+static void
+write_byte(const test_pipe& pipe)
+{
+	char buffer = 'x';
+	CHECK(write(pipe.write_fd, &buffer, 1) == 1);
+}
+
+
+static void
+read_byte(const test_pipe& pipe)
+{
+	char buffer;
+	CHECK(read(pipe.read_fd, &buffer, 1) == 1);
+}
+
+
+static void
+test_edge_triggered()
+{
+	test_pipe pipe;
+	if (!open_pipe(pipe)) {
+		sFailures++;
+		return;
+	}
+
+	int queue = create_event_queue(O_CLOEXEC);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ) == B_OK);
+
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	write_byte(pipe);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+
+	// the data is still there, but it has been reported already
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	write_byte(pipe);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+
+	read_byte(pipe);
+	read_byte(pipe);
+
+	close(queue);
+	close_pipe(pipe);
+}
+
+
+static void
+test_level_triggered()
+{
+	test_pipe pipe;
+	if (!open_pipe(pipe)) {
+		sFailures++;
+		return;
+	}
+
+	int queue = create_event_queue(O_CLOEXEC);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd,
+		B_EVENT_READ | B_EVENT_LEVEL_TRIGGERED) == B_OK);
+
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	write_byte(pipe);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+
+	// as long as the data is there, it is reported again
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+
+	read_byte(pipe);
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	write_byte(pipe);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+	read_byte(pipe);
+
+	close(queue);
+	close_pipe(pipe);
+}
+
+
+static void
+test_one_shot()
+{
+	test_pipe pipe;
+	if (!open_pipe(pipe)) {
+		sFailures++;
+		return;
+	}
+
+	int queue = create_event_queue(O_CLOEXEC);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ | B_EVENT_ONE_SHOT)
+		== B_OK);
+
+	write_byte(pipe);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+
+	// nothing is reported until it is selected again
+	write_byte(pipe);
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ | B_EVENT_ONE_SHOT)
+		== B_OK);
+	CHECK((wait_for_events(queue, pipe.read_fd) & B_EVENT_READ) != 0);
+	CHECK(wait_for_events(queue, pipe.read_fd) == 0);
+
+	read_byte(pipe);
+	read_byte(pipe);
+
+	close(queue);
+	close_pipe(pipe);
+}
+
+
+static void
+test_closed_fd()
+{
+	test_pipe pipe;
+	if (!open_pipe(pipe)) {
+		sFailures++;
+		return;
+	}
+
+	int queue = create_event_queue(O_CLOEXEC);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ) == B_OK);
+
+	int fd = pipe.read_fd;
+	close(pipe.read_fd);
+	pipe.read_fd = -1;
+
+	CHECK((wait_for_events(queue, fd) & B_EVENT_INVALID) != 0);
+
+	// the entry is gone now
+	CHECK(wait_for_events(queue, fd) == 0);
+	CHECK(select_fd(queue, fd, 0) == B_ENTRY_NOT_FOUND);
+
+	close(queue);
+	close_pipe(pipe);
+}
+
+
+/*!	The child closes the last descriptor of a queue whose FD was selected in
+	the parent, after it put another FD at the same index. The FD must still
+	be usable in the parent afterwards, and not be reported as closed.
+*/
+static void
+test_close_from_other_team()
+{
+	test_pipe pipe;
+	if (!open_pipe(pipe)) {
+		sFailures++;
+		return;
+	}
+
+	int queue = create_event_queue(0);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ) == B_OK);
+
+	pid_t child = fork();
+	if (child == 0) {
+		close(pipe.read_fd);
+		int fd = open("/dev/null", O_RDONLY);
+		if (fd >= 0 && fd != pipe.read_fd)
+			dup2(fd, pipe.read_fd);
+
+		snooze(kTimeout);
+			// let the parent close its descriptor of the queue first
+		close(queue);
+		exit(0);
+	}
+
+	CHECK(child > 0);
+	close(queue);
+
+	int status = -1;
+	if (child > 0)
+		CHECK(waitpid(child, &status, 0) == child);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	// select the FD in a new queue, to see that it is still intact
+	queue = create_event_queue(O_CLOEXEC);
+	CHECK(queue >= 0);
+	CHECK(select_fd(queue, pipe.read_fd, B_EVENT_READ) == B_OK);
+
+	write_byte(pipe);
+	uint16 events = wait_for_events(queue, pipe.read_fd);
+	CHECK((events & B_EVENT_READ) != 0);
+	CHECK((events & B_EVENT_INVALID) == 0);
+	read_byte(pipe);
+
+	close(queue);
+	close_pipe(pipe);
+}
+
+
+int
+main()
+{
+	test_edge_triggered();
+	test_level_triggered();
+	test_one_shot();
+	test_closed_fd();
+	test_close_from_other_team();
+
+	if (sFailures > 0) {
+		printf("event_queue_test: %d checks FAILED\n", sFailures);
+		return 1;
+	}
+
+	printf("event_queue_test: all checks passed\n");
+	return 0;
+}
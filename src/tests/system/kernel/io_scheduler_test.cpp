@@ -0,0 +1,342 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Runs a mixed load against a block device in each of the I/O scheduler
+	modes: one thread writes large blocks sequentially, while others read
+	small blocks at random positions. The latencies the readers see, the
+	write throughput, and the statistics of the I/O schedulers are printed
+	for each mode.
+
+	THE CONTENTS OF THE DEVICE ARE OVERWRITTEN. A file backed device can be
+	created with the checksum_device test driver:
+		echo register /path/to/file > /dev/disk/virtual/checksum_device/control
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_scheduler_defs.h>
+#include <syscalls.h>
+
+
+static const size_t kWriteSize = 1024 * 1024;
+static const size_t kReadSize = 4096;
+static const int32 kMaxReaders = 16;
+static const int32 kMaxSchedulers = 64;
+
+struct reader {
+	pthread_t	thread;
+	int64		reads;
+	bigtime_t	total_time;
+	bigtime_t	max_time;
+};
+
+static int sDevice;
+static off_t sDeviceSize;
+static volatile bool sQuit;
+static int64 sBytesWritten;
+
+
+static void*
+writer_thread(void*)
+{
+	char* buffer = (char*)malloc(kWriteSize);
+	if (buffer == NULL)
+		return NULL;
+	memset(buffer, 0xaa, kWriteSize);
+
+	// the writer uses the first half of the device
+	off_t end = sDeviceSize / 2 - kWriteSize;
+	off_t offset = 0;
+
+	while (!sQuit) {
+		ssize_t written = pwrite(sDevice, buffer, kWriteSize, offset);
+		if (written < 0) {
+			fprintf(stderr, "Writing failed: %s\n", strerror(errno));
+			break;
+		}
+
+		sBytesWritten += written;
+		offset += written;
+		if (offset > end)
+			offset = 0;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+
+static void*
+reader_thread(void* _reader)
+{
+	reader& reader = *(struct reader*)_reader;
+	char buffer[kReadSize];
+
+	// the readers use the second half of the device
+	off_t blocks = sDeviceSize / 2 / kReadSize;
+	uint32 seed = (uint32)(addr_t)_reader;
+
+	while (!sQuit) {
+		seed = seed * 1103515245 + 12345;
+		off_t offset = sDeviceSize / 2 + (seed % blocks) * kReadSize;
+
+		bigtime_t startTime = system_time();
+		if (pread(sDevice, buffer, kReadSize, offset) < 0) {
+			fprintf(stderr, "Reading failed: %s\n", strerror(errno));
+			break;
+		}
+		bigtime_t time = system_time() - startTime;
+
+		reader.reads++;
+		reader.total_time += time;
+		if (time > reader.max_time)
+			reader.max_time = time;
+
+		// readers are interactive, they don't read all the time
+		snooze(10000);
+	}
+
+	return NULL;
+}
+
+
+static int32
+get_scheduler_infos(io_scheduler_info* infos)
+{
+	int32 count = 0;
+	int32 id = 0;
+
+	while (count < kMaxSchedulers) {
+		io_scheduler_info& info = infos[count];
+		info.id = id;
+		if (_kern_generic_syscall(IO_SCHEDULER_SYSCALLS,
+				IO_SCHEDULER_GET_NEXT_INFO, &info, sizeof(info)) != B_OK)
+			break;
+
+		id = info.id;
+		count++;
+	}
+
+	return count;
+}
+
+
+static status_t
+set_mode(int32 id, uint32 mode)
+{
+	io_scheduler_mode_control control;
+	control.id = id;
+	control.mode = mode;
+	return _kern_generic_syscall(IO_SCHEDULER_SYSCALLS, IO_SCHEDULER_SET_MODE,
+		&control, sizeof(control));
+}
+
+
+static const char*
+mode_name(uint32 mode)
+{
+	switch (mode) {
+		case IO_SCHEDULER_MODE_ROUND_ROBIN:
+			return "round robin";
+		case IO_SCHEDULER_MODE_FAIR:
+			return "fair";
+		case IO_SCHEDULER_MODE_DEADLINE:
+			return "deadline";
+		default:
+			return "none";
+	}
+}
+
+
+static void
+print_latencies(const char* label, const int64* before, const int64* after)
+{
+	printf("    %-6s", label);
+	for (int32 i = 0; i < IO_SCHEDULER_LATENCY_BUCKETS; i++)
+		printf(" %6" B_PRId64, after[i] - before[i]);
+	printf("\n");
+}
+
+
+static void
+print_statistics(const io_scheduler_info* before, int32 beforeCount,
+	const io_scheduler_info* after, int32 afterCount)
+{
+	for (int32 i = 0; i < afterCount; i++) {
+		const io_scheduler_stats& stats = after[i].stats;
+
+		io_scheduler_stats previous;
+		memset(&previous, 0, sizeof(previous));
+		for (int32 k = 0; k < beforeCount; k++) {
+			if (before[k].id == after[i].id)
+				previous = before[k].stats;
+		}
+
+		int64 requests = stats.read_requests + stats.write_requests
+			- previous.read_requests - previous.write_requests;
+		if (requests == 0)
+			continue;
+
+		printf("  scheduler %" B_PRId32 " \"%s\" (%s): %" B_PRId64 " reads, %"
+			B_PRId64 " writes, %" B_PRId64 " expired, %" B_PRId64 " merged, "
+			"max. queue depth %" B_PRId32 "\n", after[i].id, after[i].name,
+			mode_name(after[i].mode),
+			stats.read_requests - previous.read_requests,
+			stats.write_requests - previous.write_requests,
+			stats.expired_requests - previous.expired_requests,
+			stats.merged_requests - previous.merged_requests,
+			stats.max_queue_depth);
+
+		printf("    < ms  ");
+		for (int32 k = 0; k < IO_SCHEDULER_LATENCY_BUCKETS; k++)
+			printf(" %6g", (64LL << k) / 1000.0);
+		printf("\n");
+
+		print_latencies("reads", previous.read_latency, stats.read_latency);
+		print_latencies("writes", previous.write_latency, stats.write_latency);
+	}
+}
+
+
+static bool
+run(uint32 mode, int32 readerCount, int32 seconds)
+{
+	status_t status = set_mode(-1, mode);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to set mode \"%s\": %s\n", mode_name(mode),
+			strerror(status));
+		return false;
+	}
+
+	io_scheduler_info before[kMaxSchedulers];
+	int32 beforeCount = get_scheduler_infos(before);
+
+	sQuit = false;
+	sBytesWritten = 0;
+
+	reader readers[kMaxReaders];
+	memset(readers, 0, sizeof(readers));
+
+	pthread_t writer;
+	pthread_create(&writer, NULL, &writer_thread, NULL);
+	for (int32 i = 0; i < readerCount; i++) {
+		pthread_create(&readers[i].thread, NULL, &reader_thread,
+			&readers[i]);
+	}
+
+	bigtime_t startTime = system_time();
+	snooze(seconds * 1000000LL);
+	sQuit = true;
+
+	pthread_join(writer, NULL);
+	for (int32 i = 0; i < readerCount; i++)
+		pthread_join(readers[i].thread, NULL);
+
+	bigtime_t time = system_time() - startTime;
+
+	io_scheduler_info after[kMaxSchedulers];
+	int32 afterCount = get_scheduler_infos(after);
+
+	int64 reads = 0;
+	bigtime_t totalTime = 0;
+	bigtime_t maxTime = 0;
+	for (int32 i = 0; i < readerCount; i++) {
+		reads += readers[i].reads;
+		totalTime += readers[i].total_time;
+		if (readers[i].max_time > maxTime)
+			maxTime = readers[i].max_time;
+	}
+
+	printf("%s: %" B_PRId64 " reads, avg. %.2f ms, max. %.2f ms; writes "
+		"%.2f MB/s\n", mode_name(mode), reads,
+		reads > 0 ? totalTime / 1000.0 / reads : 0.0, maxTime / 1000.0,
+		sBytesWritten * 1000000.0 / time / 1024 / 1024);
+	print_statistics(before, beforeCount, after, afterCount);
+
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -r <readers> ] [ -t <seconds> ] <device>\n"
+		"Overwrites the contents of <device>!\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 readerCount = 4;
+	int32 seconds = 10;
+
+	int c;
+	while ((c = getopt(argc, argv, "r:t:h")) != -1) {
+		switch (c) {
+			case 'r':
+				readerCount = atol(optarg);
+				break;
+			case 't':
+				seconds = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind + 1 != argc || readerCount < 1 || readerCount > kMaxReaders
+		|| seconds < 1) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	sDevice = open(argv[optind], O_RDWR);
+	if (sDevice < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", argv[optind],
+			strerror(errno));
+		return 1;
+	}
+
+	sDeviceSize = lseek(sDevice, 0, SEEK_END);
+	if (sDeviceSize < 4 * (off_t)kWriteSize) {
+		fprintf(stderr, "The device is too small.\n");
+		return 1;
+	}
+
+	// remember the current modes, so that we can restore them
+	io_scheduler_info infos[kMaxSchedulers];
+	int32 count = get_scheduler_infos(infos);
+
+	static const uint32 kModes[] = {
+		IO_SCHEDULER_MODE_ROUND_ROBIN,
+		IO_SCHEDULER_MODE_FAIR,
+		IO_SCHEDULER_MODE_DEADLINE
+	};
+
+	bool success = true;
+	for (size_t i = 0; success && i < sizeof(kModes) / sizeof(kModes[0]); i++)
+		success = run(kModes[i], readerCount, seconds);
+
+	for (int32 i = 0; i < count; i++) {
+		if (infos[i].mode != IO_SCHEDULER_MODE_NONE)
+			set_mode(infos[i].id, infos[i].mode);
+	}
+
+	close(sDevice);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the cost of TLB misses: reads from random positions of a big
+	area, once mapped with small pages, and once with large pages
+	(B_LARGE_PAGE_AREA). Every read depends on the previous one, so that the
+	time per read is the latency of the cache and TLB misses.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <vm_defs.h>
+
+
+static bigtime_t
+random_reads(uint64* data, size_t count, int64 reads, uint64& _sum)
+{
+	// count is a power of two
+	size_t mask = count - 1;
+	size_t index = 0;
+	uint64 sum = 0;
+
+	bigtime_t startTime = system_time();
+
+	for (int64 i = 0; i < reads; i++) {
+		uint64 value = data[index];
+		sum += value;
+		index = (size_t)(value ^ i) & mask;
+	}
+
+	_sum = sum;
+	return system_time() - startTime;
+}
+
+
+static bool
+run(const char* label, size_t size, uint32 lock, uint32 flags, int64 reads)
+{
+	void* address;
+	bigtime_t startTime = system_time();
+	area_id area = create_area(label, &address, B_ANY_ADDRESS, size, lock,
+		B_READ_AREA | B_WRITE_AREA | flags);
+	if (area < 0) {
+		fprintf(stderr, "Failed to create area: %s\n", strerror(area));
+		return false;
+	}
+
+	// fill the area with random values, which also faults in the pages of the
+	// small page area
+	uint64* data = (uint64*)address;
+	size_t count = size / sizeof(uint64);
+	uint64 seed = 0x2545f4914f6cdd1dULL;
+	for (size_t i = 0; i < count; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		data[i] = seed >> 16;
+	}
+
+	bigtime_t setupTime = system_time() - startTime;
+
+	// warm up the caches, then measure
+	uint64 sum;
+	random_reads(data, count, reads / 10, sum);
+	bigtime_t time = random_reads(data, count, reads, sum);
+
+	printf("%-12s %10.2f %12.2f   (%" B_PRIx64 ")\n", label,
+		time * 1000.0 / reads, setupTime / 1000.0, sum & 0xff);
+
+	delete_area(area);
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -r <reads> ] [ -s <size in MB> ]\n"
+		"The size must be a power of two.\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int64 reads = 20000000;
+	size_t size = 256;
+
+	int c;
+	while ((c = getopt(argc, argv, "r:s:h")) != -1) {
+		switch (c) {
+			case 'r':
+				reads = strtoll(optarg, NULL, 0);
+				break;
+			case 's':
+				size = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (reads < 1 || size < 1 || (size & (size - 1)) != 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	size *= 1024 * 1024;
+
+	printf("%" B_PRIuSIZE " MB, %" B_PRId64 " reads\n", size / 1024 / 1024,
+		reads);
+	printf("%-12s %10s %12s\n", "pages", "ns/read", "setup ms");
+
+	if (!run("small", size, B_NO_LOCK, 0, reads)
+		|| !run("large", size, B_FULL_LOCK, B_LARGE_PAGE_AREA, reads)) {
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that areas mapped with large pages (B_LARGE_PAGE_AREA) behave
+	like any other area when they are protected, partially protected,
+	partially unmapped, shrunk, and grown again -- most of which forces the
+	translation map to split its large pages into page tables.
+*/
+
+
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <OS.h>
+
+#include <vm_defs.h>
+
+
+static const size_t kLargePageSize = 2 * 1024 * 1024;
+static const size_t kAreaSize = 4 * kLargePageSize;
+
+static sigjmp_buf sFaultJump;
+static int sFailures;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+static void
+fault_handler(int signal)
+{
+	siglongjmp(sFaultJump, 1);
+}
+
+
+static inline uint32
+pattern(size_t offset)
+{
+	return (uint32)offset * 2654435761U + 1;
+}
+
+
+static bool
+can_read(uint8* base, size_t offset)
+{
+	if (sigsetjmp(sFaultJump, 1) != 0)
+		return false;
+
+	*(volatile uint32*)(base + offset);
+	return true;
+}
+
+
+static bool
+can_write(uint8* base, size_t offset)
+{
+	if (sigsetjmp(sFaultJump, 1) != 0)
+		return false;
+
+	*(volatile uint32*)(base + offset) = pattern(offset);
+	return true;
+}
+
+
+static void
+fill(uint8* base, size_t start, size_t end)
+{
+	for (size_t offset = start; offset < end; offset += sizeof(uint32))
+		*(uint32*)(base + offset) = pattern(offset);
+}
+
+
+/*!	Returns whether [start, end) of \a base still contains the pattern. */
+static bool
+verify(uint8* base, size_t start, size_t end)
+{
+	for (size_t offset = start; offset < end; offset += sizeof(uint32)) {
+		if (*(uint32*)(base + offset) != pattern(offset)) {
+			fprintf(stderr, "  data at offset %#" B_PRIxSIZE " is damaged\n",
+				offset);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static bool
+is_zero(uint8* base, size_t start, size_t end)
+{
+	for (size_t offset = start; offset < end; offset += sizeof(uint32)) {
+		if (*(uint32*)(base + offset) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+
+static void
+test_protect_all(area_id area, uint8* base)
+{
+	// protecting complete large pages doesn't have to split them
+	CHECK(set_area_protection(area, B_READ_AREA) == B_OK);
+	CHECK(can_read(base, 0));
+	CHECK(!can_write(base, 0));
+	CHECK(!can_write(base, kLargePageSize + 12345 * sizeof(uint32)));
+	CHECK(!can_write(base, kAreaSize - sizeof(uint32)));
+	CHECK(verify(base, 0, kAreaSize));
+
+	CHECK(set_area_protection(area, B_READ_AREA | B_WRITE_AREA) == B_OK);
+	CHECK(can_write(base, 0));
+	CHECK(can_write(base, kLargePageSize + 12345 * sizeof(uint32)));
+	CHECK(can_write(base, kAreaSize - sizeof(uint32)));
+	CHECK(verify(base, 0, kAreaSize));
+}
+
+
+static void
+test_protect_page(uint8* base)
+{
+	// protecting a single page in the middle of a large page splits it
+	size_t page = kLargePageSize + 16 * B_PAGE_SIZE;
+	CHECK(mprotect(base + page, B_PAGE_SIZE, PROT_READ) == 0);
+
+	CHECK(can_read(base, page));
+	CHECK(!can_write(base, page));
+	CHECK(!can_write(base, page + B_PAGE_SIZE - sizeof(uint32)));
+	CHECK(can_write(base, page - sizeof(uint32)));
+	CHECK(can_write(base, page + B_PAGE_SIZE));
+	CHECK(can_write(base, kLargePageSize));
+	CHECK(can_write(base, 2 * kLargePageSize - sizeof(uint32)));
+	CHECK(verify(base, 0, kAreaSize));
+
+	CHECK(mprotect(base + page, B_PAGE_SIZE, PROT_READ | PROT_WRITE) == 0);
+	CHECK(can_write(base, page));
+	CHECK(verify(base, 0, kAreaSize));
+}
+
+
+static void
+test_unmap_range(uint8* base)
+{
+	// unmapping a range inside a large page splits it, and cuts the area
+	size_t start = 2 * kLargePageSize + kLargePageSize / 2;
+	size_t end = start + 16 * B_PAGE_SIZE;
+	CHECK(munmap(base + start, end - start) == 0);
+
+	CHECK(!can_read(base, start));
+	CHECK(!can_read(base, end - sizeof(uint32)));
+	CHECK(can_read(base, start - sizeof(uint32)));
+	CHECK(can_read(base, end));
+	CHECK(verify(base, 0, start));
+	CHECK(verify(base, end, kAreaSize));
+
+	// the area behind the hole is still writable
+	CHECK(can_write(base, end));
+	CHECK(can_write(base, kAreaSize - sizeof(uint32)));
+}
+
+
+static void
+test_resize(area_id area, uint8* base)
+{
+	// shrinking the first part of the area into its second large page splits
+	// that one
+	size_t size = kLargePageSize + 3 * B_PAGE_SIZE;
+	CHECK(resize_area(area, size) == B_OK);
+	CHECK(verify(base, 0, size));
+	CHECK(!can_read(base, size));
+	CHECK(!can_read(base, 2 * kLargePageSize - sizeof(uint32)));
+
+	// growing it again maps new, cleared pages into the page table that
+	// replaced the large page
+	size_t grownSize = 2 * kLargePageSize;
+	CHECK(resize_area(area, grownSize) == B_OK);
+	CHECK(verify(base, 0, size));
+	CHECK(is_zero(base, size, grownSize));
+
+	fill(base, size, grownSize);
+	CHECK(verify(base, 0, grownSize));
+}
+
+
+int
+main()
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &fault_handler;
+	sigaction(SIGSEGV, &action, NULL);
+	sigaction(SIGBUS, &action, NULL);
+
+	void* address;
+	area_id area = create_area("large page test", &address, B_ANY_ADDRESS,
+		kAreaSize, B_FULL_LOCK,
+		B_READ_AREA | B_WRITE_AREA | B_LARGE_PAGE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "Failed to create area: %s\n", strerror(area));
+		return 1;
+	}
+
+	uint8* base = (uint8*)address;
+	if ((addr_t)base % kLargePageSize != 0) {
+		printf("large_page_test: area is not aligned to large pages, only "
+			"small pages are tested\n");
+	}
+
+	CHECK(is_zero(base, 0, kAreaSize));
+	fill(base, 0, kAreaSize);
+	CHECK(verify(base, 0, kAreaSize));
+
+	test_protect_all(area, base);
+	test_protect_page(base);
+	test_unmap_range(base);
+	test_resize(area, base);
+
+	delete_area(area);
+	area_id tailArea = area_for(base + 3 * kLargePageSize);
+	CHECK(tailArea >= 0);
+	if (tailArea >= 0)
+		CHECK(delete_area(tailArea) == B_OK);
+
+	if (sFailures > 0) {
+		printf("large_page_test: %d checks FAILED\n", sFailures);
+		return 1;
+	}
+
+	printf("large_page_test: all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks how well the page replacement protects the working set from
+	streaming I/O: while one thread reads a file larger than the memory
+	sequentially, another one reads small blocks at random positions of a hot
+	file that fits into memory easily. Reads of the hot file that have to go
+	to the disk show up as slow reads.
+	The page replacement statistics of the kernel are printed as well.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <system_info.h>
+
+
+static const size_t kStreamReadSize = 64 * 1024;
+static const size_t kHotReadSize = 4096;
+static const bigtime_t kSlowReadTime = 1000;
+
+static volatile bool sQuit;
+static int sStreamFile;
+static off_t sStreamSize;
+static int64 sBytesStreamed;
+
+
+static bool
+create_file(const char* path, off_t size, int& _fd)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to create \"%s\": %s\n", path,
+			strerror(errno));
+		return false;
+	}
+
+	char* buffer = (char*)malloc(kStreamReadSize);
+	if (buffer == NULL) {
+		close(fd);
+		return false;
+	}
+
+	for (off_t offset = 0; offset < size; offset += kStreamReadSize) {
+		memset(buffer, (int)(offset / kStreamReadSize), kStreamReadSize);
+		if (write(fd, buffer, kStreamReadSize) != (ssize_t)kStreamReadSize) {
+			fprintf(stderr, "Failed to write \"%s\": %s\n", path,
+				strerror(errno));
+			free(buffer);
+			close(fd);
+			return false;
+		}
+	}
+
+	free(buffer);
+	fsync(fd);
+
+	_fd = fd;
+	return true;
+}
+
+
+static void*
+stream_thread(void*)
+{
+	char* buffer = (char*)malloc(kStreamReadSize);
+	if (buffer == NULL)
+		return NULL;
+
+	off_t offset = 0;
+	while (!sQuit) {
+		ssize_t bytesRead = pread(sStreamFile, buffer, kStreamReadSize,
+			offset);
+		if (bytesRead < 0) {
+			fprintf(stderr, "Reading failed: %s\n", strerror(errno));
+			break;
+		}
+
+		sBytesStreamed += bytesRead;
+		offset += bytesRead;
+		if (bytesRead == 0 || offset >= sStreamSize)
+			offset = 0;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+
+static bool
+read_hot_set(int fd, off_t size, int64 reads, const char* label)
+{
+	char buffer[kHotReadSize];
+	off_t blocks = size / kHotReadSize;
+	uint32 seed = 0x12345678;
+
+	bigtime_t totalTime = 0;
+	bigtime_t maxTime = 0;
+	int64 slowReads = 0;
+
+	for (int64 i = 0; i < reads; i++) {
+		seed = seed * 1103515245 + 12345;
+		off_t offset = (off_t)(seed % blocks) * kHotReadSize;
+
+		bigtime_t startTime = system_time();
+		if (pread(fd, buffer, kHotReadSize, offset) < 0) {
+			fprintf(stderr, "Reading failed: %s\n", strerror(errno));
+			return false;
+		}
+		bigtime_t time = system_time() - startTime;
+
+		totalTime += time;
+		if (time > maxTime)
+			maxTime = time;
+		if (time >= kSlowReadTime)
+			slowReads++;
+	}
+
+	printf("%-10s %10" B_PRId64 " %10.2f %10.2f %10" B_PRId64 " (%.1f%%)\n",
+		label, reads, totalTime / 1000.0 / reads, maxTime / 1000.0, slowReads,
+		slowReads * 100.0 / reads);
+	return true;
+}
+
+
+static void
+get_memory_info(system_memory_info& info)
+{
+	memset(&info, 0, sizeof(info));
+	__get_system_info_etc(B_MEMORY_INFO, &info, sizeof(info));
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -d <directory> ] [ -h <hot set MB> ] "
+		"[ -r <reads> ] [ -s <stream MB> ]\n"
+		"The stream size defaults to twice the memory size.\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	const char* directory = "/var/tmp";
+	off_t hotSize = 32;
+	off_t streamSize = 0;
+	int64 reads = 100000;
+
+	int c;
+	while ((c = getopt(argc, argv, "d:h:r:s:")) != -1) {
+		switch (c) {
+			case 'd':
+				directory = optarg;
+				break;
+			case 'h':
+				hotSize = strtoll(optarg, NULL, 0);
+				break;
+			case 'r':
+				reads = strtoll(optarg, NULL, 0);
+				break;
+			case 's':
+				streamSize = strtoll(optarg, NULL, 0);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (hotSize < 1 || reads < 1 || streamSize < 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	hotSize *= 1024 * 1024;
+	streamSize *= 1024 * 1024;
+
+	if (streamSize == 0) {
+		system_info info;
+		get_system_info(&info);
+		streamSize = 2 * (off_t)info.max_pages * B_PAGE_SIZE;
+	}
+	sStreamSize = streamSize;
+
+	char hotPath[B_PATH_NAME_LENGTH];
+	char streamPath[B_PATH_NAME_LENGTH];
+	snprintf(hotPath, sizeof(hotPath), "%s/page_replacement_hot", directory);
+	snprintf(streamPath, sizeof(streamPath), "%s/page_replacement_stream",
+		directory);
+
+	printf("creating files: hot set %" B_PRIdOFF " MB, stream %" B_PRIdOFF
+		" MB\n", hotSize / 1024 / 1024, streamSize / 1024 / 1024);
+
+	int hotFile;
+	if (!create_file(hotPath, hotSize, hotFile)
+		|| !create_file(streamPath, streamSize, sStreamFile)) {
+		unlink(hotPath);
+		unlink(streamPath);
+		return 1;
+	}
+
+	printf("%-10s %10s %10s %10s %10s\n", "hot reads", "count", "avg. ms",
+		"max. ms", "slow");
+
+	// get the hot set into memory and used more than once
+	bool success = read_hot_set(hotFile, hotSize, reads, "warm-up")
+		&& read_hot_set(hotFile, hotSize, reads, "idle");
+
+	system_memory_info before;
+	get_memory_info(before);
+
+	pthread_t streamer;
+	pthread_create(&streamer, NULL, &stream_thread, NULL);
+
+	bigtime_t startTime = system_time();
+	if (success)
+		success = read_hot_set(hotFile, hotSize, reads, "streaming");
+
+	sQuit = true;
+	pthread_join(streamer, NULL);
+	bigtime_t time = system_time() - startTime;
+
+	system_memory_info after;
+	get_memory_info(after);
+
+	printf("stream: %.2f MB/s\n",
+		sBytesStreamed * 1000000.0 / time / 1024 / 1024);
+	printf("pages: %" B_PRIu64 " evicted, %" B_PRIu64 " refaulted (%"
+		B_PRIu64 " activated), %" B_PRIu64 " activated on access\n",
+		after.evicted_pages - before.evicted_pages,
+		after.refault_pages - before.refault_pages,
+		after.refault_activations - before.refault_activations,
+		after.cache_activations - before.cache_activations);
+	printf("active: %" B_PRIu64 ", inactive: %" B_PRIu64 "\n",
+		after.active_pages, after.inactive_pages);
+
+	close(hotFile);
+	close(sStreamFile);
+	unlink(hotPath);
+	unlink(streamPath);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the latency of port messages: two threads bounce a message of
+	the given size back and forth between two ports, each one reading from
+	its own port and writing to the other one.
+	Optionally, a number of additional thread pairs does the same on ports of
+	their own at the same time, to see how the port lookup and message
+	allocation scale.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+static const int32 kMaxPairs = 16;
+
+struct ping_pong {
+	port_id		ports[2];
+	thread_id	threads[2];
+	size_t		size;
+	int32		round_trips;
+	bigtime_t	time;
+};
+
+struct player {
+	ping_pong*	game;
+	int32		index;
+};
+
+
+static status_t
+player_thread(void* _player)
+{
+	player& self = *(player*)_player;
+	ping_pong& game = *self.game;
+	port_id readPort = game.ports[self.index];
+	port_id writePort = game.ports[1 - self.index];
+
+	char* buffer = (char*)malloc(game.size + 1);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	memset(buffer, 0x55, game.size);
+
+	bigtime_t startTime = system_time();
+
+	for (int32 i = 0; i < game.round_trips; i++) {
+		int32 code;
+		if (self.index == 0) {
+			if (write_port(writePort, i, buffer, game.size) != B_OK
+				|| read_port(readPort, &code, buffer, game.size) < 0) {
+				free(buffer);
+				return B_ERROR;
+			}
+		} else {
+			if (read_port(readPort, &code, buffer, game.size) < 0
+				|| write_port(writePort, code, buffer, game.size) != B_OK) {
+				free(buffer);
+				return B_ERROR;
+			}
+		}
+	}
+
+	if (self.index == 0)
+		game.time = system_time() - startTime;
+
+	free(buffer);
+	return B_OK;
+}
+
+
+static bool
+run(size_t size, int32 roundTrips, int32 pairCount)
+{
+	ping_pong games[kMaxPairs];
+	player players[kMaxPairs][2];
+
+	for (int32 i = 0; i < pairCount; i++) {
+		ping_pong& game = games[i];
+		game.size = size;
+		game.round_trips = roundTrips;
+		game.time = -1;
+
+		for (int32 k = 0; k < 2; k++) {
+			game.ports[k] = create_port(1, "ping pong");
+			if (game.ports[k] < 0) {
+				fprintf(stderr, "Failed to create port: %s\n",
+					strerror(game.ports[k]));
+				return false;
+			}
+
+			players[i][k].game = &game;
+			players[i][k].index = k;
+			game.threads[k] = spawn_thread(&player_thread, "player",
+				B_NORMAL_PRIORITY, &players[i][k]);
+		}
+	}
+
+	for (int32 i = 0; i < pairCount; i++) {
+		resume_thread(games[i].threads[1]);
+		resume_thread(games[i].threads[0]);
+	}
+
+	bool success = true;
+	bigtime_t totalTime = 0;
+	for (int32 i = 0; i < pairCount; i++) {
+		for (int32 k = 0; k < 2; k++) {
+			status_t status;
+			wait_for_thread(games[i].threads[k], &status);
+			if (status != B_OK)
+				success = false;
+
+			delete_port(games[i].ports[k]);
+		}
+
+		totalTime += games[i].time;
+	}
+
+	if (!success) {
+		fprintf(stderr, "Ping pong with %" B_PRIuSIZE " bytes failed.\n",
+			size);
+		return false;
+	}
+
+	bigtime_t time = totalTime / pairCount;
+	printf("%10" B_PRIuSIZE " %6" B_PRId32 " %10.2f %12.0f\n", size,
+		pairCount, (double)time / roundTrips,
+		1000000.0 * roundTrips * 2 * pairCount / time);
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -n <round trips> ] [ -p <pairs> ] "
+		"[ <size> ... ]\n"
+		"The sizes default to 0, 16, 256, 4096, and 65536 bytes.\n",
+		programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 roundTrips = 100000;
+	int32 pairCount = 1;
+
+	int c;
+	while ((c = getopt(argc, argv, "n:p:h")) != -1) {
+		switch (c) {
+			case 'n':
+				roundTrips = atol(optarg);
+				break;
+			case 'p':
+				pairCount = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (roundTrips < 1 || pairCount < 1 || pairCount > kMaxPairs) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	size_t sizes[16] = { 0, 16, 256, 4096, 65536 };
+	int32 sizeCount = 5;
+	if (optind < argc) {
+		sizeCount = 0;
+		for (; optind < argc && sizeCount < 16; optind++)
+			sizes[sizeCount++] = strtoul(argv[optind], NULL, 0);
+	}
+
+	printf("%10s %6s %10s %12s\n", "size", "pairs", "us/trip", "msgs/s");
+
+	for (int32 i = 0; i < sizeCount; i++) {
+		if (!run(sizes[i], roundTrips, pairCount))
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how well the scheduler spreads CPU bound threads over the
+	available CPUs. A number of busy threads is started together with
+	"bursty" threads that sleep and wake up again, creating an ever changing
+	load. At the end the kernel scheduling analysis (needs a kernel built with
+	SCHEDULING_ANALYSIS_TRACING) is used to determine how long the threads were
+	ready, but had to wait for a CPU, and how evenly the CPU time was
+	distributed.
+	Run it once per scheduler mode (see the "scheduler" kernel settings option)
+	to compare them.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <scheduler_defs.h>
+#include <syscalls.h>
+
+
+static const size_t kAnalysisBufferSize = 64 * 1024 * 1024;
+
+static volatile bool sQuit = false;
+
+
+struct test_thread {
+	thread_id	thread;
+	bool		bursty;
+	int64		iterations;
+};
+
+
+static status_t
+busy_thread(void* data)
+{
+	test_thread* info = (test_thread*)data;
+	while (!sQuit) {
+		if (info->bursty) {
+			// run for a bit, then sleep
+			bigtime_t end = system_time() + 2000 + rand() % 8000;
+			while (system_time() < end)
+				info->iterations++;
+			snooze(1000 + rand() % 5000);
+		} else {
+			for (int32 i = 0; i < 10000; i++)
+				info->iterations++;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -t <threads> ] [ -b <bursty threads> ] "
+		"[ -d <seconds> ]\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int32 threadCount = info.cpu_count * 2;
+	int32 burstyCount = info.cpu_count;
+	bigtime_t duration = 5000000;
+
+	int c;
+	while ((c = getopt(argc, argv, "t:b:d:h")) != -1) {
+		switch (c) {
+			case 't':
+				threadCount = atol(optarg);
+				break;
+			case 'b':
+				burstyCount = atol(optarg);
+				break;
+			case 'd':
+				duration = atol(optarg) * 1000000LL;
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	int32 totalCount = threadCount + burstyCount;
+	test_thread* threads = new test_thread[totalCount];
+
+	for (int32 i = 0; i < totalCount; i++) {
+		threads[i].bursty = i >= threadCount;
+		threads[i].iterations = 0;
+		threads[i].thread = spawn_thread(&busy_thread,
+			threads[i].bursty ? "bursty" : "busy", B_NORMAL_PRIORITY,
+			&threads[i]);
+		if (threads[i].thread < 0) {
+			fprintf(stderr, "Failed to spawn thread: %s\n",
+				strerror(threads[i].thread));
+			return 1;
+		}
+	}
+
+	printf("%" B_PRId32 " CPUs, %" B_PRId32 " busy and %" B_PRId32 " bursty "
+		"threads, running for %g s\n", info.cpu_count, threadCount,
+		burstyCount, duration / 1000000.0);
+
+	bigtime_t startTime = system_time();
+	for (int32 i = 0; i < totalCount; i++)
+		resume_thread(threads[i].thread);
+
+	snooze(duration);
+	sQuit = true;
+
+	bigtime_t endTime = system_time();
+	for (int32 i = 0; i < totalCount; i++)
+		wait_for_thread(threads[i].thread, NULL);
+
+	int64 minIterations = -1;
+	int64 maxIterations = 0;
+	int64 totalIterations = 0;
+	for (int32 i = 0; i < threadCount; i++) {
+		int64 iterations = threads[i].iterations;
+		totalIterations += iterations;
+		if (minIterations < 0 || iterations < minIterations)
+			minIterations = iterations;
+		if (iterations > maxIterations)
+			maxIterations = iterations;
+	}
+
+	printf("busy threads: %" B_PRId64 " iterations, min/max per thread %"
+		B_PRId64 "/%" B_PRId64 " (%.1f%% spread)\n", totalIterations,
+		minIterations, maxIterations, minIterations > 0
+			? 100.0 * (maxIterations - minIterations) / minIterations : 0.0);
+
+	// get the kernel's view of things
+	void* buffer = malloc(kAnalysisBufferSize);
+	if (buffer == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	scheduling_analysis analysis;
+	status_t error = _kern_analyze_scheduling(startTime, endTime, buffer,
+		kAnalysisBufferSize, &analysis);
+	if (error != B_OK) {
+		fprintf(stderr, "Scheduling analysis failed: %s\n", strerror(error));
+		return 1;
+	}
+
+	bigtime_t totalRunTime = 0;
+	bigtime_t totalLatency = 0;
+	bigtime_t maxLatency = 0;
+	int64 latencies = 0;
+	int64 preemptions = 0;
+	for (uint32 i = 0; i < analysis.thread_count; i++) {
+		scheduling_analysis_thread* thread = analysis.threads[i];
+
+		bool ours = false;
+		for (int32 k = 0; k < totalCount; k++) {
+			if (threads[k].thread == thread->id) {
+				ours = true;
+				break;
+			}
+		}
+		if (!ours)
+			continue;
+
+		totalRunTime += thread->total_run_time;
+		totalLatency += thread->total_latency;
+		latencies += thread->latencies;
+		preemptions += thread->preemptions;
+		if (thread->max_latency > maxLatency)
+			maxLatency = thread->max_latency;
+	}
+
+	bigtime_t available = (endTime - startTime) * info.cpu_count;
+	printf("CPU utilization:    %.1f%%\n", 100.0 * totalRunTime / available);
+	printf("average latency:    %" B_PRId64 " us\n",
+		latencies > 0 ? totalLatency / latencies : 0);
+	printf("maximum latency:    %" B_PRId64 " us\n", maxLatency);
+	printf("time spent waiting: %" B_PRId64 " us\n", totalLatency);
+	printf("preemptions:        %" B_PRId64 "\n", preemptions);
+
+	free(buffer);
+	delete[] threads;
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Prints the allocation statistics of the kernel's object caches. With an
+	interval given, the rates during that interval are printed instead of the
+	totals since boot, sorted by allocation rate.
+*/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <slab_statistics.h>
+#include <syscalls.h>
+
+
+static status_t
+get_statistics(slab_cache_statistics*& _statistics, int32& _count)
+{
+	int32 capacity = 256;
+
+	while (true) {
+		slab_cache_statistics* statistics = (slab_cache_statistics*)malloc(
+			capacity * sizeof(slab_cache_statistics));
+		if (statistics == NULL)
+			return B_NO_MEMORY;
+
+		status_t count = _kern_generic_syscall(SLAB_STATISTICS,
+			GET_SLAB_CACHE_STATISTICS, statistics,
+			capacity * sizeof(slab_cache_statistics));
+		if (count < 0) {
+			free(statistics);
+			return count;
+		}
+
+		if (count <= capacity) {
+			_statistics = statistics;
+			_count = count;
+			return B_OK;
+		}
+
+		// more caches than we have room for
+		free(statistics);
+		capacity = count + 16;
+	}
+}
+
+
+static const slab_cache_statistics*
+find_cache(const slab_cache_statistics* statistics, int32 count,
+	const char* name)
+{
+	for (int32 i = 0; i < count; i++) {
+		if (strcmp(statistics[i].name, name) == 0)
+			return &statistics[i];
+	}
+
+	return NULL;
+}
+
+
+static int
+compare_allocations(const void* _a, const void* _b)
+{
+	const slab_cache_statistics* a = (const slab_cache_statistics*)_a;
+	const slab_cache_statistics* b = (const slab_cache_statistics*)_b;
+
+	if (a->allocations == b->allocations)
+		return 0;
+	return a->allocations > b->allocations ? -1 : 1;
+}
+
+
+static void
+print_statistics(const slab_cache_statistics* statistics, int32 count,
+	const char* unit)
+{
+	printf("%-32s %7s %10s %6s %12s %12s %6s %6s %8s\n", "name", "objsize",
+		"usage", "magcap", unit[0] != '\0' ? "allocs/s" : "allocs",
+		unit[0] != '\0' ? "frees/s" : "frees", "amiss%", "fmiss%",
+		"contend");
+
+	for (int32 i = 0; i < count; i++) {
+		const slab_cache_statistics& cache = statistics[i];
+
+		double allocationMisses = cache.allocations > 0
+			? 100.0 * cache.allocation_misses / cache.allocations : 0.0;
+		double freeMisses = cache.frees > 0
+			? 100.0 * cache.free_misses / cache.frees : 0.0;
+
+		printf("%-32s %7lu %10lu %6" B_PRIu32 " %12" B_PRId64 " %12" B_PRId64
+			" %6.1f %6.1f %8" B_PRId64 "\n", cache.name, cache.object_size,
+			cache.usage, cache.magazine_capacity, cache.allocations,
+			cache.frees, allocationMisses, freeMisses,
+			cache.depot_contention);
+	}
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr, "Usage: %s [ -i <seconds> ]\n", programName);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 interval = 0;
+
+	int c;
+	while ((c = getopt(argc, argv, "i:h")) != -1) {
+		switch (c) {
+			case 'i':
+				interval = atol(optarg);
+				break;
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	slab_cache_statistics* statistics;
+	int32 count;
+	status_t status = get_statistics(statistics, count);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to get the slab statistics: %s\n",
+			strerror(status));
+		return 1;
+	}
+
+	if (interval <= 0) {
+		print_statistics(statistics, count, "");
+		free(statistics);
+		return 0;
+	}
+
+	bigtime_t startTime = system_time();
+	snooze(interval * 1000000LL);
+
+	slab_cache_statistics* previous = statistics;
+	int32 previousCount = count;
+	status = get_statistics(statistics, count);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to get the slab statistics: %s\n",
+			strerror(status));
+		return 1;
+	}
+
+	double seconds = (system_time() - startTime) / 1000000.0;
+
+	// turn the totals into rates
+	for (int32 i = 0; i < count; i++) {
+		slab_cache_statistics& cache = statistics[i];
+		const slab_cache_statistics* before = find_cache(previous,
+			previousCount, cache.name);
+		if (before != NULL) {
+			cache.allocations -= before->allocations;
+			cache.frees -= before->frees;
+			cache.allocation_misses -= before->allocation_misses;
+			cache.free_misses -= before->free_misses;
+			cache.depot_contention -= before->depot_contention;
+		}
+
+		cache.allocations = (int64)(cache.allocations / seconds);
+		cache.frees = (int64)(cache.frees / seconds);
+		cache.allocation_misses = (int64)(cache.allocation_misses / seconds);
+		cache.free_misses = (int64)(cache.free_misses / seconds);
+	}
+
+	qsort(statistics, count, sizeof(slab_cache_statistics),
+		&compare_allocations);
+	print_statistics(statistics, count, "/s");
+
+	free(previous);
+	free(statistics);
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that pages survive being written to a fragmented swap file.
+	First, the swap space is filled with the pages of many small areas, and
+	every other one of them is deleted, which leaves only small holes. Then
+	big areas are written, whose clusters of modified pages can't get a
+	contiguous slot range anymore, so that the swap code has to split them
+	up. At the end, all remaining pages are read back, and compared.
+	The test needs a swap file, and takes a while, since it has to push most
+	of the memory out to it.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <system_info.h>
+
+
+static const size_t kSmallAreaPages = 4;
+static const size_t kBigAreaPages = 256;
+
+
+struct test_area {
+	area_id		id;
+	uint32*		address;
+	size_t		pages;
+};
+
+
+static inline uint32
+pattern(int32 area, size_t page, int32 word)
+{
+	return ((uint32)area << 16 | (uint32)page) * 2654435761U + word;
+}
+
+
+static bool
+create_test_area(test_area& area, int32 index, size_t pages)
+{
+	void* address;
+	area.id = create_area("swap fragmentation", &address, B_ANY_ADDRESS,
+		pages * B_PAGE_SIZE, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area.id < 0)
+		return false;
+
+	area.address = (uint32*)address;
+	area.pages = pages;
+
+	// mark the first, a middle, and the last word of every page
+	const size_t words = B_PAGE_SIZE / sizeof(uint32);
+	for (size_t page = 0; page < pages; page++) {
+		uint32* data = area.address + page * words;
+		data[0] = pattern(index, page, 0);
+		data[words / 2] = pattern(index, page, 1);
+		data[words - 1] = pattern(index, page, 2);
+	}
+
+	return true;
+}
+
+
+static int32
+verify_test_area(const test_area& area, int32 index)
+{
+	const size_t words = B_PAGE_SIZE / sizeof(uint32);
+	int32 damaged = 0;
+
+	for (size_t page = 0; page < area.pages; page++) {
+		uint32* data = area.address + page * words;
+		if (data[0] != pattern(index, page, 0)
+			|| data[words / 2] != pattern(index, page, 1)
+			|| data[words - 1] != pattern(index, page, 2)) {
+			if (damaged++ == 0) {
+				fprintf(stderr, "area %" B_PRId32 ", page %" B_PRIuSIZE
+					" is damaged\n", index, page);
+			}
+		}
+	}
+
+	return damaged;
+}
+
+
+static bool
+get_memory_info(system_memory_info& info)
+{
+	status_t status = __get_system_info_etc(B_MEMORY_INFO, &info,
+		sizeof(system_memory_info));
+	if (status != B_OK) {
+		fprintf(stderr, "Could not get the memory info: %s\n",
+			strerror(status));
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	system_memory_info info;
+	if (!get_memory_info(info))
+		return 1;
+
+	if (info.max_swap_space == 0) {
+		printf("swap_fragmentation_test: no swap file, skipped\n");
+		return 0;
+	}
+
+	// the small areas take most of the memory that can be committed, and
+	// therefore most of the swap space
+	uint64 budget = info.free_memory / 10 * 9;
+	size_t smallCount = budget / 2 / (kSmallAreaPages * B_PAGE_SIZE);
+	size_t bigCount = budget / 3 / (kBigAreaPages * B_PAGE_SIZE);
+
+	test_area* smallAreas = (test_area*)calloc(smallCount, sizeof(test_area));
+	test_area* bigAreas = (test_area*)calloc(bigCount, sizeof(test_area));
+	if (smallAreas == NULL || bigAreas == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	uint64 swapOutPages = info.swap_out_pages;
+	uint64 swapOutWrites = info.swap_out_writes;
+
+	for (size_t i = 0; i < smallCount; i++) {
+		if (!create_test_area(smallAreas[i], i, kSmallAreaPages)) {
+			smallCount = i;
+			break;
+		}
+	}
+
+	// punch holes into the used swap space
+	for (size_t i = 0; i < smallCount; i += 2) {
+		delete_area(smallAreas[i].id);
+		smallAreas[i].id = -1;
+	}
+
+	for (size_t i = 0; i < bigCount; i++) {
+		if (!create_test_area(bigAreas[i], smallCount + i, kBigAreaPages)) {
+			bigCount = i;
+			break;
+		}
+	}
+
+	int32 damaged = 0;
+	for (size_t i = 1; i < smallCount; i += 2)
+		damaged += verify_test_area(smallAreas[i], i);
+	for (size_t i = 0; i < bigCount; i++)
+		damaged += verify_test_area(bigAreas[i], smallCount + i);
+
+	for (size_t i = 0; i < smallCount; i++) {
+		if (smallAreas[i].id >= 0)
+			delete_area(smallAreas[i].id);
+	}
+	for (size_t i = 0; i < bigCount; i++)
+		delete_area(bigAreas[i].id);
+
+	free(smallAreas);
+	free(bigAreas);
+
+	if (!get_memory_info(info))
+		return 1;
+
+	swapOutPages = info.swap_out_pages - swapOutPages;
+	swapOutWrites = info.swap_out_writes - swapOutWrites;
+	printf("%" B_PRIuSIZE " small and %" B_PRIuSIZE " big areas, %" B_PRIu64
+		" pages swapped out in %" B_PRIu64 " writes\n", smallCount, bigCount,
+		swapOutPages, swapOutWrites);
+
+	if (damaged > 0) {
+		printf("swap_fragmentation_test: %" B_PRId32 " pages FAILED\n",
+			damaged);
+		return 1;
+	}
+
+	if (swapOutPages == 0) {
+		printf("swap_fragmentation_test: nothing was swapped out, "
+			"inconclusive\n");
+		return 0;
+	}
+
+	printf("swap_fragmentation_test: all pages passed\n");
+	return 0;
+}
@@ -7,6 +7,9 @@
 #include "fssh.h"
 
 #include "command_checkfs.h"
+#include "command_fsyncbench.h"
+#include "command_fsynctest.h"
+#include "command_querybench.h"
 
 
 namespace FSShell {
@@ -17,6 +20,12 @@ register_additional_commands()
 {
 	CommandManager::Default()->AddCommand(command_checkfs, "checkfs",
 		"check file system");
+	CommandManager::Default()->AddCommand(command_querybench, "querybench",
+		"measure query performance");
+	CommandManager::Default()->AddCommand(command_fsyncbench, "fsyncbench",
+		"measure fsync() performance");
+	CommandManager::Default()->AddCommand(command_fsynctest, "fsynctest",
+		"check fsync() durability with concurrent writers");
 }
 
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A simple fsync() benchmark: a number of threads each repeatedly write to
+	and fsync() their own file, and the number of fsync() calls per second
+	all of them achieve together is measured. With several writers, the
+	journal should be able to commit their transactions as a group.
+	Mount the volume with "commit_latency <us>" to see how waiting for more
+	transactions to join a commit affects the results.
+*/
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+
+
+namespace FSShell {
+
+
+static const char* const kBaseDirectory = "/myfs/fsyncbench";
+static const int32 kMaxWriters = 64;
+static const size_t kWriteSize = 512;
+
+
+struct writer_data {
+	int32			index;
+	fssh_bigtime_t	end_time;
+	int32			fsyncs;
+	fssh_bigtime_t	max_latency;
+	fssh_status_t	status;
+};
+
+
+static fssh_status_t
+writer_thread(void* _data)
+{
+	writer_data* data = (writer_data*)_data;
+
+	char path[FSSH_B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/w%" B_PRId32, kBaseDirectory,
+		data->index);
+
+	int fd = _kern_open(-1, path, FSSH_O_CREAT | FSSH_O_WRONLY | FSSH_O_TRUNC,
+		0644);
+	if (fd < 0) {
+		data->status = fd;
+		return fd;
+	}
+
+	char buffer[kWriteSize];
+	fssh_memset(buffer, 'a' + data->index % 26, sizeof(buffer));
+
+	fssh_off_t offset = 0;
+	while (fssh_system_time() < data->end_time) {
+		// every write changes the size, and thus the inode
+		if (_kern_write(fd, offset, buffer, sizeof(buffer))
+				!= (fssh_ssize_t)sizeof(buffer)) {
+			data->status = B_IO_ERROR;
+			break;
+		}
+		offset += sizeof(buffer);
+
+		fssh_bigtime_t startTime = fssh_system_time();
+
+		fssh_status_t status = _kern_fsync(fd);
+		if (status != B_OK) {
+			data->status = status;
+			break;
+		}
+
+		fssh_bigtime_t latency = fssh_system_time() - startTime;
+		if (latency > data->max_latency)
+			data->max_latency = latency;
+
+		data->fsyncs++;
+	}
+
+	_kern_close(fd);
+	return data->status;
+}
+
+
+fssh_status_t
+command_fsyncbench(int argc, const char* const* argv)
+{
+	int32 writers = 4;
+	int32 seconds = 5;
+
+	for (int argi = 1; argi < argc; argi++) {
+		const char* arg = argv[argi];
+
+		if (!strcmp(arg, "-w") && argi + 1 < argc)
+			writers = strtol(argv[++argi], NULL, 0);
+		else if (!strcmp(arg, "-s") && argi + 1 < argc)
+			seconds = strtol(argv[++argi], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-w <writers>] [-s <seconds>]\n"
+				"  -w  Number of concurrent writer threads (default 4, at "
+				"most %" B_PRId32 ")\n"
+				"  -s  Duration of the benchmark in seconds (default 5)\n",
+				argv[0], kMaxWriters);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (writers < 1)
+		writers = 1;
+	else if (writers > kMaxWriters)
+		writers = kMaxWriters;
+	if (seconds < 1)
+		seconds = 1;
+
+	fssh_status_t status = _kern_create_dir(-1, kBaseDirectory, 0755);
+	if (status != B_OK && status != FSSH_B_FILE_EXISTS) {
+		fssh_dprintf("Could not create \"%s\": %s\n", kBaseDirectory,
+			fssh_strerror(status));
+		return status;
+	}
+
+	writer_data data[kMaxWriters];
+	fssh_thread_id threads[kMaxWriters];
+	fssh_bigtime_t startTime = fssh_system_time();
+
+	for (int32 i = 0; i < writers; i++) {
+		data[i].index = i;
+		data[i].end_time = startTime + seconds * 1000000LL;
+		data[i].fsyncs = 0;
+		data[i].max_latency = 0;
+		data[i].status = B_OK;
+
+		threads[i] = spawn_thread(&writer_thread, "fsyncbench writer",
+			B_NORMAL_PRIORITY, &data[i]);
+		if (threads[i] >= 0)
+			resume_thread(threads[i]);
+	}
+
+	int64 fsyncs = 0;
+	fssh_bigtime_t maxLatency = 0;
+
+	for (int32 i = 0; i < writers; i++) {
+		if (threads[i] < 0) {
+			status = threads[i];
+			continue;
+		}
+
+		fssh_status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+
+		fsyncs += data[i].fsyncs;
+		if (data[i].max_latency > maxLatency)
+			maxLatency = data[i].max_latency;
+		if (data[i].status != B_OK)
+			status = data[i].status;
+	}
+
+	double totalTime = (fssh_system_time() - startTime) / 1000000.0;
+
+	if (status != B_OK) {
+		fssh_dprintf("The benchmark failed: %s\n", fssh_strerror(status));
+		return status;
+	}
+
+	fssh_dprintf("%" B_PRId32 " writers, %" B_PRId64 " fsyncs in %g s\n",
+		writers, fsyncs, totalTime);
+	fssh_dprintf("  %g fsyncs/s, %g us average, %" B_PRId64 " us max "
+		"latency\n", fsyncs / totalTime,
+		fsyncs > 0 ? totalTime * 1000000.0 * writers / fsyncs : 0.0,
+		maxLatency);
+
+	return B_OK;
+}
+
+
+}	// namespace FSShell
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FSYNCBENCH_H
+#define FSYNCBENCH_H
+
+
+#include "fssh_types.h"
+
+
+namespace FSShell {
+
+
+fssh_status_t command_fsyncbench(int argc, const char* const* argv);
+
+
+}	// namespace FSShell
+
+
+#endif	// FSYNCBENCH_H
@@ -0,0 +1,399 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Checks that whatever fsync() returned for survives a crash, also when
+	many threads commit at the same time.
+	A number of writer threads each append numbered records to their own
+	file, and fsync() it after every record. Every few records, they also
+	create a numbered marker file, and fsync() that one.
+	After the writers have stopped, the image on the host contains exactly
+	what a crash would have left behind at that point, since the fs_shell
+	only writes to it from the threads calling into the file system. A copy
+	of the image is mounted, which replays its log, and for every writer
+	all of the records and markers that it fsync()ed must be there, intact,
+	and since transactions are logged in order, there must not be any gaps
+	between its markers.
+*/
+
+
+#include "fssh_errors.h"
+#include "fssh_fcntl.h"
+#include "fssh_fs_info.h"
+#include "fssh_stat.h"
+#include "fssh_stdio.h"
+#include "fssh_string.h"
+#include "fssh_unistd.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+
+
+namespace FSShell {
+
+
+static const char* const kBaseDirectory = "/myfs/fsynctest";
+static const char* const kCrashMountPoint = "/fsynctest-crash";
+static const char* const kCrashDirectory = "/fsynctest-crash/fsynctest";
+static const int32 kMaxWriters = 64;
+static const int32 kMarkerInterval = 8;
+static const size_t kRecordSize = 512;
+
+
+struct record_header {
+	uint32			writer;
+	uint32			index;
+	uint32			checksum;
+};
+
+struct writer_data {
+	int32			index;
+	int32			records;
+	int32			synced_records;
+	int32			synced_markers;
+	fssh_status_t	status;
+};
+
+
+static uint32
+record_checksum(uint32 writer, uint32 index)
+{
+	return (writer + 1) * 0x9e3779b1 ^ (index + 1) * 0x85ebca77;
+}
+
+
+static void
+fill_record(uint8* buffer, uint32 writer, uint32 index)
+{
+	record_header* header = (record_header*)buffer;
+	header->writer = writer;
+	header->index = index;
+	header->checksum = record_checksum(writer, index);
+
+	for (size_t i = sizeof(record_header); i < kRecordSize; i++)
+		buffer[i] = (uint8)(header->checksum >> (i % 4 * 8)) + i;
+}
+
+
+static fssh_status_t
+create_marker(int32 writer, int32 marker, bool sync)
+{
+	char path[FSSH_B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/m%" B_PRId32 "-%" B_PRId32,
+		kBaseDirectory, writer, marker);
+
+	int fd = _kern_open(-1, path, FSSH_O_CREAT | FSSH_O_WRONLY, 0644);
+	if (fd < 0)
+		return fd;
+
+	fssh_status_t status = sync ? _kern_fsync(fd) : B_OK;
+	_kern_close(fd);
+	return status;
+}
+
+
+static fssh_status_t
+writer_thread(void* _data)
+{
+	writer_data* data = (writer_data*)_data;
+
+	char path[FSSH_B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/w%" B_PRId32, kBaseDirectory,
+		data->index);
+
+	int fd = _kern_open(-1, path, FSSH_O_CREAT | FSSH_O_WRONLY | FSSH_O_TRUNC,
+		0644);
+	if (fd < 0) {
+		data->status = fd;
+		return fd;
+	}
+
+	uint8 buffer[kRecordSize];
+
+	for (int32 i = 0; i <= data->records; i++) {
+		// the last record and marker are never synced; they might or might
+		// not survive the crash
+		bool sync = i < data->records;
+
+		fill_record(buffer, data->index, i);
+		if (_kern_write(fd, (fssh_off_t)i * kRecordSize, buffer, kRecordSize)
+				!= (fssh_ssize_t)kRecordSize) {
+			data->status = B_IO_ERROR;
+			break;
+		}
+
+		if (sync) {
+			fssh_status_t status = _kern_fsync(fd);
+			if (status != B_OK) {
+				data->status = status;
+				break;
+			}
+			data->synced_records = i + 1;
+		}
+
+		if (i % kMarkerInterval == kMarkerInterval - 1 || !sync) {
+			int32 marker = i / kMarkerInterval;
+			fssh_status_t status = create_marker(data->index, marker, sync);
+			if (status != B_OK) {
+				data->status = status;
+				break;
+			}
+			if (sync)
+				data->synced_markers = marker + 1;
+		}
+	}
+
+	_kern_close(fd);
+	return data->status;
+}
+
+
+static fssh_status_t
+copy_image(const char* source, const char* target)
+{
+	int sourceFD = fssh_open(source, FSSH_O_RDONLY);
+	if (sourceFD < 0)
+		return fssh_errno;
+
+	int targetFD = fssh_open(target,
+		FSSH_O_WRONLY | FSSH_O_CREAT | FSSH_O_TRUNC, 0644);
+	if (targetFD < 0) {
+		fssh_close(sourceFD);
+		return fssh_errno;
+	}
+
+	fssh_status_t status = B_OK;
+	uint8 buffer[65536];
+
+	while (true) {
+		fssh_ssize_t bytesRead = fssh_read(sourceFD, buffer, sizeof(buffer));
+		if (bytesRead <= 0) {
+			if (bytesRead < 0)
+				status = fssh_errno;
+			break;
+		}
+
+		if (fssh_write(targetFD, buffer, bytesRead) != bytesRead) {
+			status = B_IO_ERROR;
+			break;
+		}
+	}
+
+	fssh_close(sourceFD);
+	fssh_close(targetFD);
+	return status;
+}
+
+
+static int32
+check_writer(const writer_data& data)
+{
+	int32 errors = 0;
+
+	char path[FSSH_B_PATH_NAME_LENGTH];
+	fssh_snprintf(path, sizeof(path), "%s/w%" B_PRId32, kCrashDirectory,
+		data.index);
+
+	int fd = _kern_open(-1, path, FSSH_O_RDONLY, 0);
+	if (fd < 0) {
+		fssh_dprintf("writer %" B_PRId32 ": file is missing: %s\n",
+			data.index, fssh_strerror(fd));
+		return 1;
+	}
+
+	fssh_struct_stat st;
+	if (_kern_read_stat(fd, NULL, false, &st, sizeof(st)) != B_OK
+		|| st.fssh_st_size < (fssh_off_t)data.synced_records * kRecordSize) {
+		fssh_dprintf("writer %" B_PRId32 ": file has %" B_PRIdOFF " bytes, "
+			"%" B_PRId32 " records were synced\n", data.index,
+			(fssh_off_t)st.fssh_st_size, data.synced_records);
+		errors++;
+	}
+
+	uint8 expected[kRecordSize];
+	uint8 buffer[kRecordSize];
+
+	for (int32 i = 0; i < data.synced_records; i++) {
+		fill_record(expected, data.index, i);
+		if (_kern_read(fd, (fssh_off_t)i * kRecordSize, buffer, kRecordSize)
+				!= (fssh_ssize_t)kRecordSize
+			|| fssh_memcmp(buffer, expected, kRecordSize) != 0) {
+			fssh_dprintf("writer %" B_PRId32 ": synced record %" B_PRId32
+				" is damaged\n", data.index, i);
+			errors++;
+			break;
+		}
+	}
+
+	_kern_close(fd);
+
+	// all synced markers must be there, and no later marker may exist
+	// without all of the ones before it
+	bool missing = false;
+	for (int32 i = 0; i <= data.records / kMarkerInterval; i++) {
+		fssh_snprintf(path, sizeof(path), "%s/m%" B_PRId32 "-%" B_PRId32,
+			kCrashDirectory, data.index, i);
+
+		fssh_struct_stat markerStat;
+		bool exists = _kern_read_stat(-1, path, false, &markerStat,
+			sizeof(markerStat)) == B_OK;
+
+		if (!exists && i < data.synced_markers) {
+			fssh_dprintf("writer %" B_PRId32 ": synced marker %" B_PRId32
+				" is missing\n", data.index, i);
+			errors++;
+		} else if (exists && missing) {
+			fssh_dprintf("writer %" B_PRId32 ": marker %" B_PRId32 " survived "
+				"the crash, but an earlier one did not\n", data.index, i);
+			errors++;
+		}
+
+		if (!exists)
+			missing = true;
+	}
+
+	return errors;
+}
+
+
+static fssh_status_t
+check_crash_image(const char* image, const writer_data* data, int32 writers)
+{
+	fssh_status_t status = _kern_create_dir(-1, kCrashMountPoint, 0755);
+	if (status != B_OK && status != FSSH_B_FILE_EXISTS)
+		return status;
+
+	fssh_dev_t volume = _kern_mount(kCrashMountPoint, image, "bfs", 0, NULL,
+		0);
+	if (volume < 0) {
+		fssh_dprintf("Could not mount the crash image: %s\n",
+			fssh_strerror(volume));
+		return volume;
+	}
+
+	int32 errors = 0;
+	for (int32 i = 0; i < writers; i++)
+		errors += check_writer(data[i]);
+
+	_kern_unmount(kCrashMountPoint, 0);
+	_kern_remove_dir(-1, kCrashMountPoint);
+
+	return errors == 0 ? B_OK : B_ERROR;
+}
+
+
+fssh_status_t
+command_fsynctest(int argc, const char* const* argv)
+{
+	int32 writers = 8;
+	int32 records = 200;
+
+	for (int argi = 1; argi < argc; argi++) {
+		const char* arg = argv[argi];
+
+		if (!strcmp(arg, "-w") && argi + 1 < argc)
+			writers = strtol(argv[++argi], NULL, 0);
+		else if (!strcmp(arg, "-r") && argi + 1 < argc)
+			records = strtol(argv[++argi], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-w <writers>] [-r <records>]\n"
+				"  -w  Number of concurrent writer threads (default 8, at "
+				"most %" B_PRId32 ")\n"
+				"  -r  Number of records every writer syncs (default 200)\n"
+				"The volume must be a plain image file, a copy of it is "
+				"created next to it.\n", argv[0], kMaxWriters);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (writers < 1)
+		writers = 1;
+	else if (writers > kMaxWriters)
+		writers = kMaxWriters;
+	if (records < 1)
+		records = 1;
+
+	fssh_struct_stat st;
+	fssh_status_t status = _kern_read_stat(-1, "/myfs", false, &st,
+		sizeof(st));
+	if (status != B_OK)
+		return status;
+
+	fssh_fs_info info;
+	status = _kern_read_fs_info(st.fssh_st_dev, &info);
+	if (status != B_OK)
+		return status;
+
+	status = _kern_create_dir(-1, kBaseDirectory, 0755);
+	if (status != B_OK && status != FSSH_B_FILE_EXISTS) {
+		fssh_dprintf("Could not create \"%s\": %s\n", kBaseDirectory,
+			fssh_strerror(status));
+		return status;
+	}
+
+	// make sure the directory itself survives the crash
+	_kern_sync();
+
+	writer_data data[kMaxWriters];
+	fssh_thread_id threads[kMaxWriters];
+
+	for (int32 i = 0; i < writers; i++) {
+		data[i].index = i;
+		data[i].records = records;
+		data[i].synced_records = 0;
+		data[i].synced_markers = 0;
+		data[i].status = B_OK;
+
+		threads[i] = spawn_thread(&writer_thread, "fsynctest writer",
+			B_NORMAL_PRIORITY, &data[i]);
+		if (threads[i] >= 0)
+			resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < writers; i++) {
+		if (threads[i] < 0) {
+			status = threads[i];
+			continue;
+		}
+
+		fssh_status_t returnValue;
+		wait_for_thread(threads[i], &returnValue);
+
+		if (data[i].status != B_OK)
+			status = data[i].status;
+	}
+
+	if (status != B_OK) {
+		fssh_dprintf("Writing failed: %s\n", fssh_strerror(status));
+		return status;
+	}
+
+	// "crash" now, and see what is left
+	char crashImage[FSSH_B_PATH_NAME_LENGTH];
+	fssh_snprintf(crashImage, sizeof(crashImage), "%s.fsynctest",
+		info.device_name);
+
+	status = copy_image(info.device_name, crashImage);
+	if (status == B_OK)
+		status = check_crash_image(crashImage, data, writers);
+	else {
+		fssh_dprintf("Could not copy the image to \"%s\": %s\n", crashImage,
+			fssh_strerror(status));
+	}
+
+	fssh_unlink(crashImage);
+
+	if (status != B_OK) {
+		fssh_dprintf("FAILED\n");
+		return status;
+	}
+
+	fssh_dprintf("%" B_PRId32 " writers, %" B_PRId32 " synced records "
+		"each: passed\n", writers, records);
+	return B_OK;
+}
+
+
+}	// namespace FSShell
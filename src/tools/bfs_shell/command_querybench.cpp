@@ -0,0 +1,254 @@
+/*
+ * Copyright 2013, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A simple query benchmark: it can create a synthetic data set of files
+	with varying names, sizes, modification times, and an indexed custom
+	attribute, and then measures how long a number of queries take.
+*/
+
+
+#include "fssh_stdio.h"
+#include "syscalls.h"
+
+#include "bfs.h"
+
+
+namespace FSShell {
+
+
+static const char* const kBaseDirectory = "/myfs/querybench";
+static const char* const kAttribute = "QueryBench:project";
+static const int32 kFilesPerDirectory = 1000;
+static const int32 kProjects = 100;
+static const fssh_time_t kBaseTime = 1000000000;
+	// the last_modified of the first file
+
+static const char* const kExtensions[] = {
+	"cpp", "h", "txt", "png", "html", "o", "jpg", "c", "mp3", "rdef"
+};
+static const int32 kExtensionCount
+	= sizeof(kExtensions) / sizeof(kExtensions[0]);
+
+
+static fssh_status_t
+create_file(int directory, int32 index)
+{
+	char name[64];
+	fssh_snprintf(name, sizeof(name), "f%" B_PRId32 ".%s", index,
+		kExtensions[index % kExtensionCount]);
+
+	int fd = _kern_open(directory, name, FSSH_O_CREAT | FSSH_O_WRONLY, 0644);
+	if (fd < 0)
+		return fd;
+
+	// About 2% of the files are large, the rest is small
+	fssh_struct_stat st;
+	fssh_memset(&st, 0, sizeof(st));
+	st.fssh_st_size = index % 50 == 7 ? 131072 : (index * 37) % 4096;
+	st.fssh_st_mtim.tv_sec = kBaseTime + index;
+
+	fssh_status_t status = _kern_write_stat(fd, NULL, false, &st, sizeof(st),
+		FSSH_B_STAT_SIZE | FSSH_B_STAT_MODIFICATION_TIME);
+	if (status == B_OK) {
+		int attribute = _kern_create_attr(fd, kAttribute, FSSH_B_INT32_TYPE,
+			FSSH_O_WRONLY | FSSH_O_TRUNC);
+		if (attribute >= 0) {
+			int32 project = index % kProjects;
+			if (_kern_write(attribute, 0, &project, sizeof(project))
+					!= sizeof(project))
+				status = B_IO_ERROR;
+			_kern_close(attribute);
+		} else
+			status = attribute;
+	}
+
+	_kern_close(fd);
+	return status;
+}
+
+
+static fssh_status_t
+create_files(fssh_dev_t volume, int32 count)
+{
+	fssh_status_t status = _kern_create_index(volume, kAttribute,
+		FSSH_B_INT32_TYPE, 0);
+	if (status != B_OK && status != FSSH_B_FILE_EXISTS) {
+		fssh_dprintf("Could not create index \"%s\": %s\n", kAttribute,
+			fssh_strerror(status));
+		return status;
+	}
+
+	status = _kern_create_dir(-1, kBaseDirectory, 0755);
+	if (status != B_OK && status != FSSH_B_FILE_EXISTS)
+		return status;
+
+	fssh_bigtime_t startTime = fssh_system_time();
+
+	for (int32 index = 0; index < count; index += kFilesPerDirectory) {
+		char path[FSSH_B_PATH_NAME_LENGTH];
+		fssh_snprintf(path, sizeof(path), "%s/d%" B_PRId32, kBaseDirectory,
+			index / kFilesPerDirectory);
+
+		status = _kern_create_dir(-1, path, 0755);
+		if (status != B_OK && status != FSSH_B_FILE_EXISTS)
+			return status;
+
+		int directory = _kern_open_dir(-1, path);
+		if (directory < 0)
+			return directory;
+
+		for (int32 i = index; i < count && i < index + kFilesPerDirectory;
+				i++) {
+			status = create_file(directory, i);
+			if (status != B_OK) {
+				fssh_dprintf("Could not create file %" B_PRId32 ": %s\n", i,
+					fssh_strerror(status));
+				_kern_close(directory);
+				return status;
+			}
+		}
+
+		_kern_close(directory);
+
+		if ((index / kFilesPerDirectory) % 10 == 0) {
+			fssh_dprintf("%9" B_PRId32 " files created\x1b[1A\n",
+				index + kFilesPerDirectory);
+		}
+	}
+
+	_kern_sync();
+
+	fssh_dprintf("%" B_PRId32 " files created in %g s\n", count,
+		(fssh_system_time() - startTime) / 1000000.0);
+	return B_OK;
+}
+
+
+static fssh_status_t
+run_query(fssh_dev_t volume, const char* query, int32 iterations)
+{
+	char buffer[sizeof(fssh_dirent) + FSSH_B_FILE_NAME_LENGTH];
+	fssh_dirent* entry = (fssh_dirent*)buffer;
+	fssh_bigtime_t totalTime = 0;
+	fssh_bigtime_t minTime = -1;
+	int64 entries = 0;
+
+	for (int32 i = 0; i < iterations; i++) {
+		fssh_bigtime_t startTime = fssh_system_time();
+
+		int fd = _kern_open_query(volume, query, fssh_strlen(query), 0, -1,
+			-1);
+		if (fd < 0) {
+			fssh_dprintf("Failed to open query \"%s\": %s\n", query,
+				fssh_strerror(fd));
+			return fd;
+		}
+
+		entries = 0;
+		while (_kern_read_dir(fd, entry, sizeof(buffer), 1) == 1)
+			entries++;
+
+		_kern_close(fd);
+
+		fssh_bigtime_t time = fssh_system_time() - startTime;
+		totalTime += time;
+		if (minTime < 0 || time < minTime)
+			minTime = time;
+	}
+
+	fssh_dprintf("%10" B_PRId64 " %12" B_PRId64 " %12" B_PRId64 "  %s\n",
+		entries, minTime, totalTime / iterations, query);
+	return B_OK;
+}
+
+
+fssh_status_t
+command_querybench(int argc, const char* const* argv)
+{
+	int32 createCount = 0;
+	int32 iterations = 3;
+
+	int argi = 1;
+	for (; argi < argc; argi++) {
+		const char* arg = argv[argi];
+		if (arg[0] != '-')
+			break;
+
+		if (!strcmp(arg, "-c") && argi + 1 < argc)
+			createCount = strtol(argv[++argi], NULL, 0);
+		else if (!strcmp(arg, "-i") && argi + 1 < argc)
+			iterations = strtol(argv[++argi], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-c <files>] [-i <iterations>] "
+				"[<query> ...]\n"
+				"  -c  First create a synthetic data set with the given "
+				"number of files\n"
+				"      (1000000 files need a volume of about 4 GB)\n"
+				"  -i  Run each query the given number of times (default 3)"
+				"\n", argv[0]);
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (iterations < 1)
+		iterations = 1;
+
+	struct fssh_stat st;
+	fssh_status_t status = _kern_read_stat(-1, "/myfs", false, &st,
+		sizeof(st));
+	if (status != B_OK)
+		return status;
+
+	fssh_dev_t volume = st.fssh_st_dev;
+
+	if (createCount > 0) {
+		status = create_files(volume, createCount);
+		if (status != B_OK)
+			return status;
+	}
+
+	fssh_dprintf("%10s %12s %12s  %s\n", "entries", "min (us)", "avg (us)",
+		"query");
+
+	if (argi < argc) {
+		for (; argi < argc; argi++) {
+			status = run_query(volume, argv[argi], iterations);
+			if (status != B_OK)
+				return status;
+		}
+		return B_OK;
+	}
+
+	// Some queries that combine the indices of the data set in different
+	// ways
+	char lastModified[64];
+	fssh_snprintf(lastModified, sizeof(lastModified), "%" B_PRId64,
+		(int64)kBaseTime + 900000);
+
+	char queries[5][256];
+	fssh_snprintf(queries[0], sizeof(queries[0]),
+		"(name==\"*.cpp\")&&(size>100000)");
+	fssh_snprintf(queries[1], sizeof(queries[1]),
+		"(name==\"*.cpp\")&&(size>100000)&&(last_modified>%s)",
+		lastModified);
+	fssh_snprintf(queries[2], sizeof(queries[2]),
+		"(%s==42)&&(size>100000)", kAttribute);
+	fssh_snprintf(queries[3], sizeof(queries[3]),
+		"((name==\"*.h\")||(name==\"*.c\"))&&(%s<10)", kAttribute);
+	fssh_snprintf(queries[4], sizeof(queries[4]),
+		"(name==\"f4711.*\")&&(size>=0)");
+
+	for (int32 i = 0; i < 5; i++) {
+		status = run_query(volume, queries[i], iterations);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+}	// namespace FSShell